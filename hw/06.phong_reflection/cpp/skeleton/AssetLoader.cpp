@@ -0,0 +1,199 @@
+#include "AssetLoader.h"
+
+#include <chrono>
+#include <sstream>
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* to_string(AssetLoadState state)
+{
+    switch (state)
+    {
+    case kAssetQueued:      return "queued";
+    case kAssetImporting:   return "importing";
+    case kAssetUploading:   return "uploading";
+    case kAssetLoaded:      return "loaded";
+    case kAssetFailed:      return "failed";
+    }
+    return "";
+}
+
+AssetLoader::AssetLoader(unsigned int num_threads) : pool_(num_threads)
+{
+}
+
+std::size_t AssetLoader::add(const std::string& path, unsigned int process_flags, const Model& settings)
+{
+    std::size_t slot_index = slots_.size();
+    slots_.push_back(std::unique_ptr<Slot>(new Slot));
+
+    Slot* slot = slots_.back().get();
+    slot->path = path;
+    slot->model = settings;
+    slot->state = kAssetQueued;
+
+    // the same file with the same options: wait for the asset of the earlier slot
+    AssetSourceKey source_key;
+    if (AssetRegistry::make_source_key(path, process_flags, settings, source_key))
+    {
+        std::map<AssetSourceKey, std::size_t>::const_iterator source = sources_.find(source_key);
+        if (source != sources_.end() && is_source_alive_(source->second))
+        {
+            slot->is_shared = true;
+            slot->source_slot = source->second;
+            slot->model.set_name(path);
+            return slot_index;
+        }
+        sources_[source_key] = slot_index;
+    }
+
+    slot->import = pool_.submit([slot, process_flags]() {
+        slot->state = kAssetImporting;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::ostringstream log;
+        bool ok = slot->model.import_model(slot->path, process_flags, log);
+
+        // the content key, from the hash the mesh cache lookup took (no second read)
+        MeshCacheKey cache_key;
+        slot->has_key = ok && slot->model.source_key(cache_key);
+        if (slot->has_key)
+            slot->key = AssetRegistry::make_key(cache_key);
+        slot->log = log.str();
+        slot->import_ms = elapsed_ms(start);
+        return ok;
+    });
+    return slot_index;
+}
+
+std::vector<std::size_t> AssetLoader::update(std::size_t byte_budget)
+{
+    std::vector<std::size_t> completed;
+    last_update_bytes_ = 0;
+
+    for (std::size_t i = 0; i < slots_.size(); ++i)
+    {
+        Slot& slot = *slots_[i];
+
+        // a shared slot completes in the update() that uploads its asset, without a budget
+        if (slot.is_shared)
+        {
+            if (slot.state != kAssetQueued)
+                continue;
+
+            std::shared_ptr<ModelAsset> asset = slots_[slot.source_slot]->asset.lock();
+            if (asset)
+            {
+                slot.model.set_asset(asset);
+                slot.asset = asset;
+                slot.state = kAssetUploading;
+                completed.push_back(i);
+            }
+            else if (state(slot.source_slot) == kAssetFailed || state(slot.source_slot) == kAssetLoaded)
+            {
+                std::cout << "Failed to load a asset file: " << slot.path << " (the model it shares did not load)" << std::endl;
+                slot.state = kAssetFailed;
+            }
+            continue;
+        }
+
+        // the worker is done once the future is ready (its state still says importing)
+        if (slot.state == kAssetImporting || slot.state == kAssetQueued)
+        {
+            if (slot.import.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                continue;
+
+            if (!slot.import.get())
+            {
+                std::cout << slot.log << "Failed to load a asset file: " << slot.path << std::endl;
+                slot.state = kAssetFailed;
+                continue;
+            }
+            std::cout << slot.log << "imported " << slot.path << " in " << slot.import_ms << " ms ("
+                      << (slot.model.is_cache_hit() ? "mesh cache" : "import") << ")" << std::endl;
+
+            // the contents of another path: its asset instead of a second upload
+            if (slot.has_key)
+            {
+                std::shared_ptr<ModelAsset> asset = registry_.find(slot.key);
+                std::map<AssetKey, std::size_t>::const_iterator source = importing_.find(slot.key);
+                if (asset)
+                {
+                    slot.is_shared = true;
+                    slot.model.set_asset(asset);
+                    slot.asset = asset;
+                    slot.state = kAssetUploading;
+                    completed.push_back(i);
+                    continue;
+                }
+                if (source != importing_.end())
+                {
+                    slot.is_shared = true;
+                    slot.source_slot = source->second;
+                    slot.state = kAssetQueued;
+                    continue;
+                }
+                importing_[slot.key] = i;
+            }
+            slot.upload_bytes = slot.model.pending_upload_bytes();
+            slot.state = kAssetUploading;
+        }
+
+        if (slot.state != kAssetUploading || last_update_bytes_ >= byte_budget)
+            continue;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::size_t n = slot.model.upload_model(byte_budget - last_update_bytes_);
+        slot.upload_ms += elapsed_ms(start);
+        slot.uploaded_bytes += n;
+        last_update_bytes_ += n;
+
+        if (slot.model.is_uploaded())
+        {
+            // the later slots of the key pick the asset up from here (in this very update())
+            slot.asset = slot.model.asset();
+            if (slot.has_key)
+            {
+                registry_.insert(slot.key, slot.model.asset());
+                importing_.erase(slot.key);
+            }
+            completed.push_back(i);
+        }
+    }
+    return completed;
+}
+
+Model AssetLoader::take_model(std::size_t slot_index)
+{
+    Slot& slot = *slots_[slot_index];
+    slot.state = kAssetLoaded;
+    return std::move(slot.model);
+}
+
+float AssetLoader::upload_progress(std::size_t slot_index) const
+{
+    const Slot& slot = *slots_[slot_index];
+    if (slot.state == kAssetLoaded)
+        return 1.0f;
+    return slot.upload_bytes > 0 ? (float) slot.uploaded_bytes / slot.upload_bytes : 0.0f;
+}
+
+bool AssetLoader::is_source_alive_(std::size_t slot_index) const
+{
+    // a loaded slot's asset is gone with the last Model holding it
+    AssetLoadState source_state = state(slot_index);
+    return source_state != kAssetFailed && !(source_state == kAssetLoaded && slots_[slot_index]->asset.expired());
+}
+
+bool AssetLoader::is_busy() const
+{
+    for (std::size_t i = 0; i < slots_.size(); ++i)
+    {
+        if (state(i) != kAssetLoaded && state(i) != kAssetFailed)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AssetRegistry.h"
+#include "Model.h"
+#include "ThreadPool.h"
+
+enum AssetLoadState
+{
+    kAssetQueued,       // waiting for a worker
+    kAssetImporting,    // Model::import_model() on a worker
+    kAssetUploading,    // Model::upload_model() on the GL thread, a budget per update()
+    kAssetLoaded,       // taken over by take_model()
+    kAssetFailed
+};
+
+const char* to_string(AssetLoadState state);
+
+// streams models in while the application keeps rendering: the imports run on a
+// ThreadPool, and update() (once per frame, GL thread) uploads the imported models
+// within a byte budget per call, so no single frame pays for a whole model.
+// a model with the AssetSourceKey of one added before is not imported again, and one whose
+// import turns out to have the AssetKey of another (the same contents under another path) is
+// not uploaded again: its slot gets a handle to the same ModelAsset once that is uploaded
+class AssetLoader
+{
+public:
+    explicit AssetLoader(unsigned int num_threads = 0);
+
+    // queue path for import; returns the slot of the model. the model starts as a copy of
+    // settings, so its options (import_flags, draw_type, use_mesh_cache, ...) apply.
+    // (a stat() of the file: its contents are hashed on the worker that imports it)
+    std::size_t add(const std::string& path, unsigned int process_flags, const Model& settings = Model());
+
+    // upload up to byte_budget bytes of imported models (oldest slot first).
+    // returns the slots whose upload completed in this call; take_model() them.
+    std::vector<std::size_t> update(std::size_t byte_budget);
+
+    // the fully uploaded model of a slot returned by update() (once)
+    Model take_model(std::size_t slot);
+
+    std::size_t num_slots() const                       { return slots_.size(); }
+    AssetLoadState state(std::size_t slot) const        { return (AssetLoadState) slots_[slot]->state.load(); }
+    const std::string& path(std::size_t slot) const     { return slots_[slot]->path; }
+    float upload_progress(std::size_t slot) const;      // [0, 1] of the GPU bytes
+    double import_ms(std::size_t slot) const            { return slots_[slot]->import_ms; }
+    double upload_ms(std::size_t slot) const            { return slots_[slot]->upload_ms; }
+    bool is_shared(std::size_t slot) const              { return slots_[slot]->is_shared; }  // took the asset of another slot
+    const AssetRegistry& registry() const               { return registry_; }
+
+    bool is_busy() const;       // a slot is neither loaded nor failed
+    std::size_t last_update_bytes() const               { return last_update_bytes_; }
+
+private:
+    struct Slot
+    {
+        std::string         path;
+        Model               model;
+        std::string         log;                // of the import, printed when the upload starts
+        std::atomic<int>    state;
+        std::future<bool>   import;
+        std::size_t         upload_bytes = 0;   // total
+        std::size_t         uploaded_bytes = 0;
+        double              import_ms = 0.0;
+        double              upload_ms = 0.0;    // GL time spent, summed over the frames
+
+        AssetKey            key;                // set by the import (worker)
+        bool                has_key = false;    // false: the file could not be hashed
+        bool                is_shared = false;
+        std::size_t         source_slot = SIZE_MAX; // of a shared slot: the slot whose asset it takes
+        std::weak_ptr<ModelAsset>   asset;      // once uploaded, for the slots sharing it
+    };
+
+    // a slot whose asset a new slot of the same source key can still share
+    bool is_source_alive_(std::size_t slot) const;
+
+    // the slots must outlive the workers that write them (destroyed after pool_)
+    std::vector<std::unique_ptr<Slot> > slots_;
+    AssetRegistry                       registry_;
+    std::map<AssetSourceKey, std::size_t>   sources_;   // slot importing each source key
+    std::map<AssetKey, std::size_t>     importing_;     // slot uploading each key, until done
+    ThreadPool                          pool_;
+    std::size_t                         last_update_bytes_ = 0;
+};
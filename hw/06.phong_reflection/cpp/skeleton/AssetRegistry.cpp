@@ -0,0 +1,90 @@
+#include "AssetRegistry.h"
+
+#include "MappedFile.h"
+
+bool AssetKey::operator<(const AssetKey& k) const
+{
+    if (source_size != k.source_size)       return source_size < k.source_size;
+    if (source_hash != k.source_hash)       return source_hash < k.source_hash;
+    if (material_hash != k.material_hash)   return material_hash < k.material_hash;
+    if (process_flags != k.process_flags)   return process_flags < k.process_flags;
+    if (import_flags != k.import_flags)     return import_flags < k.import_flags;
+    if (draw_type != k.draw_type)           return draw_type < k.draw_type;
+    return precision < k.precision;
+}
+
+bool AssetSourceKey::operator<(const AssetSourceKey& k) const
+{
+    if (path != k.path)                     return path < k.path;
+    if (size != k.size)                     return size < k.size;
+    if (mtime != k.mtime)                   return mtime < k.mtime;
+    if (process_flags != k.process_flags)   return process_flags < k.process_flags;
+    if (import_flags != k.import_flags)     return import_flags < k.import_flags;
+    if (draw_type != k.draw_type)           return draw_type < k.draw_type;
+    return precision < k.precision;
+}
+
+bool AssetRegistry::make_source_key(const std::string& path, unsigned int process_flags, const Model& settings, AssetSourceKey& key)
+{
+    if (!stat_file(path, key.size, key.mtime))
+        return false;
+
+    key.path = path;
+    key.process_flags = process_flags;
+    key.import_flags = settings.effective_import_flags(path);
+    key.draw_type = settings.draw_type;
+    key.precision = settings.vertex_precision;
+    return true;
+}
+
+AssetKey AssetRegistry::make_key(const MeshCacheKey& cache_key)
+{
+    AssetKey key;
+    key.source_size = cache_key.source_size;
+    key.source_hash = cache_key.source_hash;
+    key.material_hash = cache_key.material_hash;
+    key.process_flags = cache_key.process_flags;
+    key.import_flags = cache_key.import_flags;
+    key.draw_type = cache_key.draw_type;
+    key.precision = cache_key.precision;
+    return key;
+}
+
+std::shared_ptr<ModelAsset> AssetRegistry::find(const AssetKey& key) const
+{
+    std::map<AssetKey, std::weak_ptr<ModelAsset> >::const_iterator it = assets_.find(key);
+    return (it != assets_.end()) ? it->second.lock() : std::shared_ptr<ModelAsset>();
+}
+
+std::shared_ptr<ModelAsset> AssetRegistry::insert(const AssetKey& key, const std::shared_ptr<ModelAsset>& asset)
+{
+    std::weak_ptr<ModelAsset>& entry = assets_[key];
+    std::shared_ptr<ModelAsset> alive = entry.lock();
+    if (alive)
+        return alive;
+
+    entry = asset;
+    return asset;
+}
+
+std::size_t AssetRegistry::num_assets() const
+{
+    std::size_t count = 0;
+    for (std::map<AssetKey, std::weak_ptr<ModelAsset> >::const_iterator it = assets_.begin(); it != assets_.end(); ++it)
+        count += !it->second.expired();
+    return count;
+}
+
+std::size_t AssetRegistry::gpu_bytes() const
+{
+    std::size_t bytes = 0;
+    for (std::map<AssetKey, std::weak_ptr<ModelAsset> >::const_iterator it = assets_.begin(); it != assets_.end(); ++it)
+    {
+        std::shared_ptr<ModelAsset> asset = it->second.lock();
+        if (!asset)
+            continue;
+        for (std::size_t i = 0; i < asset->meshes.size(); ++i)
+            bytes += asset->meshes[i].gpu_bytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "MeshCache.h"
+#include "Model.h"
+
+// content address of an imported model: the source bytes (size and hash, not the path or the
+// mtime, so two copies of a file are one asset) and every setting the meshes depend on
+struct AssetKey
+{
+    uint64_t    source_size = 0;
+    uint64_t    source_hash = 0;
+    uint64_t    material_hash = 0;      // MeshCacheKey::material_hash
+    uint32_t    process_flags = 0;      // MeshProcess bits
+    uint32_t    import_flags = 0;       // Model::effective_import_flags()
+    uint32_t    draw_type = 0;
+    uint32_t    precision = 0;
+
+    bool operator<(const AssetKey& k) const;
+};
+
+// what can be told of a model without reading its file: the path, its size and mtime, and the
+// same settings as AssetKey. models with the same source key are the same asset (and models
+// with different ones may still be, which only AssetKey finds out)
+struct AssetSourceKey
+{
+    std::string path;
+    uint64_t    size = 0;
+    int64_t     mtime = 0;
+    uint32_t    process_flags = 0;
+    uint32_t    import_flags = 0;
+    uint32_t    draw_type = 0;
+    uint32_t    precision = 0;
+
+    bool operator<(const AssetSourceKey& k) const;
+};
+
+// the ModelAssets of the scene by AssetKey. the registry only holds weak references: the
+// Models are the handles, and an asset (with its GL buffers) is gone when its last Model is.
+// GL thread only, like the uploads that fill the assets
+class AssetRegistry
+{
+public:
+    // the source key of path imported by a Model with the options of settings: a stat() of
+    // the file, cheap enough for the GL thread. false if the file does not exist
+    static bool make_source_key(const std::string& path, unsigned int process_flags, const Model& settings, AssetSourceKey& key);
+
+    // the key of the import that made cache_key (Model::source_key(), on the worker that hashed
+    // the file): the mtime is left out, so two copies of a file are one asset
+    static AssetKey make_key(const MeshCacheKey& cache_key);
+
+    // the asset of key, or NULL if there is none (any more)
+    std::shared_ptr<ModelAsset> find(const AssetKey& key) const;
+
+    // register an uploaded asset under key; an asset already alive under key wins and is
+    // returned instead (the caller then drops its own)
+    std::shared_ptr<ModelAsset> insert(const AssetKey& key, const std::shared_ptr<ModelAsset>& asset);
+
+    std::size_t num_assets() const;     // alive
+    std::size_t gpu_bytes() const;      // of the assets alive, each counted once
+
+private:
+    std::map<AssetKey, std::weak_ptr<ModelAsset> >      assets_;
+};
@@ -0,0 +1,700 @@
+#include "ChunkFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "PlyReader.h"
+
+static const char kChunkFileMagic[8] = { 'M', 'E', 'S', 'H', 'C', 'H', 'N', 'K' };
+
+static const std::size_t kChunkFileAlignment = 16;
+
+namespace
+{
+
+std::size_t align_up(std::size_t n)
+{
+    return (n + kChunkFileAlignment - 1) & ~(kChunkFileAlignment - 1);
+}
+
+// fseek() takes a long, which is 32 bits on Windows
+bool seek_file(FILE* file, uint64_t offset)
+{
+#if defined(_WIN32)
+    return _fseeki64(file, (__int64) offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t) offset, SEEK_SET) == 0;
+#endif
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// append-only byte buckets (one per chunk) staged in a temporary file: each bucket collects
+// into a small buffer, and a full buffer goes to the end of the file as a block of that bucket
+class SpillFile
+{
+public:
+    SpillFile() {}
+    ~SpillFile()    { close(); }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    bool open(const std::string& path, std::size_t num_buckets, std::size_t buffer_bytes);
+    void close();       // and removes the file
+
+    bool append(std::size_t bucket, const void* data, std::size_t size);
+    bool flush();       // every buffer to the file (and freed); read() needs it first
+    bool read(std::size_t bucket, std::vector<unsigned char>& data);
+
+private:
+    struct Block
+    {
+        uint64_t    offset;
+        std::size_t size;
+    };
+
+    bool write_(std::size_t bucket);
+
+    std::string                                 path_;
+    FILE*                                       file_ = NULL;
+    uint64_t                                    file_size_ = 0;
+    std::size_t                                 buffer_bytes_ = 0;
+    std::vector<std::vector<unsigned char> >    buffers_;
+    std::vector<std::vector<Block> >            blocks_;
+};
+
+bool SpillFile::open(const std::string& path, std::size_t num_buckets, std::size_t buffer_bytes)
+{
+    close();
+    file_ = fopen(path.c_str(), "w+b");
+    if (file_ == NULL)
+        return false;
+
+    path_ = path;
+    buffer_bytes_ = buffer_bytes;
+    buffers_.resize(num_buckets);
+    blocks_.resize(num_buckets);
+    return true;
+}
+
+void SpillFile::close()
+{
+    if (file_ == NULL)
+        return;
+    fclose(file_);
+    remove(path_.c_str());
+    file_ = NULL;
+    file_size_ = 0;
+    buffers_.clear();
+    blocks_.clear();
+}
+
+bool SpillFile::append(std::size_t bucket, const void* data, std::size_t size)
+{
+    std::vector<unsigned char>& buffer = buffers_[bucket];
+    if (buffer.capacity() == 0)
+        buffer.reserve(buffer_bytes_);
+    if (buffer.size() + size > buffer_bytes_ && !write_(bucket))
+        return false;
+    buffer.insert(buffer.end(), (const unsigned char*) data, (const unsigned char*) data + size);
+    return true;
+}
+
+bool SpillFile::write_(std::size_t bucket)
+{
+    std::vector<unsigned char>& buffer = buffers_[bucket];
+    if (buffer.empty())
+        return true;
+
+    // a read() may have moved the position
+    if (!seek_file(file_, file_size_) || fwrite(buffer.data(), 1, buffer.size(), file_) != buffer.size())
+        return false;
+
+    Block block = { file_size_, buffer.size() };
+    blocks_[bucket].push_back(block);
+    file_size_ += buffer.size();
+    buffer.clear();
+    return true;
+}
+
+bool SpillFile::flush()
+{
+    for (std::size_t b = 0; b < buffers_.size(); ++b)
+    {
+        if (!write_(b))
+            return false;
+        std::vector<unsigned char>().swap(buffers_[b]);
+    }
+    return fflush(file_) == 0;
+}
+
+bool SpillFile::read(std::size_t bucket, std::vector<unsigned char>& data)
+{
+    const std::vector<Block>& blocks = blocks_[bucket];
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+        size += blocks[i].size;
+
+    data.resize(size);
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < blocks.size(); ++i)
+    {
+        if (!seek_file(file_, blocks[i].offset) || fread(&data[offset], 1, blocks[i].size, file_) != blocks[i].size)
+            return false;
+        offset += blocks[i].size;
+    }
+    return true;
+}
+
+// a box of cells of the vertex histogram, and the vertices in it
+struct CellBox
+{
+    int         lo[3];
+    int         hi[3];
+    uint64_t    count;
+};
+
+// k-d tree over the histogram: a box with more than max_vertices is split along its longest
+// side where half of its vertices are below; the leaves are the chunks
+void split_cells(const std::vector<uint32_t>& histogram, const int dims[3], const CellBox& box, uint64_t max_vertices, std::vector<CellBox>& leaves)
+{
+    int axis = -1;
+    for (int a = 0; a < 3; ++a)
+    {
+        if (box.hi[a] - box.lo[a] > 1 && (axis < 0 || box.hi[a] - box.lo[a] > box.hi[axis] - box.lo[axis]))
+            axis = a;
+    }
+    // a single cell over the limit stays one (larger) chunk
+    if (box.count <= max_vertices || axis < 0)
+    {
+        if (box.count > 0)
+            leaves.push_back(box);
+        return;
+    }
+
+    std::vector<uint64_t> slices(box.hi[axis] - box.lo[axis], 0);
+    for (int z = box.lo[2]; z < box.hi[2]; ++z)
+        for (int y = box.lo[1]; y < box.hi[1]; ++y)
+            for (int x = box.lo[0]; x < box.hi[0]; ++x)
+            {
+                int cell[3] = { x, y, z };
+                slices[cell[axis] - box.lo[axis]] += histogram[((std::size_t) z * dims[1] + y) * dims[0] + x];
+            }
+
+    // the first slice where the lower half reaches half of the vertices (both halves keep one slice at least)
+    std::size_t split = 1;
+    uint64_t below = slices[0];
+    while (split + 1 < slices.size() && 2 * below < box.count)
+        below += slices[split++];
+
+    CellBox lower = box, upper = box;
+    lower.hi[axis] = upper.lo[axis] = box.lo[axis] + (int) split;
+    lower.count = below;
+    upper.count = box.count - below;
+    split_cells(histogram, dims, lower, max_vertices, leaves);
+    split_cells(histogram, dims, upper, max_vertices, leaves);
+}
+
+// the histogram cell of a position
+struct CellGrid
+{
+    glm::vec3   origin;
+    float       inv_cell_size;
+    int         dims[3];
+
+    std::size_t cell(const glm::vec3& p) const
+    {
+        int c[3];
+        for (int a = 0; a < 3; ++a)
+            c[a] = std::min(std::max((int) ((p[a] - origin[a]) * inv_cell_size), 0), dims[a] - 1);
+        return ((std::size_t) c[2] * dims[1] + c[1]) * dims[0] + c[0];
+    }
+};
+
+// the source index a vertex spill record starts with
+uint32_t record_id(const unsigned char* record)
+{
+    uint32_t v;
+    memcpy(&v, record, sizeof(v));
+    return v;
+}
+
+const int kHistogramResolution = 128;   // cells along the longest side of the bounds
+
+} // namespace
+
+uint32_t chunk_file_layout()
+{
+    // also catches a reader with the other byte order: the sizes end up in different bytes
+    uint32_t layout = (uint32_t) hash_bytes(NULL, 0);
+    const uint32_t sizes[] = {
+        (uint32_t) sizeof(ChunkFileHeader), (uint32_t) sizeof(ChunkRecord),
+        (uint32_t) sizeof(glm::vec3), (uint32_t) sizeof(glm::vec4), (uint32_t) sizeof(unsigned int),
+    };
+    return (uint32_t) hash_bytes(sizes, sizeof(sizes), layout);
+}
+
+bool make_chunk_file_key(const std::string& source_path, const ChunkBuildOptions& options, ChunkFileKey& key)
+{
+    if (!stat_file(source_path, key.source_size, key.source_mtime))
+        return false;
+    key.chunk_triangles = (uint32_t) options.chunk_triangles;
+    return true;
+}
+
+uint64_t chunk_data_size(uint32_t num_vertices, uint32_t num_triangles, uint32_t flags)
+{
+    uint64_t vertex_size = sizeof(glm::vec3);
+    if (flags & kChunkHasNormals)
+        vertex_size += sizeof(glm::vec3);
+    if (flags & kChunkHasColors)
+        vertex_size += sizeof(glm::vec4);
+    return vertex_size * num_vertices + 3 * sizeof(unsigned int) * (uint64_t) num_triangles;
+}
+
+bool build_chunk_file(const std::string& source_path, const std::string& chunk_path, const ChunkBuildOptions& options, std::ostream& log, std::string* error)
+{
+    std::string message;
+    bool ok = false;
+    std::string tmp_path = chunk_path + ".tmp";
+    FILE* out = NULL;
+    SpillFile vertex_spill, triangle_spill, export_spill, foreign_spill;
+
+    // the passes below leave with "break" and message set on the first failure
+    do
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ChunkFileKey key;
+        PlyStream ply;
+        if (!make_chunk_file_key(source_path, options, key) || !ply.open(source_path, options.window_bytes))
+        {
+            message = ply.error().empty() ? "cannot open " + source_path : ply.error();
+            break;
+        }
+
+        const std::size_t num_vertices = ply.num_vertices();
+        const std::size_t batch = std::max<std::size_t>(options.window_bytes / 64, 1024);
+        uint32_t flags = (ply.has_normals() ? kChunkHasNormals : 0) | (ply.has_colors() ? kChunkHasColors : 0);
+        if (num_vertices > 0xffffffffu)
+        {
+            message = source_path + ": more than 2^32 vertices";
+            break;
+        }
+
+        // pass 1: bounds
+        MeshArrays arrays;
+        glm::vec3 aabb_min(FLT_MAX), aabb_max(-FLT_MAX);
+        std::size_t count;
+        while ((count = ply.read_vertices(batch, arrays)) > 0)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                aabb_min = glm::min(aabb_min, arrays.positions[i]);
+                aabb_max = glm::max(aabb_max, arrays.positions[i]);
+            }
+        }
+        if (!ply.error().empty() || num_vertices == 0)
+        {
+            message = ply.error().empty() ? source_path + ": no vertices" : ply.error();
+            break;
+        }
+        log << "chunks: " << num_vertices << " vertices, " << ply.num_faces() << " faces; bounds in " << elapsed_ms(start) << " ms" << std::endl;
+
+        // pass 2: vertex histogram on cubic cells
+        CellGrid grid;
+        glm::vec3 extent = aabb_max - aabb_min;
+        float longest = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+        grid.origin = aabb_min;
+        grid.inv_cell_size = kHistogramResolution / longest;
+        for (int a = 0; a < 3; ++a)
+            grid.dims[a] = std::max(1, std::min(kHistogramResolution, (int) std::ceil(extent[a] * grid.inv_cell_size)));
+
+        std::vector<uint32_t> histogram((std::size_t) grid.dims[0] * grid.dims[1] * grid.dims[2], 0);
+        ply.rewind();
+        while ((count = ply.read_vertices(batch, arrays)) > 0)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                ++histogram[grid.cell(arrays.positions[i])];
+        }
+
+        // the chunks: about two triangles per vertex on a closed surface
+        CellBox root = { { 0, 0, 0 }, { grid.dims[0], grid.dims[1], grid.dims[2] }, num_vertices };
+        std::vector<CellBox> leaves;
+        split_cells(histogram, grid.dims, root, std::max<uint64_t>(options.chunk_triangles / 2, 1), leaves);
+        if (leaves.size() > 0xffff)
+        {
+            message = source_path + ": " + std::to_string(leaves.size()) + " chunks (at most 65535, raise chunk_triangles)";
+            break;
+        }
+        const std::size_t num_chunks = leaves.size();
+
+        std::vector<uint16_t> cell_chunk(histogram.size(), 0);
+        for (std::size_t c = 0; c < num_chunks; ++c)
+        {
+            const CellBox& box = leaves[c];
+            for (int z = box.lo[2]; z < box.hi[2]; ++z)
+                for (int y = box.lo[1]; y < box.hi[1]; ++y)
+                    for (int x = box.lo[0]; x < box.hi[0]; ++x)
+                        cell_chunk[((std::size_t) z * grid.dims[1] + y) * grid.dims[0] + x] = (uint16_t) c;
+        }
+        std::vector<uint32_t>().swap(histogram);
+        log << "chunks: " << num_chunks << " chunks from a " << grid.dims[0] << "x" << grid.dims[1] << "x" << grid.dims[2]
+            << " histogram in " << elapsed_ms(start) << " ms" << std::endl;
+
+        // spill record of a vertex: source index, position, normal, color
+        const std::size_t record_size = sizeof(uint32_t) + (std::size_t) chunk_data_size(1, 0, flags);
+        std::size_t buffer_bytes = std::min<std::size_t>(std::max<std::size_t>(options.spill_bytes / (3 * num_chunks), 4 << 10), 1 << 20);
+        if (!vertex_spill.open(chunk_path + ".vertices.tmp", num_chunks, buffer_bytes)
+            || !triangle_spill.open(chunk_path + ".triangles.tmp", num_chunks, buffer_bytes)
+            || !export_spill.open(chunk_path + ".exports.tmp", num_chunks, buffer_bytes))
+        {
+            message = "cannot write next to " + chunk_path;
+            break;
+        }
+
+        // pass 3: the vertices to the chunk of their cell
+        std::vector<uint16_t> vertex_chunk(num_vertices);
+        std::vector<unsigned char> record(record_size);
+        std::size_t first = 0;
+        bool is_written = true;
+        ply.rewind();
+        while (is_written && (count = ply.read_vertices(batch, arrays)) > 0)
+        {
+            for (std::size_t i = 0; i < count && is_written; ++i)
+            {
+                uint16_t c = cell_chunk[grid.cell(arrays.positions[i])];
+                vertex_chunk[first + i] = c;
+
+                uint32_t v = (uint32_t) (first + i);
+                unsigned char* p = record.data();
+                memcpy(p, &v, sizeof(v));                                       p += sizeof(v);
+                memcpy(p, &arrays.positions[i], sizeof(glm::vec3));             p += sizeof(glm::vec3);
+                if (flags & kChunkHasNormals)
+                {
+                    memcpy(p, &arrays.normals[i], sizeof(glm::vec3));           p += sizeof(glm::vec3);
+                }
+                if (flags & kChunkHasColors)
+                    memcpy(p, &arrays.colors[i], sizeof(glm::vec4));
+                is_written = vertex_spill.append(c, record.data(), record_size);
+            }
+            first += count;
+        }
+        std::vector<uint16_t>().swap(cell_chunk);
+        arrays = MeshArrays();
+
+        // pass 4: a triangle goes to the chunk of its first vertex; its other vertices that live
+        // in another chunk are exported to it
+        std::vector<unsigned int> tv_indices;
+        std::size_t num_triangles = 0;
+        while (is_written && ply.read_faces(batch, tv_indices) > 0)
+        {
+            for (std::size_t t = 0; t + 2 < tv_indices.size() && is_written; t += 3)
+            {
+                uint32_t triangle[3] = { tv_indices[t], tv_indices[t+1], tv_indices[t+2] };
+                uint32_t c = vertex_chunk[triangle[0]];
+                is_written = triangle_spill.append(c, triangle, sizeof(triangle));
+                for (int k = 1; k < 3 && is_written; ++k)
+                {
+                    uint32_t home = vertex_chunk[triangle[k]];
+                    uint32_t entry[2] = { triangle[k], c };
+                    if (home != c)
+                        is_written = export_spill.append(home, entry, sizeof(entry));
+                }
+            }
+            num_triangles += tv_indices.size() / 3;
+        }
+        if (!ply.error().empty())
+        {
+            message = ply.error();
+            break;
+        }
+        std::vector<uint16_t>().swap(vertex_chunk);
+        ply.close();
+
+        if (!is_written || !vertex_spill.flush() || !triangle_spill.flush() || !export_spill.flush()
+            || !foreign_spill.open(chunk_path + ".foreign.tmp", num_chunks, buffer_bytes))
+        {
+            message = "cannot write next to " + chunk_path;
+            break;
+        }
+        log << "chunks: " << num_triangles << " triangles binned in " << elapsed_ms(start) << " ms" << std::endl;
+
+        // pass 5: the exported vertices to the chunks that use them (the vertex records of a
+        // chunk are sorted by source index: they were written in file order)
+        std::vector<unsigned char> vertices, entries;
+        for (std::size_t h = 0; h < num_chunks && is_written; ++h)
+        {
+            if (!vertex_spill.read(h, vertices) || !export_spill.read(h, entries))
+            {
+                is_written = false;
+                break;
+            }
+            std::size_t num_records = vertices.size() / record_size;
+            for (std::size_t e = 0; e + 2 * sizeof(uint32_t) <= entries.size() && is_written; e += 2 * sizeof(uint32_t))
+            {
+                uint32_t entry[2];
+                memcpy(entry, &entries[e], sizeof(entry));
+
+                // binary search by source index
+                std::size_t lo = 0, hi = num_records;
+                while (lo < hi)
+                {
+                    std::size_t mid = (lo + hi) / 2;
+                    uint32_t v;
+                    memcpy(&v, &vertices[mid * record_size], sizeof(v));
+                    if (v < entry[0])
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                is_written = foreign_spill.append(entry[1], &vertices[lo * record_size], record_size);
+            }
+        }
+        export_spill.close();
+        if (!is_written || !foreign_spill.flush())
+        {
+            message = "cannot write next to " + chunk_path;
+            break;
+        }
+
+        // pass 6: each chunk on its own: local indices over the vertices its triangles use
+        out = fopen(tmp_path.c_str(), "wb");
+        if (out == NULL)
+        {
+            message = "cannot write " + tmp_path;
+            break;
+        }
+
+        ChunkFileHeader header;
+        memcpy(header.magic, kChunkFileMagic, sizeof(header.magic));
+        header.layout = chunk_file_layout();
+        header.key = key;
+        header.flags = flags;
+        header.data_offset = align_up(sizeof(ChunkFileHeader) + sizeof(ChunkRecord) * num_chunks);
+        for (int a = 0; a < 3; ++a)
+        {
+            header.aabb_min[a] = aabb_min[a];
+            header.aabb_max[a] = aabb_max[a];
+        }
+        std::vector<unsigned char> zeros(header.data_offset, 0);
+        is_written = fwrite(zeros.data(), 1, zeros.size(), out) == zeros.size();
+
+        std::vector<ChunkRecord> records;
+        std::vector<unsigned char> foreign, triangles;
+        std::vector<const unsigned char*> sorted;
+        std::vector<uint32_t> ids;
+        std::vector<unsigned int> local;
+        MeshArrays chunk;
+        for (std::size_t c = 0; c < num_chunks && is_written; ++c)
+        {
+            if (!triangle_spill.read(c, triangles) || !vertex_spill.read(c, vertices) || !foreign_spill.read(c, foreign))
+            {
+                is_written = false;
+                break;
+            }
+            if (triangles.empty())
+                continue;
+
+            // the records by source index, each once
+            sorted.clear();
+            for (std::size_t r = 0; r < vertices.size(); r += record_size)
+                sorted.push_back(&vertices[r]);
+            for (std::size_t r = 0; r < foreign.size(); r += record_size)
+                sorted.push_back(&foreign[r]);
+            std::sort(sorted.begin(), sorted.end(), [](const unsigned char* a, const unsigned char* b) { return record_id(a) < record_id(b); });
+            ids.resize(sorted.size());
+            for (std::size_t r = 0; r < sorted.size(); ++r)
+                ids[r] = record_id(sorted[r]);
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+            // the triangles in local indices; unused vertices (their triangles are in other chunks) are dropped
+            std::size_t num_chunk_triangles = triangles.size() / (3 * sizeof(uint32_t));
+            chunk.tv_indices.resize(3 * num_chunk_triangles);
+            local.assign(ids.size(), UINT32_MAX);
+            uint32_t num_used = 0;
+            for (std::size_t i = 0; i < chunk.tv_indices.size(); ++i)
+            {
+                uint32_t v;
+                memcpy(&v, &triangles[i * sizeof(uint32_t)], sizeof(v));
+                std::size_t r = std::lower_bound(ids.begin(), ids.end(), v) - ids.begin();
+                if (local[r] == UINT32_MAX)
+                    local[r] = num_used++;
+                chunk.tv_indices[i] = local[r];
+            }
+
+            // the vertex streams in the order of first use (a vertex both home and exported
+            // here has two equal records)
+            chunk.positions.resize(num_used);
+            chunk.normals.resize((flags & kChunkHasNormals) ? num_used : 0);
+            chunk.colors.resize((flags & kChunkHasColors) ? num_used : 0);
+            std::size_t r = 0;
+            for (std::size_t s = 0; s < sorted.size(); ++s)
+            {
+                while (ids[r] != record_id(sorted[s]))
+                    ++r;
+                if (local[r] == UINT32_MAX)
+                    continue;
+
+                const unsigned char* p = sorted[s] + sizeof(uint32_t);
+                memcpy(&chunk.positions[local[r]], p, sizeof(glm::vec3));       p += sizeof(glm::vec3);
+                if (flags & kChunkHasNormals)
+                {
+                    memcpy(&chunk.normals[local[r]], p, sizeof(glm::vec3));     p += sizeof(glm::vec3);
+                }
+                if (flags & kChunkHasColors)
+                    memcpy(&chunk.colors[local[r]], p, sizeof(glm::vec4));
+            }
+            reorder_for_vertex_cache(chunk.tv_indices, num_used);
+
+            ChunkRecord rec;
+            rec.offset = header.data_size;
+            rec.num_vertices = num_used;
+            rec.num_triangles = (uint32_t) num_chunk_triangles;
+            rec.size = chunk_data_size(rec.num_vertices, rec.num_triangles, flags);
+            glm::vec3 chunk_min(FLT_MAX), chunk_max(-FLT_MAX);
+            for (std::size_t i = 0; i < chunk.positions.size(); ++i)
+            {
+                chunk_min = glm::min(chunk_min, chunk.positions[i]);
+                chunk_max = glm::max(chunk_max, chunk.positions[i]);
+            }
+            for (int a = 0; a < 3; ++a)
+            {
+                rec.aabb_min[a] = chunk_min[a];
+                rec.aabb_max[a] = chunk_max[a];
+            }
+
+            is_written = fwrite(chunk.positions.data(), sizeof(glm::vec3), num_used, out) == num_used
+                && (chunk.normals.empty() || fwrite(chunk.normals.data(), sizeof(glm::vec3), num_used, out) == num_used)
+                && (chunk.colors.empty() || fwrite(chunk.colors.data(), sizeof(glm::vec4), num_used, out) == num_used)
+                && fwrite(chunk.tv_indices.data(), sizeof(unsigned int), chunk.tv_indices.size(), out) == chunk.tv_indices.size();
+
+            records.push_back(rec);
+            header.data_size += rec.size;
+            header.num_vertices += rec.num_vertices;
+            header.num_triangles += rec.num_triangles;
+        }
+
+        // the table goes into the room left for it at the front
+        header.num_chunks = (uint32_t) records.size();
+        is_written = is_written && seek_file(out, 0)
+            && fwrite(&header, sizeof(header), 1, out) == 1
+            && (records.empty() || fwrite(records.data(), sizeof(ChunkRecord), records.size(), out) == records.size());
+        is_written = (fclose(out) == 0) && is_written;
+        out = NULL;
+        if (!is_written)
+        {
+            message = "cannot write " + tmp_path;
+            break;
+        }
+
+        remove(chunk_path.c_str());     // rename() does not replace an existing file everywhere
+        if (rename(tmp_path.c_str(), chunk_path.c_str()) != 0)
+        {
+            message = "cannot write " + chunk_path;
+            break;
+        }
+        log << "chunks: " << chunk_path << ": " << records.size() << " chunks, " << header.num_vertices << " vertices, "
+            << header.num_triangles << " triangles, " << (header.data_offset + header.data_size) / (1024 * 1024) << " MB in "
+            << elapsed_ms(start) << " ms" << std::endl;
+        ok = true;
+    } while (false);
+
+    if (out != NULL)
+        fclose(out);
+    if (!ok)
+    {
+        remove(tmp_path.c_str());
+        if (error != NULL)
+            *error = message;
+    }
+    return ok;
+}
+
+bool ChunkFileReader::open(const std::string& path, const ChunkFileKey& key)
+{
+    close();
+
+    uint64_t file_size;
+    int64_t mtime;
+    if (!stat_file(path, file_size, mtime))
+        return false;
+
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    ChunkFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, kChunkFileMagic, sizeof(header.magic)) == 0
+        && header.version == kChunkFileVersion
+        && header.layout == chunk_file_layout()
+        && header.key == key
+        && header.data_offset >= sizeof(ChunkFileHeader) + (uint64_t) sizeof(ChunkRecord) * header.num_chunks
+        && header.data_offset <= file_size && header.data_size == file_size - header.data_offset;
+
+    std::vector<ChunkRecord> records;
+    if (ok)
+    {
+        records.resize(header.num_chunks);
+        ok = records.empty() || fread(records.data(), sizeof(ChunkRecord), records.size(), file) == records.size();
+    }
+    fclose(file);
+
+    for (std::size_t i = 0; ok && i < records.size(); ++i)
+    {
+        const ChunkRecord& r = records[i];
+        ok = r.size == chunk_data_size(r.num_vertices, r.num_triangles, header.flags)
+            && r.offset <= header.data_size && r.size <= header.data_size - r.offset;
+    }
+    if (!ok)
+        return false;
+
+    path_ = path;
+    header_ = header;
+    records_.swap(records);
+    return true;
+}
+
+void ChunkFileReader::close()
+{
+    path_.clear();
+    records_.clear();
+}
+
+bool ChunkFileReader::read_chunk(std::size_t i, MeshArrays& arrays) const
+{
+    arrays = MeshArrays();
+    const ChunkRecord& r = records_[i];
+
+    FILE* file = fopen(path_.c_str(), "rb");
+    if (file == NULL)
+        return false;
+
+    arrays.positions.resize(r.num_vertices);
+    arrays.normals.resize((header_.flags & kChunkHasNormals) ? r.num_vertices : 0);
+    arrays.colors.resize((header_.flags & kChunkHasColors) ? r.num_vertices : 0);
+    arrays.tv_indices.resize(3 * (std::size_t) r.num_triangles);
+
+    bool ok = seek_file(file, header_.data_offset + r.offset)
+        && fread(arrays.positions.data(), sizeof(glm::vec3), r.num_vertices, file) == r.num_vertices
+        && (arrays.normals.empty() || fread(arrays.normals.data(), sizeof(glm::vec3), r.num_vertices, file) == r.num_vertices)
+        && (arrays.colors.empty() || fread(arrays.colors.data(), sizeof(glm::vec4), r.num_vertices, file) == r.num_vertices)
+        && fread(arrays.tv_indices.data(), sizeof(unsigned int), arrays.tv_indices.size(), file) == arrays.tv_indices.size();
+    fclose(file);
+
+    for (std::size_t k = 0; ok && k < arrays.tv_indices.size(); ++k)
+        ok = arrays.tv_indices[k] < r.num_vertices;
+    if (!ok)
+        arrays = MeshArrays();
+    return ok;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MeshArrays.h"
+
+// .chunks: a mesh too large to load at once, cut into spatially coherent chunks that each
+// carry their own bounds (build_chunk_file() from a binary PLY; ChunkedModel pages them in).
+// written next to the source (models/scan.ply -> models/scan.ply.chunks)
+//   ChunkFileHeader | ChunkRecord x num_chunks | chunk data
+// a chunk is self-contained: positions (glm::vec3), normals (glm::vec3, if the source has
+// them), colors (glm::vec4, if), then its triangles as unsigned int indices into those.
+// like .meshcache, the structs are stored as they are in memory (version and layout are checked)
+
+const uint32_t kChunkFileVersion = 1;
+
+enum ChunkFileFlags
+{
+    kChunkHasNormals = 1 << 0,
+    kChunkHasColors = 1 << 1
+};
+
+// what the file was built from; any difference rebuilds it. no content hash: hashing a
+// multi-GB scan on every launch would cost as much as reading it
+struct ChunkFileKey
+{
+    uint64_t    source_size = 0;
+    int64_t     source_mtime = 0;
+    uint32_t    chunk_triangles = 0;    // ChunkBuildOptions::chunk_triangles
+    uint32_t    reserved = 0;
+
+    bool operator==(const ChunkFileKey& k) const
+    {
+        return source_size == k.source_size && source_mtime == k.source_mtime && chunk_triangles == k.chunk_triangles;
+    }
+};
+
+struct ChunkFileHeader
+{
+    char        magic[8];
+    uint32_t    version = kChunkFileVersion;
+    uint32_t    layout = 0;             // chunk_file_layout() of the writer
+    ChunkFileKey key;
+    uint32_t    num_chunks = 0;
+    uint32_t    flags = 0;              // ChunkFileFlags
+    uint64_t    num_vertices = 0;       // over all chunks (a vertex on a border is in each of its chunks)
+    uint64_t    num_triangles = 0;
+    uint64_t    data_offset = 0;        // start of the chunk data
+    uint64_t    data_size = 0;
+    float       aabb_min[3];
+    float       aabb_max[3];
+};
+
+struct ChunkRecord
+{
+    uint64_t    offset = 0;             // in the data section
+    uint64_t    size = 0;
+    uint32_t    num_vertices = 0;
+    uint32_t    num_triangles = 0;
+    float       aabb_min[3];            // of the chunk's vertices
+    float       aabb_max[3];
+};
+
+struct ChunkBuildOptions
+{
+    std::size_t window_bytes = 16 << 20;        // PLY read window (PlyStream)
+    std::size_t chunk_triangles = 1 << 18;      // aimed for per chunk
+    std::size_t spill_bytes = 64 << 20;         // staging buffers of all chunks together
+};
+
+// changes whenever a struct stored in the file changes size
+uint32_t chunk_file_layout();
+
+// key of source_path as it is now (false if the file does not exist)
+bool make_chunk_file_key(const std::string& source_path, const ChunkBuildOptions& options, ChunkFileKey& key);
+
+// bytes of a chunk with these counts in a file with these flags
+uint64_t chunk_data_size(uint32_t num_vertices, uint32_t num_triangles, uint32_t flags);
+
+// cut the binary PLY at source_path into chunk_path without holding the mesh: the vertices
+// are binned on a k-d tree over a vertex histogram (three passes over the vertex element),
+// each triangle goes to the chunk of its first vertex (one pass over the faces), and the
+// vertices and triangles of each chunk are staged in spill files next to chunk_path.
+// memory: 2 bytes per source vertex (its chunk), spill_bytes and one chunk at a time.
+// progress goes to log; false (and why in *error) if the source cannot be read
+bool build_chunk_file(const std::string& source_path, const std::string& chunk_path, const ChunkBuildOptions& options, std::ostream& log = std::cout, std::string* error = NULL);
+
+// the header and chunk table of a .chunks file; the chunks themselves are read on demand
+class ChunkFileReader
+{
+public:
+    bool open(const std::string& path, const ChunkFileKey& key);
+    void close();
+    bool is_open() const                            { return !path_.empty(); }
+
+    const ChunkFileHeader& header() const           { return header_; }
+    std::size_t num_chunks() const                  { return records_.size(); }
+    const ChunkRecord& record(std::size_t i) const  { return records_[i]; }
+
+    // chunk i into the streams and tv_indices of arrays. opens the file on its own, so reads
+    // may run on several threads at once
+    bool read_chunk(std::size_t i, MeshArrays& arrays) const;
+
+private:
+    std::string                 path_;
+    ChunkFileHeader             header_;
+    std::vector<ChunkRecord>    records_;
+};
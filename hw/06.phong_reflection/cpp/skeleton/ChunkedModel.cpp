@@ -0,0 +1,338 @@
+#include "ChunkedModel.h"
+
+#include <algorithm>
+#include <chrono>
+
+static bool is_box_outside(const Frustum& frustum, const glm::vec3& box_min, const glm::vec3& box_max)
+{
+    // the corner furthest along each plane normal
+    for (int i = 0; i < 6; ++i)
+    {
+        const glm::vec4& p = frustum.planes[i];
+        glm::vec3 corner(p.x >= 0.0f ? box_max.x : box_min.x, p.y >= 0.0f ? box_max.y : box_min.y, p.z >= 0.0f ? box_max.z : box_min.z);
+        if (glm::dot(glm::vec3(p), corner) + p.w < 0.0f)
+            return true;
+    }
+    return false;
+}
+
+ChunkedModel::ChunkedModel(unsigned int num_threads) : pool_(num_threads)
+{
+}
+
+ChunkedModel::~ChunkedModel()
+{
+    release_();
+}
+
+glm::mat4 ChunkedModel::get_model_matrix() const
+{
+    glm::mat4 mat_model = glm::mat4(1.0f);
+
+    mat_model = mat_model * glm::translate(glm::mat4(1.0f), vec_translate_);
+    mat_model = mat_model * glm::mat4_cast(quat_rotate_);
+    mat_model = mat_model * glm::scale(glm::mat4(1.0f), vec_scale_);
+
+    return mat_model;
+}
+
+bool ChunkedModel::load_model(const std::string& _path, std::ostream& log)
+{
+    release_();
+    chunks_.clear();
+    stats_ = ChunkResidencyStats();
+
+    ChunkFileKey key;
+    if (!make_chunk_file_key(_path, build_options, key))
+    {
+        log << "cannot open " << _path << std::endl;
+        return false;
+    }
+
+    std::string chunk_path = _path + ".chunks";
+    if (!reader_.open(chunk_path, key))
+    {
+        log << chunk_path << " is missing or stale: building it" << std::endl;
+        std::string error;
+        if (!build_chunk_file(_path, chunk_path, build_options, log, &error))
+        {
+            log << error << std::endl;
+            return false;
+        }
+        if (!reader_.open(chunk_path, key))
+        {
+            log << "cannot read " << chunk_path << std::endl;
+            return false;
+        }
+    }
+
+    chunks_.resize(reader_.num_chunks());
+    stats_.num_chunks = chunks_.size();
+    log << _path << ": " << chunks_.size() << " chunks, " << reader_.header().num_triangles << " triangles" << std::endl;
+    return true;
+}
+
+std::shared_ptr<ChunkedModel::LoadedChunk> ChunkedModel::load_chunk_(std::size_t i) const
+{
+    std::shared_ptr<MeshArrays> arrays = std::make_shared<MeshArrays>();
+    if (!reader_.read_chunk(i, *arrays))
+        return std::shared_ptr<LoadedChunk>();
+
+    // the builder already ordered the triangles for the vertex cache
+    std::shared_ptr<LoadedChunk> loaded = std::make_shared<LoadedChunk>();
+    loaded->mesh = Mesh(std::shared_ptr<const MeshArrays>(arrays));
+    loaded->mesh.update_tv_indices();
+    loaded->mesh.pack_gl_buffers(kDrawElements, kVertexFloat, loaded->gpu_data);
+
+    // the GL buffers, and the streams and the copy of the triangles the mesh keeps
+    const ChunkRecord& record = reader_.record(i);
+    loaded->bytes = record.size + 3 * sizeof(unsigned int) * (std::size_t) record.num_triangles;
+    for (int s = kSmooth; s <= kFlat; ++s)
+        loaded->bytes += loaded->gpu_data.vertices[s].size() + loaded->gpu_data.indices[s].size();
+    return loaded;
+}
+
+bool ChunkedModel::make_room_(std::size_t bytes, float distance)
+{
+    while (stats_.resident_bytes + bytes > memory_budget)
+    {
+        // the least recently visible chunk out of view, else the farthest visible one beyond distance
+        Chunk* victim = NULL;
+        for (std::size_t i = 0; i < chunks_.size(); ++i)
+        {
+            Chunk& chunk = chunks_[i];
+            if (chunk.state != kChunkResident)
+                continue;
+            if (!chunk.is_visible)
+            {
+                if (victim == NULL || victim->is_visible || chunk.last_visible_frame < victim->last_visible_frame)
+                    victim = &chunk;
+            }
+            else if (chunk.distance > distance && (victim == NULL || (victim->is_visible && chunk.distance > victim->distance)))
+            {
+                victim = &chunk;
+            }
+        }
+        if (victim == NULL)
+            return false;
+        evict_(*victim);
+    }
+    return true;
+}
+
+void ChunkedModel::evict_(Chunk& chunk)
+{
+    chunk.mesh.delete_gl_buffers();
+    chunk.mesh = Mesh();
+    chunk.draw_list = MeshDrawList();
+    chunk.state = kChunkOut;
+    stats_.resident_bytes -= chunk.bytes;
+    ++stats_.num_evictions;
+}
+
+void ChunkedModel::release_()
+{
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        Chunk& chunk = chunks_[i];
+        if (chunk.read.valid())
+            chunk.read.wait();      // the worker reads through reader_
+        chunk.read = std::future<std::shared_ptr<LoadedChunk> >();
+        chunk.loaded.reset();
+        if (chunk.state == kChunkResident)
+            chunk.mesh.delete_gl_buffers();
+        chunk.mesh = Mesh();
+        chunk.state = kChunkOut;
+    }
+    stats_.resident_bytes = 0;
+}
+
+void ChunkedModel::update(const glm::mat4& mat_view_proj, const glm::vec3& camera_position)
+{
+    ++frame_;
+    glm::mat4 mat_model = get_model_matrix();
+    Frustum frustum = extract_frustum(mat_view_proj * mat_model);
+    glm::vec3 camera = glm::vec3(glm::inverse(mat_model) * glm::vec4(camera_position, 1.0f));
+
+    // visibility of the chunk boxes (model space), and the order they are wanted in
+    order_.clear();
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        Chunk& chunk = chunks_[i];
+        const ChunkRecord& record = reader_.record(i);
+        glm::vec3 box_min(record.aabb_min[0], record.aabb_min[1], record.aabb_min[2]);
+        glm::vec3 box_max(record.aabb_max[0], record.aabb_max[1], record.aabb_max[2]);
+        chunk.is_visible = !is_box_outside(frustum, box_min, box_max);
+        if (!chunk.is_visible)
+            continue;
+
+        chunk.last_visible_frame = frame_;
+        chunk.distance = glm::length(glm::max(box_min, glm::min(camera, box_max)) - camera);
+        order_.push_back(i);
+    }
+    std::sort(order_.begin(), order_.end(), [this](std::size_t a, std::size_t b) { return chunks_[a].distance < chunks_[b].distance; });
+
+    // a lowered budget: the chunks out of view go first, then the farthest ones
+    make_room_(0, 0.0f);
+
+    // the reads done since the last frame
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        Chunk& chunk = chunks_[i];
+        if (chunk.state != kChunkLoading || !chunk.read.valid() || chunk.read.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        chunk.loaded = chunk.read.get();
+        if (chunk.loaded)
+            chunk.bytes = chunk.loaded->bytes;
+        else
+            chunk.state = kChunkOut;    // read again when it is wanted
+    }
+
+    // uploads, nearest first; a chunk that does not fit in the budget (even with every chunk
+    // out of view and every farther one evicted) is dropped
+    std::size_t uploaded = 0;
+    for (std::size_t k = 0; k < order_.size() && uploaded < upload_budget; ++k)
+    {
+        Chunk& chunk = chunks_[order_[k]];
+        if (chunk.state != kChunkLoading || !chunk.loaded)
+            continue;
+
+        std::shared_ptr<LoadedChunk> loaded = chunk.loaded;
+        chunk.loaded.reset();
+        if (!make_room_(chunk.bytes, chunk.distance))
+        {
+            chunk.state = kChunkOut;
+            ++stats_.num_rejected;
+            continue;
+        }
+
+        chunk.mesh = std::move(loaded->mesh);
+        chunk.mesh.gen_gl_buffers();
+        chunk.mesh.upload_gl_buffers(loaded->gpu_data);
+        uploaded += chunk.mesh.gpu_bytes();
+
+        // no meshlets or LODs: the whole chunk is one draw range
+        MeshletCullStats cull_stats;
+        chunk.mesh.cull(glm::mat4(1.0f), glm::vec3(0.0f), false, LodSelection(), cull_stats, chunk.draw_list);
+
+        chunk.state = kChunkResident;
+        stats_.resident_bytes += chunk.bytes;
+        ++stats_.num_loads;
+    }
+
+    // reads of chunks gone out of view before their upload are dropped
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        Chunk& chunk = chunks_[i];
+        if (chunk.state == kChunkLoading && chunk.loaded && !chunk.is_visible)
+        {
+            chunk.loaded.reset();
+            chunk.state = kChunkOut;
+        }
+    }
+
+    // new reads, nearest first; a chunk of known size is only read if it can fit
+    std::size_t num_loading = 0;
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+        num_loading += (chunks_[i].state == kChunkLoading);
+    for (std::size_t k = 0; k < order_.size() && num_loading < max_pending_loads; ++k)
+    {
+        std::size_t index = order_[k];
+        Chunk& chunk = chunks_[index];
+        if (chunk.state != kChunkOut)
+            continue;
+        if (chunk.bytes > 0)
+        {
+            std::size_t evictable = 0;
+            for (std::size_t i = 0; i < chunks_.size(); ++i)
+            {
+                const Chunk& other = chunks_[i];
+                if (other.state == kChunkResident && (!other.is_visible || other.distance > chunk.distance))
+                    evictable += other.bytes;
+            }
+            if (stats_.resident_bytes - evictable + chunk.bytes > memory_budget)
+                continue;
+        }
+
+        chunk.state = kChunkLoading;
+        chunk.read = pool_.submit([this, index]() { return load_chunk_(index); });
+        ++num_loading;
+    }
+
+    stats_.num_visible = order_.size();
+    stats_.num_resident = stats_.num_drawn = stats_.num_drawn_triangles = 0;
+    stats_.num_loading = num_loading;
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        const Chunk& chunk = chunks_[i];
+        if (chunk.state != kChunkResident)
+            continue;
+        ++stats_.num_resident;
+        if (chunk.is_visible)
+        {
+            ++stats_.num_drawn;
+            stats_.num_drawn_triangles += reader_.record(i).num_triangles;
+        }
+    }
+}
+
+void ChunkedModel::draw(GLStateCache& state, int loc_u_ambient, int loc_u_diffuse, int loc_u_specular, int loc_u_shininess) const
+{
+    state.uniform(loc_u_ambient, material.ambient);
+    state.uniform(loc_u_diffuse, material.diffuse);
+    state.uniform(loc_u_specular, material.specular);
+    state.uniform(loc_u_shininess, material.shininess);
+
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        const Chunk& chunk = chunks_[i];
+        if (chunk.state == kChunkResident && chunk.is_visible)
+            chunk.mesh.draw(shading_type, chunk.draw_list, state);
+    }
+}
+
+void ChunkedModel::draw(GLStateCache& state, UniformBlocks& blocks)
+{
+    if (material_slot_ == UINT_MAX)
+        material_slot_ = blocks.add_material(material);
+    blocks.bind_material(material_slot_, material);
+
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        const Chunk& chunk = chunks_[i];
+        if (chunk.state == kChunkResident && chunk.is_visible)
+            chunk.mesh.draw(shading_type, chunk.draw_list, state);
+    }
+}
+
+void ChunkedModel::emit(RenderQueue& queue, UniformBlocks& blocks, uint32_t program, uint32_t object, const glm::mat4& mat_view)
+{
+    if (material_slot_ == UINT_MAX)
+        material_slot_ = blocks.add_material(material);
+
+    glm::mat4 mat_model_view = mat_view * get_model_matrix();
+
+    for (std::size_t i = 0; i < chunks_.size(); ++i)
+    {
+        const Chunk& chunk = chunks_[i];
+        if (chunk.state != kChunkResident || !chunk.is_visible)
+            continue;
+
+        const ChunkRecord& record = reader_.record(i);
+        glm::vec3 center = 0.5f * (glm::vec3(record.aabb_min[0], record.aabb_min[1], record.aabb_min[2])
+                                 + glm::vec3(record.aabb_max[0], record.aabb_max[1], record.aabb_max[2]));
+
+        DrawPacket packet;
+        packet.mesh = &chunk.mesh;
+        packet.draw_list = &chunk.draw_list;
+        packet.material = &material;
+        packet.shading_type = shading_type;
+        packet.vertex_array = chunk.mesh.vertex_array(shading_type);
+        packet.program = program;
+        packet.object = object;
+        packet.material_slot = material_slot_;
+        packet.depth = -(mat_model_view * glm::vec4(center, 1.0f)).z;
+        queue.add(packet);
+    }
+}
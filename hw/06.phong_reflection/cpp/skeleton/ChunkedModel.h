@@ -0,0 +1,130 @@
+#pragma once
+#include <climits>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "ShadingType.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "ChunkFile.h"
+#include "ThreadPool.h"
+#include "UniformBlocks.h"
+#include "RenderQueue.h"
+
+// chunk residency of a ChunkedModel (the counts are of the last update())
+struct ChunkResidencyStats
+{
+    std::size_t num_chunks = 0;
+    std::size_t num_visible = 0;            // in the view frustum
+    std::size_t num_resident = 0;           // uploaded
+    std::size_t num_drawn = 0;              // visible and resident
+    std::size_t num_loading = 0;            // read on a worker or waiting for the upload
+    std::size_t resident_bytes = 0;         // GPU buffers + the CPU copy of the resident chunks
+    std::size_t num_drawn_triangles = 0;
+
+    std::size_t num_loads = 0;              // uploads since load_model()
+    std::size_t num_evictions = 0;
+    std::size_t num_rejected = 0;           // reads dropped: no room within the budget
+};
+
+// a mesh larger than memory (a model type of its own next to Model): its .chunks file is built
+// from a binary PLY by load_model(), and update() keeps the chunks in the view frustum resident,
+// nearest first, within memory_budget. chunks are read and packed on worker threads and
+// uploaded on the GL thread; the least recently visible ones are evicted to make room.
+// one material for the whole mesh (a scan has vertex colors, if anything)
+class ChunkedModel
+{
+public:
+    ShadingType shading_type = kSmooth;
+    std::size_t memory_budget = 512 << 20;      // bytes of the resident chunks (see ChunkResidencyStats)
+    std::size_t upload_budget = 16 << 20;       // bytes uploaded per update()
+    unsigned int max_pending_loads = 8;         // chunks read / packed at once
+    ChunkBuildOptions build_options;
+    Material    material;
+
+public:
+    explicit ChunkedModel(unsigned int num_threads = 2);
+    ~ChunkedModel();    // waits for the reads; deletes the GL buffers (GL thread)
+
+    ChunkedModel(const ChunkedModel&) = delete;
+    ChunkedModel& operator=(const ChunkedModel&) = delete;
+
+    // (re)build <path>.chunks if it is missing or stale (this reads the whole source, once),
+    // then read its chunk table. no chunk is loaded until update()
+    bool load_model(const std::string& _path, std::ostream& log = std::cout);
+
+    // once per frame on the GL thread, before draw(): find the visible chunks, upload the ones
+    // read since the last call (evicting to stay within the budget) and queue the reads of the
+    // visible chunks missing, nearest first
+    void update(const glm::mat4& mat_view_proj, const glm::vec3& camera_position);
+    void draw(GLStateCache& state, int loc_u_ambient, int loc_u_diffuse, int loc_u_specular, int loc_u_shininess) const;
+    void draw(GLStateCache& state, UniformBlocks& blocks);      // the object block of this model must be bound
+    // the visible resident chunks as packets of queue (mat_view gives their depth)
+    void emit(RenderQueue& queue, UniformBlocks& blocks, uint32_t program, uint32_t object, const glm::mat4& mat_view);
+
+    const ChunkResidencyStats& stats() const    { return stats_; }
+    const ChunkFileHeader& chunk_header() const { return reader_.header(); }
+
+    std::string get_name() const                { return name_; }
+    void set_name(const std::string& _name)     { name_ = _name; }
+
+    glm::vec3 get_translate() const             { return vec_translate_; }
+    glm::vec3 get_scale() const                 { return vec_scale_; }
+    void set_translate(const glm::vec3& _vec)   { vec_translate_ = _vec; }
+    void set_scale(const glm::vec3& _vec)       { vec_scale_ = _vec; }
+    void get_rotate(glm::quat& _quat) const     { _quat = quat_rotate_; }
+    void set_rotate(const glm::quat& _quat)     { quat_rotate_ = _quat; }
+
+    glm::mat4 get_model_matrix() const;
+
+private:
+    enum ChunkState { kChunkOut, kChunkLoading, kChunkResident };
+
+    // a chunk read and packed on a worker
+    struct LoadedChunk
+    {
+        Mesh        mesh;
+        MeshGpuData gpu_data;
+        std::size_t bytes = 0;
+    };
+
+    struct Chunk
+    {
+        ChunkState  state = kChunkOut;
+        std::future<std::shared_ptr<LoadedChunk> >  read;   // kChunkLoading, until it is ready
+        std::shared_ptr<LoadedChunk>    loaded;             // kChunkLoading, waiting for the upload
+        Mesh        mesh;                   // kChunkResident
+        MeshDrawList draw_list;
+        std::size_t bytes = 0;              // once loaded (0: not known yet)
+        bool        is_visible = false;
+        float       distance = 0.0f;        // of the camera to the box
+        uint64_t    last_visible_frame = 0;
+    };
+
+    std::shared_ptr<LoadedChunk> load_chunk_(std::size_t i) const;
+    bool make_room_(std::size_t bytes, float distance);     // evict until bytes fit
+    void evict_(Chunk& chunk);
+    void release_();
+
+    std::string         name_;
+    ChunkFileReader     reader_;
+    std::vector<Chunk>  chunks_;
+    std::vector<std::size_t> order_;        // visible chunks, nearest first (scratch of update())
+    uint64_t            frame_ = 0;
+    ChunkResidencyStats stats_;
+    unsigned int        material_slot_ = UINT_MAX;  // in the UniformBlocks (UINT_MAX: not drawn with them yet)
+
+    glm::vec3  vec_translate_ = glm::vec3(0.0f);
+    glm::quat  quat_rotate_ = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3  vec_scale_ = glm::vec3(1.0f);
+
+    ThreadPool          pool_;              // last: joined before the rest goes
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+// kDrawElements : unique vertices + index buffer (glDrawElements)
+// kDrawArrays   : per triangle-vertex expansion (glDrawArrays)
+enum DrawType { kDrawElements, kDrawArrays };
@@ -0,0 +1,191 @@
+#include "GLStateCache.h"
+
+#include <cstring>
+
+#include <glm/gtc/type_ptr.hpp>
+
+// uniform locations above this are sent without being cached (drivers hand out small ones)
+static const GLint kMaxCachedLocation = 1024;
+
+const char* state_call_name(GLStateCall call)
+{
+    switch (call)
+    {
+    case kStateProgram:     return "glUseProgram";
+    case kStateVertexArray: return "glBindVertexArray";
+    case kStateBuffer:      return "glBindBuffer";
+    case kStateBufferRange: return "glBindBufferBase/Range";
+    case kStateCapability:  return "glEnable/glDisable";
+    case kStateUniform:     return "glUniform*";
+    default:                return "?";
+    }
+}
+
+std::size_t GLStateStats::total_issued() const
+{
+    std::size_t total = 0;
+    for (int i = 0; i < kNumStateCalls; ++i)
+        total += issued[i];
+    return total;
+}
+
+std::size_t GLStateStats::total_skipped() const
+{
+    std::size_t total = 0;
+    for (int i = 0; i < kNumStateCalls; ++i)
+        total += skipped[i];
+    return total;
+}
+
+void GLStateCache::begin_frame()
+{
+    last_frame_stats_ = stats_;
+    stats_ = GLStateStats();
+    invalidate();
+}
+
+void GLStateCache::invalidate()
+{
+    program_ = kUnknown;
+    program_uniforms_ = NULL;
+    vertex_array_ = kUnknown;
+    buffers_.clear();
+    indexed_buffers_.clear();
+    capabilities_.clear();
+}
+
+bool GLStateCache::is_set_(GLStateCall call, bool is_same)
+{
+    if (is_same)
+        ++stats_.skipped[call];
+    else
+        ++stats_.issued[call];
+    return is_same;
+}
+
+void GLStateCache::use_program(GLuint program)
+{
+    if (is_set_(kStateProgram, program == program_))
+        return;
+
+    glUseProgram(program);
+    program_ = program;
+    program_uniforms_ = (program != 0) ? &uniforms_[program] : NULL;
+}
+
+void GLStateCache::bind_vertex_array(GLuint vertex_array)
+{
+    if (is_set_(kStateVertexArray, vertex_array == vertex_array_))
+        return;
+
+    glBindVertexArray(vertex_array);
+    vertex_array_ = vertex_array;
+    // the element array binding is part of the vertex array
+    buffers_.erase(GL_ELEMENT_ARRAY_BUFFER);
+}
+
+void GLStateCache::bind_buffer(GLenum target, GLuint buffer)
+{
+    std::map<GLenum, GLuint>::iterator it = buffers_.find(target);
+    if (is_set_(kStateBuffer, it != buffers_.end() && it->second == buffer))
+        return;
+
+    glBindBuffer(target, buffer);
+    buffers_[target] = buffer;
+}
+
+void GLStateCache::bind_buffer_base(GLenum target, GLuint index, GLuint buffer)
+{
+    IndexedBinding& binding = indexed_buffers_[std::make_pair(target, index)];
+    if (is_set_(kStateBufferRange, binding.buffer == buffer && binding.size == 0))
+        return;
+
+    glBindBufferBase(target, index, buffer);
+    binding.buffer = buffer;
+    binding.offset = 0;
+    binding.size = 0;
+    buffers_[target] = buffer;      // binds the generic binding point as well
+}
+
+void GLStateCache::bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    IndexedBinding& binding = indexed_buffers_[std::make_pair(target, index)];
+    if (is_set_(kStateBufferRange, binding.buffer == buffer && binding.offset == offset && binding.size == size))
+        return;
+
+    glBindBufferRange(target, index, buffer, offset, size);
+    binding.buffer = buffer;
+    binding.offset = offset;
+    binding.size = size;
+    buffers_[target] = buffer;
+}
+
+void GLStateCache::set_capability(GLenum cap, bool is_enabled)
+{
+    std::map<GLenum, bool>::iterator it = capabilities_.find(cap);
+    if (is_set_(kStateCapability, it != capabilities_.end() && it->second == is_enabled))
+        return;
+
+    if (is_enabled)
+        glEnable(cap);
+    else
+        glDisable(cap);
+    capabilities_[cap] = is_enabled;
+}
+
+bool GLStateCache::set_uniform_(GLint location, const void* data, std::size_t size)
+{
+    if (location < 0)
+    {
+        ++stats_.skipped[kStateUniform];
+        return false;
+    }
+    if (program_uniforms_ == NULL || location > kMaxCachedLocation)
+    {
+        ++stats_.issued[kStateUniform];
+        return true;
+    }
+
+    std::vector<UniformValue>& values = *program_uniforms_;
+    if ((std::size_t) location >= values.size())
+        values.resize(location + 1);
+
+    UniformValue& value = values[location];
+    if (is_set_(kStateUniform, value.size == size && memcmp(value.data, data, size) == 0))
+        return false;
+
+    value.size = (uint32_t) size;
+    memcpy(value.data, data, size);
+    return true;
+}
+
+void GLStateCache::uniform(GLint location, int value)
+{
+    // an int in the float slots: compared bytewise
+    if (set_uniform_(location, &value, sizeof(value)))
+        glUniform1i(location, value);
+}
+
+void GLStateCache::uniform(GLint location, float value)
+{
+    if (set_uniform_(location, &value, sizeof(value)))
+        glUniform1f(location, value);
+}
+
+void GLStateCache::uniform(GLint location, const glm::vec3& value)
+{
+    if (set_uniform_(location, glm::value_ptr(value), sizeof(glm::vec3)))
+        glUniform3fv(location, 1, glm::value_ptr(value));
+}
+
+void GLStateCache::uniform(GLint location, const glm::mat3& value)
+{
+    if (set_uniform_(location, glm::value_ptr(value), sizeof(glm::mat3)))
+        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void GLStateCache::uniform(GLint location, const glm::mat4& value)
+{
+    if (set_uniform_(location, glm::value_ptr(value), sizeof(glm::mat4)))
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// the kinds of calls GLStateCache filters
+enum GLStateCall
+{
+    kStateProgram,          // glUseProgram
+    kStateVertexArray,      // glBindVertexArray
+    kStateBuffer,           // glBindBuffer
+    kStateBufferRange,      // glBindBufferBase / glBindBufferRange
+    kStateCapability,       // glEnable / glDisable
+    kStateUniform,          // glUniform*
+    kNumStateCalls
+};
+
+const char* state_call_name(GLStateCall call);
+
+// calls of one frame: made, and dropped because they would have changed nothing
+struct GLStateStats
+{
+    std::size_t issued[kNumStateCalls] = {};
+    std::size_t skipped[kNumStateCalls] = {};
+    std::size_t num_draws = 0;              // glMultiDraw* / glDraw* (never skipped)
+
+    std::size_t total_issued() const;
+    std::size_t total_skipped() const;
+};
+
+// a thin layer the draws of render_object() go through: it remembers the bound program,
+// vertex array, buffers, capabilities and the uniform values of each program, and drops the
+// calls that would set what is already set. GL thread only.
+// the cache only sees its own calls: begin_frame() forgets the bindings, since the uploads and
+// ImGui bind their own between frames. GL objects must not be created or deleted between
+// begin_frame() and the last draw of the frame (a recycled name would look bound).
+// uniform values are state of the program object, which nobody else sets: they are kept
+class GLStateCache
+{
+public:
+    void begin_frame();         // the counts so far become last_frame_stats()
+    void invalidate();          // forget everything but the uniform values
+
+    void use_program(GLuint program);
+    void bind_vertex_array(GLuint vertex_array);
+    void bind_buffer(GLenum target, GLuint buffer);
+    void bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+    void bind_buffer_range(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void set_capability(GLenum cap, bool is_enabled);
+
+    // of the program in use (location -1 is skipped, as GL ignores it)
+    void uniform(GLint location, int value);
+    void uniform(GLint location, float value);
+    void uniform(GLint location, const glm::vec3& value);
+    void uniform(GLint location, const glm::mat3& value);
+    void uniform(GLint location, const glm::mat4& value);
+
+    void count_draws(std::size_t num_draws = 1)     { stats_.num_draws += num_draws; }
+
+    const GLStateStats& stats() const               { return stats_; }
+    const GLStateStats& last_frame_stats() const    { return last_frame_stats_; }
+
+private:
+    static const GLuint kUnknown = 0xffffffffu;
+
+    struct IndexedBinding
+    {
+        GLuint      buffer = kUnknown;
+        GLintptr    offset = 0;
+        GLsizeiptr  size = 0;           // 0: the whole buffer (glBindBufferBase)
+    };
+
+    // a uniform value as it was last sent (size 0: not known)
+    struct UniformValue
+    {
+        uint32_t    size = 0;
+        float       data[16];
+    };
+
+    bool is_set_(GLStateCall call, bool is_same);   // counts the call; true if it can be dropped
+    bool set_uniform_(GLint location, const void* data, std::size_t size);
+
+    GLuint  program_ = kUnknown;
+    GLuint  vertex_array_ = kUnknown;
+    std::map<GLenum, GLuint>    buffers_;           // generic binding point of each target
+    std::map<std::pair<GLenum, GLuint>, IndexedBinding> indexed_buffers_;
+    std::map<GLenum, bool>      capabilities_;
+
+    std::map<GLuint, std::vector<UniformValue> > uniforms_;     // by program, by location
+    std::vector<UniformValue>*  program_uniforms_ = NULL;       // of program_
+
+    GLStateStats    stats_;
+    GLStateStats    last_frame_stats_;
+};
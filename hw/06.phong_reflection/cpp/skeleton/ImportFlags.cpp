@@ -0,0 +1,219 @@
+#include "ImportFlags.h"
+
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+
+#include <assimp/cimport.h>
+#include <assimp/scene.h>
+
+#include "ProcessMemory.h"
+
+namespace
+{
+
+struct ImportStep
+{
+    unsigned int    flag;
+    const char*     name;
+};
+
+// the order profile_import_steps() applies them in. it is not exactly the order of a full
+// import: the importer validates the scene (ValidateDataStructure) on its own before any
+// step, the left-handed conversion steps (MakeLeftHanded, FlipUVs, FlipWindingOrder) are
+// placed differently between Assimp versions, and a full import also runs internal steps
+// (spatial sorts, vertex splitting) that have no flag. the rest follows Assimp's step registry
+const ImportStep kImportSteps[] = {
+    { aiProcess_ValidateDataStructure,  "ValidateDataStructure" },
+    { aiProcess_MakeLeftHanded,         "MakeLeftHanded" },
+    { aiProcess_FlipUVs,                "FlipUVs" },
+    { aiProcess_FlipWindingOrder,       "FlipWindingOrder" },
+    { aiProcess_RemoveComponent,        "RemoveComponent" },
+    { aiProcess_RemoveRedundantMaterials, "RemoveRedundantMaterials" },
+    { aiProcess_EmbedTextures,          "EmbedTextures" },
+    { aiProcess_FindInstances,          "FindInstances" },
+    { aiProcess_OptimizeGraph,          "OptimizeGraph" },
+    { aiProcess_OptimizeMeshes,         "OptimizeMeshes" },
+    { aiProcess_FindDegenerates,        "FindDegenerates" },
+    { aiProcess_GenUVCoords,            "GenUVCoords" },
+    { aiProcess_TransformUVCoords,      "TransformUVCoords" },
+    { aiProcess_GlobalScale,            "GlobalScale" },
+    { aiProcess_PopulateArmatureData,   "PopulateArmatureData" },
+    { aiProcess_PreTransformVertices,   "PreTransformVertices" },
+    { aiProcess_Triangulate,            "Triangulate" },
+    { aiProcess_SortByPType,            "SortByPType" },
+    { aiProcess_FindInvalidData,        "FindInvalidData" },
+    { aiProcess_FixInfacingNormals,     "FixInfacingNormals" },
+    { aiProcess_SplitByBoneCount,       "SplitByBoneCount" },
+    { aiProcess_SplitLargeMeshes,       "SplitLargeMeshes" },
+    { aiProcess_DropNormals,            "DropNormals" },
+    { aiProcess_GenNormals,             "GenNormals" },
+    { aiProcess_ForceGenNormals,        "ForceGenNormals" },
+    { aiProcess_GenSmoothNormals,       "GenSmoothNormals" },
+    { aiProcess_CalcTangentSpace,       "CalcTangentSpace" },
+    { aiProcess_JoinIdenticalVertices,  "JoinIdenticalVertices" },
+    { aiProcess_Debone,                 "Debone" },
+    { aiProcess_LimitBoneWeights,       "LimitBoneWeights" },
+    { aiProcess_ImproveCacheLocality,   "ImproveCacheLocality" },
+    { aiProcess_GenBoundingBoxes,       "GenBoundingBoxes" },
+};
+const std::size_t kNumImportSteps = sizeof(kImportSteps) / sizeof(kImportSteps[0]);
+
+bool find_flags(const std::string& name, unsigned int& flags)
+{
+    if (name == "realtime_max_quality" || name == "aiProcessPreset_TargetRealtime_MaxQuality")
+        flags = aiProcessPreset_TargetRealtime_MaxQuality;
+    else if (name == "realtime_quality" || name == "aiProcessPreset_TargetRealtime_Quality")
+        flags = aiProcessPreset_TargetRealtime_Quality;
+    else if (name == "realtime_fast" || name == "aiProcessPreset_TargetRealtime_Fast")
+        flags = aiProcessPreset_TargetRealtime_Fast;
+    else if (name == "none" || name == "0")
+        flags = 0;
+    else
+    {
+        std::string step = (name.compare(0, 10, "aiProcess_") == 0) ? name.substr(10) : name;
+        for (std::size_t i = 0; i < kNumImportSteps; ++i)
+        {
+            if (step == kImportSteps[i].name)
+            {
+                flags = kImportSteps[i].flag;
+                return true;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int64_t scene_bytes(const aiScene* scene)
+{
+    aiMemoryInfo info;
+    aiGetMemoryRequirements(scene, &info);
+    return info.total;
+}
+
+} // namespace
+
+bool parse_import_flags(const std::string& spec, unsigned int& flags, std::string* error)
+{
+    // words and the '|' / '-' between them; blanks are ignored
+    std::string compact;
+    for (std::size_t i = 0; i < spec.size(); ++i)
+    {
+        if (!isspace((unsigned char) spec[i]))
+            compact += spec[i];
+    }
+
+    unsigned int result = 0;
+    char op = '|';
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i <= compact.size(); ++i)
+    {
+        if (i < compact.size() && compact[i] != '|' && compact[i] != '-')
+            continue;
+
+        std::string word = compact.substr(begin, i - begin);
+        unsigned int word_flags = 0;
+        if (word.empty() || !find_flags(word, word_flags))
+        {
+            if (error != NULL)
+                *error = "unknown import flag \"" + word + "\" in \"" + spec + "\"";
+            return false;
+        }
+        result = (op == '|') ? (result | word_flags) : (result & ~word_flags);
+
+        if (i < compact.size())
+            op = compact[i];
+        begin = i + 1;
+    }
+    flags = result;
+    return true;
+}
+
+std::string import_flags_to_string(unsigned int flags)
+{
+    std::string names;
+    for (std::size_t i = 0; i < kNumImportSteps; ++i)
+    {
+        if (flags & kImportSteps[i].flag)
+            names += (names.empty() ? "" : "|") + std::string(kImportSteps[i].name);
+    }
+    return names.empty() ? "none" : names;
+}
+
+bool profile_import_steps(const std::string& path, unsigned int flags, std::vector<ImportStepProfile>& steps, std::string* error)
+{
+    steps.clear();
+
+    ImportStepProfile read;
+    read.name = "read";
+    int64_t rss = (int64_t) resident_set_bytes();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const aiScene* scene = aiImportFile(path.c_str(), 0);
+    read.ms = elapsed_ms(start);
+    if (scene == NULL)
+    {
+        if (error != NULL)
+            *error = path + ": " + aiGetErrorString();
+        return false;
+    }
+    read.scene_bytes = read.scene_delta = scene_bytes(scene);
+    read.rss_delta = (int64_t) resident_set_bytes() - rss;
+    steps.push_back(read);
+
+    for (std::size_t i = 0; i < kNumImportSteps; ++i)
+    {
+        if (!(flags & kImportSteps[i].flag))
+            continue;
+
+        ImportStepProfile step;
+        step.name = kImportSteps[i].name;
+        step.flag = kImportSteps[i].flag;
+        int64_t bytes = steps.back().scene_bytes;
+        rss = (int64_t) resident_set_bytes();
+        start = std::chrono::steady_clock::now();
+
+        // a failing step releases the scene (Assimp returns NULL then)
+        scene = aiApplyPostProcessing(scene, step.flag);
+        step.ms = elapsed_ms(start);
+        if (scene == NULL)
+        {
+            if (error != NULL)
+                *error = path + ": " + step.name + " failed: " + aiGetErrorString();
+            return false;
+        }
+        step.scene_bytes = scene_bytes(scene);
+        step.scene_delta = step.scene_bytes - bytes;
+        step.rss_delta = (int64_t) resident_set_bytes() - rss;
+        steps.push_back(step);
+    }
+
+    aiReleaseImport(scene);
+    return true;
+}
+
+void print_import_profile(const std::string& path, unsigned int flags, const std::vector<ImportStepProfile>& steps, std::ostream& out)
+{
+    const double kKB = 1.0 / 1024.0;
+
+    double total_ms = 0.0;
+    out << path << " (" << import_flags_to_string(flags) << ")" << std::endl
+        << "  step                          ms    scene KB   delta KB     RSS KB" << std::endl;
+    for (std::size_t i = 0; i < steps.size(); ++i)
+    {
+        const ImportStepProfile& step = steps[i];
+        out << "  " << std::left << std::setw(24) << step.name << std::right << std::fixed
+            << std::setw(10) << std::setprecision(2) << step.ms
+            << std::setw(12) << std::setprecision(1) << step.scene_bytes * kKB
+            << std::setw(11) << std::setprecision(1) << step.scene_delta * kKB
+            << std::setw(11) << std::setprecision(1) << step.rss_delta * kKB << std::endl;
+        total_ms += step.ms;
+    }
+    out << "  " << std::left << std::setw(24) << "total" << std::right << std::setw(10) << std::setprecision(2) << total_ms << std::endl;
+    out.unsetf(std::ios::fixed);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <assimp/postprocess.h>
+
+// aiProcess_* flags of an Assimp import (Model::import_flags), by name.
+// a spec is presets and steps joined by '|'; a step after '-' is taken out again:
+//   realtime_max_quality                       (the default, aiProcessPreset_TargetRealtime_MaxQuality)
+//   realtime_fast | realtime_quality | none
+//   Triangulate|JoinIdenticalVertices|GenSmoothNormals     (aiProcess_ prefix optional)
+//   realtime_max_quality-CalcTangentSpace-FindInvalidData
+const unsigned int kDefaultImportFlags = aiProcessPreset_TargetRealtime_MaxQuality;
+
+bool parse_import_flags(const std::string& spec, unsigned int& flags, std::string* error = NULL);
+std::string import_flags_to_string(unsigned int flags);    // step names joined by '|'
+
+// one post-process step of profile_import_steps()
+struct ImportStepProfile
+{
+    std::string name;               // "read" for aiImportFile(path, 0) itself
+    unsigned int flag = 0;
+    double      ms = 0.0;
+    int64_t     scene_bytes = 0;    // aiGetMemoryRequirements() after the step
+    int64_t     scene_delta = 0;    // change of scene_bytes by the step
+    int64_t     rss_delta = 0;      // change of the resident set size by the step
+};
+
+// profiling mode: aiImportFile(path, 0), then each step of flags on its own through
+// aiApplyPostProcessing() (roughly in the order of Assimp's step registry, see kImportSteps),
+// timing each call and measuring the scene and process memory around it. the steps run one
+// call each, so a time can differ from the step's share of a full import. false if the
+// import or a step fails
+bool profile_import_steps(const std::string& path, unsigned int flags, std::vector<ImportStepProfile>& steps, std::string* error = NULL);
+void print_import_profile(const std::string& path, unsigned int flags, const std::vector<ImportStepProfile>& steps, std::ostream& out = std::cout);
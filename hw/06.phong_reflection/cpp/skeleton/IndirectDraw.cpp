@@ -0,0 +1,202 @@
+#include "IndirectDraw.h"
+
+#include <algorithm>
+
+#include "VertexFormat.h"
+
+// the buffers of capacity_[]
+enum { kCommandBuffer, kDrawDataBuffer, kObjectBuffer, kMaterialBuffer };
+
+// bytes of data into the buffer bound to target, orphaning the storage of the last frame
+// (its draws may still read it)
+static void upload_stream(GLenum target, std::size_t& capacity, const void* data, std::size_t bytes)
+{
+    capacity = std::max(capacity, bytes);
+    glBufferData(target, capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, bytes, data);
+}
+
+IndirectDraw::~IndirectDraw()
+{
+    release();
+}
+
+bool IndirectDraw::is_supported()
+{
+    // glMultiDrawElementsIndirect, base_instance, shader storage buffers
+    return GLEW_VERSION_4_3;
+}
+
+bool IndirectDraw::init(MeshPool& pool)
+{
+    release();
+    if (!is_supported())
+        return false;
+
+    glGenBuffers(1, &command_buffer_);
+    glGenBuffers(1, &draw_data_buffer_);
+    glGenBuffers(1, &object_buffer_);
+    glGenBuffers(1, &material_buffer_);
+    if (command_buffer_ == 0 || draw_data_buffer_ == 0 || object_buffer_ == 0 || material_buffer_ == 0)
+    {
+        // glDeleteBuffers() skips the names that are 0
+        GLuint buffers[4] = { command_buffer_, draw_data_buffer_, object_buffer_, material_buffer_ };
+        glDeleteBuffers(4, buffers);
+        command_buffer_ = draw_data_buffer_ = object_buffer_ = material_buffer_ = 0;
+        return false;
+    }
+
+    pool_ = &pool;
+    return true;
+}
+
+void IndirectDraw::release()
+{
+    if (!is_ready())
+        return;
+
+    if (!vertex_arrays_.empty())
+        glDeleteVertexArrays((GLsizei) vertex_arrays_.size(), &vertex_arrays_[0]);
+    vertex_arrays_.clear();
+
+    GLuint buffers[4] = { command_buffer_, draw_data_buffer_, object_buffer_, material_buffer_ };
+    glDeleteBuffers(4, buffers);
+    command_buffer_ = draw_data_buffer_ = object_buffer_ = material_buffer_ = 0;
+    std::fill(capacity_, capacity_ + 4, 0);
+    pool_ = NULL;
+}
+
+void IndirectDraw::update()
+{
+    if (!is_ready())
+        return;
+
+    // the pool buffers keep their names when they grow: a VAO per pool is set up once
+    for (std::size_t i = vertex_arrays_.size(); i < pool_->num_pools(); ++i)
+    {
+        const MeshPoolBuffers& buffers = pool_->buffers((int) i);
+
+        GLuint vertex_array = 0;
+        glGenVertexArrays(1, &vertex_array);
+        glBindVertexArray(vertex_array);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.vertex_buffer);
+        buffers.format.set_attrib_pointers();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.index_buffer);
+
+        glBindBuffer(GL_ARRAY_BUFFER, draw_data_buffer_);
+        glEnableVertexAttribArray(kAttribDrawData);
+        glVertexAttribIPointer(kAttribDrawData, 2, GL_UNSIGNED_INT, sizeof(IndirectDrawData), (void*) 0);
+        glVertexAttribDivisor(kAttribDrawData, 1);
+
+        vertex_arrays_.push_back(vertex_array);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void IndirectDraw::clear()
+{
+    for (std::size_t i = 0; i < pools_.size(); ++i)
+    {
+        pools_[i].commands.clear();
+        pools_[i].draw_data.clear();
+    }
+    stats_ = IndirectDrawStats();
+}
+
+bool IndirectDraw::add(const DrawPacket& packet)
+{
+    const MeshPoolRange* range = packet.mesh->pool_range(packet.shading_type);
+    if (range == NULL || pool_ == NULL || packet.mesh->draw_type() != kDrawElements)
+    {
+        ++stats_.num_fallback_packets;
+        return false;
+    }
+
+    add(*range, packet);
+    return true;
+}
+
+void IndirectDraw::add(const MeshPoolRange& range, const DrawPacket& packet)
+{
+    if ((std::size_t) range.pool >= pools_.size())
+        pools_.resize(range.pool + 1);
+    PoolCommands& pool = pools_[range.pool];
+
+    // the draw list ranges are in indices of the mesh: the pool range offsets them
+    IndirectDrawData data;
+    data.object = packet.object;
+    data.material = packet.material_slot;
+    const MeshDrawList& draw_list = *packet.draw_list;
+    for (std::size_t i = 0; i < draw_list.firsts.size(); ++i)
+    {
+        DrawElementsIndirectCommand command;
+        command.count = (GLuint) draw_list.counts[i];
+        command.instance_count = 1;
+        command.first_index = range.first_index + (GLuint) draw_list.firsts[i];
+        command.base_vertex = range.base_vertex;
+        command.base_instance = 0;      // build()
+        pool.commands.push_back(command);
+        pool.draw_data.push_back(data);
+    }
+
+    // the material as the packet has it now (an edit shows in the next frame's upload)
+    if (packet.material != NULL)
+    {
+        if (packet.material_slot >= materials_.size())
+            materials_.resize(packet.material_slot + 1);
+        materials_[packet.material_slot] = MaterialUniforms(*packet.material);
+    }
+    ++stats_.num_packets;
+}
+
+void IndirectDraw::build()
+{
+    commands_.clear();
+    draw_data_.clear();
+    for (std::size_t p = 0; p < pools_.size(); ++p)
+    {
+        PoolCommands& pool = pools_[p];
+        pool.first = commands_.size();
+        commands_.insert(commands_.end(), pool.commands.begin(), pool.commands.end());
+        draw_data_.insert(draw_data_.end(), pool.draw_data.begin(), pool.draw_data.end());
+    }
+
+    // command i reads draw data i
+    for (std::size_t i = 0; i < commands_.size(); ++i)
+        commands_[i].base_instance = (GLuint) i;
+    stats_.num_commands = commands_.size();
+}
+
+void IndirectDraw::submit(GLStateCache& state, const std::vector<ObjectUniforms>& objects)
+{
+    build();
+    if (commands_.empty())
+        return;
+
+    state.bind_buffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_);
+    upload_stream(GL_DRAW_INDIRECT_BUFFER, capacity_[kCommandBuffer], commands_.data(), commands_.size() * sizeof(DrawElementsIndirectCommand));
+    state.bind_buffer(GL_ARRAY_BUFFER, draw_data_buffer_);
+    upload_stream(GL_ARRAY_BUFFER, capacity_[kDrawDataBuffer], draw_data_.data(), draw_data_.size() * sizeof(IndirectDrawData));
+    state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, kIndirectObjectBinding, object_buffer_);
+    upload_stream(GL_SHADER_STORAGE_BUFFER, capacity_[kObjectBuffer], objects.data(), objects.size() * sizeof(ObjectUniforms));
+    state.bind_buffer_base(GL_SHADER_STORAGE_BUFFER, kIndirectMaterialBinding, material_buffer_);
+    upload_stream(GL_SHADER_STORAGE_BUFFER, capacity_[kMaterialBuffer], materials_.data(), materials_.size() * sizeof(MaterialUniforms));
+    stats_.upload_bytes = commands_.size() * sizeof(DrawElementsIndirectCommand) + draw_data_.size() * sizeof(IndirectDrawData)
+                        + objects.size() * sizeof(ObjectUniforms) + materials_.size() * sizeof(MaterialUniforms);
+
+    for (std::size_t p = 0; p < pools_.size() && p < vertex_arrays_.size(); ++p)
+    {
+        const PoolCommands& pool = pools_[p];
+        if (pool.commands.empty())
+            continue;
+
+        state.bind_vertex_array(vertex_arrays_[p]);
+        state.count_draws();
+        glMultiDrawElementsIndirect(GL_TRIANGLES, pool_->buffers((int) p).index_type,
+                                    (const void*) (pool.first * sizeof(DrawElementsIndirectCommand)), (GLsizei) pool.commands.size(), 0);
+        ++stats_.num_multi_draws;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GLStateCache.h"
+#include "MeshPool.h"
+#include "RenderQueue.h"
+#include "UniformBlocks.h"
+
+// one draw of glMultiDrawElementsIndirect, as GL reads it from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+    GLuint  count;
+    GLuint  instance_count;
+    GLuint  first_index;
+    GLint   base_vertex;
+    GLuint  base_instance;      // the draw ID: the IndirectDrawData of this command
+};
+
+// a_draw_data of shader/vertex_indirect.glsl: where a draw finds its object and material
+struct IndirectDrawData
+{
+    uint32_t    object;         // in the object buffer (ObjectUniforms)
+    uint32_t    material;       // in the material buffer (MaterialUniforms; a UniformBlocks slot)
+};
+
+// shader storage bindings of shader/vertex_indirect.glsl (std430: the structs of
+// UniformBlocks.h have the same layout there)
+enum IndirectStorageBinding
+{
+    kIndirectObjectBinding = 0,
+    kIndirectMaterialBinding = 1
+};
+
+// of one frame
+struct IndirectDrawStats
+{
+    std::size_t num_packets = 0;            // drawn from the pool
+    std::size_t num_fallback_packets = 0;   // not in the pool (or kDrawArrays): the caller drew them
+    std::size_t num_commands = 0;           // a command per draw range of a packet
+    std::size_t num_multi_draws = 0;        // glMultiDrawElementsIndirect calls: one per pool drawn from
+    std::size_t upload_bytes = 0;           // commands, draw data, objects and materials
+};
+
+// the packets of a frame whose meshes are in a MeshPool, drawn with one
+// glMultiDrawElementsIndirect per pool: a command per draw range, in the order the packets are
+// added (the RenderQueue order). instance 0 of command i reads a_draw_data (divisor 1) at its
+// base_instance = i, which makes i the draw ID (gl_DrawID without GL 4.6), and the vertex shader
+// looks up the object matrices and material of its draw in two shader storage buffers.
+// GL thread only (add() and build() make no GL calls); needs GL 4.3
+class IndirectDraw
+{
+public:
+    IndirectDraw() {}
+    ~IndirectDraw();    // deletes the buffers and VAOs (GL thread)
+
+    IndirectDraw(const IndirectDraw&) = delete;
+    IndirectDraw& operator=(const IndirectDraw&) = delete;
+
+    static bool is_supported();
+
+    // draw the meshes of pool (it must outlive this, or release() first); false without GL 4.3
+    // or if the buffers could not be created
+    bool init(MeshPool& pool);
+    void release();
+    bool is_ready() const                   { return command_buffer_ != 0; }
+
+    // before GLStateCache::begin_frame(): a VAO for each pool created since
+    void update();
+
+    void clear();
+    // the commands of packet; false if its mesh is not in the pool (the caller draws it)
+    bool add(const DrawPacket& packet);
+    // the commands of packet with its mesh at range (no GL: the benchmark builds scenes with it)
+    void add(const MeshPoolRange& range, const DrawPacket& packet);
+    // commands() and draw_data() grouped by pool, with the draw IDs set
+    void build();
+
+    // build(), the uploads and a multi-draw per pool; the program of shader/vertex_indirect.glsl
+    // must be in use, with the frame block bound. objects: of DrawPacket::object
+    void submit(GLStateCache& state, const std::vector<ObjectUniforms>& objects);
+
+    const std::vector<DrawElementsIndirectCommand>& commands() const    { return commands_; }
+    const std::vector<IndirectDrawData>& draw_data() const              { return draw_data_; }
+    const IndirectDrawStats& stats() const                              { return stats_; }
+
+private:
+    // the commands of one pool in the order of add()
+    struct PoolCommands
+    {
+        std::vector<DrawElementsIndirectCommand>    commands;
+        std::vector<IndirectDrawData>               draw_data;
+        std::size_t                                 first = 0;      // in commands_ after build()
+    };
+
+    MeshPool*                   pool_ = NULL;
+    std::vector<PoolCommands>   pools_;         // [MeshPoolRange::pool]
+    std::vector<DrawElementsIndirectCommand>    commands_;
+    std::vector<IndirectDrawData>               draw_data_;
+    std::vector<MaterialUniforms>               materials_;     // [material slot], of the packets
+    IndirectDrawStats           stats_;
+
+    GLuint  command_buffer_ = 0;
+    GLuint  draw_data_buffer_ = 0;
+    GLuint  object_buffer_ = 0;
+    GLuint  material_buffer_ = 0;
+    std::size_t capacity_[4] = { 0, 0, 0, 0 };  // bytes of the buffers above
+    std::vector<GLuint>         vertex_arrays_; // [pool]: its buffers and a_draw_data
+};
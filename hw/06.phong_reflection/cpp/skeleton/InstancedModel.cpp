@@ -0,0 +1,195 @@
+#include "InstancedModel.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <random>
+
+#include "Parallel.h"
+#include "VertexFormat.h"
+
+void build_instance_matrices(const InstanceTransform* transforms, std::size_t count, const glm::mat4& mat_decode, InstanceMatrices* matrices)
+{
+    parallel_for(0, count, [&](std::size_t b, std::size_t e) {
+        for (std::size_t i = b; i < e; ++i)
+        {
+            const InstanceTransform& transform = transforms[i];
+            glm::mat3 rotate = glm::mat3_cast(transform.rotate);
+
+            glm::mat4 mat_model(1.0f);
+            glm::mat3 mat_normal;
+            for (int c = 0; c < 3; ++c)
+            {
+                float scale = transform.scale[c];
+                mat_model[c] = glm::vec4(rotate[c] * scale, 0.0f);
+                mat_normal[c] = (scale != 0.0f) ? rotate[c] / scale : glm::vec3(0.0f);
+            }
+            mat_model[3] = glm::vec4(transform.translate, 1.0f);
+
+            matrices[i].model_matrix = mat_model * mat_decode;
+            matrices[i].normal_matrix = mat_normal;
+        }
+    }, 0, 16384);
+}
+
+std::vector<InstanceTransform> make_instance_grid(std::size_t count, const glm::vec3& center, float spacing, const glm::vec3& scale, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> jitter(-0.25f * spacing, 0.25f * spacing);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> size(0.8f, 1.2f);
+
+    std::size_t side = (std::size_t) std::ceil(std::sqrt((double) count));
+    float offset = 0.5f * (side - 1) * spacing;
+
+    std::vector<InstanceTransform> transforms(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        InstanceTransform& transform = transforms[i];
+        transform.translate = center + glm::vec3((i % side) * spacing - offset + jitter(rng), 0.0f, (i / side) * spacing - offset + jitter(rng));
+        transform.rotate = glm::angleAxis(angle(rng), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform.scale = scale * size(rng);
+    }
+    return transforms;
+}
+
+InstancedModel::InstancedModel(const Model& model)
+    : shading_type(model.shading_type), model_(model)
+{
+}
+
+InstancedModel::~InstancedModel()
+{
+    if (instance_buffer_ == 0)
+        return;
+
+    if (!vertex_arrays_.empty())
+        glDeleteVertexArrays((GLsizei) vertex_arrays_.size(), &vertex_arrays_[0]);
+    glDeleteBuffers(1, &instance_buffer_);
+}
+
+bool InstancedModel::is_supported()
+{
+    // glVertexAttribDivisor
+    return GLEW_VERSION_3_3;
+}
+
+void InstancedModel::update()
+{
+    if (instance_buffer_ == 0)
+        create_vertex_arrays_();
+    if (!is_dirty_)
+        return;
+
+    matrices_.resize(instances_.size());
+    build_instance_matrices(instances_.data(), instances_.size(), model_.get_position_decode_matrix(), matrices_.data());
+
+    // the VAOs point at instance_buffer_, not at its storage: a larger store keeps them valid
+    glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+    if (matrices_.size() > instance_capacity_)
+    {
+        instance_capacity_ = std::max(matrices_.size(), 2 * instance_capacity_);
+        glBufferData(GL_ARRAY_BUFFER, instance_capacity_ * sizeof(InstanceMatrices), NULL, GL_STATIC_DRAW);
+    }
+    if (!matrices_.empty())
+        glBufferSubData(GL_ARRAY_BUFFER, 0, matrices_.size() * sizeof(InstanceMatrices), matrices_.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // the staging is as large as the buffer: built again on the next edit
+    std::vector<InstanceMatrices>().swap(matrices_);
+    is_dirty_ = false;
+}
+
+void InstancedModel::create_vertex_arrays_()
+{
+    glGenBuffers(1, &instance_buffer_);
+
+    const std::vector<Mesh>& meshes = model_.meshes();
+    vertex_arrays_.resize(2 * meshes.size());
+    if (vertex_arrays_.empty())
+        return;
+    glGenVertexArrays((GLsizei) vertex_arrays_.size(), &vertex_arrays_[0]);
+
+    // the attributes of the mesh, then the instance matrices a column per location, advanced per instance
+    const GLsizei stride = sizeof(InstanceMatrices);
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        for (int s = kSmooth; s <= kFlat; ++s)
+        {
+            glBindVertexArray(vertex_arrays_[2 * i + s]);
+            meshes[i].bind_gl_buffers((ShadingType) s);
+
+            glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+            for (int c = 0; c < 4; ++c)
+            {
+                GLuint location = kAttribInstanceModel + c;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*) (offsetof(InstanceMatrices, model_matrix) + c * sizeof(glm::vec4)));
+                glVertexAttribDivisor(location, 1);
+            }
+            for (int c = 0; c < 3; ++c)
+            {
+                GLuint location = kAttribInstanceNormal + c;
+                glEnableVertexAttribArray(location);
+                glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, (void*) (offsetof(InstanceMatrices, normal_matrix) + c * sizeof(glm::vec3)));
+                glVertexAttribDivisor(location, 1);
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstancedModel::cull(const glm::mat4& mat_view_proj, const glm::vec3& camera_position, const LodSelection& lod_selection, MeshletCullStats& stats)
+{
+    num_drawn_triangles_ = 0;
+    if (instances_.empty())
+        return;
+
+    // the instance nearest to the camera picks the LOD of all (the finest any of them needs)
+    std::size_t nearest = 0;
+    float nearest_distance = FLT_MAX;
+    for (std::size_t i = 0; i < instances_.size(); ++i)
+    {
+        glm::vec3 d = instances_[i].translate - camera_position;
+        float distance = glm::dot(d, d);
+        if (distance < nearest_distance)
+        {
+            nearest = i;
+            nearest_distance = distance;
+        }
+    }
+    model_.set_translate(instances_[nearest].translate);
+    model_.set_rotate(instances_[nearest].rotate);
+    model_.set_scale(instances_[nearest].scale);
+
+    // no meshlet culling: the meshlets facing away from one instance face others
+    MeshletCullStats model_stats;
+    model_.cull(mat_view_proj, camera_position, false, lod_selection, model_stats);
+
+    num_drawn_triangles_ = model_stats.num_drawn_triangles * instances_.size();
+    stats.num_meshlets += model_stats.num_meshlets * instances_.size();
+    stats.num_triangles += model_stats.num_triangles * instances_.size();
+    stats.num_drawn_triangles += num_drawn_triangles_;
+    stats.num_draw_ranges += model_stats.num_draw_ranges;
+}
+
+void InstancedModel::draw(GLStateCache& state, UniformBlocks& blocks, GLint loc_u_oct_normal)
+{
+    // nothing is drawn before the first update() and cull()
+    const std::vector<Mesh>& meshes = model_.meshes();
+    const std::vector<MeshDrawList>& draw_lists = model_.draw_lists();
+    if (instances_.empty() || is_dirty_ || draw_lists.size() != meshes.size())
+        return;
+
+    state.uniform(loc_u_oct_normal, (int) (model_.vertex_precision != kVertexFloat));
+
+    const std::vector<unsigned int>& slots = model_.material_slots(blocks);
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        blocks.bind_material(slots[i], meshes[i].material);
+        meshes[i].draw_instanced(shading_type, draw_lists[i], vertex_arrays_[2 * i + shading_type], (GLsizei) instances_.size(), state);
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Model.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+
+// where one copy of an InstancedModel is (the translate / rotate / scale of a Model)
+struct InstanceTransform
+{
+    glm::vec3   translate = glm::vec3(0.0f);
+    glm::quat   rotate = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3   scale = glm::vec3(1.0f);
+};
+
+// one instance in the instance buffer: a_instance_model and a_instance_normal of
+// shader/vertex_instanced.glsl
+struct InstanceMatrices
+{
+    glm::mat4   model_matrix;       // with the position decode of the asset (quantized vertices)
+    glm::mat3   normal_matrix;
+};
+
+// the matrices of transforms[0, count): model = T R S decode, normal = R S^-1 (the inverse
+// transpose of a TRS without forming the inverse; a zero scale gives a zero column)
+void build_instance_matrices(const InstanceTransform* transforms, std::size_t count, const glm::mat4& mat_decode, InstanceMatrices* matrices);
+
+// count copies on a jittered grid in the xz plane around center, spacing apart, with a random
+// turn about y and a scale of scale +-20% (the stress scenes)
+std::vector<InstanceTransform> make_instance_grid(std::size_t count, const glm::vec3& center, float spacing, const glm::vec3& scale, unsigned int seed = 1);
+
+// many copies of one Model in a draw per mesh (glDraw*Instanced): the transforms are kept in
+// one array, and their matrices in an instance buffer the VAOs of this model read per instance.
+// the meshes come from the Model (shared, as in AssetRegistry; it must be uploaded), drawn with
+// the LOD the instance nearest to the camera needs. GL 3.3 and the uniform blocks (the frame
+// and material blocks; see shader/vertex_instanced.glsl)
+class InstancedModel
+{
+public:
+    ShadingType shading_type = kSmooth;
+
+public:
+    explicit InstancedModel(const Model& model);    // its meshes and shading type
+    ~InstancedModel();      // deletes the VAOs and the instance buffer (GL thread)
+
+    InstancedModel(const InstancedModel&) = delete;
+    InstancedModel& operator=(const InstancedModel&) = delete;
+
+    static bool is_supported();
+
+    const std::vector<InstanceTransform>& instances() const     { return instances_; }
+    std::vector<InstanceTransform>& edit_instances()    { is_dirty_ = true; return instances_; }
+    std::size_t num_instances() const                   { return instances_.size(); }
+
+    // GL thread, before the draws of the frame: creates the VAOs (the first time) and uploads the
+    // instance matrices if the instances were edited
+    void update();
+
+    // choose the LOD of each mesh for the next draw(); stats counts the triangles of all instances
+    void cull(const glm::mat4& mat_view_proj, const glm::vec3& camera_position, const LodSelection& lod_selection, MeshletCullStats& stats);
+    // the program of shader/vertex_instanced.glsl must be in use (loc_u_oct_normal of it)
+    void draw(GLStateCache& state, UniformBlocks& blocks, GLint loc_u_oct_normal);
+
+    const Model& model() const                  { return model_; }
+    std::size_t num_drawn_triangles() const     { return num_drawn_triangles_; }    // of the last cull(), all instances
+    std::size_t gpu_bytes() const               { return instance_capacity_ * sizeof(InstanceMatrices); }
+
+private:
+    void create_vertex_arrays_();
+
+    Model                           model_;         // the meshes; its transform is the nearest instance's (cull())
+    std::vector<InstanceTransform>  instances_;
+    std::vector<InstanceMatrices>   matrices_;      // staging of update()
+    bool                            is_dirty_ = true;
+    std::size_t                     num_drawn_triangles_ = 0;
+
+    GLuint                  instance_buffer_ = 0;
+    std::size_t             instance_capacity_ = 0; // instances the buffer holds
+    std::vector<GLuint>     vertex_arrays_;         // [2 * mesh + shading type]
+};
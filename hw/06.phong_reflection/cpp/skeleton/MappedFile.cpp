@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+#ifdef MAPPED_FILE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_ = (std::size_t) st.st_size;
+    if (size_ > 0)
+    {
+        void* p = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED)
+        {
+            size_ = 0;
+            return false;
+        }
+        data_ = (const unsigned char*) p;
+        is_mapped_ = true;
+        return true;
+    }
+    ::close(fd);
+#else
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == NULL)
+        return false;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buffer_.resize(size > 0 ? (std::size_t) size : 0);
+    std::size_t num_read = buffer_.empty() ? 0 : fread(&buffer_[0], 1, buffer_.size(), fp);
+    fclose(fp);
+    if (num_read != buffer_.size())
+    {
+        buffer_.clear();
+        return false;
+    }
+    size_ = buffer_.size();
+#endif
+
+    // an empty file is still an open file
+    if (buffer_.empty())
+        buffer_.resize(1);
+    data_ = &buffer_[0];
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef MAPPED_FILE_MMAP
+    if (is_mapped_)
+        munmap((void*) data_, size_);
+#endif
+    data_ = NULL;
+    size_ = 0;
+    is_mapped_ = false;
+    buffer_.clear();
+}
+
+bool stat_file(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+
+    size = (uint64_t) st.st_size;
+    mtime = (int64_t) st.st_mtime;
+    return true;
+}
+
+uint64_t hash_bytes(const void* data, std::size_t size, uint64_t hash)
+{
+    const unsigned char* p = (const unsigned char*) data;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// read-only view of a whole file: mmap() on POSIX, read into memory elsewhere
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile()   { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const                    { return data_ != NULL; }
+    const unsigned char* data() const       { return data_; }
+    std::size_t size() const                { return size_; }
+
+private:
+    const unsigned char*        data_ = NULL;
+    std::size_t                 size_ = 0;
+    bool                        is_mapped_ = false;
+    std::vector<unsigned char>  buffer_;        // fallback without mmap (or for empty files)
+};
+
+// size and modification time of a file (false if it does not exist)
+bool stat_file(const std::string& path, uint64_t& size, int64_t& mtime);
+
+// 64-bit FNV-1a
+uint64_t hash_bytes(const void* data, std::size_t size, uint64_t hash = 14695981039346656037ull);
@@ -1,135 +1,822 @@
 #include "Mesh.h"
+#include "VertexNormals.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// the streams a Mesh reads from an aiMesh, copied out so the scene can be released
+static std::shared_ptr<const MeshArrays> copy_ai_mesh(const aiMesh* _pmesh)
+{
+    // aiVector3D / aiColor4D are plain float structs with the layout of glm::vec3 / glm::vec4
+    std::shared_ptr<MeshArrays> arrays = std::make_shared<MeshArrays>();
+    unsigned int num_vertices = _pmesh->mNumVertices;
+    const glm::vec3* positions = (const glm::vec3*) _pmesh->mVertices;
+    arrays->positions.assign(positions, positions + num_vertices);
+    if (_pmesh->HasNormals())
+    {
+        const glm::vec3* normals = (const glm::vec3*) _pmesh->mNormals;
+        arrays->normals.assign(normals, normals + num_vertices);
+    }
+    if (_pmesh->HasVertexColors(0))
+    {
+        const glm::vec4* colors = (const glm::vec4*) _pmesh->mColors[0];
+        arrays->colors.assign(colors, colors + num_vertices);
+    }
+    if (_pmesh->HasTextureCoords(0))
+    {
+        const glm::vec3* texcoords = (const glm::vec3*) _pmesh->mTextureCoords[0];
+        arrays->texcoords.assign(texcoords, texcoords + num_vertices);
+    }
+
+    for (unsigned int i = 0; i < _pmesh->mNumFaces; ++i) 
+    {
+        const aiFace& ai_face = _pmesh->mFaces[i];
+        if (ai_face.mNumIndices < 3)
+            continue;   // a point or a line (import flags without aiProcess_SortByPType)
+
+        // convert a polygon to a triangle fan
+        for (unsigned int idx = 0; idx < ai_face.mNumIndices - 2; ++idx)
+        {
+            arrays->tv_indices.push_back(ai_face.mIndices[0]);
+            arrays->tv_indices.push_back(ai_face.mIndices[idx+1]);
+            arrays->tv_indices.push_back(ai_face.mIndices[idx+2]);
+        }
+    }
+    return arrays;
+}
+
+Mesh::Mesh(const aiMesh* _pmesh) : Mesh(copy_ai_mesh(_pmesh))
+{
+}
+
+Mesh::Mesh(const std::shared_ptr<const MeshArrays>& _arrays)
+{
+    set_streams_(_arrays);
+    num_source_vertices_ = _arrays->num_vertices();
+}
+
+void Mesh::set_streams_(const std::shared_ptr<const MeshArrays>& _arrays)
+{
+    // the arrays are used in place and live as long as the mesh
+    const MeshArrays& arrays = *_arrays;
+    streams_owner_ = _arrays;
+    streams_ = MeshStreams();
+    streams_.positions = arrays.positions.empty() ? NULL : &arrays.positions[0];
+    streams_.normals = arrays.normals.empty() ? NULL : &arrays.normals[0];
+    streams_.colors = arrays.colors.empty() ? NULL : &arrays.colors[0];
+    streams_.texcoords = arrays.texcoords.empty() ? NULL : &arrays.texcoords[0];
+    streams_.num_vertices = (unsigned int) arrays.num_vertices();
+    streams_.tv_indices = arrays.tv_indices.empty() ? NULL : &arrays.tv_indices[0];
+    streams_.num_tv_indices = arrays.tv_indices.size();
+}
+
+bool Mesh::has_vertex_arrays()
+{
+    return GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
+}
 
 void Mesh::gen_gl_buffers()
 {
-    glGenBuffers(1, &position_buffer_);
-    glGenBuffers(1, &color_buffer_);
-    glGenBuffers(1, &normal_buffer_);
+    // the buffers come with the first upload: of the mesh's own, or ranges of the MeshPool
+    if (has_vertex_arrays())
+        glGenVertexArrays(2, vertex_array_);
 }
 
+void Mesh::delete_gl_buffers()
+{
+    // a mesh that was never uploaded has no buffers (and maybe no GL context to call)
+    if (vertex_array_[kSmooth] == 0 && vertex_buffer_[kSmooth] == 0 && vertex_buffer_[kFlat] == 0)
+        return;
+
+    if (vertex_array_[kSmooth] != 0)
+        glDeleteVertexArrays(2, vertex_array_);
+    for (int s = kSmooth; s <= kFlat; ++s)
+    {
+        release_gl_storage_((ShadingType) s);
+        vertex_array_[s] = 0;
+    }
+}
+
+void Mesh::detach_gl_buffers()
+{
+    // the handles stay with the mesh this was copied from (and its last owner deletes them)
+    for (int s = kSmooth; s <= kFlat; ++s)
+    {
+        vertex_array_[s] = vertex_buffer_[s] = index_buffer_[s] = 0;
+        pool_[s] = NULL;
+        pool_range_[s] = MeshPoolRange();
+        gpu_bytes_[s] = 0;
+    }
+}
+
+void Mesh::release_gl_storage_(ShadingType shading_type)
+{
+    if (pool_[shading_type] != NULL)
+    {
+        // the buffers are the pool's
+        pool_[shading_type]->free(pool_range_[shading_type]);
+        pool_[shading_type] = NULL;
+        pool_range_[shading_type] = MeshPoolRange();
+    }
+    else
+    {
+        glDeleteBuffers(1, &vertex_buffer_[shading_type]);
+        glDeleteBuffers(1, &index_buffer_[shading_type]);
+    }
+    vertex_buffer_[shading_type] = index_buffer_[shading_type] = 0;
+    gpu_bytes_[shading_type] = 0;
+}
 
 void Mesh::update_tv_indices()
 {
     // triangle-vertex indices
-    tv_indices_.clear();
-    for (unsigned int i = 0; i < pmesh_->mNumFaces; ++i) 
+    tv_indices_.assign(streams_.tv_indices, streams_.tv_indices + streams_.num_tv_indices);
+
+    vertex_src_.resize(streams_.num_vertices);
+    for (unsigned int v = 0; v < streams_.num_vertices; ++v)
+        vertex_src_[v] = v;
+}
+
+template <typename T>
+static void gather_stream(const T* stream, const std::vector<unsigned int>& vertex_src, std::vector<T>& values)
+{
+    if (stream == NULL)
+        return;
+    values.resize(vertex_src.size());
+    for (std::size_t v = 0; v < values.size(); ++v)
+        values[v] = stream[vertex_src[v]];
+}
+
+void Mesh::compact_streams()
+{
+    // the triangles are in tv_indices_ already; the source arrays go once no other mesh uses them
+    std::shared_ptr<MeshArrays> arrays = std::make_shared<MeshArrays>();
+    gather_stream(streams_.positions, vertex_src_, arrays->positions);
+    gather_stream(streams_.normals, vertex_src_, arrays->normals);
+    gather_stream(streams_.colors, vertex_src_, arrays->colors);
+    gather_stream(streams_.texcoords, vertex_src_, arrays->texcoords);
+    set_streams_(arrays);
+
+    for (unsigned int v = 0; v < vertex_src_.size(); ++v)
+        vertex_src_[v] = v;
+}
+
+
+void Mesh::optimize_vertex_cache(std::ostream& log)
+{
+    // reorder triangles only; the flat-shading split follows the new order
+    VertexCacheStats before = analyze_vertex_cache(tv_indices_, num_vertices());
+    reorder_for_vertex_cache(tv_indices_, num_vertices());
+    VertexCacheStats after = analyze_vertex_cache(tv_indices_, num_vertices());
+
+    log << "vertex cache (FIFO 16): ACMR " << before.acmr << " -> " << after.acmr
+        << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+void Mesh::optimize_overdraw(std::ostream& log)
+{
+    // expects a vertex-cache optimized tv_indices_ (clusters are cut along its cache runs)
+    std::vector<glm::vec3> positions;
+    gather_positions_(positions);
+
+    OverdrawStats before = estimate_overdraw(tv_indices_, &positions[0], positions.size());
+    reorder_for_overdraw(tv_indices_, &positions[0], positions.size());
+    OverdrawStats after = estimate_overdraw(tv_indices_, &positions[0], positions.size());
+
+    log << "overdraw (CPU estimate): " << before.overdraw << " -> " << after.overdraw
+        << ", ACMR " << analyze_vertex_cache(tv_indices_, num_vertices()).acmr << std::endl;
+}
+
+void Mesh::optimize_vertex_fetch()
+{
+    // runs after the triangle order is final: renumber vertices in first-use order
+    // and drop the unreferenced ones (vertex_src_ remaps every stream)
+    std::vector<unsigned int> new_src;
+    reorder_for_vertex_fetch(tv_indices_, num_vertices(), new_src);
+
+    // LOD vertices are a subset of the LOD 0 vertices, so they all have a new number
+    if (!lod_indices_.empty())
     {
-        aiFace& ai_face = pmesh_->mFaces[i];
-        assert(ai_face.mNumIndices >= 3);
+        std::vector<unsigned int> new_index(num_vertices());
+        for (std::size_t v = 0; v < new_src.size(); ++v)
+            new_index[new_src[v]] = (unsigned int) v;
+        for (std::size_t i = 0; i < lod_indices_.size(); ++i)
+            lod_indices_[i] = new_index[lod_indices_[i]];
+    }
 
-        // convert a polygon to a triangle fan
-        for (unsigned int idx = 0; idx < ai_face.mNumIndices - 2; ++idx)
+    for (std::size_t v = 0; v < new_src.size(); ++v)
+        new_src[v] = vertex_src_[new_src[v]];
+    vertex_src_.swap(new_src);
+}
+
+void Mesh::build_meshlets(std::ostream& log)
+{
+    // keeps the order of the previous passes as far as the meshlets allow
+    std::vector<glm::vec3> positions;
+    gather_positions_(positions);
+    ::build_meshlets(tv_indices_, &positions[0], positions.size(), meshlets_);
+
+    std::size_t num_meshlet_vertices = 0;
+    for (std::size_t m = 0; m < meshlets_.size(); ++m)
+        num_meshlet_vertices += meshlets_[m].vertex_count;
+
+    std::size_t num_triangles = tv_indices_.size() / 3;
+    log << "meshlets: " << meshlets_.size() << " (avg " << (float) num_meshlet_vertices / meshlets_.size() << " vertices, "
+        << (float) num_triangles / meshlets_.size() << " triangles)"
+        << ", ACMR " << analyze_vertex_cache(tv_indices_, num_vertices()).acmr << std::endl;
+}
+
+void Mesh::build_lods(std::ostream& log)
+{
+    // runs after the passes that reorder tv_indices_ (LOD 0 keeps their order)
+    std::vector<glm::vec3> positions;
+    gather_positions_(positions);
+    build_lod_chain(tv_indices_, &positions[0], positions.size(), lod_indices_, lods_);
+
+    glm::vec3 p_min = positions[0], p_max = positions[0];
+    for (std::size_t v = 1; v < positions.size(); ++v)
+    {
+        p_min = glm::min(p_min, positions[v]);
+        p_max = glm::max(p_max, positions[v]);
+    }
+    lod_center_ = 0.5f * (p_min + p_max);
+    float radius = 0.5f * glm::length(p_max - p_min);
+
+    for (std::size_t l = 0; l < lods_.size(); ++l)
+    {
+        log << "LOD " << l << ": " << lods_[l].index_count / 3 << " triangles, error " << lods_[l].error
+            << " (" << (radius > 0.0f ? lods_[l].error / radius : 0.0f) << " x radius)" << std::endl;
+    }
+}
+
+void Mesh::cull(const glm::mat4& mat_PVM, const glm::vec3& camera_position, bool is_culling, const LodSelection& lod_selection, MeshletCullStats& stats, MeshDrawList& draw_list) const
+{
+    std::vector<GLint>& draw_firsts = draw_list.firsts;
+    std::vector<GLsizei>& draw_counts = draw_list.counts;
+    draw_firsts.clear();
+    draw_counts.clear();
+
+    std::size_t num_triangles = tv_indices_.size() / 3;
+    stats.num_triangles += num_triangles;
+
+    // LOD: the error projected at the mesh center (w: distance along the view axis, 1 for ortho)
+    draw_list.lod = 0;
+    if (lod_selection.forced_lod >= 0)
+    {
+        draw_list.lod = std::min<unsigned int>(lod_selection.forced_lod, lods_.empty() ? 0 : (unsigned int) lods_.size() - 1);
+    }
+    else if (!lods_.empty())
+    {
+        float w = (mat_PVM * glm::vec4(lod_center_, 1.0f)).w;
+        if (w > 0.0f)
+            draw_list.lod = select_lod(lods_, lod_selection.pixels_per_unit / w, lod_selection.max_pixel_error);
+    }
+
+    if (draw_list.lod > 0)
+    {
+        // meshlets are built on LOD 0 only; a coarser LOD is one range
+        stats.num_drawn_triangles += lods_[draw_list.lod].index_count / 3;
+        stats.num_draw_ranges += 1;
+        draw_firsts.push_back((GLint) lods_[draw_list.lod].index_offset);
+        draw_counts.push_back((GLsizei) lods_[draw_list.lod].index_count);
+        return;
+    }
+
+    if (!is_culling || meshlets_.empty())
+    {
+        stats.num_meshlets += meshlets_.size();
+        stats.num_drawn_triangles += num_triangles;
+        stats.num_draw_ranges += 1;
+        draw_firsts.push_back(0);
+        draw_counts.push_back((GLsizei) (3 * num_triangles));
+        return;
+    }
+
+    Frustum frustum = extract_frustum(mat_PVM);
+    for (std::size_t m = 0; m < meshlets_.size(); ++m)
+    {
+        const Meshlet& meshlet = meshlets_[m];
+        ++stats.num_meshlets;
+
+        if (is_meshlet_outside(meshlet, frustum))
         {
-            tv_indices_.push_back(ai_face.mIndices[0]);
-            tv_indices_.push_back(ai_face.mIndices[idx+1]);
-            tv_indices_.push_back(ai_face.mIndices[idx+2]);
+            ++stats.num_outside;
+            continue;
+        }
+        if (is_meshlet_backfacing(meshlet, camera_position))
+        {
+            ++stats.num_backfacing;
+            continue;
+        }
+        stats.num_drawn_triangles += meshlet.triangle_count;
+
+        // visible neighbors are adjacent in the index buffer: extend the last range
+        GLint first = (GLint) (3 * meshlet.triangle_offset);
+        if (!draw_firsts.empty() && draw_firsts.back() + draw_counts.back() == first)
+        {
+            draw_counts.back() += (GLsizei) (3 * meshlet.triangle_count);
+        }
+        else
+        {
+            draw_firsts.push_back(first);
+            draw_counts.push_back((GLsizei) (3 * meshlet.triangle_count));
         }
     }
+    stats.num_draw_ranges += draw_firsts.size();
 }
 
+void Mesh::gather_positions_(std::vector<glm::vec3>& positions) const
+{
+    positions.resize(num_vertices());
+    for (std::size_t v = 0; v < positions.size(); ++v)
+        positions[v] = streams_.positions[vertex_src_[v]];
+}
 
-void Mesh::set_gl_position_buffer_()
+void Mesh::compute_normals_(const std::vector<unsigned int>& draw_indices, Vec3SoA& f_normals, Vec3SoA& v_smooth_normals) const
 {
-    assert(pmesh_->HasPositions());
+    // SoA copy of the positions for the SIMD kernels
+    std::size_t num_vertices = vertex_src_.size();
+    Vec3SoA positions;
+    positions.resize(num_vertices);
+    for (std::size_t v = 0; v < num_vertices; ++v)
+        positions.set(v, streams_.positions[vertex_src_[v]]);
 
-    std::vector<glm::vec3>  tv_positions;       // per triangle-vertex 3D position (size = 3 x #triangles)
-    
-    // TODO: for each triangle, set tv_positions
+    // per-triangle normal (size = #triangles of all LODs; LOD 0 = tv_indices_ comes first)
+    compute_face_normals(positions, draw_indices, f_normals);
+
+    // if the mesh has per-vertex normals, then just use them.
+    if (streams_.normals != NULL)
+    {
+        v_smooth_normals.resize(num_vertices);
+        for (std::size_t v = 0; v < num_vertices; ++v)
+            v_smooth_normals.set(v, streams_.normals[vertex_src_[v]]);
+    }
+    else
+    {
+        compute_vertex_normals(f_normals, tv_indices_, num_vertices, v_smooth_normals);
+    }
+}
+
+void Mesh::split_flat_vertices_(const std::vector<unsigned int>& draw_indices, const Vec3SoA& f_normals, std::vector<unsigned int>& v_src, Vec3SoA& v_normals, std::vector<unsigned int>& indices) const
+{
+    // split a vertex only if its adjacent triangles have different face normals.
+    // split_head[v] / split_next[w] chain the output vertices made from mesh vertex v.
+    const unsigned int kNone = 0xFFFFFFFFu;
+    std::vector<unsigned int>   split_head(num_vertices(), kNone);
+    std::vector<unsigned int>   split_next;
+
+    v_src.clear();
+    v_normals.clear();
+    indices.resize(draw_indices.size());
+    for (std::size_t i = 0; i < draw_indices.size(); ++i)
+    {
+        unsigned int v = draw_indices[i];
+        glm::vec3 f_normal = f_normals.get(i/3);
+
+        unsigned int w = split_head[v];
+        while (w != kNone && v_normals.get(w) != f_normal)
+            w = split_next[w];
 
-    glBindBuffer(GL_ARRAY_BUFFER, position_buffer_);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*tv_positions.size(), &tv_positions[0], GL_STATIC_DRAW);
+        if (w == kNone)
+        {
+            w = (unsigned int) v_src.size();
+            v_src.push_back(v);
+            v_normals.push_back(f_normal);
+            split_next.push_back(split_head[v]);
+            split_head[v] = w;
+        }
+        indices[i] = w;
+    }
 }
 
-void Mesh::set_gl_color_buffer_(unsigned int cs_idx)
+void Mesh::pack_vertex_array_(const std::vector<unsigned int>& v_src, const Vec3SoA& v_normals, const std::vector<unsigned int>& indices,
+                              std::vector<unsigned char>& vertices, std::vector<unsigned char>& index_bytes, GLenum& index_type)
 {
-    assert(pmesh_->HasVertexColors(cs_idx));
+    // interleave the attributes of format_ (v_src[i]: mesh vertex of the i-th output vertex)
+    const GLsizei stride = format_.stride();
+    vertices.assign(stride * v_src.size(), 0);
+
+    for (std::size_t i = 0; i < v_src.size(); ++i)
+    {
+        unsigned char* vertex = &vertices[stride * i];
+        unsigned int v = vertex_src_[v_src[i]];     // stream vertex
+
+        glm::vec3 position = streams_.positions[v];
+        glm::vec3 normal = v_normals.get(i);
+
+        if (precision_ == kVertexFloat)
+        {
+            format_.pack(kAttribPosition, vertex, &position[0]);
+            format_.pack(kAttribNormal, vertex, &normal[0]);
+        }
+        else
+        {
+            // the shader gets [0, 1]^3; Model::get_position_decode_matrix() maps it back
+            glm::vec3 unorm_position = (position - box_min_) / box_extent_;
+            glm::vec2 oct_normal = oct_encode(normal, (precision_ == kVertexQuantized16) ? 16 : 8);
+            format_.pack(kAttribPosition, vertex, &unorm_position[0]);
+            format_.pack(kAttribNormal, vertex, &oct_normal[0]);
+        }
+        if (format_.has(kAttribColor))
+            format_.pack(kAttribColor, vertex, &streams_.colors[v][0]);
+        if (format_.has(kAttribTexcoord))
+            format_.pack(kAttribTexcoord, vertex, &streams_.texcoords[v][0]);
 
-    std::vector<glm::vec3>  tv_colors;       // per triangle-vertex 3D position (size = 3 x #triangles)
+        if (precision_ != kVertexFloat)
+        {
+            // decode as the GPU does and compare with the float data
+            glm::vec3 decoded;
+            format_.unpack(kAttribPosition, vertex, &decoded[0]);
+            decoded = box_min_ + decoded * box_extent_;
+            quantization_error_.max_position = std::max(quantization_error_.max_position, glm::length(decoded - position));
 
-    // TODO: for each triangle, set tv_colors
+            glm::vec2 oct;
+            format_.unpack(kAttribNormal, vertex, &oct[0]);
+            glm::vec3 decoded_normal = oct_decode(oct);
+            float angle = std::atan2(glm::length(glm::cross(decoded_normal, normal)), glm::dot(decoded_normal, normal));
+            quantization_error_.max_normal_degrees = std::max(quantization_error_.max_normal_degrees, glm::degrees(angle));
 
-    glBindBuffer(GL_ARRAY_BUFFER, color_buffer_);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*tv_colors.size(), &tv_colors[0], GL_STATIC_DRAW);
+            if (format_.has(kAttribColor))
+            {
+                float color[4];
+                format_.unpack(kAttribColor, vertex, color);
+                for (int k = 0; k < 4; ++k)
+                    quantization_error_.max_color = std::max(quantization_error_.max_color, std::fabs(color[k] - streams_.colors[v][k]));
+            }
+        }
+    }
 
-    is_color_ = true;
+    if (v_src.size() <= 0xFFFF)
+    {
+        // 16-bit indices are enough for most meshes
+        std::vector<unsigned short> indices16(indices.begin(), indices.end());
+        index_bytes.resize(sizeof(unsigned short)*indices16.size());
+        if (!indices16.empty())
+            memcpy(&index_bytes[0], &indices16[0], index_bytes.size());
+        index_type = GL_UNSIGNED_SHORT;
+    }
+    else
+    {
+        index_bytes.resize(sizeof(unsigned int)*indices.size());
+        if (!indices.empty())
+            memcpy(&index_bytes[0], &indices[0], index_bytes.size());
+        index_type = GL_UNSIGNED_INT;
+    }
+}
+
+void Mesh::upload_gl_buffers(ShadingType shading_type, const void* vertices, std::size_t vertex_bytes, const void* indices, std::size_t index_bytes, GLenum index_type)
+{
+    allocate_gl_buffers(shading_type, vertex_bytes, index_bytes, index_type);
+    upload_gl_buffer_range(shading_type, false, 0, vertices, vertex_bytes);
+    upload_gl_buffer_range(shading_type, true, 0, indices, index_bytes);
 }
 
+void Mesh::allocate_gl_buffers(ShadingType shading_type, std::size_t vertex_bytes, std::size_t index_bytes, GLenum index_type)
+{
+    MeshPool* pool = MeshPool::active();
+    if (pool != NULL || pool_[shading_type] != NULL)
+        release_gl_storage_(shading_type);
+
+    index_type_[shading_type] = index_type;
+    gpu_bytes_[shading_type] = vertex_bytes + index_bytes;
+
+    if (pool != NULL)
+    {
+        // ranges of the pool buffers of this format and index type
+        std::size_t index_size = (index_type == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+        assert(vertex_bytes % format_.stride() == 0 && index_bytes % index_size == 0);
+        pool_[shading_type] = pool;
+        pool_range_[shading_type] = pool->allocate(format_, index_type, vertex_bytes / format_.stride(), index_bytes / index_size);
+
+        const MeshPoolBuffers& buffers = pool->buffers(pool_range_[shading_type].pool);
+        vertex_buffer_[shading_type] = buffers.vertex_buffer;
+        index_buffer_[shading_type] = buffers.index_buffer;
+    }
+    else
+    {
+        if (vertex_buffer_[shading_type] == 0)
+        {
+            glGenBuffers(1, &vertex_buffer_[shading_type]);
+            glGenBuffers(1, &index_buffer_[shading_type]);
+        }
+
+        // a buffer object has no fixed target: the index buffer gets its store through
+        // GL_ARRAY_BUFFER too, which leaves the element array binding of a bound VAO alone
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_[shading_type]);
+        glBufferData(GL_ARRAY_BUFFER, vertex_bytes, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, index_buffer_[shading_type]);
+        glBufferData(GL_ARRAY_BUFFER, index_bytes, NULL, GL_STATIC_DRAW);
+    }
 
-void Mesh::set_gl_normal_buffer_(ShadingType shading_type)
+    if (vertex_array_[shading_type] != 0)
+    {
+        glBindVertexArray(vertex_array_[shading_type]);
+        bind_gl_buffers(shading_type);
+        glBindVertexArray(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Mesh::upload_gl_buffer_range(ShadingType shading_type, bool is_index_buffer, std::size_t offset, const void* data, std::size_t size)
 {
-    std::vector<glm::vec3>      tv_flat_normals;    // per triangle-vertex flat normal (size = 3 x #triangles)
-    std::vector<glm::vec3>      tv_smooth_normals;  // per triangle-vertex smooth normal (size = 3 x #triangles)
-    std::vector<glm::vec3>      v_smooth_normals;   // per-vertex 3D normal (size = #vertices)
+    if (size == 0)
+        return;
 
-    // init normals
-    v_smooth_normals.resize(pmesh_->mNumVertices);
-    for (std::size_t i = 0; i < v_smooth_normals.size(); ++i)
-        v_smooth_normals[i] = glm::vec3(0.0f, 0.0f, 0.0f);
+    // a buffer object has no fixed target: writing the index buffer through GL_ARRAY_BUFFER
+    // leaves the element array binding of whatever VAO is bound alone
+    std::size_t base_offset = is_index_buffer ? index_offset_(shading_type) : vertex_offset_(shading_type);
+    glBindBuffer(GL_ARRAY_BUFFER, is_index_buffer ? index_buffer_[shading_type] : vertex_buffer_[shading_type]);
+    glBufferSubData(GL_ARRAY_BUFFER, base_offset + offset, size, data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Mesh::bind_gl_buffers(ShadingType shading_type) const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_[shading_type]);
+    format_.set_attrib_pointers(vertex_offset_(shading_type));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_[shading_type]);
+}
 
-    // TODO: compute per-triangle normal & 
-    //       add_up to tv_flat_normals & v_smooth_normals
-    tv_flat_normals.resize(tv_indices_.size());
+std::size_t Mesh::vertex_offset_(ShadingType shading_type) const
+{
+    return (pool_[shading_type] != NULL) ? pool_range_[shading_type].base_vertex * (std::size_t) format_.stride() : 0;
+}
 
-    // normalize v_smooth_normals
-    for (std::size_t i = 0; i < v_smooth_normals.size(); ++i)
-        v_smooth_normals[i] = glm::normalize(v_smooth_normals[i]);
+std::size_t Mesh::index_offset_(ShadingType shading_type) const
+{
+    std::size_t index_size = (index_type_[shading_type] == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+    return (pool_[shading_type] != NULL) ? pool_range_[shading_type].first_index * index_size : 0;
+}
 
-    // if pmesh_ has per-vertex normals, then just use them.
-    if (pmesh_->HasNormals())
-        memcpy(&v_smooth_normals[0], &pmesh_->mNormals[0], sizeof(pmesh_->mNormals[0])*pmesh_->mNumVertices);
+void Mesh::set_quantization_box(const glm::vec3& _min, const glm::vec3& _max)
+{
+    box_min_ = _min;
+    box_extent_ = glm::max(_max - _min, glm::vec3(1.0e-20f));
+}
 
-    // TODO: set tv_smooth_normals from v_smooth_normals
+void Mesh::set_gl_buffers(DrawType draw_type, VertexPrecision precision)
+{
+    MeshGpuData gpu_data;
+    pack_gl_buffers(draw_type, precision, gpu_data);
+    upload_gl_buffers(gpu_data);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_);
-    if (shading_type == kSmooth)
+void Mesh::upload_gl_buffers(const MeshGpuData& gpu_data)
+{
+    for (int s = kSmooth; s <= kFlat; ++s)
     {
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*tv_smooth_normals.size(), &tv_smooth_normals[0], GL_STATIC_DRAW);
+        const std::vector<unsigned char>& vertices = gpu_data.vertices[s];
+        const std::vector<unsigned char>& indices = gpu_data.indices[s];
+        upload_gl_buffers((ShadingType) s, vertices.empty() ? NULL : &vertices[0], vertices.size(),
+                          indices.empty() ? NULL : &indices[0], indices.size(), gpu_data.index_type[s]);
     }
-    else //if (shading_type == kFlat)
+}
+
+void Mesh::pack_gl_buffers(DrawType draw_type, VertexPrecision precision, MeshGpuData& gpu_data)
+{
+    assert(streams_.positions != NULL);
+
+    draw_type_ = draw_type;
+    precision_ = precision;
+    quantization_error_ = QuantizationError();
+    format_ = VertexFormat::from_attribs(streams_.colors != NULL, streams_.texcoords != NULL, precision);
+
+    // normals for both shading types are computed once and kept in GPU memory
+    Vec3SoA                     f_normals;          // per-triangle flat normal (size = #triangles)
+    Vec3SoA                     v_smooth_normals;   // per-vertex 3D normal (size = #vertices)
+
+    // the index buffers hold LOD 0 (tv_indices_) followed by the coarser LODs
+    std::vector<unsigned int>   draw_indices(tv_indices_);
+    draw_indices.insert(draw_indices.end(), lod_indices_.begin(), lod_indices_.end());
+
+    compute_normals_(draw_indices, f_normals, v_smooth_normals);
+
+    std::vector<unsigned int>   v_src;              // mesh vertex of each output vertex
+    Vec3SoA                     v_normals;          // normal of each output vertex
+    std::vector<unsigned int>   indices;            // size = 3 x #triangles (empty for glDrawArrays)
+
+    if (draw_type == kDrawElements)
     {
-        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*tv_flat_normals.size(), &tv_flat_normals[0], GL_STATIC_DRAW);
+        // smooth: the mesh vertices as they are
+        v_src.resize(num_vertices());
+        for (unsigned int v = 0; v < v_src.size(); ++v)
+            v_src[v] = v;
+        pack_vertex_array_(v_src, v_smooth_normals, draw_indices, gpu_data.vertices[kSmooth], gpu_data.indices[kSmooth], gpu_data.index_type[kSmooth]);
+
+        // flat: vertices split by face normals
+        split_flat_vertices_(draw_indices, f_normals, v_src, v_normals, indices);
+        pack_vertex_array_(v_src, v_normals, indices, gpu_data.vertices[kFlat], gpu_data.indices[kFlat], gpu_data.index_type[kFlat]);
     }
+    else //if (draw_type == kDrawArrays)
+    {
+        // per triangle-vertex expansion (size = 3 x #triangles)
+        v_src = draw_indices;
+        v_normals.resize(draw_indices.size());
+
+        for (std::size_t i = 0; i < draw_indices.size(); ++i)
+            v_normals.set(i, v_smooth_normals.get(draw_indices[i]));
+        pack_vertex_array_(v_src, v_normals, indices, gpu_data.vertices[kSmooth], gpu_data.indices[kSmooth], gpu_data.index_type[kSmooth]);
+
+        for (std::size_t i = 0; i < draw_indices.size(); ++i)
+            v_normals.set(i, f_normals.get(i/3));
+        pack_vertex_array_(v_src, v_normals, indices, gpu_data.vertices[kFlat], gpu_data.indices[kFlat], gpu_data.index_type[kFlat]);
+    }
+
+    num_draw_indices_ = (GLsizei) tv_indices_.size();
+}
+
+
+template <typename T>
+static MeshCacheBlob add_stream(MeshCacheWriter& writer, const T* stream, const std::vector<unsigned int>& vertex_src)
+{
+    if (stream == NULL)
+        return MeshCacheBlob();
+
+    std::vector<T> values(vertex_src.size());
+    for (std::size_t v = 0; v < values.size(); ++v)
+        values[v] = stream[vertex_src[v]];
+    return writer.add(values);
 }
 
-void Mesh::set_gl_buffers(ShadingType shading_type)
+static void copy_vec3(float dst[3], const glm::vec3& src)
 {
-    set_gl_position_buffer_();
-    if (pmesh_->HasVertexColors(0))
-        set_gl_color_buffer_(0);
-    set_gl_normal_buffer_(shading_type);
+    dst[0] = src.x;
+    dst[1] = src.y;
+    dst[2] = src.z;
 }
 
+void Mesh::save_cache(MeshCacheWriter& writer, const MeshGpuData& gpu_data) const
+{
+    MeshCacheRecord record;
+    record.num_vertices = (uint32_t) num_vertices();
+    record.num_source_vertices = (uint32_t) num_source_vertices_;
+
+    // streams in mesh vertex order, so vertex_src_ is the identity after loading
+    record.positions = add_stream(writer, streams_.positions, vertex_src_);
+    record.normals = add_stream(writer, streams_.normals, vertex_src_);
+    record.colors = add_stream(writer, streams_.colors, vertex_src_);
+    record.texcoords = add_stream(writer, streams_.texcoords, vertex_src_);
+
+    record.tv_indices = writer.add(tv_indices_);
+    record.lod_indices = writer.add(lod_indices_);
+    record.lods = writer.add(lods_);
+    record.meshlets = writer.add(meshlets_);
+
+    for (int s = kSmooth; s <= kFlat; ++s)
+    {
+        record.vertices[s] = writer.add(gpu_data.vertices[s]);
+        record.indices[s] = writer.add(gpu_data.indices[s]);
+        record.index_type[s] = gpu_data.index_type[s];
+    }
+
+    copy_vec3(record.lod_center, lod_center_);
+    record.quantization_error[0] = quantization_error_.max_position;
+    record.quantization_error[1] = quantization_error_.max_normal_degrees;
+    record.quantization_error[2] = quantization_error_.max_color;
+
+    memset(record.material_name, 0, sizeof(record.material_name));
+    strncpy(record.material_name, material.name.c_str(), sizeof(record.material_name) - 1);
+    copy_vec3(record.ambient, material.ambient);
+    copy_vec3(record.diffuse, material.diffuse);
+    copy_vec3(record.specular, material.specular);
+    record.shininess = material.shininess;
 
-void Mesh::draw(int loc_a_position, int loc_a_normal)
+    writer.add_record(record);
+}
+
+template <typename T>
+static void copy_blob(const MeshCacheReader& reader, const MeshCacheBlob& blob, std::vector<T>& values)
 {
-    // TODO : draw a triangular mesh
-    //          glBindBuffer() with position_buffer_
-    //          glEnableVertexAttribArray() for loc_a_position  
-    //          glVertexAttribPointer() by reusing GPU data in loc_a_position
-    //
-    //          glBindBuffer() with normal_buffer_
-    //          glEnableVertexAttribArray() for loc_a_normal  
-    //          glVertexAttribPointer() by reusing GPU data in loc_a_normal
-    //
-    //          glDrawArrays(GL_TRIANGLES, ...)
-    //
-    //          glDisableVertexAttribArray() for loc_a_position & loc_a_normal
+    const T* data = (const T*) reader.data(blob);
+    values.assign(data, data + blob.size / sizeof(T));
+}
+
+void Mesh::load_cache(const MeshCacheReader& reader, std::size_t index)
+{
+    const MeshCacheRecord& record = reader.record(index);
+    const MeshCacheKey& key = reader.header().key;
+
+    // the attribute streams are used in place; the mapping lives as long as the mesh
+    streams_owner_ = reader.file();
+    streams_.positions = (const glm::vec3*) reader.data(record.positions);
+    streams_.normals = (const glm::vec3*) reader.data(record.normals);
+    streams_.colors = (const glm::vec4*) reader.data(record.colors);
+    streams_.texcoords = (const glm::vec3*) reader.data(record.texcoords);
+    streams_.num_vertices = record.num_vertices;
+    num_source_vertices_ = record.num_source_vertices;
+
+    vertex_src_.resize(record.num_vertices);
+    for (unsigned int v = 0; v < record.num_vertices; ++v)
+        vertex_src_[v] = v;
+
+    // indices are modified by the passes, so they are copied out of the mapping
+    copy_blob(reader, record.tv_indices, tv_indices_);
+    copy_blob(reader, record.lod_indices, lod_indices_);
+    copy_blob(reader, record.lods, lods_);
+    copy_blob(reader, record.meshlets, meshlets_);
+    lod_center_ = glm::vec3(record.lod_center[0], record.lod_center[1], record.lod_center[2]);
+
+    // what pack_gl_buffers() would have set for the cached buffer contents
+    draw_type_ = (DrawType) key.draw_type;
+    precision_ = (VertexPrecision) key.precision;
+    format_ = VertexFormat::from_attribs(streams_.colors != NULL, streams_.texcoords != NULL, precision_);
+    quantization_error_.max_position = record.quantization_error[0];
+    quantization_error_.max_normal_degrees = record.quantization_error[1];
+    quantization_error_.max_color = record.quantization_error[2];
+
+    num_draw_indices_ = (GLsizei) tv_indices_.size();
+
+    material = Material(glm::vec3(record.ambient[0], record.ambient[1], record.ambient[2]),
+                        glm::vec3(record.diffuse[0], record.diffuse[1], record.diffuse[2]),
+                        glm::vec3(record.specular[0], record.specular[1], record.specular[2]),
+                        record.shininess);
+    material.name = std::string(record.material_name, strnlen(record.material_name, sizeof(record.material_name)));
+}
+
+
+void Mesh::draw(ShadingType shading_type, const MeshDrawList& draw_list, GLStateCache& state) const
+{
+    // the visible ranges cull() put in draw_list (both index buffers and the glDrawArrays
+    // expansion keep the triangle order of tv_indices_, so the same ranges serve all)
+    const std::vector<GLint>& draw_firsts = draw_list.firsts;
+    const std::vector<GLsizei>& draw_counts = draw_list.counts;
+    if (draw_firsts.empty())
+        return;
+
+    // all attribute setup lives in the VAO (left bound: the next draw binds its own)
+    if (vertex_array_[shading_type] != 0)
+        state.bind_vertex_array(vertex_array_[shading_type]);
+    else
+    {
+        state.bind_buffer(GL_ARRAY_BUFFER, vertex_buffer_[shading_type]);
+        format_.set_attrib_pointers(vertex_offset_(shading_type));
+        state.bind_buffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_[shading_type]);
+    }
+    state.count_draws();
+
+    if (draw_type_ == kDrawElements)
+    {
+        std::size_t index_size = (index_type_[shading_type] == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+
+        std::size_t base_offset = index_offset_(shading_type);
+
+        std::vector<const void*> offsets(draw_firsts.size());
+        for (std::size_t i = 0; i < offsets.size(); ++i)
+            offsets[i] = (const void*) (base_offset + index_size * draw_firsts[i]);
+        glMultiDrawElements(GL_TRIANGLES, &draw_counts[0], index_type_[shading_type], &offsets[0], (GLsizei) offsets.size());
+    }
+    else //if (draw_type_ == kDrawArrays)
+    {
+        glMultiDrawArrays(GL_TRIANGLES, &draw_firsts[0], &draw_counts[0], (GLsizei) draw_firsts.size());
+    }
+}
+
+void Mesh::draw_instanced(ShadingType shading_type, const MeshDrawList& draw_list, GLuint vertex_array, GLsizei num_instances, GLStateCache& state) const
+{
+    // there is no multi-draw of instances: a draw per range (one without meshlet culling)
+    if (draw_list.firsts.empty() || num_instances == 0)
+        return;
+
+    state.bind_vertex_array(vertex_array);
+    state.count_draws(draw_list.firsts.size());
+
+    std::size_t index_size = (index_type_[shading_type] == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+    std::size_t base_offset = index_offset_(shading_type);
+    for (std::size_t i = 0; i < draw_list.firsts.size(); ++i)
+    {
+        if (draw_type_ == kDrawElements)
+            glDrawElementsInstanced(GL_TRIANGLES, draw_list.counts[i], index_type_[shading_type], (const void*) (base_offset + index_size * draw_list.firsts[i]), num_instances);
+        else
+            glDrawArraysInstanced(GL_TRIANGLES, draw_list.firsts[i], draw_list.counts[i], num_instances);
+    }
 }
     
-void Mesh::print_info()
+void Mesh::print_info(bool print_vertices)
 {
     std::cout << "print mesh info" << std::endl;
 
-    std::cout << "num vertices " << pmesh_->mNumVertices << std::endl;
-    for (unsigned int i = 0; i < pmesh_->mNumVertices; ++i)
+    std::cout << "num vertices " << num_vertices() << " (source " << num_source_vertices_ << ", "
+              << num_dropped_vertices() << " unreferenced dropped, "
+              << num_dropped_vertices() * vertex_size() << " bytes saved)" << std::endl;
+
+    VertexFetchStats fetch = analyze_vertex_fetch(tv_indices_, num_vertices(), vertex_size());
+    std::cout << "vertex fetch overfetch " << fetch.overfetch << std::endl;
+
+    if (!print_vertices)
+        return;
+
+    for (std::size_t i = 0; i < num_vertices(); ++i)
     {
-        aiVector3D vertex = pmesh_->mVertices[i];
+        const glm::vec3& vertex = streams_.positions[vertex_src_[i]];
         std::cout << "  vertex  (" << vertex.x << ", " << vertex.y << ", " << vertex.z << ")" << std::endl;
 
-        if (pmesh_->mColors[0] != NULL)
+        if (streams_.colors != NULL)
         {
-            aiColor4D color = pmesh_->mColors[0][i];
+            const glm::vec4& color = streams_.colors[vertex_src_[i]];
             std::cout << "  color  (" << color.r << ", " << color.g << ", " << color.b << ", " << color.a << ")" << std::endl;
         }
     }
-}
\ No newline at end of file
+}
@@ -12,9 +12,51 @@
 
 #include <GL/glew.h>
 #include <iostream>
+#include <memory>
 
 #include "ShadingType.h"
+#include "DrawType.h"
 #include "Material.h"
+#include "VertexFormat.h"
+#include "MeshKernels.h"
+#include "Meshlet.h"
+#include "MeshSimplify.h"
+#include "MeshCache.h"
+#include "MeshArrays.h"
+#include "GLStateCache.h"
+#include "MeshPool.h"
+
+
+// vertex attributes of a mesh: views into a MeshArrays (copied from an aiMesh or read by
+// read_ply() / read_obj()) or a mapped .meshcache
+struct MeshStreams
+{
+    const glm::vec3*    positions = NULL;
+    const glm::vec3*    normals = NULL;     // NULL: computed from the faces
+    const glm::vec4*    colors = NULL;
+    const glm::vec3*    texcoords = NULL;
+    unsigned int        num_vertices = 0;
+
+    const unsigned int* tv_indices = NULL;  // triangles (NULL after compact_streams())
+    std::size_t         num_tv_indices = 0;
+};
+
+// CPU side contents of the GL buffers, [kSmooth], [kFlat]
+struct MeshGpuData
+{
+    std::vector<unsigned char>  vertices[2];
+    std::vector<unsigned char>  indices[2];     // empty for kDrawArrays
+    GLenum                      index_type[2] = { GL_UNSIGNED_INT, GL_UNSIGNED_INT };
+};
+
+// what Mesh::cull() chose for one instance of a mesh. a Model keeps one per mesh, so the
+// Models sharing a mesh (see AssetRegistry) each draw their own LOD and meshlets
+struct MeshDrawList
+{
+    unsigned int            lod = 0;
+    std::vector<GLint>      firsts;     // visible triangle ranges (in indices / vertices)
+    std::vector<GLsizei>    counts;
+};
 
 
 class Mesh
@@ -23,33 +65,129 @@ public:
 
 public:
     Mesh() {};
-    Mesh(const aiMesh* _pmesh) : pmesh_(_pmesh) {}
+    Mesh(const aiMesh* _pmesh);     // copies the streams it uses: the aiScene can be released right after
+    Mesh(const std::shared_ptr<const MeshArrays>& _arrays);    // read_ply() / read_obj() instead of Assimp
+
+    // VAOs need GL 3.0 (or ARB_vertex_array_object); without them (a legacy GL 2.1 context, as
+    // macOS gives one) draw() binds the buffers and sets the attribute pointers every time
+    static bool has_vertex_arrays();
 
+    // the VAOs, if has_vertex_arrays(); the buffers come with the upload (ranges of
+    // MeshPool::active() if it is set)
     void gen_gl_buffers();    
-    void set_gl_buffers(ShadingType shading_type);
+    void delete_gl_buffers();   // the handles are shared by copies of the mesh: the last owner calls it
+    // forget the VAOs, buffers and pool ranges without deleting them: a copy of a mesh calls it
+    // before gen_gl_buffers() so that its upload leaves the original's buffers alone
+    void detach_gl_buffers();
+    void set_gl_buffers(DrawType draw_type = kDrawElements, VertexPrecision precision = kVertexFloat);
+
+    // set_gl_buffers() in two steps: building the buffer contents needs no GL context
+    void pack_gl_buffers(DrawType draw_type, VertexPrecision precision, MeshGpuData& gpu_data);
+    void upload_gl_buffers(const MeshGpuData& gpu_data);
+    void upload_gl_buffers(ShadingType shading_type, const void* vertices, std::size_t vertex_bytes, const void* indices, std::size_t index_bytes, GLenum index_type);
+
+    // upload_gl_buffers() over several calls (e.g. frames): allocate the buffers of a shading
+    // type, then fill them range by range; the VAO is complete once every byte is written
+    void allocate_gl_buffers(ShadingType shading_type, std::size_t vertex_bytes, std::size_t index_bytes, GLenum index_type);
+    void upload_gl_buffer_range(ShadingType shading_type, bool is_index_buffer, std::size_t offset, const void* data, std::size_t size);
+
+    // the vertex buffer (with the attribute pointers) and index buffer of shading_type into the
+    // bound VAO: a VAO of another owner that adds attributes of its own (see InstancedModel)
+    void bind_gl_buffers(ShadingType shading_type) const;
+
+    // .meshcache record of this mesh (after all passes and pack_gl_buffers())
+    void save_cache(MeshCacheWriter& writer, const MeshGpuData& gpu_data) const;
+    // the state save_cache() recorded; the streams stay in the mapping of the reader.
+    // the GL buffers are then uploaded from reader.data(record.vertices[s]) etc.
+    void load_cache(const MeshCacheReader& reader, std::size_t index);
+
     void update_tv_indices();
+    // the passes report their stats to log (a worker thread passes its own stream)
+    void optimize_vertex_cache(std::ostream& log = std::cout);
+    void optimize_overdraw(std::ostream& log = std::cout);
+    void optimize_vertex_fetch();
+    void build_meshlets(std::ostream& log = std::cout);
+    void build_lods(std::ostream& log = std::cout);
+
+    // after the passes: the streams are copied to arrays of the mesh's own, in the final vertex
+    // order and without the unreferenced vertices (vertex_src_ becomes the identity). the
+    // import's arrays (and their copy of the triangles) are released with the last mesh using them
+    void compact_streams();
+
+    // choose the LOD and (for LOD 0) the meshlets to draw (mat_PVM and camera_position in the
+    // space of the aiMesh positions); without culling or meshlets a LOD is one draw range
+    void cull(const glm::mat4& mat_PVM, const glm::vec3& camera_position, bool is_culling, const LodSelection& lod_selection, MeshletCullStats& stats, MeshDrawList& draw_list) const;
     
-    void draw(int loc_a_position, int loc_a_normal); 
-    void print_info();
+    void draw(ShadingType shading_type, const MeshDrawList& draw_list, GLStateCache& state) const;
+    // num_instances times with vertex_array, a VAO set up with bind_gl_buffers() (GL 3.1)
+    void draw_instanced(ShadingType shading_type, const MeshDrawList& draw_list, GLuint vertex_array, GLsizei num_instances, GLStateCache& state) const;
+    void print_info(bool print_vertices = true);
 
     void set_material(const Material& _mat) { material = _mat; }
+
+    // box that quantized positions are relative to (usually the AABB of the whole model)
+    void set_quantization_box(const glm::vec3& _min, const glm::vec3& _max);
+    const QuantizationError& quantization_error() const     { return quantization_error_; }
+
+    GLuint vertex_array(ShadingType shading_type) const     { return vertex_array_[shading_type]; }
+    // where shading_type is in the MeshPool it was uploaded to (NULL: buffers of its own)
+    const MeshPoolRange* pool_range(ShadingType shading_type) const     { return pool_[shading_type] ? &pool_range_[shading_type] : NULL; }
+    DrawType draw_type() const              { return draw_type_; }
+    // center of the bounding box in the space of the aiMesh positions (set by build_lods())
+    const glm::vec3& center() const         { return lod_center_; }
+
+    std::size_t gpu_bytes() const           { return gpu_bytes_[kSmooth] + gpu_bytes_[kFlat]; }
+    std::size_t num_vertices() const        { return vertex_src_.size(); }
+    std::size_t num_dropped_vertices() const    { return num_source_vertices_ - vertex_src_.size(); }
+    std::size_t vertex_size() const         { return format_.stride(); }
+    const std::vector<Meshlet>& meshlets() const    { return meshlets_; }
+    const std::vector<MeshLod>& lods() const        { return lods_; }
     
     Material    material;
 
 protected:
 
-    void set_gl_position_buffer_();
-    void set_gl_color_buffer_(unsigned int cs_idx);
-    void set_gl_normal_buffer_(ShadingType shading_type);
+    void pack_vertex_array_(const std::vector<unsigned int>& v_src, const Vec3SoA& v_normals, const std::vector<unsigned int>& indices,
+                            std::vector<unsigned char>& vertices, std::vector<unsigned char>& index_bytes, GLenum& index_type);
+
+    void set_streams_(const std::shared_ptr<const MeshArrays>& _arrays);
+    void gather_positions_(std::vector<glm::vec3>& positions) const;
+    void compute_normals_(const std::vector<unsigned int>& draw_indices, Vec3SoA& f_normals, Vec3SoA& v_smooth_normals) const;
+    void split_flat_vertices_(const std::vector<unsigned int>& draw_indices, const Vec3SoA& f_normals, std::vector<unsigned int>& v_src, Vec3SoA& v_normals, std::vector<unsigned int>& indices) const;
+
+    void release_gl_storage_(ShadingType shading_type);     // the buffers or the pool ranges
+    std::size_t vertex_offset_(ShadingType shading_type) const;     // bytes into vertex_buffer_ (0 without a pool)
+    std::size_t index_offset_(ShadingType shading_type) const;
 
 private:
-    GLuint  position_buffer_;   // GPU 메모리에서 vertices_buffer 위치 
-    GLuint  color_buffer_;      // GPU 메모리에서 color_buffer 위치
-    GLuint  normal_buffer_;     // GPU 메모리에서 normal_buffer 위치   
-    bool    is_color_ = false;
+    // [kSmooth], [kFlat] 쉐이딩 별 GPU buffer (둘 다 GPU 메모리에 유지)
+    GLuint  vertex_array_[2] = { 0, 0 };    // VAO: vertex_buffer_의 attribute 설정 + index_buffer_
+    GLuint  vertex_buffer_[2] = { 0, 0 };   // GPU 메모리에서 interleaved vertex buffer 위치
+    GLuint  index_buffer_[2] = { 0, 0 };    // GPU 메모리에서 index_buffer 위치
+    MeshPool*       pool_[2] = { NULL, NULL };  // the buffers above are ranges of its buffers (NULL: the mesh's own)
+    MeshPoolRange   pool_range_[2];
+
+    VertexFormat    format_;        // interleaved vertex layout
+    VertexPrecision precision_ = kVertexFloat;
+    glm::vec3       box_min_ = glm::vec3(0.0f);
+    glm::vec3       box_extent_ = glm::vec3(1.0f);
+    QuantizationError   quantization_error_;    // of the last set_gl_buffers()
+
+    DrawType    draw_type_ = kDrawElements;
+    GLenum      index_type_[2] = { GL_UNSIGNED_INT, GL_UNSIGNED_INT };  // GL_UNSIGNED_SHORT if #vertices < 2^16
+    GLsizei     num_draw_indices_ = 0;          // #indices (kDrawElements) or #vertices (kDrawArrays)
+    std::size_t gpu_bytes_[2] = { 0, 0 };       // bytes uploaded per shading type
 
     // std::vector<Face> faces;
     std::vector<unsigned int>   tv_indices_;
-    
-    const aiMesh* pmesh_;
+    std::vector<unsigned int>   vertex_src_;    // stream vertex of each mesh vertex (identity until optimize_vertex_fetch() and after compact_streams())
+
+    std::vector<Meshlet>        meshlets_;      // contiguous triangle ranges of tv_indices_ (empty until build_meshlets())
+    std::vector<unsigned int>   lod_indices_;   // LOD 1, 2, ... after tv_indices_ (LOD 0) in the index buffers
+    std::vector<MeshLod>        lods_;          // empty until build_lods()
+    glm::vec3                   lod_center_ = glm::vec3(0.0f);  // where the screen size of a LOD error is measured
+
+    MeshStreams                 streams_;
+    std::size_t                 num_source_vertices_ = 0;   // of the import (the cache keeps the count only)
+    std::shared_ptr<const void> streams_owner_; // the MeshArrays or .meshcache streams_ point into
 };
@@ -0,0 +1,17 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// vertex and triangle arrays of a mesh read without Assimp (read_ply(), read_obj()), in the
+// layout Mesh reads them (see MeshStreams)
+struct MeshArrays
+{
+    std::vector<glm::vec3>      positions;      // x, y, z
+    std::vector<glm::vec3>      normals;        // nx, ny, nz (empty if the file has none)
+    std::vector<glm::vec4>      colors;         // red, green, blue, alpha in [0, 1] (alpha = 1 if missing)
+    std::vector<glm::vec3>      texcoords;      // (s, t, 0) or (u, v, 0)
+    std::vector<unsigned int>   tv_indices;     // faces as triangle fans, size = 3 x #triangles
+
+    std::size_t num_vertices() const    { return positions.size(); }
+};
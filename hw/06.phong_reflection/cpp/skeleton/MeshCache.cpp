@@ -0,0 +1,210 @@
+#include "MeshCache.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define get_process_id getpid
+#elif defined(_WIN32)
+#include <process.h>
+#define get_process_id _getpid
+#endif
+
+#include "Meshlet.h"
+#include "MeshSimplify.h"
+#include "ObjReader.h"
+
+static const char kMeshCacheMagic[8] = { 'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H' };
+
+static const std::size_t kMeshCacheAlignment = 16;
+
+static std::size_t align_up(std::size_t n)
+{
+    return (n + kMeshCacheAlignment - 1) & ~(kMeshCacheAlignment - 1);
+}
+
+uint32_t mesh_cache_layout()
+{
+    // also catches a reader with the other byte order: the sizes end up in different bytes
+    uint32_t layout = (uint32_t) hash_bytes(NULL, 0);
+    const uint32_t sizes[] = {
+        (uint32_t) sizeof(MeshCacheHeader), (uint32_t) sizeof(MeshCacheRecord),
+        (uint32_t) sizeof(Meshlet), (uint32_t) sizeof(MeshLod), (uint32_t) sizeof(unsigned int),
+    };
+    return (uint32_t) hash_bytes(sizes, sizeof(sizes), layout);
+}
+
+bool make_mesh_cache_key(const std::string& source_path, unsigned int process_flags, unsigned int import_flags, unsigned int draw_type, unsigned int precision, MeshCacheKey& key)
+{
+    if (!stat_file(source_path, key.source_size, key.source_mtime))
+        return false;
+
+    // the hash catches a copy that keeps the old mtime; a changed mtime invalidates the cache too
+    MappedFile source;
+    if (!source.open(source_path))
+        return false;
+
+    key.source_size = source.size();
+    key.source_hash = hash_bytes(source.data(), source.size());
+
+    // the materials of an OBJ come from its .mtl files (Assimp and read_obj() read them both):
+    // their contents are a part of the key. a missing one hashes as its name
+    key.material_hash = 0;
+    if (is_obj_path(source_path))
+    {
+        std::vector<std::string> mtl_paths;
+        find_mtllibs(source_path, (const char*) source.data(), source.size(), mtl_paths);
+        key.material_hash = hash_bytes(NULL, 0);
+        for (std::size_t i = 0; i < mtl_paths.size(); ++i)
+        {
+            MappedFile mtl;
+            if (mtl.open(mtl_paths[i]))
+                key.material_hash = hash_bytes(mtl.data(), mtl.size(), key.material_hash);
+            else
+                key.material_hash = hash_bytes(mtl_paths[i].data(), mtl_paths[i].size(), key.material_hash);
+        }
+    }
+    key.process_flags = process_flags;
+    key.import_flags = import_flags;
+    key.draw_type = draw_type;
+    key.precision = precision;
+    return true;
+}
+
+std::string mesh_cache_path(const std::string& source_path, const MeshCacheKey& key)
+{
+    // the settings only: an edited source replaces its cache instead of adding one
+    const uint32_t settings[] = { key.process_flags, key.import_flags, key.draw_type, key.precision };
+    std::ostringstream path;
+    path << source_path << "." << std::hex << (uint32_t) hash_bytes(settings, sizeof(settings)) << ".meshcache";
+    return path.str();
+}
+
+// a temporary file next to path that no other writer uses: imports run on several threads,
+// and another process may write the same cache
+static std::string unique_tmp_path(const std::string& path)
+{
+    static std::atomic<unsigned int> counter(0);
+    std::ostringstream tmp_path;
+    tmp_path << path << ".";
+#ifdef get_process_id
+    tmp_path << get_process_id() << "-";
+#endif
+    tmp_path << counter++ << ".tmp";
+    return tmp_path.str();
+}
+
+MeshCacheBlob MeshCacheWriter::add(const void* data, std::size_t size)
+{
+    MeshCacheBlob blob;
+    if (size == 0)
+        return blob;
+
+    std::size_t offset = align_up(data_.size());
+    data_.resize(offset + size, 0);
+    memcpy(&data_[offset], data, size);
+
+    blob.offset = offset;
+    blob.size = size;
+    return blob;
+}
+
+bool MeshCacheWriter::write(const std::string& path, const MeshCacheKey& key, const float aabb_min[3], const float aabb_max[3]) const
+{
+    MeshCacheHeader header;
+    memcpy(header.magic, kMeshCacheMagic, sizeof(header.magic));
+    header.layout = mesh_cache_layout();
+    header.key = key;
+    header.num_meshes = (uint32_t) records_.size();
+    header.data_offset = align_up(sizeof(MeshCacheHeader) + sizeof(MeshCacheRecord) * records_.size());
+    header.data_size = data_.size();
+    for (int i = 0; i < 3; ++i)
+    {
+        header.aabb_min[i] = aabb_min[i];
+        header.aabb_max[i] = aabb_max[i];
+    }
+
+    // a crash halfway through leaves the .tmp file, never a truncated cache
+    std::string tmp_path = unique_tmp_path(path);
+    FILE* fp = fopen(tmp_path.c_str(), "wb");
+    if (fp == NULL)
+        return false;
+
+    static const unsigned char zeros[kMeshCacheAlignment] = { 0 };
+    std::size_t head = sizeof(MeshCacheHeader) + sizeof(MeshCacheRecord) * records_.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    if (ok && !records_.empty())
+        ok = fwrite(&records_[0], sizeof(MeshCacheRecord), records_.size(), fp) == records_.size();
+    if (ok && header.data_offset > head)
+        ok = fwrite(zeros, 1, header.data_offset - head, fp) == header.data_offset - head;
+    if (ok && !data_.empty())
+        ok = fwrite(&data_[0], 1, data_.size(), fp) == data_.size();
+    ok = (fclose(fp) == 0) && ok;
+
+    if (ok)
+    {
+        remove(path.c_str());   // rename() does not replace an existing file everywhere
+        ok = rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+    if (!ok)
+        remove(tmp_path.c_str());
+    return ok;
+}
+
+static bool is_blob_valid(const MeshCacheBlob& blob, uint64_t data_size, std::size_t element_size)
+{
+    return blob.offset <= data_size && blob.size <= data_size - blob.offset
+        && blob.offset % kMeshCacheAlignment == 0 && blob.size % element_size == 0;
+}
+
+bool MeshCacheReader::open(const std::string& path, const MeshCacheKey& key)
+{
+    file_.reset();
+    header_ = NULL;
+    records_ = NULL;
+
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(MeshCacheHeader))
+        return false;
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*) file->data();
+    if (memcmp(header->magic, kMeshCacheMagic, sizeof(header->magic)) != 0
+        || header->version != kMeshCacheVersion
+        || header->layout != mesh_cache_layout()
+        || !(header->key == key))
+        return false;
+
+    uint64_t head = sizeof(MeshCacheHeader) + (uint64_t) sizeof(MeshCacheRecord) * header->num_meshes;
+    if (header->data_offset < head || header->data_offset % kMeshCacheAlignment != 0
+        || header->data_offset > file->size() || header->data_size != file->size() - header->data_offset)
+        return false;
+
+    const MeshCacheRecord* records = (const MeshCacheRecord*) (header + 1);
+    for (uint32_t i = 0; i < header->num_meshes; ++i)
+    {
+        const MeshCacheRecord& r = records[i];
+        uint64_t n = r.num_vertices;
+        uint64_t data_size = header->data_size;
+        if (!is_blob_valid(r.positions, data_size, sizeof(float) * 3) || r.positions.size != n * sizeof(float) * 3
+            || !is_blob_valid(r.normals, data_size, sizeof(float) * 3) || (r.normals.size && r.normals.size != r.positions.size)
+            || !is_blob_valid(r.colors, data_size, sizeof(float) * 4) || (r.colors.size && r.colors.size != n * sizeof(float) * 4)
+            || !is_blob_valid(r.texcoords, data_size, sizeof(float) * 3) || (r.texcoords.size && r.texcoords.size != r.positions.size)
+            || !is_blob_valid(r.tv_indices, data_size, sizeof(unsigned int))
+            || !is_blob_valid(r.lod_indices, data_size, sizeof(unsigned int))
+            || !is_blob_valid(r.lods, data_size, sizeof(MeshLod))
+            || !is_blob_valid(r.meshlets, data_size, sizeof(Meshlet)))
+            return false;
+        for (int s = 0; s < 2; ++s)
+            if (!is_blob_valid(r.vertices[s], data_size, 1) || !is_blob_valid(r.indices[s], data_size, 1))
+                return false;
+    }
+
+    file_ = file;
+    header_ = header;
+    records_ = records;
+    return true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// .meshcache: the meshes of Model::load_model() after all mesh passes, written next to the
+// source (models/bunny.ply -> models/bunny.ply.<settings>.meshcache, see mesh_cache_path())
+// and mapped on later launches.
+//   MeshCacheHeader | MeshCacheRecord x num_meshes | data (blobs aligned to 16 bytes)
+// the attribute streams are used in place and the GL buffer contents are uploaded straight
+// from the mapping. the file stores structs as they are in memory, so it is only read back
+// by a build with the same layout (version, struct sizes and byte order are checked).
+
+const uint32_t kMeshCacheVersion = 3;
+
+// MeshCacheKey::import_flags of a model read without Assimp (read_ply(), read_obj())
+const uint32_t kNativeImportFlags = 0xffffffffu;
+
+// a byte range of the data section
+struct MeshCacheBlob
+{
+    uint64_t    offset = 0;
+    uint64_t    size = 0;
+};
+
+// what the cache was built from; any difference invalidates it
+struct MeshCacheKey
+{
+    uint64_t    source_size = 0;
+    int64_t     source_mtime = 0;
+    uint64_t    source_hash = 0;        // of the source contents
+    uint64_t    material_hash = 0;      // of the .mtl files an OBJ source names (mtllib)
+    uint32_t    process_flags = 0;      // MeshProcess bits
+    uint32_t    import_flags = 0;       // aiProcess_ bits, or kNativeImportFlags
+    uint32_t    draw_type = 0;          // of the GL buffer blobs
+    uint32_t    precision = 0;
+
+    bool operator==(const MeshCacheKey& k) const
+    {
+        return source_size == k.source_size && source_mtime == k.source_mtime && source_hash == k.source_hash && material_hash == k.material_hash
+            && process_flags == k.process_flags && import_flags == k.import_flags && draw_type == k.draw_type && precision == k.precision;
+    }
+};
+
+struct MeshCacheHeader
+{
+    char        magic[8];
+    uint32_t    version = kMeshCacheVersion;
+    uint32_t    layout = 0;             // mesh_cache_layout() of the writer
+    MeshCacheKey key;
+    uint32_t    num_meshes = 0;
+    uint32_t    reserved = 0;
+    uint64_t    data_offset = 0;        // start of the data section
+    uint64_t    data_size = 0;
+    float       aabb_min[3];
+    float       aabb_max[3];
+};
+
+// one Mesh (see Mesh::save_cache())
+struct MeshCacheRecord
+{
+    uint32_t        num_vertices = 0;           // after the vertex fetch pass
+    uint32_t        num_source_vertices = 0;    // of the aiMesh
+    uint32_t        index_type[2] = { 0, 0 };   // [kSmooth], [kFlat]
+
+    // attribute streams in final vertex order (size 0: not present)
+    MeshCacheBlob   positions;                  // glm::vec3
+    MeshCacheBlob   normals;                    // glm::vec3
+    MeshCacheBlob   colors;                     // glm::vec4
+    MeshCacheBlob   texcoords;                  // glm::vec3
+
+    MeshCacheBlob   tv_indices;                 // unsigned int
+    MeshCacheBlob   lod_indices;                // unsigned int
+    MeshCacheBlob   lods;                       // MeshLod
+    MeshCacheBlob   meshlets;                   // Meshlet
+
+    // GL buffer contents for key.draw_type / key.precision
+    MeshCacheBlob   vertices[2];
+    MeshCacheBlob   indices[2];
+
+    float           lod_center[3];
+    float           quantization_error[3];      // max position, normal (degrees), color
+
+    char            material_name[64];
+    float           ambient[3];
+    float           diffuse[3];
+    float           specular[3];
+    float           shininess = 0.0f;
+};
+
+// changes whenever a struct stored in the file changes size
+uint32_t mesh_cache_layout();
+
+// key of source_path as it is now (false if the file cannot be read)
+bool make_mesh_cache_key(const std::string& source_path, unsigned int process_flags, unsigned int import_flags, unsigned int draw_type, unsigned int precision, MeshCacheKey& key);
+
+// the cache file of source_path for the settings of key: one per process flags, import flags,
+// draw type and precision, so the variants of a model do not overwrite each other's cache
+std::string mesh_cache_path(const std::string& source_path, const MeshCacheKey& key);
+
+// collects the records and blobs of a cache file in memory
+class MeshCacheWriter
+{
+public:
+    // copy size bytes into the data section
+    MeshCacheBlob add(const void* data, std::size_t size);
+
+    template <typename T>
+    MeshCacheBlob add(const std::vector<T>& v)      { return add(v.empty() ? NULL : &v[0], sizeof(T) * v.size()); }
+
+    void add_record(const MeshCacheRecord& record)  { records_.push_back(record); }
+
+    // write header | records | data to a temporary file, then rename it to path
+    bool write(const std::string& path, const MeshCacheKey& key, const float aabb_min[3], const float aabb_max[3]) const;
+
+private:
+    std::vector<MeshCacheRecord>    records_;
+    std::vector<unsigned char>      data_;
+};
+
+// maps a cache file and checks it against the key (every blob is bounds-checked, too)
+class MeshCacheReader
+{
+public:
+    bool open(const std::string& path, const MeshCacheKey& key);
+    bool is_open() const                                { return header_ != NULL; }
+
+    const MeshCacheHeader& header() const               { return *header_; }
+    const MeshCacheRecord& record(std::size_t i) const  { return records_[i]; }
+
+    // NULL for an empty blob
+    const void* data(const MeshCacheBlob& blob) const   { return blob.size ? file_->data() + header_->data_offset + blob.offset : NULL; }
+
+    // keeps the mapping alive as long as a mesh uses its streams
+    std::shared_ptr<MappedFile> file() const            { return file_; }
+
+private:
+    std::shared_ptr<MappedFile> file_;
+    const MeshCacheHeader*      header_ = NULL;
+    const MeshCacheRecord*      records_ = NULL;
+};
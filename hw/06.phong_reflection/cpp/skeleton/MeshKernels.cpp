@@ -0,0 +1,296 @@
+#include "MeshKernels.h"
+
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MESH_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+void Vec3SoA::assign(const glm::vec3* v, std::size_t n)
+{
+    resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        x[i] = v[i].x;
+        y[i] = v[i].y;
+        z[i] = v[i].z;
+    }
+}
+
+void Vec3SoA::copy_to(glm::vec3* v) const
+{
+    for (std::size_t i = 0; i < size(); ++i)
+        v[i] = glm::vec3(x[i], y[i], z[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// scalar
+////////////////////////////////////////////////////////////////////////////////
+
+// cross(u, v) with u = q-p, v = r-p; returns |cross|^2
+static inline float cross_scalar(const float* px, const float* py, const float* pz, unsigned int a, unsigned int b, unsigned int c, float& cx, float& cy, float& cz)
+{
+    float ux = px[b] - px[a], uy = py[b] - py[a], uz = pz[b] - pz[a];
+    float vx = px[c] - px[a], vy = py[c] - py[a], vz = pz[c] - pz[a];
+
+    cx = uy*vz - vy*uz;
+    cy = uz*vx - vz*ux;
+    cz = ux*vy - vx*uy;
+
+    return cx*cx + cy*cy + cz*cz;
+}
+
+static void face_normals_scalar(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* nx, float* ny, float* nz)
+{
+    for (std::size_t f = 0; f < num_triangles; ++f)
+    {
+        float cx, cy, cz;
+        float d = cross_scalar(px, py, pz, tv_indices[3*f], tv_indices[3*f+1], tv_indices[3*f+2], cx, cy, cz);
+
+        float inv = (d > 0.0f) ? 1.0f / std::sqrt(d) : 0.0f;
+        nx[f] = cx * inv;
+        ny[f] = cy * inv;
+        nz[f] = cz * inv;
+    }
+}
+
+static void triangle_areas_scalar(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* areas)
+{
+    for (std::size_t f = 0; f < num_triangles; ++f)
+    {
+        float cx, cy, cz;
+        float d = cross_scalar(px, py, pz, tv_indices[3*f], tv_indices[3*f+1], tv_indices[3*f+2], cx, cy, cz);
+
+        areas[f] = 0.5f * std::sqrt(d);
+    }
+}
+
+static void normalize_scalar(float* x, float* y, float* z, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        float d = x[i]*x[i] + y[i]*y[i] + z[i]*z[i];
+
+        float inv = (d > 0.0f) ? 1.0f / std::sqrt(d) : 0.0f;
+        x[i] *= inv;
+        y[i] *= inv;
+        z[i] *= inv;
+    }
+}
+
+#ifdef MESH_KERNELS_X86
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2 (4 triangles / vertices per iteration, scalar tail)
+////////////////////////////////////////////////////////////////////////////////
+
+// cross(q-p, r-p) of triangles f..f+3; returns |cross|^2
+__attribute__((target("sse2")))
+static inline __m128 cross_sse2(const float* px, const float* py, const float* pz, const unsigned int* tri, __m128& cx, __m128& cy, __m128& cz)
+{
+    const unsigned int* t = tri;
+    __m128 ax = _mm_setr_ps(px[t[0]], px[t[3]], px[t[6]], px[t[9]]);
+    __m128 ay = _mm_setr_ps(py[t[0]], py[t[3]], py[t[6]], py[t[9]]);
+    __m128 az = _mm_setr_ps(pz[t[0]], pz[t[3]], pz[t[6]], pz[t[9]]);
+    __m128 ux = _mm_sub_ps(_mm_setr_ps(px[t[1]], px[t[4]], px[t[7]], px[t[10]]), ax);
+    __m128 uy = _mm_sub_ps(_mm_setr_ps(py[t[1]], py[t[4]], py[t[7]], py[t[10]]), ay);
+    __m128 uz = _mm_sub_ps(_mm_setr_ps(pz[t[1]], pz[t[4]], pz[t[7]], pz[t[10]]), az);
+    __m128 vx = _mm_sub_ps(_mm_setr_ps(px[t[2]], px[t[5]], px[t[8]], px[t[11]]), ax);
+    __m128 vy = _mm_sub_ps(_mm_setr_ps(py[t[2]], py[t[5]], py[t[8]], py[t[11]]), ay);
+    __m128 vz = _mm_sub_ps(_mm_setr_ps(pz[t[2]], pz[t[5]], pz[t[8]], pz[t[11]]), az);
+
+    cx = _mm_sub_ps(_mm_mul_ps(uy, vz), _mm_mul_ps(vy, uz));
+    cy = _mm_sub_ps(_mm_mul_ps(uz, vx), _mm_mul_ps(vz, ux));
+    cz = _mm_sub_ps(_mm_mul_ps(ux, vy), _mm_mul_ps(vx, uy));
+
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+}
+
+__attribute__((target("sse2")))
+static void face_normals_sse2(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* nx, float* ny, float* nz)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    std::size_t f = 0;
+    for (; f + 4 <= num_triangles; f += 4)
+    {
+        __m128 cx, cy, cz;
+        __m128 d = cross_sse2(px, py, pz, tv_indices + 3*f, cx, cy, cz);
+
+        __m128 inv = _mm_and_ps(_mm_cmpgt_ps(d, zero), _mm_div_ps(one, _mm_sqrt_ps(d)));
+        _mm_storeu_ps(nx + f, _mm_mul_ps(cx, inv));
+        _mm_storeu_ps(ny + f, _mm_mul_ps(cy, inv));
+        _mm_storeu_ps(nz + f, _mm_mul_ps(cz, inv));
+    }
+    face_normals_scalar(px, py, pz, tv_indices + 3*f, num_triangles - f, nx + f, ny + f, nz + f);
+}
+
+__attribute__((target("sse2")))
+static void triangle_areas_sse2(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* areas)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    std::size_t f = 0;
+    for (; f + 4 <= num_triangles; f += 4)
+    {
+        __m128 cx, cy, cz;
+        __m128 d = cross_sse2(px, py, pz, tv_indices + 3*f, cx, cy, cz);
+
+        _mm_storeu_ps(areas + f, _mm_mul_ps(half, _mm_sqrt_ps(d)));
+    }
+    triangle_areas_scalar(px, py, pz, tv_indices + 3*f, num_triangles - f, areas + f);
+}
+
+__attribute__((target("sse2")))
+static void normalize_sse2(float* x, float* y, float* z, std::size_t n)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+
+        __m128 inv = _mm_and_ps(_mm_cmpgt_ps(d, zero), _mm_div_ps(one, _mm_sqrt_ps(d)));
+        _mm_storeu_ps(x + i, _mm_mul_ps(vx, inv));
+        _mm_storeu_ps(y + i, _mm_mul_ps(vy, inv));
+        _mm_storeu_ps(z + i, _mm_mul_ps(vz, inv));
+    }
+    normalize_scalar(x + i, y + i, z + i, n - i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2 (8 triangles / vertices per iteration, gathers, scalar tail)
+// "avx2" only, not "fma": a fused multiply-add would round differently from the other levels.
+////////////////////////////////////////////////////////////////////////////////
+
+// cross(q-p, r-p) of triangles f..f+7; returns |cross|^2
+__attribute__((target("avx2")))
+static inline __m256 cross_avx2(const float* px, const float* py, const float* pz, const unsigned int* tri, __m256& cx, __m256& cy, __m256& cz)
+{
+    const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+    const int* t = (const int*) tri;
+    __m256i a = _mm256_i32gather_epi32(t,     stride, 4);
+    __m256i b = _mm256_i32gather_epi32(t + 1, stride, 4);
+    __m256i c = _mm256_i32gather_epi32(t + 2, stride, 4);
+
+    __m256 ax = _mm256_i32gather_ps(px, a, 4);
+    __m256 ay = _mm256_i32gather_ps(py, a, 4);
+    __m256 az = _mm256_i32gather_ps(pz, a, 4);
+    __m256 ux = _mm256_sub_ps(_mm256_i32gather_ps(px, b, 4), ax);
+    __m256 uy = _mm256_sub_ps(_mm256_i32gather_ps(py, b, 4), ay);
+    __m256 uz = _mm256_sub_ps(_mm256_i32gather_ps(pz, b, 4), az);
+    __m256 vx = _mm256_sub_ps(_mm256_i32gather_ps(px, c, 4), ax);
+    __m256 vy = _mm256_sub_ps(_mm256_i32gather_ps(py, c, 4), ay);
+    __m256 vz = _mm256_sub_ps(_mm256_i32gather_ps(pz, c, 4), az);
+
+    cx = _mm256_sub_ps(_mm256_mul_ps(uy, vz), _mm256_mul_ps(vy, uz));
+    cy = _mm256_sub_ps(_mm256_mul_ps(uz, vx), _mm256_mul_ps(vz, ux));
+    cz = _mm256_sub_ps(_mm256_mul_ps(ux, vy), _mm256_mul_ps(vx, uy));
+
+    return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+}
+
+__attribute__((target("avx2")))
+static void face_normals_avx2(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* nx, float* ny, float* nz)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    std::size_t f = 0;
+    for (; f + 8 <= num_triangles; f += 8)
+    {
+        __m256 cx, cy, cz;
+        __m256 d = cross_avx2(px, py, pz, tv_indices + 3*f, cx, cy, cz);
+
+        __m256 inv = _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ), _mm256_div_ps(one, _mm256_sqrt_ps(d)));
+        _mm256_storeu_ps(nx + f, _mm256_mul_ps(cx, inv));
+        _mm256_storeu_ps(ny + f, _mm256_mul_ps(cy, inv));
+        _mm256_storeu_ps(nz + f, _mm256_mul_ps(cz, inv));
+    }
+    face_normals_scalar(px, py, pz, tv_indices + 3*f, num_triangles - f, nx + f, ny + f, nz + f);
+}
+
+__attribute__((target("avx2")))
+static void triangle_areas_avx2(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* areas)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    std::size_t f = 0;
+    for (; f + 8 <= num_triangles; f += 8)
+    {
+        __m256 cx, cy, cz;
+        __m256 d = cross_avx2(px, py, pz, tv_indices + 3*f, cx, cy, cz);
+
+        _mm256_storeu_ps(areas + f, _mm256_mul_ps(half, _mm256_sqrt_ps(d)));
+    }
+    triangle_areas_scalar(px, py, pz, tv_indices + 3*f, num_triangles - f, areas + f);
+}
+
+__attribute__((target("avx2")))
+static void normalize_avx2(float* x, float* y, float* z, std::size_t n)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 vx = _mm256_loadu_ps(x + i);
+        __m256 vy = _mm256_loadu_ps(y + i);
+        __m256 vz = _mm256_loadu_ps(z + i);
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), _mm256_mul_ps(vz, vz));
+
+        __m256 inv = _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ), _mm256_div_ps(one, _mm256_sqrt_ps(d)));
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(vx, inv));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(vy, inv));
+        _mm256_storeu_ps(z + i, _mm256_mul_ps(vz, inv));
+    }
+    normalize_scalar(x + i, y + i, z + i, n - i);
+}
+
+#endif // MESH_KERNELS_X86
+
+////////////////////////////////////////////////////////////////////////////////
+// runtime dispatch
+////////////////////////////////////////////////////////////////////////////////
+
+static SimdLevel detect_simd_level()
+{
+#ifdef MESH_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return kSimdAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return kSimdSSE2;
+#endif
+    return kSimdScalar;
+}
+
+SimdLevel max_simd_level()
+{
+    static const SimdLevel level = detect_simd_level();
+    return level;
+}
+
+const MeshKernels& mesh_kernels(SimdLevel level)
+{
+    static const MeshKernels kernels[] = {
+        { kSimdScalar, "scalar", face_normals_scalar, triangle_areas_scalar, normalize_scalar },
+#ifdef MESH_KERNELS_X86
+        { kSimdSSE2,   "sse2",   face_normals_sse2,   triangle_areas_sse2,   normalize_sse2 },
+        { kSimdAVX2,   "avx2",   face_normals_avx2,   triangle_areas_avx2,   normalize_avx2 },
+#endif
+    };
+
+    if (level > max_simd_level())
+        level = max_simd_level();
+    return kernels[level];
+}
@@ -0,0 +1,498 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+VertexCacheStats analyze_vertex_cache(const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, unsigned int cache_size)
+{
+    VertexCacheStats stats;
+
+    // a vertex is in the FIFO while fewer than cache_size misses happened after it was pushed
+    // (timestamps[v] = #misses when v was pushed, 0: never)
+    std::vector<std::size_t> timestamps(num_vertices, 0);
+    std::size_t num_used = 0;
+
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+    {
+        unsigned int v = tv_indices[i];
+        if (timestamps[v] == 0)
+            ++num_used;
+
+        if (timestamps[v] == 0 || stats.num_transformed - timestamps[v] >= cache_size)
+            timestamps[v] = ++stats.num_transformed;
+    }
+
+    std::size_t num_triangles = tv_indices.size() / 3;
+    stats.acmr = num_triangles ? (float) stats.num_transformed / num_triangles : 0.0f;
+    stats.atvr = num_used ? (float) stats.num_transformed / num_used : 0.0f;
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Forsyth's vertex cache optimization
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const int   kCacheSize          = 32;       // modelled LRU cache
+const float kCacheDecayPower    = 1.5f;
+const float kLastTriScore       = 0.75f;
+const float kValenceBoostScale  = 2.0f;
+const float kValenceBoostPower  = 0.5f;
+
+// score of a vertex at LRU position cache_pos (-1: not cached) with num_remaining unemitted triangles
+float vertex_score(int cache_pos, unsigned int num_remaining)
+{
+    if (num_remaining == 0)
+        return -1.0f;   // no triangle needs it anymore
+
+    float score = 0.0f;
+    if (cache_pos >= 0)
+    {
+        if (cache_pos < 3)
+        {
+            // the last triangle's vertices get a fixed score so that
+            // the next triangle does not just reuse the same edge
+            score = kLastTriScore;
+        }
+        else
+        {
+            float scaler = 1.0f / (kCacheSize - 3);
+            score = std::pow(1.0f - (cache_pos - 3) * scaler, kCacheDecayPower);
+        }
+    }
+
+    // boost vertices with few remaining triangles so that they get finished (and leave the cache)
+    score += kValenceBoostScale * std::pow((float) num_remaining, -kValenceBoostPower);
+    return score;
+}
+
+} // namespace
+
+void reorder_for_vertex_cache(std::vector<unsigned int>& tv_indices, std::size_t num_vertices)
+{
+    std::size_t num_triangles = tv_indices.size() / 3;
+    if (num_triangles == 0)
+        return;
+
+    // vertex -> triangles (CSR); the first num_remaining[v] entries are the unemitted ones
+    std::vector<unsigned int> offsets(num_vertices + 1, 0);
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+        ++offsets[tv_indices[i] + 1];
+    for (std::size_t v = 0; v < num_vertices; ++v)
+        offsets[v+1] += offsets[v];
+
+    std::vector<unsigned int> num_remaining(num_vertices, 0);
+    std::vector<unsigned int> v_triangles(tv_indices.size());
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+    {
+        unsigned int v = tv_indices[i];
+        v_triangles[offsets[v] + num_remaining[v]++] = (unsigned int) (i / 3);
+    }
+
+    std::vector<int>    cache_pos(num_vertices, -1);
+    std::vector<float>  v_scores(num_vertices);
+    for (std::size_t v = 0; v < num_vertices; ++v)
+        v_scores[v] = vertex_score(-1, num_remaining[v]);
+
+    // start with the best-scoring triangle (the one with the lowest valence vertices)
+    std::vector<float>  t_scores(num_triangles);
+    std::vector<char>   is_emitted(num_triangles, 0);
+    for (std::size_t t = 0; t < num_triangles; ++t)
+        t_scores[t] = v_scores[tv_indices[3*t]] + v_scores[tv_indices[3*t+1]] + v_scores[tv_indices[3*t+2]];
+
+    std::vector<unsigned int> reordered;
+    reordered.reserve(tv_indices.size());
+
+    // LRU cache (+3 slots for the vertices of the triangle being added)
+    std::vector<unsigned int> cache, new_cache;
+    cache.reserve(kCacheSize + 3);
+    new_cache.reserve(kCacheSize + 3);
+
+    std::size_t best = std::max_element(t_scores.begin(), t_scores.end()) - t_scores.begin();
+    std::size_t scan_cursor = 0;    // every triangle before it has been emitted
+
+    for (std::size_t n = 0; n < num_triangles; ++n)
+    {
+        if (best == num_triangles)
+        {
+            // nothing adjacent to the cache: continue with the next unemitted triangle
+            while (is_emitted[scan_cursor])
+                ++scan_cursor;
+            best = scan_cursor;
+        }
+
+        const unsigned int* tri = &tv_indices[3*best];
+        reordered.insert(reordered.end(), tri, tri + 3);
+        is_emitted[best] = 1;
+
+        // remove the triangle from the remaining lists of its vertices
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = tri[k];
+            unsigned int* begin = &v_triangles[offsets[v]];
+            unsigned int* end = begin + num_remaining[v];
+            unsigned int* it = std::find(begin, end, (unsigned int) best);
+            if (it != end)
+            {
+                std::swap(*it, *(end - 1));
+                --num_remaining[v];
+            }
+        }
+
+        // move the triangle's vertices to the front of the LRU cache
+        new_cache.clear();
+        for (int k = 0; k < 3; ++k)
+            if (std::find(new_cache.begin(), new_cache.end(), tri[k]) == new_cache.end())
+                new_cache.push_back(tri[k]);
+        for (std::size_t c = 0; c < cache.size(); ++c)
+        {
+            unsigned int v = cache[c];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                new_cache.push_back(v);
+        }
+        for (std::size_t c = kCacheSize; c < new_cache.size(); ++c)
+        {
+            cache_pos[new_cache[c]] = -1;
+            v_scores[new_cache[c]] = vertex_score(-1, num_remaining[new_cache[c]]);
+        }
+        if (new_cache.size() > (std::size_t) kCacheSize)
+            new_cache.resize(kCacheSize);
+        cache.swap(new_cache);
+
+        for (std::size_t c = 0; c < cache.size(); ++c)
+        {
+            cache_pos[cache[c]] = (int) c;
+            v_scores[cache[c]] = vertex_score((int) c, num_remaining[cache[c]]);
+        }
+
+        // rescore the remaining triangles of the cached vertices and pick the best one
+        float best_score = -1.0f;
+        best = num_triangles;
+        for (std::size_t c = 0; c < cache.size(); ++c)
+        {
+            unsigned int v = cache[c];
+            for (unsigned int j = 0; j < num_remaining[v]; ++j)
+            {
+                unsigned int t = v_triangles[offsets[v] + j];
+                float score = v_scores[tv_indices[3*t]] + v_scores[tv_indices[3*t+1]] + v_scores[tv_indices[3*t+2]];
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    tv_indices.swap(reordered);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// overdraw
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// depth-only rasterizer with pixel-center sampling
+class DepthRasterizer
+{
+public:
+    DepthRasterizer(unsigned int resolution) : resolution_(resolution), depth_(resolution * resolution) {}
+
+    void clear()    { std::fill(depth_.begin(), depth_.end(), 1.0e30f); }
+
+    // screen-space (x, y) in pixels, z = depth (smaller is nearer); returns #fragments passing the depth test
+    std::size_t draw_triangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, bool cull_back_faces)
+    {
+        float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (area == 0.0f || (cull_back_faces && area < 0.0f))
+            return 0;
+
+        int x_min = std::max(0, (int) std::floor(std::min(a.x, std::min(b.x, c.x))));
+        int y_min = std::max(0, (int) std::floor(std::min(a.y, std::min(b.y, c.y))));
+        int x_max = std::min((int) resolution_ - 1, (int) std::ceil(std::max(a.x, std::max(b.x, c.x))));
+        int y_max = std::min((int) resolution_ - 1, (int) std::ceil(std::max(a.y, std::max(b.y, c.y))));
+
+        float inv_area = 1.0f / area;
+        std::size_t num_passed = 0;
+        for (int y = y_min; y <= y_max; ++y)
+        {
+            for (int x = x_min; x <= x_max; ++x)
+            {
+                float px = x + 0.5f, py = y + 0.5f;
+
+                // barycentric weights (all >= 0 inside for either winding)
+                float w0 = ((c.x - b.x) * (py - b.y) - (px - b.x) * (c.y - b.y)) * inv_area;
+                float w1 = ((a.x - c.x) * (py - c.y) - (px - c.x) * (a.y - c.y)) * inv_area;
+                float w2 = 1.0f - w0 - w1;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+
+                float z = w0 * a.z + w1 * b.z + w2 * c.z;
+                float& depth = depth_[y * resolution_ + x];
+                if (z < depth)
+                {
+                    depth = z;
+                    ++num_passed;
+                }
+            }
+        }
+        return num_passed;
+    }
+
+    std::size_t num_covered() const
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < depth_.size(); ++i)
+            if (depth_[i] < 1.0e30f)
+                ++count;
+        return count;
+    }
+
+private:
+    unsigned int        resolution_;
+    std::vector<float>  depth_;
+};
+
+// FIFO cache update for one triangle; returns #misses
+unsigned int update_fifo_cache(const unsigned int* tri, unsigned int cache_size, std::vector<std::size_t>& timestamps, std::size_t& num_misses)
+{
+    unsigned int misses = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        std::size_t& stamp = timestamps[tri[k]];
+        if (stamp == 0 || num_misses - stamp >= cache_size)
+        {
+            stamp = ++num_misses;
+            ++misses;
+        }
+    }
+    return misses;
+}
+
+// invalidate the cache without clearing the timestamps (everything older is a miss)
+void flush_fifo_cache(unsigned int cache_size, std::size_t& num_misses)
+{
+    num_misses += cache_size;
+}
+
+} // namespace
+
+OverdrawStats estimate_overdraw(const std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, unsigned int resolution, bool cull_back_faces)
+{
+    OverdrawStats stats;
+    if (num_vertices == 0 || tv_indices.empty())
+        return stats;
+
+    glm::vec3 p_min = positions[0], p_max = positions[0];
+    for (std::size_t v = 1; v < num_vertices; ++v)
+    {
+        p_min = glm::min(p_min, positions[v]);
+        p_max = glm::max(p_max, positions[v]);
+    }
+    glm::vec3 center = 0.5f * (p_min + p_max);
+    float radius = std::max(0.5f * glm::length(p_max - p_min), 1.0e-20f);
+
+    DepthRasterizer rasterizer(resolution);
+    std::vector<glm::vec3> screen(num_vertices);
+
+    for (int view = 0; view < 14; ++view)
+    {
+        // view direction: 6 axes, then 8 cube corners
+        glm::vec3 dir;
+        if (view < 6)
+        {
+            dir = glm::vec3(0.0f);
+            dir[view / 2] = (view % 2) ? -1.0f : 1.0f;
+        }
+        else
+        {
+            int corner = view - 6;
+            dir = glm::normalize(glm::vec3((corner & 1) ? -1.0f : 1.0f, (corner & 2) ? -1.0f : 1.0f, (corner & 4) ? -1.0f : 1.0f));
+        }
+        glm::vec3 up = (std::fabs(dir.y) > 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::vec3 right = glm::normalize(glm::cross(dir, up));
+        up = glm::cross(right, dir);
+
+        // orthographic projection of the bounding sphere onto the whole viewport
+        float scale = 0.5f * resolution / radius;
+        for (std::size_t v = 0; v < num_vertices; ++v)
+        {
+            glm::vec3 d = positions[v] - center;
+            screen[v] = glm::vec3((glm::dot(d, right) + radius) * scale, (glm::dot(d, up) + radius) * scale, glm::dot(d, dir));
+        }
+
+        rasterizer.clear();
+        for (std::size_t i = 0; i + 2 < tv_indices.size(); i += 3)
+            stats.num_shaded += rasterizer.draw_triangle(screen[tv_indices[i]], screen[tv_indices[i+1]], screen[tv_indices[i+2]], cull_back_faces);
+        stats.num_covered += rasterizer.num_covered();
+    }
+
+    stats.overdraw = stats.num_covered ? (float) stats.num_shaded / stats.num_covered : 0.0f;
+    return stats;
+}
+
+void reorder_for_overdraw(std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, float acmr_threshold)
+{
+    const unsigned int kCacheSize = 16;
+
+    std::size_t num_triangles = tv_indices.size() / 3;
+    if (num_triangles == 0)
+        return;
+
+    // 1) hard boundaries: a triangle with 3 cache misses starts a new patch
+    std::vector<std::size_t> timestamps(num_vertices, 0);
+    std::size_t num_misses = 0;
+
+    std::vector<std::size_t> hard_clusters;
+    for (std::size_t t = 0; t < num_triangles; ++t)
+        if (update_fifo_cache(&tv_indices[3*t], kCacheSize, timestamps, num_misses) == 3 || t == 0)
+            hard_clusters.push_back(t);
+    hard_clusters.push_back(num_triangles);
+
+    // 2) soft boundaries: split a patch once a sub-cluster's ACMR gets close to the patch's ACMR
+    std::vector<std::size_t> clusters;
+    for (std::size_t h = 0; h + 1 < hard_clusters.size(); ++h)
+    {
+        std::size_t b = hard_clusters[h], e = hard_clusters[h+1];
+
+        flush_fifo_cache(kCacheSize, num_misses);
+        std::size_t start_misses = num_misses;
+        for (std::size_t t = b; t < e; ++t)
+            update_fifo_cache(&tv_indices[3*t], kCacheSize, timestamps, num_misses);
+        float patch_acmr = (float) (num_misses - start_misses) / (e - b);
+
+        flush_fifo_cache(kCacheSize, num_misses);
+        start_misses = num_misses;
+        std::size_t start = b;
+        clusters.push_back(b);
+        for (std::size_t t = b; t < e; ++t)
+        {
+            update_fifo_cache(&tv_indices[3*t], kCacheSize, timestamps, num_misses);
+
+            float acmr = (float) (num_misses - start_misses) / (t + 1 - start);
+            if (acmr <= patch_acmr * acmr_threshold && t + 1 < e)
+            {
+                clusters.push_back(t + 1);
+                flush_fifo_cache(kCacheSize, num_misses);
+                start_misses = num_misses;
+                start = t + 1;
+            }
+        }
+    }
+    clusters.push_back(num_triangles);
+    std::size_t num_clusters = clusters.size() - 1;
+
+    // 3) sort key: how much a cluster faces away from the mesh center
+    //    dot(cluster centroid - mesh centroid, cluster normal), both area-weighted
+    std::vector<glm::vec3> c_centroids(num_clusters, glm::vec3(0.0f)), c_normals(num_clusters, glm::vec3(0.0f));
+    std::vector<float> c_areas(num_clusters, 0.0f);
+    glm::vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+
+    for (std::size_t c = 0; c < num_clusters; ++c)
+    {
+        for (std::size_t t = clusters[c]; t < clusters[c+1]; ++t)
+        {
+            const glm::vec3& p = positions[tv_indices[3*t]];
+            const glm::vec3& q = positions[tv_indices[3*t+1]];
+            const glm::vec3& r = positions[tv_indices[3*t+2]];
+
+            glm::vec3 n = glm::cross(q-p, r-p);
+            float area = glm::length(n);
+
+            c_centroids[c] += area * (p + q + r) / 3.0f;
+            c_normals[c] += n;
+            c_areas[c] += area;
+        }
+        mesh_centroid += c_centroids[c];
+        mesh_area += c_areas[c];
+    }
+    if (mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+
+    std::vector<float> keys(num_clusters, 0.0f);
+    for (std::size_t c = 0; c < num_clusters; ++c)
+    {
+        float normal_length = glm::length(c_normals[c]);
+        if (c_areas[c] > 0.0f && normal_length > 0.0f)
+            keys[c] = glm::dot(c_centroids[c] / c_areas[c] - mesh_centroid, c_normals[c] / normal_length);
+    }
+
+    std::vector<unsigned int> order(num_clusters);
+    for (std::size_t c = 0; c < num_clusters; ++c)
+        order[c] = (unsigned int) c;
+    std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return keys[a] > keys[b]; });
+
+    // 4) concatenate the clusters in the sorted order
+    std::vector<unsigned int> reordered;
+    reordered.reserve(tv_indices.size());
+    for (std::size_t k = 0; k < num_clusters; ++k)
+    {
+        std::size_t c = order[k];
+        reordered.insert(reordered.end(), tv_indices.begin() + 3*clusters[c], tv_indices.begin() + 3*clusters[c+1]);
+    }
+    tv_indices.swap(reordered);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// vertex fetch
+////////////////////////////////////////////////////////////////////////////////
+
+VertexFetchStats analyze_vertex_fetch(const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, std::size_t vertex_size)
+{
+    const std::size_t kLineSize = 64;
+    const std::size_t kNumLines = 256;
+
+    VertexFetchStats stats;
+
+    std::vector<char> is_used(num_vertices, 0);
+    std::vector<std::size_t> lines(kNumLines, (std::size_t) -1);   // line address held by each cache slot
+
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+    {
+        unsigned int v = tv_indices[i];
+        if (!is_used[v])
+        {
+            is_used[v] = 1;
+            ++stats.num_used;
+        }
+
+        // a vertex may straddle two lines
+        std::size_t first = (v * vertex_size) / kLineSize;
+        std::size_t last = (v * vertex_size + vertex_size - 1) / kLineSize;
+        for (std::size_t line = first; line <= last; ++line)
+        {
+            std::size_t& slot = lines[line % kNumLines];
+            if (slot != line)
+            {
+                slot = line;
+                stats.bytes_fetched += kLineSize;
+            }
+        }
+    }
+
+    std::size_t used_bytes = stats.num_used * vertex_size;
+    stats.overfetch = used_bytes ? (float) stats.bytes_fetched / used_bytes : 0.0f;
+    return stats;
+}
+
+std::size_t reorder_for_vertex_fetch(std::vector<unsigned int>& tv_indices, std::size_t num_vertices, std::vector<unsigned int>& vertex_src)
+{
+    const unsigned int kNone = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(num_vertices, kNone);      // old vertex -> new vertex
+
+    vertex_src.clear();
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+    {
+        unsigned int& v_new = remap[tv_indices[i]];
+        if (v_new == kNone)
+        {
+            v_new = (unsigned int) vertex_src.size();
+            vertex_src.push_back(tv_indices[i]);
+        }
+        tv_indices[i] = v_new;
+    }
+    return vertex_src.size();
+}
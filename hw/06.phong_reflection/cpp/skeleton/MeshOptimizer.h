@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// post-transform vertex cache statistics of a triangle order (GPU-independent simulation)
+//   ACMR = transformed vertices / #triangles     (0.5 at best for a regular grid, 3.0 at worst)
+//   ATVR = transformed vertices / #used vertices  (1.0 at best)
+struct VertexCacheStats
+{
+    std::size_t num_transformed = 0;
+    float       acmr = 0.0f;
+    float       atvr = 0.0f;
+};
+
+// simulate a FIFO cache of cache_size entries over tv_indices (size = 3 x #triangles)
+VertexCacheStats analyze_vertex_cache(const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, unsigned int cache_size = 16);
+
+// reorder triangles for vertex cache locality (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation").
+// only the triangle order changes; each triangle keeps its winding.
+void reorder_for_vertex_cache(std::vector<unsigned int>& tv_indices, std::size_t num_vertices);
+
+// overdraw of a triangle order, estimated on the CPU (depth-only rasterization, depth test GL_LESS)
+// from 14 orthographic viewpoints around the mesh (6 axes + 8 cube corners), summed over the views.
+//   overdraw = fragments passing the depth test / covered pixels  (1.0 = no overdraw)
+struct OverdrawStats
+{
+    std::size_t num_covered = 0;
+    std::size_t num_shaded = 0;
+    float       overdraw = 0.0f;
+};
+
+OverdrawStats estimate_overdraw(const std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, unsigned int resolution = 256, bool cull_back_faces = false);
+
+// split a vertex-cache optimized order into clusters and draw the clusters that face
+// away from the mesh center (likely occluders) first (Sander et al., "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw"). a cluster is only split while
+// its ACMR stays within acmr_threshold x the ACMR of the original run.
+void reorder_for_overdraw(std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, float acmr_threshold = 1.05f);
+
+// vertex fetch statistics: bytes read through a small direct-mapped cache (256 x 64-byte lines)
+// walking the vertices of tv_indices in order
+//   overfetch = bytes fetched / bytes of the used vertices  (1.0 = every vertex read once, sequentially)
+struct VertexFetchStats
+{
+    std::size_t num_used = 0;       // #vertices referenced by tv_indices
+    std::size_t bytes_fetched = 0;
+    float       overfetch = 0.0f;
+};
+
+VertexFetchStats analyze_vertex_fetch(const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, std::size_t vertex_size);
+
+// renumber vertices in first-use order of tv_indices and drop the unreferenced ones.
+// vertex_src[new vertex] = old vertex; returns the new #vertices (= vertex_src.size())
+std::size_t reorder_for_vertex_fetch(std::vector<unsigned int>& tv_indices, std::size_t num_vertices, std::vector<unsigned int>& vertex_src);
@@ -0,0 +1,229 @@
+#include "MeshPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+// the first store of a pool buffer (then x2 when full)
+static const std::size_t kInitialBufferBytes = 4 << 20;
+
+std::size_t RangeAllocator::allocate(std::size_t count)
+{
+    assert(count > 0);
+
+    // the smallest free range of count units or more; the rest of it stays free
+    std::set<std::pair<std::size_t, std::size_t> >::iterator it = by_size_.lower_bound(std::make_pair(count, std::size_t(0)));
+    if (it == by_size_.end())
+        return kNone;
+
+    std::size_t first = it->second;
+    std::size_t size = it->first;
+    erase_free_(by_first_.find(first));
+    if (size > count)
+        insert_free_(first + count, size - count);
+
+    used_ += count;
+    return first;
+}
+
+void RangeAllocator::free(std::size_t first, std::size_t count)
+{
+    if (count == 0)
+        return;
+    assert(used_ >= count);
+    used_ -= count;
+
+    // merge with the free ranges right after and right before
+    std::map<std::size_t, std::size_t>::iterator next = by_first_.lower_bound(first);
+    if (next != by_first_.end() && next->first == first + count)
+    {
+        count += next->second;
+        std::map<std::size_t, std::size_t>::iterator after = std::next(next);
+        erase_free_(next);
+        next = after;
+    }
+    if (next != by_first_.begin())
+    {
+        std::map<std::size_t, std::size_t>::iterator prev = std::prev(next);
+        if (prev->first + prev->second == first)
+        {
+            first = prev->first;
+            count += prev->second;
+            erase_free_(prev);
+        }
+    }
+    insert_free_(first, count);
+}
+
+void RangeAllocator::grow(std::size_t capacity)
+{
+    if (capacity <= capacity_)
+        return;
+
+    // free() the new units: they merge with a free range at the old end
+    std::size_t old_capacity = capacity_;
+    capacity_ = capacity;
+    used_ += capacity - old_capacity;
+    free(old_capacity, capacity - old_capacity);
+}
+
+void RangeAllocator::insert_free_(std::size_t first, std::size_t count)
+{
+    by_first_[first] = count;
+    by_size_.insert(std::make_pair(count, first));
+}
+
+void RangeAllocator::erase_free_(std::map<std::size_t, std::size_t>::iterator it)
+{
+    by_size_.erase(std::make_pair(it->second, it->first));
+    by_first_.erase(it);
+}
+
+
+static MeshPool* g_active_pool = NULL;
+
+MeshPool::~MeshPool()
+{
+    if (g_active_pool == this)
+        g_active_pool = NULL;
+    release();
+}
+
+bool MeshPool::is_supported()
+{
+    return GLEW_VERSION_3_1 || GLEW_ARB_copy_buffer;
+}
+
+MeshPool* MeshPool::active()
+{
+    return g_active_pool;
+}
+
+void MeshPool::set_active(MeshPool* pool)
+{
+    g_active_pool = pool;
+}
+
+int MeshPool::find_pool_(const VertexFormat& format, GLenum index_type)
+{
+    // a handful: a linear search
+    for (std::size_t i = 0; i < pools_.size(); ++i)
+    {
+        if (pools_[i].index_type == index_type && pools_[i].format == format)
+            return (int) i;
+    }
+
+    MeshPoolBuffers pool;
+    pool.format = format;
+    pool.index_type = index_type;
+    glGenBuffers(1, &pool.vertex_buffer);
+    glGenBuffers(1, &pool.index_buffer);
+    pools_.push_back(pool);
+    return (int) pools_.size() - 1;
+}
+
+void MeshPool::grow_buffer_(GLuint buffer, std::size_t old_bytes, std::size_t bytes)
+{
+    // the contents go to a scratch buffer and back, so buffer keeps its name
+    GLuint scratch = 0;
+    if (old_bytes > 0)
+    {
+        glGenBuffers(1, &scratch);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+        glBufferData(GL_COPY_WRITE_BUFFER, old_bytes, NULL, GL_STATIC_COPY);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_bytes);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBufferData(GL_COPY_READ_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+
+    if (old_bytes > 0)
+    {
+        glCopyBufferSubData(GL_COPY_WRITE_BUFFER, GL_COPY_READ_BUFFER, 0, 0, old_bytes);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &scratch);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+MeshPoolRange MeshPool::allocate(const VertexFormat& format, GLenum index_type, std::size_t num_vertices, std::size_t num_indices)
+{
+    MeshPoolRange range;
+    range.pool = find_pool_(format, index_type);
+    MeshPoolBuffers& pool = pools_[range.pool];
+    range.num_vertices = (GLuint) num_vertices;
+    range.num_indices = (GLuint) num_indices;
+
+    if (num_vertices > 0)
+    {
+        std::size_t first = pool.vertices.allocate(num_vertices);
+        if (first == RangeAllocator::kNone)
+        {
+            std::size_t stride = format.stride();
+            std::size_t capacity = std::max(std::max(2 * pool.vertices.capacity(), pool.vertices.capacity() + num_vertices),
+                                            kInitialBufferBytes / stride);
+            grow_buffer_(pool.vertex_buffer, pool.vertices.capacity() * stride, capacity * stride);
+            pool.vertices.grow(capacity);
+            ++pool.num_grows;
+            first = pool.vertices.allocate(num_vertices);
+        }
+        range.base_vertex = (GLint) first;
+    }
+
+    if (num_indices > 0)
+    {
+        std::size_t first = pool.indices.allocate(num_indices);
+        if (first == RangeAllocator::kNone)
+        {
+            std::size_t index_size = pool.index_size();
+            std::size_t capacity = std::max(std::max(2 * pool.indices.capacity(), pool.indices.capacity() + num_indices),
+                                            kInitialBufferBytes / index_size);
+            grow_buffer_(pool.index_buffer, pool.indices.capacity() * index_size, capacity * index_size);
+            pool.indices.grow(capacity);
+            ++pool.num_grows;
+            first = pool.indices.allocate(num_indices);
+        }
+        range.first_index = (GLuint) first;
+    }
+
+    ++pool.num_ranges;
+    return range;
+}
+
+void MeshPool::free(const MeshPoolRange& range)
+{
+    if (range.pool < 0 || range.pool >= (int) pools_.size())
+        return;
+
+    MeshPoolBuffers& pool = pools_[range.pool];
+    pool.vertices.free(range.base_vertex, range.num_vertices);
+    pool.indices.free(range.first_index, range.num_indices);
+    --pool.num_ranges;
+}
+
+void MeshPool::release()
+{
+    for (std::size_t i = 0; i < pools_.size(); ++i)
+    {
+        glDeleteBuffers(1, &pools_[i].vertex_buffer);
+        glDeleteBuffers(1, &pools_[i].index_buffer);
+    }
+    pools_.clear();
+}
+
+std::size_t MeshPool::gpu_bytes() const
+{
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < pools_.size(); ++i)
+        bytes += pools_[i].vertices.capacity() * pools_[i].format.stride() + pools_[i].indices.capacity() * pools_[i].index_size();
+    return bytes;
+}
+
+std::size_t MeshPool::used_bytes() const
+{
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < pools_.size(); ++i)
+        bytes += pools_[i].vertices.used() * pools_[i].format.stride() + pools_[i].indices.used() * pools_[i].index_size();
+    return bytes;
+}
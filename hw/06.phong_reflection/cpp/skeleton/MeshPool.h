@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "VertexFormat.h"
+
+// free ranges of [0, capacity()) in some unit (vertices, indices): an allocation takes the
+// smallest free range it fits in, and a freed range merges with the free ones next to it.
+// no GL calls
+class RangeAllocator
+{
+public:
+    static const std::size_t kNone = ~std::size_t(0);
+
+    // first unit of count units (count > 0), kNone if no free range is large enough
+    std::size_t allocate(std::size_t count);
+    void free(std::size_t first, std::size_t count);
+    // [capacity(), capacity) becomes free (a smaller capacity is ignored)
+    void grow(std::size_t capacity);
+
+    std::size_t capacity() const            { return capacity_; }
+    std::size_t used() const                { return used_; }
+    std::size_t num_free_ranges() const     { return by_first_.size(); }
+    std::size_t largest_free() const        { return by_size_.empty() ? 0 : by_size_.rbegin()->first; }
+
+private:
+    void insert_free_(std::size_t first, std::size_t count);
+    void erase_free_(std::map<std::size_t, std::size_t>::iterator it);
+
+    std::map<std::size_t, std::size_t>      by_first_;  // free ranges: first -> count
+    std::set<std::pair<std::size_t, std::size_t> >  by_size_;   // the same as (count, first)
+    std::size_t capacity_ = 0;
+    std::size_t used_ = 0;
+};
+
+// where the vertices and indices of one upload (a shading type of a Mesh) are in a MeshPool
+struct MeshPoolRange
+{
+    int         pool = -1;          // of MeshPool::buffers()
+    GLint       base_vertex = 0;    // first vertex in the vertex buffer of the pool
+    GLuint      num_vertices = 0;
+    GLuint      first_index = 0;    // first index in the index buffer of the pool
+    GLuint      num_indices = 0;
+};
+
+// the vertex and index buffer of one vertex format and index type
+struct MeshPoolBuffers
+{
+    VertexFormat    format;
+    GLenum          index_type = GL_UNSIGNED_INT;
+    GLuint          vertex_buffer = 0;
+    GLuint          index_buffer = 0;
+    RangeAllocator  vertices;
+    RangeAllocator  indices;
+    std::size_t     num_ranges = 0;     // allocated now
+    std::size_t     num_grows = 0;      // times a buffer was enlarged
+
+    std::size_t index_size() const      { return (index_type == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int); }
+};
+
+// the vertices and indices of every mesh in a few large buffers, one pair per vertex format
+// and index type, so the meshes of a pool draw with one VAO and one multi-draw (see
+// IndirectDraw.h). a Mesh uploads into the active() pool, if one is set, instead of buffers
+// of its own, and frees its ranges in delete_gl_buffers().
+// a full buffer grows (x2) under the same name, so the VAOs pointing into it stay valid.
+// GL thread only; needs glCopyBufferSubData (GL 3.1)
+class MeshPool
+{
+public:
+    MeshPool() {}
+    ~MeshPool();        // deletes the buffers (GL thread), after the meshes in them
+
+    MeshPool(const MeshPool&) = delete;
+    MeshPool& operator=(const MeshPool&) = delete;
+
+    static bool is_supported();
+
+    // the pool Mesh uploads go to (NULL: buffers of each mesh's own). set it before the first
+    // upload; the meshes uploaded before keep their own buffers
+    static MeshPool* active();
+    static void set_active(MeshPool* pool);
+
+    // num_vertices and num_indices of a pool of format and index_type (created on first use);
+    // the pool grows if they do not fit. kDrawArrays meshes take no indices
+    MeshPoolRange allocate(const VertexFormat& format, GLenum index_type, std::size_t num_vertices, std::size_t num_indices);
+    void free(const MeshPoolRange& range);
+    void release();
+
+    std::size_t num_pools() const                   { return pools_.size(); }
+    const MeshPoolBuffers& buffers(int pool) const  { return pools_[pool]; }
+
+    std::size_t gpu_bytes() const;      // of all buffers
+    std::size_t used_bytes() const;     // of the allocated ranges
+
+private:
+    int find_pool_(const VertexFormat& format, GLenum index_type);
+    // a store of bytes for buffer, with the old_bytes it had copied over
+    static void grow_buffer_(GLuint buffer, std::size_t old_bytes, std::size_t bytes);
+
+    std::vector<MeshPoolBuffers>    pools_;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+// optional load-time mesh passes (bit flags for Model::load_model, like aiProcess_*)
+// kMeshProcessVertexCache : reorder triangles for the post-transform vertex cache
+// kMeshProcessOverdraw    : then draw outward-facing triangle clusters first (implies kMeshProcessVertexCache)
+// kMeshProcessMeshlets    : group the triangles into meshlets for per-frame CPU culling (after the passes above)
+// kMeshProcessLods        : build a chain of simplified LODs over the same vertices (after the passes above)
+// kMeshProcessVertexFetch : renumber vertices in first-use order, drop unreferenced ones (runs last)
+enum MeshProcess
+{
+    kMeshProcessNone        = 0,
+    kMeshProcessVertexCache = 1 << 0,
+    kMeshProcessOverdraw    = 1 << 1,
+    kMeshProcessVertexFetch = 1 << 2,
+    kMeshProcessMeshlets    = 1 << 3,
+    kMeshProcessLods        = 1 << 4,
+};
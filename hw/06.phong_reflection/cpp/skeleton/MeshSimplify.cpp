@@ -0,0 +1,316 @@
+#include "MeshSimplify.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+// symmetric 4x4 matrix of area-weighted plane equations (a, b, c, d):
+// error(p) = weighted mean of the squared distances of p to the planes
+struct Quadric
+{
+    double  a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double  b2 = 0.0, bc = 0.0, bd = 0.0;
+    double  c2 = 0.0, cd = 0.0;
+    double  d2 = 0.0;
+    double  w = 0.0;        // sum of the weights
+
+    void add_plane(double a, double b, double c, double d, double weight)
+    {
+        a2 += weight*a*a;  ab += weight*a*b;  ac += weight*a*c;  ad += weight*a*d;
+        b2 += weight*b*b;  bc += weight*b*c;  bd += weight*b*d;
+        c2 += weight*c*c;  cd += weight*c*d;
+        d2 += weight*d*d;
+        w += weight;
+    }
+
+    Quadric& operator+=(const Quadric& q)
+    {
+        a2 += q.a2;  ab += q.ab;  ac += q.ac;  ad += q.ad;
+        b2 += q.b2;  bc += q.bc;  bd += q.bd;
+        c2 += q.c2;  cd += q.cd;
+        d2 += q.d2;
+        w += q.w;
+        return *this;
+    }
+
+    double error(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double e = a2*x*x + 2.0*ab*x*y + 2.0*ac*x*z + 2.0*ad*x
+                 + b2*y*y + 2.0*bc*y*z + 2.0*bd*y
+                 + c2*z*z + 2.0*cd*z
+                 + d2;
+        return (w > 0.0) ? std::max(e, 0.0) / w : 0.0;
+    }
+};
+
+struct Collapse
+{
+    double          error;
+    unsigned int    from;
+    unsigned int    to;
+
+    bool operator<(const Collapse& c) const     { return error < c.error; }
+};
+
+class QuadricSimplifier
+{
+public:
+    QuadricSimplifier(const std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices)
+        : indices_(tv_indices), positions_(positions), num_vertices_(num_vertices),
+          quadrics_(num_vertices), is_locked_(num_vertices, false), remap_(num_vertices)
+    {
+        for (std::size_t i = 0; i + 2 < indices_.size(); i += 3)
+        {
+            const glm::vec3& p0 = positions_[indices_[i]];
+            glm::vec3 n = glm::cross(positions_[indices_[i+1]] - p0, positions_[indices_[i+2]] - p0);
+            float len = glm::length(n);
+            if (len == 0.0f)
+                continue;
+            n /= len;
+
+            Quadric q;
+            q.add_plane(n.x, n.y, n.z, -glm::dot(n, p0), 0.5 * len);
+            for (int k = 0; k < 3; ++k)
+                quadrics_[indices_[i+k]] += q;
+        }
+        lock_borders_and_seams_();
+    }
+
+    // collapse edges (cheapest first) until at most target_triangles remain or nothing can collapse
+    void simplify(std::size_t target_triangles);
+
+    const std::vector<unsigned int>& indices() const    { return indices_; }
+    float error() const     { return (float) std::sqrt(max_error_); }     // RMS distance of the worst collapse
+
+private:
+    void lock_borders_and_seams_();
+    bool has_flips_(unsigned int from, unsigned int to, const std::vector<unsigned int>& adjacency_offsets, const std::vector<unsigned int>& adjacency) const;
+
+    std::vector<unsigned int>   indices_;
+    const glm::vec3*            positions_;
+    std::size_t                 num_vertices_;
+
+    std::vector<Quadric>        quadrics_;
+    std::vector<bool>           is_locked_;
+    std::vector<unsigned int>   remap_;         // vertex after the collapses of the current pass
+    double                      max_error_ = 0.0;
+};
+
+void QuadricSimplifier::lock_borders_and_seams_()
+{
+    // an undirected edge used by anything but exactly 2 triangles is a border (or non-manifold)
+    std::unordered_map<unsigned long long, unsigned int> edge_counts;
+    edge_counts.reserve(indices_.size());
+    for (std::size_t i = 0; i < indices_.size(); ++i)
+    {
+        unsigned int a = indices_[i];
+        unsigned int b = indices_[(i % 3 == 2) ? i - 2 : i + 1];
+        unsigned long long key = (a < b) ? ((unsigned long long) a << 32 | b) : ((unsigned long long) b << 32 | a);
+        ++edge_counts[key];
+    }
+    for (std::unordered_map<unsigned long long, unsigned int>::const_iterator it = edge_counts.begin(); it != edge_counts.end(); ++it)
+    {
+        if (it->second != 2)
+        {
+            is_locked_[(unsigned int) (it->first >> 32)] = true;
+            is_locked_[(unsigned int) (it->first & 0xFFFFFFFFu)] = true;
+        }
+    }
+
+    // vertices split by JoinIdenticalVertices for differing normals / colors / texcoords:
+    // sort by position and lock the runs of equal positions
+    std::vector<unsigned int> order(num_vertices_);
+    for (unsigned int v = 0; v < num_vertices_; ++v)
+        order[v] = v;
+
+    const glm::vec3* positions = positions_;
+    std::sort(order.begin(), order.end(), [positions](unsigned int a, unsigned int b) {
+        const glm::vec3& p = positions[a];
+        const glm::vec3& q = positions[b];
+        return (p.x != q.x) ? p.x < q.x : (p.y != q.y) ? p.y < q.y : p.z < q.z;
+    });
+    for (std::size_t i = 1; i < order.size(); ++i)
+    {
+        if (positions_[order[i]] == positions_[order[i-1]])
+            is_locked_[order[i]] = is_locked_[order[i-1]] = true;
+    }
+}
+
+bool QuadricSimplifier::has_flips_(unsigned int from, unsigned int to, const std::vector<unsigned int>& adjacency_offsets, const std::vector<unsigned int>& adjacency) const
+{
+    const glm::vec3& p_from = positions_[from];
+    const glm::vec3& p_to = positions_[to];
+
+    for (unsigned int k = adjacency_offsets[from]; k < adjacency_offsets[from+1]; ++k)
+    {
+        const unsigned int* tri = &indices_[3 * adjacency[k]];
+        unsigned int v[3] = { remap_[tri[0]], remap_[tri[1]], remap_[tri[2]] };
+        if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+            continue;   // already collapsed in this pass
+        if (v[0] == to || v[1] == to || v[2] == to)
+            continue;   // becomes degenerate and is removed
+
+        // rotate so that v[0] == from
+        int s = (v[0] == from) ? 0 : (v[1] == from) ? 1 : 2;
+        const glm::vec3& p1 = positions_[v[(s+1)%3]];
+        const glm::vec3& p2 = positions_[v[(s+2)%3]];
+
+        glm::vec3 n_old = glm::cross(p1 - p_from, p2 - p_from);
+        glm::vec3 n_new = glm::cross(p1 - p_to, p2 - p_to);
+        if (glm::dot(n_old, n_new) <= 0.0f)
+            return true;
+    }
+    return false;
+}
+
+void QuadricSimplifier::simplify(std::size_t target_triangles)
+{
+    while (indices_.size() / 3 > target_triangles)
+    {
+        std::size_t num_triangles = indices_.size() / 3;
+
+        // vertex -> triangles (CSR) of the current indices
+        std::vector<unsigned int> adjacency_offsets(num_vertices_ + 1, 0);
+        for (std::size_t i = 0; i < indices_.size(); ++i)
+            ++adjacency_offsets[indices_[i] + 1];
+        for (std::size_t v = 0; v < num_vertices_; ++v)
+            adjacency_offsets[v+1] += adjacency_offsets[v];
+
+        std::vector<unsigned int> adjacency(indices_.size());
+        std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (std::size_t i = 0; i < indices_.size(); ++i)
+            adjacency[fill[indices_[i]]++] = (unsigned int) (i / 3);
+
+        // the cheaper direction of every edge (each interior edge is seen from both triangles)
+        std::vector<Collapse> collapses;
+        collapses.reserve(indices_.size() / 2);
+        for (std::size_t i = 0; i < indices_.size(); ++i)
+        {
+            unsigned int a = indices_[i];
+            unsigned int b = indices_[(i % 3 == 2) ? i - 2 : i + 1];
+            if (a > b || (is_locked_[a] && is_locked_[b]))
+                continue;
+
+            Quadric q = quadrics_[a];
+            q += quadrics_[b];
+
+            Collapse c;
+            c.error = 1.0e300;
+            if (!is_locked_[a])
+            {
+                c.error = q.error(positions_[b]);
+                c.from = a;
+                c.to = b;
+            }
+            if (!is_locked_[b] && q.error(positions_[a]) < c.error)
+            {
+                c.error = q.error(positions_[a]);
+                c.from = b;
+                c.to = a;
+            }
+            collapses.push_back(c);
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        // a collapse removes about 2 triangles; each vertex takes part in one collapse per pass
+        // so that the flip test sees final positions
+        for (unsigned int v = 0; v < num_vertices_; ++v)
+            remap_[v] = v;
+        std::vector<bool> is_touched(num_vertices_, false);
+
+        std::size_t num_to_remove = num_triangles - target_triangles;
+        std::size_t num_removed = 0;
+        for (std::size_t k = 0; k < collapses.size() && num_removed < num_to_remove; ++k)
+        {
+            const Collapse& c = collapses[k];
+            if (is_touched[c.from] || is_touched[c.to])
+                continue;
+            if (has_flips_(c.from, c.to, adjacency_offsets, adjacency))
+                continue;
+
+            remap_[c.from] = c.to;
+            quadrics_[c.to] += quadrics_[c.from];
+            is_touched[c.from] = is_touched[c.to] = true;
+            max_error_ = std::max(max_error_, c.error);
+            num_removed += 2;
+        }
+
+        // apply the collapses and drop the degenerate triangles
+        std::size_t out = 0;
+        for (std::size_t i = 0; i < indices_.size(); i += 3)
+        {
+            unsigned int a = remap_[indices_[i]], b = remap_[indices_[i+1]], c = remap_[indices_[i+2]];
+            if (a == b || b == c || c == a)
+                continue;
+            indices_[out++] = a;
+            indices_[out++] = b;
+            indices_[out++] = c;
+        }
+        indices_.resize(out);
+
+        if (indices_.size() / 3 == num_triangles)
+            break;  // stuck: every remaining collapse would flip a triangle or move a locked vertex
+    }
+}
+
+}   // namespace
+
+float simplify_mesh(std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, std::size_t target_triangles)
+{
+    QuadricSimplifier simplifier(tv_indices, positions, num_vertices);
+    simplifier.simplify(target_triangles);
+    tv_indices = simplifier.indices();
+    return simplifier.error();
+}
+
+void build_lod_chain(const std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices,
+                     std::vector<unsigned int>& lod_indices, std::vector<MeshLod>& lods,
+                     unsigned int max_lods, float ratio)
+{
+    const std::size_t kMinTriangles = 16;
+
+    lod_indices.clear();
+    lods.assign(1, MeshLod());
+    lods[0].index_count = (unsigned int) tv_indices.size();
+
+    // each LOD continues from the previous one with the accumulated quadrics,
+    // so the error of LOD k is measured against LOD 0
+    QuadricSimplifier simplifier(tv_indices, positions, num_vertices);
+    while (lods.size() < max_lods)
+    {
+        std::size_t prev_triangles = lods.back().index_count / 3;
+        std::size_t target = (std::size_t) (prev_triangles * ratio);
+        if (target < kMinTriangles)
+            break;
+
+        simplifier.simplify(target);
+
+        // stop when a LOD would not be noticeably cheaper than the previous one
+        std::vector<unsigned int> indices = simplifier.indices();
+        if (indices.size() / 3 > prev_triangles * (1.0f + ratio) / 2)
+            break;
+        reorder_for_vertex_cache(indices, num_vertices);
+
+        MeshLod lod;
+        lod.index_offset = (unsigned int) (tv_indices.size() + lod_indices.size());
+        lod.index_count = (unsigned int) indices.size();
+        lod.error = simplifier.error();
+        lods.push_back(lod);
+        lod_indices.insert(lod_indices.end(), indices.begin(), indices.end());
+    }
+}
+
+unsigned int select_lod(const std::vector<MeshLod>& lods, float pixels_per_unit, float max_pixel_error)
+{
+    unsigned int lod = 0;
+    if (pixels_per_unit <= 0.0f)
+        return lod;
+
+    while (lod + 1 < lods.size() && lods[lod+1].error * pixels_per_unit <= max_pixel_error)
+        ++lod;
+    return lod;
+}
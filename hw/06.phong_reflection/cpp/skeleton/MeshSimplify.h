@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// one level of detail: a range of a shared index buffer over the full-resolution vertices
+struct MeshLod
+{
+    unsigned int    index_offset = 0;
+    unsigned int    index_count = 0;        // 3 x #triangles
+    float           error = 0.0f;           // simplification error in model units (0 for LOD 0)
+};
+
+const unsigned int kMaxMeshLods = 5;
+
+// quadric edge collapse (Garland & Heckbert, "Surface Simplification Using Quadric Error Metrics")
+// of tv_indices down to about target_triangles. a vertex only ever collapses onto one of its
+// neighbors, so the result indexes the same vertices (and every attribute stays valid).
+// border vertices (open edges, e.g. material boundaries between aiMeshes) and vertices sharing
+// their position with another vertex (attribute seams) never move, so no cracks open.
+// returns the error: sqrt of the largest quadric error of a collapse, i.e. the RMS distance
+// (in model units) of the moved vertex to the area-weighted original planes around it
+float simplify_mesh(std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, std::size_t target_triangles);
+
+// LOD 0 = tv_indices, then each LOD with about ratio x the triangles of the previous one, up to
+// max_lods levels (fewer if the simplifier gets stuck). LOD k > 0 is appended to lod_indices,
+// vertex cache optimized; MeshLod::index_offset counts from the start of tv_indices (LOD 0),
+// i.e. the GPU index buffer is tv_indices followed by lod_indices.
+void build_lod_chain(const std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices,
+                     std::vector<unsigned int>& lod_indices, std::vector<MeshLod>& lods,
+                     unsigned int max_lods = kMaxMeshLods, float ratio = 0.5f);
+
+// how Mesh::cull() picks a LOD
+struct LodSelection
+{
+    float   pixels_per_unit = 0.0f;     // pixels covered by one model unit at clip w = 1 (0: always LOD 0)
+    float   max_pixel_error = 1.0f;
+    int     forced_lod = -1;            // >= 0: this LOD (or the coarsest one there is)
+};
+
+// coarsest LOD whose error stays within max_pixel_error on screen.
+// pixels_per_unit: pixels covered by one model unit at the mesh (0: always LOD 0)
+unsigned int select_lod(const std::vector<MeshLod>& lods, float pixels_per_unit, float max_pixel_error);
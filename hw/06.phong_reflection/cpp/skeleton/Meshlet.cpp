@@ -0,0 +1,199 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const unsigned int kNone = 0xFFFFFFFFu;
+
+// bounding sphere and normal cone of the triangles [b, e) of tv_indices
+void compute_meshlet_bounds(const std::vector<unsigned int>& tv_indices, const glm::vec3* positions, Meshlet& meshlet)
+{
+    std::size_t b = 3 * (std::size_t) meshlet.triangle_offset;
+    std::size_t e = b + 3 * (std::size_t) meshlet.triangle_count;
+
+    // sphere around the AABB center (not minimal, but cheap and tight enough for culling)
+    glm::vec3 box_min(positions[tv_indices[b]]), box_max(box_min);
+    for (std::size_t i = b; i < e; ++i)
+    {
+        box_min = glm::min(box_min, positions[tv_indices[i]]);
+        box_max = glm::max(box_max, positions[tv_indices[i]]);
+    }
+    meshlet.center = 0.5f * (box_min + box_max);
+    meshlet.radius = 0.0f;
+    for (std::size_t i = b; i < e; ++i)
+        meshlet.radius = std::max(meshlet.radius, glm::length(positions[tv_indices[i]] - meshlet.center));
+
+    // cone axis = average face normal, spread = the widest face normal
+    std::vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangle_count);
+    glm::vec3 sum(0.0f);
+    for (std::size_t i = b; i < e; i += 3)
+    {
+        const glm::vec3& p0 = positions[tv_indices[i]];
+        glm::vec3 n = glm::cross(positions[tv_indices[i+1]] - p0, positions[tv_indices[i+2]] - p0);
+        float len = glm::length(n);
+        if (len == 0.0f)
+            continue;   // degenerate triangles are never rasterized
+        normals.push_back(n / len);
+        sum += normals.back();
+    }
+
+    meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.cone_cutoff = 1.0f;
+    float sum_len = glm::length(sum);
+    if (normals.empty() || sum_len < 1.0e-6f)
+        return;
+
+    meshlet.cone_axis = sum / sum_len;
+    float min_dot = 1.0f;
+    for (std::size_t k = 0; k < normals.size(); ++k)
+        min_dot = std::min(min_dot, glm::dot(meshlet.cone_axis, normals[k]));
+
+    // a half-angle of 90 degrees or more: some triangle always faces the camera
+    if (min_dot > 0.0f)
+        meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+}   // namespace
+
+void build_meshlets(std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, std::vector<Meshlet>& meshlets)
+{
+    meshlets.clear();
+    std::size_t num_triangles = tv_indices.size() / 3;
+    if (num_triangles == 0)
+        return;
+
+    // vertex -> adjacent triangles (CSR)
+    std::vector<unsigned int> adjacency_offsets(num_vertices + 1, 0);
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+        ++adjacency_offsets[tv_indices[i] + 1];
+    for (std::size_t v = 0; v < num_vertices; ++v)
+        adjacency_offsets[v+1] += adjacency_offsets[v];
+
+    std::vector<unsigned int> adjacency(tv_indices.size());
+    std::vector<unsigned int> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+        adjacency[fill[tv_indices[i]]++] = (unsigned int) (i / 3);
+
+    std::vector<bool>           is_emitted(num_triangles, false);
+    std::vector<unsigned int>   vertex_meshlet(num_vertices, kNone);   // last meshlet that used the vertex
+    std::vector<unsigned int>   meshlet_vertices;
+    std::vector<unsigned int>   new_indices;
+    new_indices.reserve(tv_indices.size());
+
+    auto num_new_vertices = [&](unsigned int t, unsigned int m) -> unsigned int {
+        return (vertex_meshlet[tv_indices[3*t]] != m) + (vertex_meshlet[tv_indices[3*t+1]] != m) + (vertex_meshlet[tv_indices[3*t+2]] != m);
+    };
+
+    std::size_t seed = 0;
+    while (true)
+    {
+        while (seed < num_triangles && is_emitted[seed])
+            ++seed;
+        if (seed == num_triangles)
+            break;
+
+        unsigned int m = (unsigned int) meshlets.size();
+        Meshlet meshlet;
+        meshlet.triangle_offset = (unsigned int) (new_indices.size() / 3);
+        meshlet_vertices.clear();
+
+        unsigned int t = (unsigned int) seed;
+        while (t != kNone)
+        {
+            is_emitted[t] = true;
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int v = tv_indices[3*t+k];
+                if (vertex_meshlet[v] != m)
+                {
+                    vertex_meshlet[v] = m;
+                    meshlet_vertices.push_back(v);
+                }
+                new_indices.push_back(v);
+            }
+            ++meshlet.triangle_count;
+            if (meshlet.triangle_count == kMeshletMaxTriangles)
+                break;
+
+            // next: the unemitted triangle around the meshlet's vertices that adds the
+            // fewest vertices (earlier in the current order on ties, to keep its locality).
+            // newest vertices first: that is where a triangle with no new vertex usually is.
+            t = kNone;
+            unsigned int best_new = 3;
+            for (std::size_t k = meshlet_vertices.size(); k-- > 0 && best_new > 0; )
+            {
+                unsigned int v = meshlet_vertices[k];
+                for (unsigned int a = adjacency_offsets[v]; a < adjacency_offsets[v+1]; ++a)
+                {
+                    unsigned int candidate = adjacency[a];
+                    if (is_emitted[candidate])
+                        continue;
+
+                    unsigned int n = num_new_vertices(candidate, m);
+                    if (meshlet_vertices.size() + n > kMeshletMaxVertices)
+                        continue;
+                    if (t == kNone || n < best_new || (n == best_new && candidate < t))
+                    {
+                        t = candidate;
+                        best_new = n;
+                    }
+                }
+            }
+        }
+
+        meshlet.vertex_count = (unsigned int) meshlet_vertices.size();
+        meshlets.push_back(meshlet);
+    }
+
+    tv_indices.swap(new_indices);
+
+    for (std::size_t m = 0; m < meshlets.size(); ++m)
+        compute_meshlet_bounds(tv_indices, positions, meshlets[m]);
+}
+
+Frustum extract_frustum(const glm::mat4& mat_PVM)
+{
+    // row i of the matrix (glm is column-major)
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(mat_PVM[0][i], mat_PVM[1][i], mat_PVM[2][i], mat_PVM[3][i]);
+
+    // -w <= x, y, z <= w in clip space
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];      // left
+    frustum.planes[1] = rows[3] - rows[0];      // right
+    frustum.planes[2] = rows[3] + rows[1];      // bottom
+    frustum.planes[3] = rows[3] - rows[1];      // top
+    frustum.planes[4] = rows[3] + rows[2];      // near
+    frustum.planes[5] = rows[3] - rows[2];      // far
+
+    for (int i = 0; i < 6; ++i)
+    {
+        float len = glm::length(glm::vec3(frustum.planes[i]));
+        if (len > 0.0f)
+            frustum.planes[i] /= len;
+    }
+    return frustum;
+}
+
+bool is_meshlet_backfacing(const Meshlet& meshlet, const glm::vec3& camera_position)
+{
+    // the view direction to every point of the sphere is within 90 degrees - half-angle of
+    // the cone axis (conservative; Zeux, meshoptimizer "meshopt_computeMeshletBounds")
+    glm::vec3 d = meshlet.center - camera_position;
+    return glm::dot(d, meshlet.cone_axis) > meshlet.cone_cutoff * glm::length(d) + meshlet.radius;
+}
+
+bool is_meshlet_outside(const Meshlet& meshlet, const Frustum& frustum)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        const glm::vec4& p = frustum.planes[i];
+        if (glm::dot(glm::vec3(p), meshlet.center) + p.w < -meshlet.radius)
+            return true;
+    }
+    return false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// a cluster of up to kMeshletMaxVertices vertices / kMeshletMaxTriangles triangles,
+// stored as a contiguous triangle range of the mesh (so it is drawn with one index range)
+const unsigned int kMeshletMaxVertices  = 64;
+const unsigned int kMeshletMaxTriangles = 124;
+
+struct Meshlet
+{
+    unsigned int    triangle_offset = 0;    // first triangle in tv_indices
+    unsigned int    triangle_count = 0;
+    unsigned int    vertex_count = 0;       // #unique vertices
+
+    // bounding sphere
+    glm::vec3       center = glm::vec3(0.0f);
+    float           radius = 0.0f;
+
+    // normal cone: all face normals are within the cone around cone_axis.
+    // cone_cutoff = sin(cone half-angle) (1: too wide to ever cull)
+    glm::vec3       cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    float           cone_cutoff = 1.0f;
+};
+
+// group the triangles of tv_indices into meshlets and reorder tv_indices so that each
+// meshlet is a contiguous range. a meshlet is grown from the first unused triangle (in
+// the current order) by adding the adjacent triangle with the fewest new vertices.
+void build_meshlets(std::vector<unsigned int>& tv_indices, const glm::vec3* positions, std::size_t num_vertices, std::vector<Meshlet>& meshlets);
+
+// per-frame culling statistics (summed over meshes)
+struct MeshletCullStats
+{
+    std::size_t num_meshlets = 0;
+    std::size_t num_backfacing = 0;     // rejected by the normal cone
+    std::size_t num_outside = 0;        // rejected by the frustum
+    std::size_t num_triangles = 0;
+    std::size_t num_drawn_triangles = 0;
+    std::size_t num_draw_ranges = 0;    // contiguous runs of visible meshlets (1 per mesh without culling)
+};
+
+// view frustum as 6 planes (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside and |(a, b, c)| = 1,
+// in the space that mat_PVM maps to clip space (Gribb & Hartmann)
+struct Frustum
+{
+    glm::vec4   planes[6];
+};
+
+Frustum extract_frustum(const glm::mat4& mat_PVM);
+
+// all triangles of the meshlet face away from the camera (everything in model space)
+bool is_meshlet_backfacing(const Meshlet& meshlet, const glm::vec3& camera_position);
+
+// the bounding sphere is completely outside one of the planes
+bool is_meshlet_outside(const Meshlet& meshlet, const Frustum& frustum);
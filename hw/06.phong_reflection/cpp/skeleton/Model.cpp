@@ -1,7 +1,18 @@
 #include "Model.h"
 
+#include <algorithm>
+#include <cfloat>
 #include <iostream>
 
+#include "ObjReader.h"
+#include "PlyReader.h"
+
+ModelAsset::~ModelAsset()
+{
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+        meshes[i].delete_gl_buffers();
+}
+
 glm::mat4 Model::get_model_matrix() const
 {
     glm::mat4 mat_model = glm::mat4(1.0f);
@@ -13,43 +24,283 @@ glm::mat4 Model::get_model_matrix() const
     return mat_model;
 }
 
+glm::mat4 Model::get_position_decode_matrix() const
+{
+    if (vertex_precision == kVertexFloat)
+        return glm::mat4(1.0f);
 
-void Model::draw(int loc_a_position, int loc_a_normal, int loc_u_ambient, int loc_u_diffuse, int loc_u_specular, int loc_u_shininess)
+    glm::vec3 extent = glm::max(asset_->aabb_max - asset_->aabb_min, glm::vec3(1.0e-20f));
+    return glm::translate(glm::mat4(1.0f), asset_->aabb_min) * glm::scale(glm::mat4(1.0f), extent);
+}
+
+std::size_t Model::gpu_bytes() const
 {
+    const std::vector<Mesh>& meshes = asset_->meshes;
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+        bytes += meshes[i].gpu_bytes();
+    return bytes;
+}
+
+void Model::set_asset(const std::shared_ptr<ModelAsset>& _asset)
+{
+    asset_ = _asset;
+    draw_lists_.clear();
+    pending_gpu_data_.clear();
+    cache_reader_ = MeshCacheReader();
+    is_uploaded_ = true;
+}
+
+void Model::set_vertex_format(DrawType _draw_type, VertexPrecision _precision)
+{
+    draw_type = _draw_type;
+    vertex_precision = _precision;
+
+    // copy on write: the CPU side of the meshes is copied, the GL buffers are new
+    bool is_shared = asset_.use_count() > 1;
+    if (is_shared)
+    {
+        std::shared_ptr<ModelAsset> copy = std::make_shared<ModelAsset>();
+        copy->meshes = asset_->meshes;
+        copy->aabb_min = asset_->aabb_min;
+        copy->aabb_max = asset_->aabb_max;
+        asset_ = copy;
+    }
+
+    std::vector<Mesh>& meshes = asset_->meshes;
     for (std::size_t i = 0; i < meshes.size(); ++i)
     {
-        Mesh& mesh = meshes[i];
+        if (is_shared)
+        {
+            meshes[i].detach_gl_buffers();
+            meshes[i].gen_gl_buffers();
+        }
+        meshes[i].set_gl_buffers(draw_type, vertex_precision);
+    }
+}
 
-        // TODO : send material data to GPU
-        // call glUniform3fv(...) 
-        //      with loc_u_ambient/diffuse/specular
-        //      to send mesh.material.ambient/diffuse/specular data to the GPU side
-        // call glUniform1f(...) 
-        //      with loc_u_shininess
-        //      to send mesh.material.shininess
+void Model::print_info()
+{
+    std::vector<Mesh>& meshes = asset_->meshes;
+    std::cout << "model " << name_ << ": " << meshes.size() << " meshes" << std::endl;
+
+    std::size_t num_vertices = 0, num_dropped = 0, bytes_saved = 0;
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        meshes[i].print_info(false);
 
-        mesh.draw(loc_a_position, loc_a_normal);
+        num_vertices += meshes[i].num_vertices();
+        num_dropped += meshes[i].num_dropped_vertices();
+        bytes_saved += meshes[i].num_dropped_vertices() * meshes[i].vertex_size();
     }
+    std::cout << "model " << name_ << ": " << num_vertices << " vertices, "
+              << num_dropped << " unreferenced dropped, " << bytes_saved << " bytes saved" << std::endl;
+}
+
+
+void Model::cull(const glm::mat4& mat_view_proj, const glm::vec3& camera_position, bool is_culling, const LodSelection& lod_selection, MeshletCullStats& stats)
+{
+    // meshlet bounds and LOD errors are in model space (float positions, before any quantization decode)
+    glm::mat4 mat_model = get_model_matrix();
+    glm::mat4 mat_PVM = mat_view_proj * mat_model;
+    glm::vec3 camera_position_model = glm::vec3(glm::inverse(mat_model) * glm::vec4(camera_position, 1.0f));
+
+    // a model unit is at most this long in the world
+    float max_scale = std::max(std::max(glm::length(glm::vec3(mat_model[0])), glm::length(glm::vec3(mat_model[1]))), glm::length(glm::vec3(mat_model[2])));
+    LodSelection model_lod_selection = lod_selection;
+    model_lod_selection.pixels_per_unit *= max_scale;
+
+    const std::vector<Mesh>& meshes = asset_->meshes;
+    draw_lists_.resize(meshes.size());
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+        meshes[i].cull(mat_PVM, camera_position_model, is_culling, model_lod_selection, stats, draw_lists_[i]);
 }
 
-bool Model::load_model(const std::string& _path)
+unsigned int Model::current_lod(std::size_t mesh_index) const
+{
+    return (mesh_index < draw_lists_.size()) ? draw_lists_[mesh_index].lod : 0;
+}
+
+void Model::draw(GLStateCache& state, int loc_u_ambient, int loc_u_diffuse, int loc_u_specular, int loc_u_shininess)
+{
+    // nothing is drawn before the first cull()
+    const std::vector<Mesh>& meshes = asset_->meshes;
+    if (draw_lists_.size() != meshes.size())
+        return;
+
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        const Mesh& mesh = meshes[i];
+
+        // the meshes of a model (and the models after it) often repeat a material
+        state.uniform(loc_u_ambient, mesh.material.ambient);
+        state.uniform(loc_u_diffuse, mesh.material.diffuse);
+        state.uniform(loc_u_specular, mesh.material.specular);
+        state.uniform(loc_u_shininess, mesh.material.shininess);
+
+        mesh.draw(shading_type, draw_lists_[i], state);
+    }
+}
+
+void Model::draw(GLStateCache& state, UniformBlocks& blocks)
+{
+    std::vector<Mesh>& meshes = asset_->meshes;
+    if (draw_lists_.size() != meshes.size())
+        return;
+
+    const std::vector<unsigned int>& slots = material_slots(blocks);
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        blocks.bind_material(slots[i], meshes[i].material);
+        meshes[i].draw(shading_type, draw_lists_[i], state);
+    }
+}
+
+void Model::emit(RenderQueue& queue, UniformBlocks& blocks, uint32_t program, uint32_t object, const glm::mat4& mat_view)
+{
+    const std::vector<Mesh>& meshes = asset_->meshes;
+    if (draw_lists_.size() != meshes.size())
+        return;
+
+    const std::vector<unsigned int>& slots = material_slots(blocks);
+    glm::mat4 mat_model_view = mat_view * get_model_matrix();
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        if (draw_lists_[i].firsts.empty())
+            continue;   // culled
+
+        DrawPacket packet;
+        packet.mesh = &meshes[i];
+        packet.draw_list = &draw_lists_[i];
+        packet.material = &meshes[i].material;
+        packet.shading_type = shading_type;
+        packet.vertex_array = meshes[i].vertex_array(shading_type);
+        packet.program = program;
+        packet.object = object;
+        packet.material_slot = slots[i];
+        packet.depth = -(mat_model_view * glm::vec4(meshes[i].center(), 1.0f)).z;
+        queue.add(packet);
+    }
+}
+
+const std::vector<unsigned int>& Model::material_slots(UniformBlocks& blocks)
+{
+    // the materials get their slots on the first draw; the Models sharing the asset share them
+    std::vector<unsigned int>& slots = asset_->material_slots;
+    while (slots.size() < asset_->meshes.size())
+        slots.push_back(blocks.add_material(asset_->meshes[slots.size()].material));
+    return slots;
+}
+
+bool Model::load_model(const std::string& _path, unsigned int process_flags)
+{
+    if (!import_model(_path, process_flags))
+        return false;
+
+    upload_model();
+    return true;
+}
+
+bool Model::import_model(const std::string& _path, unsigned int process_flags, std::ostream& log)
 {
     set_name(_path);
-    const aiScene* scene = aiImportFile(_path.c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
+    path_ = _path;
+    is_cache_hit_ = false;
+    is_uploaded_ = false;
+    upload_mesh_ = 0;
+    upload_buffer_ = 0;
+    upload_offset_ = 0;
+    asset_ = std::make_shared<ModelAsset>();
+    draw_lists_.clear();
+
+    // PLY and OBJ files skip Assimp (see read_ply(), read_obj())
+    bool is_native_ply = use_native_ply && is_ply_path(_path);
+    bool is_native_obj = use_native_obj && is_obj_path(_path);
+
+    // warm start: everything the passes below produce, straight from the mapped cache
+    process_flags_ = process_flags;
+    has_cache_key_ = use_mesh_cache && make_mesh_cache_key(_path, process_flags, effective_import_flags(_path), draw_type, vertex_precision, cache_key_);
+    std::string cache_path = mesh_cache_path(_path, cache_key_);
+    if (has_cache_key_ && cache_reader_.open(cache_path, cache_key_))
+    {
+        load_cache_();
+        is_cache_hit_ = true;
+        return true;
+    }
+
+    bool ok;
+    if (is_native_ply)
+        ok = import_ply_(_path, process_flags, log);
+    else if (is_native_obj)
+        ok = import_obj_(_path, process_flags, log);
+    else
+        ok = import_assimp_(_path, process_flags, log);
+    if (!ok)
+        return false;
+
+    if (has_cache_key_)
+    {
+        const std::vector<Mesh>& meshes = asset_->meshes;
+        MeshCacheWriter cache_writer;
+        for (std::size_t i = 0; i < meshes.size(); ++i)
+            meshes[i].save_cache(cache_writer, pending_gpu_data_[i]);
+
+        float aabb_min[3] = { asset_->aabb_min.x, asset_->aabb_min.y, asset_->aabb_min.z };
+        float aabb_max[3] = { asset_->aabb_max.x, asset_->aabb_max.y, asset_->aabb_max.z };
+        if (!cache_writer.write(cache_path, cache_key_, aabb_min, aabb_max))
+            log << "failed to write " << cache_path << std::endl;
+    }
+    return true;
+}
+
+bool Model::source_key(MeshCacheKey& key) const
+{
+    if (has_cache_key_)
+    {
+        key = cache_key_;
+        return true;
+    }
+    return make_mesh_cache_key(path_, process_flags_, effective_import_flags(path_), draw_type, vertex_precision, key);
+}
+
+unsigned int Model::effective_import_flags(const std::string& _path) const
+{
+    if ((use_native_ply && is_ply_path(_path)) || (use_native_obj && is_obj_path(_path)))
+        return kNativeImportFlags;
+    return import_flags;
+}
+
+bool Model::import_assimp_(const std::string& _path, unsigned int process_flags, std::ostream& log)
+{
+    const aiScene* scene = aiImportFile(_path.c_str(), import_flags);
     if (scene == NULL)
+    {
+        log << _path << ": " << aiGetErrorString() << std::endl;
         return false;
+    }
 
     aiColor3D tmp;    
     aiString name;
 
+    // one quantization box for all meshes, so a single decode matrix serves the model
+    asset_->aabb_min = glm::vec3(FLT_MAX);
+    asset_->aabb_max = glm::vec3(-FLT_MAX);
     for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
     {
-        Mesh mesh;
-        mesh = Mesh(scene->mMeshes[i]);
-        
-        mesh.update_tv_indices();
-        mesh.gen_gl_buffers();
-        mesh.set_gl_buffers(shading_type);
+        const aiMesh* ai_mesh = scene->mMeshes[i];
+        for (unsigned int v = 0; v < ai_mesh->mNumVertices; ++v)
+        {
+            glm::vec3 p(ai_mesh->mVertices[v].x, ai_mesh->mVertices[v].y, ai_mesh->mVertices[v].z);
+            asset_->aabb_min = glm::min(asset_->aabb_min, p);
+            asset_->aabb_max = glm::max(asset_->aabb_max, p);
+        }
+    }
+
+    pending_gpu_data_.resize(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        Mesh mesh(scene->mMeshes[i]);
+        process_mesh_(mesh, process_flags, pending_gpu_data_[i], log);
 
         int mat_idx = scene->mMeshes[i]->mMaterialIndex;    
         
@@ -68,7 +319,209 @@ bool Model::load_model(const std::string& _path)
 
         mesh.set_material(mat);
 
-        meshes.push_back(mesh);        
+        asset_->meshes.push_back(mesh);        
+    }
+
+    // the meshes have copies of what they use
+    aiReleaseImport(scene);
+    return true;
+}
+
+bool Model::import_ply_(const std::string& _path, unsigned int process_flags, std::ostream& log)
+{
+    std::shared_ptr<MeshArrays> ply_mesh = std::make_shared<MeshArrays>();
+    std::string error;
+    if (!read_ply(_path, *ply_mesh, &error))
+    {
+        log << error << std::endl;
+        return false;
+    }
+
+    asset_->aabb_min = glm::vec3(FLT_MAX);
+    asset_->aabb_max = glm::vec3(-FLT_MAX);
+    for (std::size_t v = 0; v < ply_mesh->positions.size(); ++v)
+    {
+        asset_->aabb_min = glm::min(asset_->aabb_min, ply_mesh->positions[v]);
+        asset_->aabb_max = glm::max(asset_->aabb_max, ply_mesh->positions[v]);
     }
+
+    // one mesh; it reads the streams from ply_mesh until compact_streams()
+    pending_gpu_data_.resize(1);
+    Mesh mesh(ply_mesh);
+    process_mesh_(mesh, process_flags, pending_gpu_data_[0], log);
+
+    // the default material Assimp gives a PLY file (it has none of its own)
+    mesh.set_material(Material(glm::vec3(0.05f), glm::vec3(1.0f), glm::vec3(1.0f), 5.0f));
+
+    asset_->meshes.push_back(mesh);
     return true;
 }
+
+bool Model::import_obj_(const std::string& _path, unsigned int process_flags, std::ostream& log)
+{
+    std::vector<ObjMesh> obj_meshes;
+    std::string error;
+    if (!read_obj(_path, obj_meshes, &error))
+    {
+        log << error << std::endl;
+        return false;
+    }
+
+    asset_->aabb_min = glm::vec3(FLT_MAX);
+    asset_->aabb_max = glm::vec3(-FLT_MAX);
+    for (std::size_t i = 0; i < obj_meshes.size(); ++i)
+    {
+        const std::vector<glm::vec3>& positions = obj_meshes[i].arrays->positions;
+        for (std::size_t v = 0; v < positions.size(); ++v)
+        {
+            asset_->aabb_min = glm::min(asset_->aabb_min, positions[v]);
+            asset_->aabb_max = glm::max(asset_->aabb_max, positions[v]);
+        }
+    }
+
+    // a mesh per material, as import_assimp_() gets them (reading the ObjMesh arrays until compact_streams())
+    pending_gpu_data_.resize(obj_meshes.size());
+    for (std::size_t i = 0; i < obj_meshes.size(); ++i)
+    {
+        Mesh mesh(obj_meshes[i].arrays);
+        process_mesh_(mesh, process_flags, pending_gpu_data_[i], log);
+
+        // k_a, k_d, k_s of the .mtl file; the shininess is fixed like in import_assimp_()
+        const Material& obj_material = obj_meshes[i].material;
+        Material mat(obj_material.ambient, obj_material.diffuse, obj_material.specular, 5.0f);
+        mat.name = obj_material.name;
+        mesh.set_material(mat);
+
+        asset_->meshes.push_back(mesh);
+    }
+    return true;
+}
+
+void Model::process_mesh_(Mesh& mesh, unsigned int process_flags, MeshGpuData& gpu_data, std::ostream& log)
+{
+    mesh.update_tv_indices();
+    if (process_flags & (kMeshProcessVertexCache | kMeshProcessOverdraw))
+        mesh.optimize_vertex_cache(log);
+    if (process_flags & kMeshProcessOverdraw)
+        mesh.optimize_overdraw(log);
+    if (process_flags & kMeshProcessMeshlets)
+        mesh.build_meshlets(log);
+    if (process_flags & kMeshProcessLods)
+        mesh.build_lods(log);
+    if (process_flags & kMeshProcessVertexFetch)
+        mesh.optimize_vertex_fetch();
+    mesh.compact_streams();
+    mesh.set_quantization_box(asset_->aabb_min, asset_->aabb_max);
+    mesh.pack_gl_buffers(draw_type, vertex_precision, gpu_data);
+}
+
+void Model::load_cache_()
+{
+    const MeshCacheHeader& header = cache_reader_.header();
+    asset_->aabb_min = glm::vec3(header.aabb_min[0], header.aabb_min[1], header.aabb_min[2]);
+    asset_->aabb_max = glm::vec3(header.aabb_max[0], header.aabb_max[1], header.aabb_max[2]);
+
+    for (uint32_t i = 0; i < header.num_meshes; ++i)
+    {
+        Mesh mesh;
+        mesh.load_cache(cache_reader_, i);
+        mesh.set_quantization_box(asset_->aabb_min, asset_->aabb_max);
+        asset_->meshes.push_back(mesh);
+    }
+}
+
+void Model::pending_buffer_(std::size_t mesh_index, int buffer, const void*& data, std::size_t& size) const
+{
+    // buffer: 0 / 1 = vertices / indices of kSmooth, 2 / 3 = the same for kFlat
+    ShadingType shading_type = (ShadingType) (buffer / 2);
+    bool is_index_buffer = (buffer % 2) != 0;
+
+    if (cache_reader_.is_open())
+    {
+        // the GL buffers are filled from the mapping without a copy
+        const MeshCacheRecord& record = cache_reader_.record(mesh_index);
+        const MeshCacheBlob& blob = is_index_buffer ? record.indices[shading_type] : record.vertices[shading_type];
+        data = cache_reader_.data(blob);
+        size = (std::size_t) blob.size;
+    }
+    else
+    {
+        const MeshGpuData& gpu_data = pending_gpu_data_[mesh_index];
+        const std::vector<unsigned char>& bytes = is_index_buffer ? gpu_data.indices[shading_type] : gpu_data.vertices[shading_type];
+        data = bytes.empty() ? NULL : &bytes[0];
+        size = bytes.size();
+    }
+}
+
+std::size_t Model::pending_upload_bytes() const
+{
+    if (is_uploaded_)
+        return 0;
+
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i < asset_->meshes.size(); ++i)
+    {
+        for (int buffer = 0; buffer < 4; ++buffer)
+        {
+            const void* data;
+            std::size_t size;
+            pending_buffer_(i, buffer, data, size);
+            bytes += size;
+        }
+    }
+    return bytes;
+}
+
+std::size_t Model::upload_model(std::size_t byte_budget)
+{
+    std::vector<Mesh>& meshes = asset_->meshes;
+    std::size_t num_uploaded = 0;
+    while (upload_mesh_ < meshes.size() && num_uploaded < byte_budget)
+    {
+        Mesh& mesh = meshes[upload_mesh_];
+        ShadingType shading_type = (ShadingType) (upload_buffer_ / 2);
+        bool is_index_buffer = (upload_buffer_ % 2) != 0;
+
+        const void* data;
+        std::size_t size;
+        pending_buffer_(upload_mesh_, upload_buffer_, data, size);
+
+        if (!is_index_buffer && upload_offset_ == 0)
+        {
+            // vertex buffer of a shading type comes first: set up both of its buffers
+            if (shading_type == kSmooth)
+                mesh.gen_gl_buffers();
+
+            const void* index_data;
+            std::size_t index_size;
+            pending_buffer_(upload_mesh_, upload_buffer_ + 1, index_data, index_size);
+
+            GLenum index_type = cache_reader_.is_open() ? (GLenum) cache_reader_.record(upload_mesh_).index_type[shading_type]
+                                                        : pending_gpu_data_[upload_mesh_].index_type[shading_type];
+            mesh.allocate_gl_buffers(shading_type, size, index_size, index_type);
+        }
+
+        std::size_t n = std::min(size - upload_offset_, byte_budget - num_uploaded);
+        mesh.upload_gl_buffer_range(shading_type, is_index_buffer, upload_offset_, (const unsigned char*) data + upload_offset_, n);
+        upload_offset_ += n;
+        num_uploaded += n;
+        if (upload_offset_ < size)
+            break;
+
+        upload_offset_ = 0;
+        if (++upload_buffer_ == 4)
+        {
+            upload_buffer_ = 0;
+            ++upload_mesh_;
+        }
+    }
+
+    if (upload_mesh_ == meshes.size() && !is_uploaded_)
+    {
+        // the meshes keep the mapping of their streams themselves
+        pending_gpu_data_.clear();
+        cache_reader_ = MeshCacheReader();
+        is_uploaded_ = true;
+    }
+    return num_uploaded;
+}
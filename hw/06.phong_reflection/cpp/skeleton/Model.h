@@ -1,4 +1,7 @@
 #pragma once
+#include <cstdint>
+#include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,18 +16,89 @@
 
 
 #include "ShadingType.h"
+#include "DrawType.h"
+#include "MeshProcess.h"
 #include "Mesh.h"
+#include "ImportFlags.h"
+#include "UniformBlocks.h"
+#include "RenderQueue.h"
+
+// the meshes of one import: their CPU data and GL buffers. copies of a Model, and the Models
+// AssetRegistry hands the same asset to, share it; the GL buffers go with the last of them
+struct ModelAsset
+{
+    std::vector<Mesh>   meshes;
+    glm::vec3           aabb_min = glm::vec3(0.0f);     // of all meshes (quantization box)
+    glm::vec3           aabb_max = glm::vec3(1.0f);
+    std::vector<unsigned int> material_slots;   // UniformBlocks slot of each mesh (empty until drawn with them)
+
+    ModelAsset() {}
+    ModelAsset(const ModelAsset&) = delete;
+    ModelAsset& operator=(const ModelAsset&) = delete;
+    ~ModelAsset();      // deletes the GL buffers (GL thread, or never uploaded)
+};
 
 class Model
 {
 public:
     ShadingType shading_type = kSmooth;
+    DrawType    draw_type = kDrawElements;
+    VertexPrecision vertex_precision = kVertexFloat;
+    bool        use_mesh_cache = true;      // read / write <path>.<settings>.meshcache
+    bool        use_native_ply = true;      // read .ply files with read_ply() instead of Assimp
+    bool        use_native_obj = true;      // read .obj files with read_obj() instead of Assimp
+    unsigned int import_flags = kDefaultImportFlags;    // aiProcess_ bits of an Assimp import
 
 public: 
-    Model() {};
+    Model() : asset_(std::make_shared<ModelAsset>()) {};
     
-    bool load_model(const std::string& _path) ;
-    void draw(int loc_a_position, int loc_a_normal, int loc_u_ambient, int loc_u_diffuse, int loc_u_specular, int loc_u_shininess);
+    // process_flags: MeshProcess bits of the optional load-time passes.
+    // with use_mesh_cache, a valid mesh_cache_path() file replaces the import and the passes,
+    // and a missing or stale one is (re)written after them
+    bool load_model(const std::string& _path, unsigned int process_flags = kMeshProcessNone) ;
+    bool is_cache_hit() const                   { return is_cache_hit_; }
+    // the mesh cache key of the last import_model(): the one of the cache lookup, or (with
+    // use_mesh_cache off) made now, which reads the file. false if the file cannot be read
+    bool source_key(MeshCacheKey& key) const;
+
+    // load_model() in two steps. import_model() makes no GL calls, so models can be
+    // imported on worker threads; upload_model() then runs on the GL context thread
+    bool import_model(const std::string& _path, unsigned int process_flags = kMeshProcessNone, std::ostream& log = std::cout);
+
+    // upload at most byte_budget bytes more (call again until is_uploaded()); returns the
+    // bytes written. the meshes must not be drawn before the upload is complete
+    std::size_t upload_model(std::size_t byte_budget = SIZE_MAX);
+    bool is_uploaded() const                    { return is_uploaded_; }
+    std::size_t pending_upload_bytes() const;   // total of the buffers upload_model() writes
+    void draw(GLStateCache& state, int loc_u_ambient, int loc_u_diffuse, int loc_u_specular, int loc_u_shininess);
+    // the same with the GLSL 1.40 shaders: the object block of this Model must be bound
+    void draw(GLStateCache& state, UniformBlocks& blocks);
+    // the meshes of the last cull() as packets of queue, drawn with the object uniforms object
+    // (mat_view gives their depth); the meshes get their material slots as in draw(blocks)
+    void emit(RenderQueue& queue, UniformBlocks& blocks, uint32_t program, uint32_t object, const glm::mat4& mat_view);
+
+    // pick the LOD of each mesh and reject the back-facing and off-screen meshlets for the next draw()
+    // (lod_selection.pixels_per_unit is in world units). the choice is kept per Model, so the
+    // Models sharing an asset can all be culled before any of them is drawn
+    void cull(const glm::mat4& mat_view_proj, const glm::vec3& camera_position, bool is_culling, const LodSelection& lod_selection, MeshletCullStats& stats);
+    unsigned int current_lod(std::size_t mesh_index) const;    // of the last cull()
+    const std::vector<MeshDrawList>& draw_lists() const     { return draw_lists_; }
+
+    // the UniformBlocks slot of each mesh, added on the first call (shared with the Models of the asset)
+    const std::vector<unsigned int>& material_slots(UniformBlocks& blocks);
+
+    // the aiProcess_ bits that import_model() keys the mesh cache and the asset with
+    // (kNativeImportFlags for a file read by read_ply() / read_obj())
+    unsigned int effective_import_flags(const std::string& _path) const;
+
+    // the meshes are shared with the copies of this Model (see AssetRegistry)
+    const std::shared_ptr<ModelAsset>& asset() const   { return asset_; }
+    void set_asset(const std::shared_ptr<ModelAsset>& _asset);     // an uploaded asset
+    long num_asset_owners() const               { return asset_.use_count(); }
+
+    // rebuild the GL buffers for another draw path / vertex format. a shared asset is
+    // copied first, so the other Models keep the buffers (and the format) they have
+    void set_vertex_format(DrawType _draw_type, VertexPrecision _precision);
 
     std::string get_name() const                { return name_; }
     void set_name(const std::string& _name)     { name_ = _name; }
@@ -43,11 +117,42 @@ public:
 
     glm::mat4 get_model_matrix() const;
 
-    std::vector<Mesh>   meshes;
+    // maps quantized [0, 1]^3 positions back to model space (identity for kVertexFloat);
+    // goes right of the model matrix for positions, but not into the normal matrix
+    glm::mat4 get_position_decode_matrix() const;
+
+    std::size_t gpu_bytes() const;
+    void print_info();
+
+    std::vector<Mesh>& meshes()                 { return asset_->meshes; }
+    const std::vector<Mesh>& meshes() const     { return asset_->meshes; }
 
 private :
+    void load_cache_();
+    bool import_assimp_(const std::string& _path, unsigned int process_flags, std::ostream& log);
+    bool import_ply_(const std::string& _path, unsigned int process_flags, std::ostream& log);
+    bool import_obj_(const std::string& _path, unsigned int process_flags, std::ostream& log);
+    void process_mesh_(Mesh& mesh, unsigned int process_flags, MeshGpuData& gpu_data, std::ostream& log);
+    void pending_buffer_(std::size_t mesh_index, int buffer, const void*& data, std::size_t& size) const;
+
     std::string         path_;
     std::string         name_;
+    bool                is_cache_hit_ = false;  // of the last load_model()
+    unsigned int        process_flags_ = 0;     // of the last import_model()
+    MeshCacheKey        cache_key_;             // of the last import_model(), if has_cache_key_
+    bool                has_cache_key_ = false;
+    bool                is_uploaded_ = false;
+
+    // between import_model() and upload_model(): the buffer contents of each mesh
+    // (imported) or the cache they are mapped from (cache hit)
+    std::vector<MeshGpuData>    pending_gpu_data_;
+    MeshCacheReader             cache_reader_;
+    std::size_t                 upload_mesh_ = 0;       // where upload_model() continues
+    int                         upload_buffer_ = 0;
+    std::size_t                 upload_offset_ = 0;
+
+    std::shared_ptr<ModelAsset> asset_;         // never NULL
+    std::vector<MeshDrawList>   draw_lists_;    // of the last cull(), one per mesh
 
     glm::vec3  vec_translate_ = glm::vec3(0.0f);
     glm::quat  quat_rotate_ = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
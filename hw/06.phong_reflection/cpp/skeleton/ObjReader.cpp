@@ -0,0 +1,535 @@
+#include "ObjReader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "ParseNumber.h"
+
+namespace
+{
+
+// a chunk is at least this long, so small files are parsed on the calling thread
+const std::size_t kMinChunkBytes = 1 << 20;
+
+const int32_t kNoIndex = -1;
+
+// the arrays a corner indexes: v, vt, vn
+enum ObjArray { kArrayPositions, kArrayTexcoords, kArrayNormals };
+
+// v / vt / vn indices of a face corner. while a chunk is parsed: 0-based, or relative to the
+// start of the chunk (bit k of relative_mask) for negative indices; fix_up_chunk() then makes
+// all of them 0-based into the concatenated arrays. kNoIndex: no vt / vn
+struct ObjCorner
+{
+    int32_t     index[3];
+    uint32_t    relative_mask;
+};
+
+// a line-aligned piece of the file and what parse_chunk() found in it
+struct ObjChunk
+{
+    const char*                 begin = NULL;
+    const char*                 end = NULL;
+
+    std::vector<glm::vec3>      arrays[3];      // [ObjArray]
+    std::vector<ObjCorner>      corners;        // 3 per triangle
+    std::vector<std::pair<std::size_t, std::string> > usemtls;  // (first triangle, material name)
+    std::vector<std::string>    mtllibs;
+
+    std::size_t                 offsets[3] = { 0, 0, 0 };   // of arrays[] in the concatenated arrays
+    std::size_t                 num_lines = 0;
+    std::string                 error;          // of line num_lines (in the chunk)
+};
+
+// triangles [triangle_begin, triangle_end) of a chunk, all of one material
+struct MaterialRun
+{
+    std::size_t chunk;
+    std::size_t triangle_begin;
+    std::size_t triangle_end;
+};
+
+inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline void skip_blanks(const char*& p, const char* line_end)
+{
+    while (p < line_end && is_blank(*p))
+        ++p;
+}
+
+// keyword followed by a blank
+inline bool is_keyword(const char* p, const char* line_end, const char* keyword, std::size_t length)
+{
+    return (std::size_t) (line_end - p) > length && memcmp(p, keyword, length) == 0 && is_blank(p[length]);
+}
+
+std::string trim(const char* begin, const char* end)
+{
+    while (begin < end && is_blank(*begin))
+        ++begin;
+    while (end > begin && is_blank(end[-1]))
+        --end;
+    return std::string(begin, end);
+}
+
+inline bool parse_index(const char*& p, const char* line_end, int32_t& value)
+{
+    bool is_negative = (p < line_end && *p == '-');
+    if (is_negative)
+        ++p;
+    if (p == line_end || (unsigned) (*p - '0') >= 10)
+        return false;
+
+    int64_t v = 0;
+    for (; p < line_end && (unsigned) (*p - '0') < 10; ++p)
+        v = std::min<int64_t>(10 * v + (*p - '0'), INT32_MAX);
+    value = (int32_t) (is_negative ? -v : v);
+    return true;
+}
+
+// up to max_count numbers to the end of the line (or a comment); -1 for a malformed one
+int parse_numbers(const char*& p, const char* line_end, float* values, int max_count)
+{
+    int count = 0;
+    for (; count < max_count; ++count)
+    {
+        skip_blanks(p, line_end);
+        if (p == line_end || *p == '#')
+            break;
+
+        double value;
+        if (!parse_number(p, line_end, value))
+            return -1;
+        values[count] = (float) value;
+    }
+    return count;
+}
+
+// "f v v v ...", "f v/vt ...", "f v//vn ...", "f v/vt/vn ..." as a triangle fan
+bool parse_face(const char* p, const char* line_end, ObjChunk& chunk, std::vector<ObjCorner>& polygon)
+{
+    polygon.clear();
+    for (;;)
+    {
+        skip_blanks(p, line_end);
+        if (p == line_end || *p == '#')
+            break;
+
+        ObjCorner corner = { { kNoIndex, kNoIndex, kNoIndex }, 0 };
+        for (int k = 0; k < 3; ++k)
+        {
+            if (k > 0)
+            {
+                if (p == line_end || *p != '/')
+                    break;
+                ++p;
+                if (k == kArrayTexcoords && p < line_end && *p == '/')
+                    continue;   // v//vn
+            }
+
+            int32_t value;
+            if (!parse_index(p, line_end, value) || value == 0)
+                return false;
+            if (value > 0)
+            {
+                corner.index[k] = value - 1;
+            }
+            else
+            {
+                // -1 is the last one so far; the chunk may not hold it yet (fixed up later)
+                corner.index[k] = (int32_t) chunk.arrays[k].size() + value;
+                corner.relative_mask |= 1u << k;
+            }
+        }
+        if (p < line_end && !is_blank(*p) && *p != '#')
+            return false;
+        polygon.push_back(corner);
+    }
+
+    // points and lines are dropped like aiProcess_SortByPType + the preset do
+    for (std::size_t i = 2; i < polygon.size(); ++i)
+    {
+        chunk.corners.push_back(polygon[0]);
+        chunk.corners.push_back(polygon[i-1]);
+        chunk.corners.push_back(polygon[i]);
+    }
+    return true;
+}
+
+bool parse_line(const char* p, const char* line_end, ObjChunk& chunk, std::vector<ObjCorner>& polygon)
+{
+    skip_blanks(p, line_end);
+    if (p == line_end)
+        return true;
+
+    float values[3] = { 0.0f, 0.0f, 0.0f };
+    if (is_keyword(p, line_end, "v", 1))
+    {
+        // a w or the r g b some exporters append are ignored
+        p += 1;
+        if (parse_numbers(p, line_end, values, 3) != 3)
+            return false;
+        chunk.arrays[kArrayPositions].push_back(glm::vec3(values[0], values[1], values[2]));
+    }
+    else if (is_keyword(p, line_end, "vn", 2))
+    {
+        p += 2;
+        if (parse_numbers(p, line_end, values, 3) != 3)
+            return false;
+        chunk.arrays[kArrayNormals].push_back(glm::vec3(values[0], values[1], values[2]));
+    }
+    else if (is_keyword(p, line_end, "vt", 2))
+    {
+        p += 2;
+        if (parse_numbers(p, line_end, values, 3) < 1)
+            return false;
+        chunk.arrays[kArrayTexcoords].push_back(glm::vec3(values[0], values[1], values[2]));
+    }
+    else if (is_keyword(p, line_end, "f", 1))
+    {
+        return parse_face(p + 1, line_end, chunk, polygon);
+    }
+    else if (is_keyword(p, line_end, "usemtl", 6))
+    {
+        chunk.usemtls.push_back(std::make_pair(chunk.corners.size() / 3, trim(p + 6, line_end)));
+    }
+    else if (is_keyword(p, line_end, "mtllib", 6))
+    {
+        chunk.mtllibs.push_back(trim(p + 6, line_end));
+    }
+    // everything else (#, o, g, s, vp, l, p, ...) does not change the meshes
+    return true;
+}
+
+void parse_chunk(ObjChunk& chunk)
+{
+    std::vector<ObjCorner> polygon;
+    for (const char* p = chunk.begin; p < chunk.end; ++chunk.num_lines)
+    {
+        const char* line_end = (const char*) memchr(p, '\n', chunk.end - p);
+        if (line_end == NULL)
+            line_end = chunk.end;
+
+        if (!parse_line(p, line_end, chunk, polygon))
+        {
+            chunk.error = "cannot parse \"" + trim(p, line_end) + "\"";
+            return;
+        }
+        p = line_end + 1;
+    }
+}
+
+// chunk indices -> indices into the concatenated arrays (sizes: the totals of the arrays)
+bool fix_up_chunk(ObjChunk& chunk, const std::size_t sizes[3])
+{
+    for (std::size_t i = 0; i < chunk.corners.size(); ++i)
+    {
+        ObjCorner& corner = chunk.corners[i];
+        for (int k = 0; k < 3; ++k)
+        {
+            int64_t index = corner.index[k];
+            if (corner.relative_mask & (1u << k))
+                index += (int64_t) chunk.offsets[k];
+            else if (index == kNoIndex)
+                continue;
+
+            if (index < 0 || index >= (int64_t) sizes[k])
+                return false;
+            corner.index[k] = (int32_t) index;
+        }
+        corner.relative_mask = 0;
+    }
+    return true;
+}
+
+inline uint32_t hash_corner(const ObjCorner& corner)
+{
+    return (uint32_t) corner.index[0] * 73856093u ^ (uint32_t) corner.index[1] * 19349663u ^ (uint32_t) corner.index[2] * 83492791u;
+}
+
+// the triangles of runs as one mesh; corners with the same v/vt/vn share a vertex
+// (in the order of their first use, like aiProcess_JoinIdenticalVertices)
+void build_mesh(const std::vector<ObjChunk>& chunks, const std::vector<MaterialRun>& runs, const std::vector<glm::vec3> arrays[3], MeshArrays& mesh)
+{
+    std::size_t num_corners = 0;
+    for (std::size_t r = 0; r < runs.size(); ++r)
+        num_corners += 3 * (runs[r].triangle_end - runs[r].triangle_begin);
+
+    // open addressing, at most half full
+    std::size_t capacity = 16;
+    while (capacity < 2 * num_corners)
+        capacity *= 2;
+    std::vector<uint32_t> table(capacity, UINT32_MAX);
+    std::vector<ObjCorner> vertices;
+    vertices.reserve(num_corners / 2);
+
+    // vt of corners without one are 0; normals are computed (Mesh) unless every corner has a vn
+    bool has_texcoords = false, has_normals = true;
+    mesh.tv_indices.resize(num_corners);
+    std::size_t n = 0;
+    for (std::size_t r = 0; r < runs.size(); ++r)
+    {
+        const ObjChunk& chunk = chunks[runs[r].chunk];
+        for (std::size_t i = 3 * runs[r].triangle_begin; i < 3 * runs[r].triangle_end; ++i)
+        {
+            const ObjCorner& corner = chunk.corners[i];
+            std::size_t slot = hash_corner(corner) & (capacity - 1);
+            while (table[slot] != UINT32_MAX && memcmp(vertices[table[slot]].index, corner.index, sizeof(corner.index)) != 0)
+                slot = (slot + 1) & (capacity - 1);
+
+            if (table[slot] == UINT32_MAX)
+            {
+                table[slot] = (uint32_t) vertices.size();
+                vertices.push_back(corner);
+                has_texcoords = has_texcoords || corner.index[kArrayTexcoords] != kNoIndex;
+                has_normals = has_normals && corner.index[kArrayNormals] != kNoIndex;
+            }
+            mesh.tv_indices[n++] = table[slot];
+        }
+    }
+
+    mesh.positions.resize(vertices.size());
+    mesh.texcoords.resize(has_texcoords ? vertices.size() : 0, glm::vec3(0.0f));
+    mesh.normals.resize(has_normals ? vertices.size() : 0);
+    for (std::size_t v = 0; v < vertices.size(); ++v)
+    {
+        const int32_t* index = vertices[v].index;
+        mesh.positions[v] = arrays[kArrayPositions][index[kArrayPositions]];
+        if (has_texcoords && index[kArrayTexcoords] != kNoIndex)
+            mesh.texcoords[v] = arrays[kArrayTexcoords][index[kArrayTexcoords]];
+        if (has_normals)
+            mesh.normals[v] = arrays[kArrayNormals][index[kArrayNormals]];
+    }
+}
+
+// what Assimp gives an OBJ material (or a face without one)
+Material default_obj_material(const std::string& name)
+{
+    Material material(glm::vec3(0.0f), glm::vec3(0.6f), glm::vec3(0.0f), 0.0f);
+    material.name = name;
+    return material;
+}
+
+bool fail(std::string* error, const std::string& message)
+{
+    if (error != NULL)
+        *error = message;
+    return false;
+}
+
+} // namespace
+
+bool read_obj(const std::string& path, std::vector<ObjMesh>& meshes, std::string* error, unsigned int num_threads)
+{
+    meshes.clear();
+
+    MappedFile file;
+    if (!file.open(path))
+        return fail(error, "cannot open " + path);
+
+    // cut the file at the first line break after every 1 / num_chunks of it
+    const char* data = (const char*) file.data();
+    const char* data_end = data + file.size();
+    std::size_t num_chunks = std::max<std::size_t>(1, std::min<std::size_t>(num_worker_threads(num_threads), file.size() / kMinChunkBytes));
+    std::vector<ObjChunk> chunks(num_chunks);
+    const char* begin = data;
+    for (std::size_t c = 0; c < num_chunks; ++c)
+    {
+        const char* end = data_end;
+        if (c + 1 < num_chunks)
+        {
+            end = std::max(begin, data + file.size() * (c + 1) / num_chunks);
+            const char* line_break = (const char*) memchr(end, '\n', data_end - end);
+            end = (line_break != NULL) ? line_break + 1 : data_end;
+        }
+        chunks[c].begin = begin;
+        chunks[c].end = end;
+        begin = end;
+    }
+
+    parallel_for(0, num_chunks, [&chunks](std::size_t b, std::size_t e) {
+        for (std::size_t c = b; c < e; ++c)
+            parse_chunk(chunks[c]);
+    }, num_threads, 1);
+
+    // prefix sums of the v / vt / vn counts: where each chunk's arrays start
+    std::size_t sizes[3] = { 0, 0, 0 };
+    std::size_t first_line = 1;
+    for (std::size_t c = 0; c < num_chunks; ++c)
+    {
+        if (!chunks[c].error.empty())
+            return fail(error, path + ":" + std::to_string(first_line + chunks[c].num_lines) + ": " + chunks[c].error);
+        first_line += chunks[c].num_lines;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            chunks[c].offsets[k] = sizes[k];
+            sizes[k] += chunks[c].arrays[k].size();
+        }
+    }
+    if (sizes[kArrayPositions] == 0)
+        return fail(error, path + ": no vertices");
+    if (sizes[kArrayPositions] > INT32_MAX || sizes[kArrayTexcoords] > INT32_MAX || sizes[kArrayNormals] > INT32_MAX)
+        return fail(error, path + ": too many vertices");
+
+    // concatenate the arrays and fix up the face indices, a chunk per thread
+    std::vector<glm::vec3> arrays[3];
+    for (int k = 0; k < 3; ++k)
+        arrays[k].resize(sizes[k]);
+    std::vector<char> is_fixed_up(num_chunks, 0);
+    parallel_for(0, num_chunks, [&](std::size_t b, std::size_t e) {
+        for (std::size_t c = b; c < e; ++c)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                std::copy(chunks[c].arrays[k].begin(), chunks[c].arrays[k].end(), arrays[k].begin() + chunks[c].offsets[k]);
+                std::vector<glm::vec3>().swap(chunks[c].arrays[k]);
+            }
+            is_fixed_up[c] = fix_up_chunk(chunks[c], sizes);
+        }
+    }, num_threads, 1);
+    for (std::size_t c = 0; c < num_chunks; ++c)
+    {
+        if (!is_fixed_up[c])
+            return fail(error, path + ": face index out of range");
+    }
+
+    // runs of triangles per material, materials in the order of first use
+    std::vector<std::string> material_names;
+    std::vector<std::vector<MaterialRun> > material_runs;
+    std::string material_name;      // of the faces before the first usemtl: none
+    auto add_run = [&](std::size_t c, std::size_t triangle_begin, std::size_t triangle_end) {
+        if (triangle_end <= triangle_begin)
+            return;
+        std::size_t m = std::find(material_names.begin(), material_names.end(), material_name) - material_names.begin();
+        if (m == material_names.size())
+        {
+            material_names.push_back(material_name);
+            material_runs.push_back(std::vector<MaterialRun>());
+        }
+        MaterialRun run = { c, triangle_begin, triangle_end };
+        material_runs[m].push_back(run);
+    };
+    for (std::size_t c = 0; c < num_chunks; ++c)
+    {
+        std::size_t triangle = 0;
+        for (std::size_t u = 0; u < chunks[c].usemtls.size(); ++u)
+        {
+            add_run(c, triangle, chunks[c].usemtls[u].first);
+            triangle = chunks[c].usemtls[u].first;
+            material_name = chunks[c].usemtls[u].second;
+        }
+        add_run(c, triangle, chunks[c].corners.size() / 3);
+    }
+
+    // mtllib paths are relative to the .obj file; a missing .mtl leaves the default material
+    // (Assimp only warns about it as well)
+    std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    std::vector<Material> materials;
+    for (std::size_t c = 0; c < num_chunks; ++c)
+    {
+        for (std::size_t i = 0; i < chunks[c].mtllibs.size(); ++i)
+            read_mtl(directory + chunks[c].mtllibs[i], materials);
+    }
+
+    meshes.resize(material_names.size());
+    parallel_for(0, meshes.size(), [&](std::size_t b, std::size_t e) {
+        for (std::size_t m = b; m < e; ++m)
+        {
+            meshes[m].arrays = std::make_shared<MeshArrays>();
+            build_mesh(chunks, material_runs[m], arrays, *meshes[m].arrays);
+
+            meshes[m].material = default_obj_material("DefaultMaterial");
+            for (std::size_t i = 0; i < materials.size(); ++i)
+            {
+                if (materials[i].name == material_names[m])
+                {
+                    meshes[m].material = materials[i];
+                    break;
+                }
+            }
+        }
+    }, num_threads, 1);
+    return true;
+}
+
+bool read_mtl(const std::string& path, std::vector<Material>& materials, std::string* error)
+{
+    std::ifstream file(path.c_str());
+    if (!file)
+        return fail(error, "cannot open " + path);
+
+    std::size_t current = materials.size();     // none yet
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "newmtl")
+        {
+            std::string name;
+            std::getline(words, name);
+            current = materials.size();
+            materials.push_back(default_obj_material(trim(name.data(), name.data() + name.size())));
+        }
+        else if (current < materials.size() && (keyword == "Ka" || keyword == "Kd" || keyword == "Ks"))
+        {
+            // "Kd r" means "Kd r r r"
+            float rgb[3] = { 0.0f, 0.0f, 0.0f };
+            if (!(words >> rgb[0]))
+                continue;
+            if (!(words >> rgb[1] >> rgb[2]))
+                rgb[1] = rgb[2] = rgb[0];
+
+            glm::vec3 color(rgb[0], rgb[1], rgb[2]);
+            if (keyword == "Ka")        materials[current].ambient = color;
+            else if (keyword == "Kd")   materials[current].diffuse = color;
+            else                        materials[current].specular = color;
+        }
+        else if (current < materials.size() && keyword == "Ns")
+        {
+            words >> materials[current].shininess;
+        }
+    }
+    return true;
+}
+
+void find_mtllibs(const std::string& path, const char* data, std::size_t size, std::vector<std::string>& mtl_paths)
+{
+    std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    const char* end = data + size;
+    for (const char* p = data; p < end; )
+    {
+        const char* line_end = (const char*) memchr(p, '\n', end - p);
+        if (line_end == NULL)
+            line_end = end;
+
+        skip_blanks(p, line_end);
+        if (is_keyword(p, line_end, "mtllib", 6))
+            mtl_paths.push_back(directory + trim(p + 6, line_end));
+        p = line_end + 1;
+    }
+}
+
+bool is_obj_path(const std::string& path)
+{
+    if (path.size() < 4)
+        return false;
+
+    std::string extension = path.substr(path.size() - 4);
+    for (std::size_t i = 0; i < extension.size(); ++i)
+        extension[i] = (char) tolower((unsigned char) extension[i]);
+    return extension == ".obj";
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Material.h"
+#include "MeshArrays.h"
+
+// a mesh of an OBJ file: the faces of one material
+struct ObjMesh
+{
+    std::shared_ptr<MeshArrays> arrays;
+    Material                    material;   // from the .mtl file(s) of mtllib
+};
+
+// OBJ reader without Assimp. the mapped file is cut into line-aligned chunks that are parsed
+// on num_threads threads (0: all cores); the v / vt / vn arrays of the chunks are then
+// concatenated and the face indices of each chunk shifted by the counts of the chunks before
+// it (a prefix sum, which also resolves negative indices). the faces are split by material
+// into one mesh each, in the order of first use, with the vertices shared by identical
+// v/vt/vn corners; that is the set of meshes Assimp makes of the file.
+// returns false (and why in *error) for a malformed file
+bool read_obj(const std::string& path, std::vector<ObjMesh>& meshes, std::string* error = NULL, unsigned int num_threads = 0);
+
+// newmtl / Ka / Kd / Ks / Ns of an .mtl file, appended to materials
+bool read_mtl(const std::string& path, std::vector<Material>& materials, std::string* error = NULL);
+
+// the .mtl files the mtllib lines of the OBJ file path (its contents: data, size) name, as
+// read_obj() resolves them (relative to the .obj file), appended to mtl_paths
+void find_mtllibs(const std::string& path, const char* data, std::size_t size, std::vector<std::string>& mtl_paths);
+
+// true if path ends with .obj (any case)
+bool is_obj_path(const std::string& path);
@@ -0,0 +1,45 @@
+#pragma once
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// #threads to use (0: as many as the hardware supports)
+inline unsigned int num_worker_threads(unsigned int num_threads = 0)
+{
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    return std::max(num_threads, 1u);
+}
+
+// split [begin, end) into contiguous ranges and call func(range_begin, range_end)
+// for each range on its own thread. small inputs run on the calling thread.
+template <typename Func>
+void parallel_for(std::size_t begin, std::size_t end, Func func, unsigned int num_threads = 0, std::size_t min_range_size = 4096)
+{
+    if (end <= begin)
+        return;
+
+    std::size_t count = end - begin;
+    std::size_t num_ranges = std::min<std::size_t>(num_worker_threads(num_threads), (count + min_range_size - 1) / min_range_size);
+    if (num_ranges <= 1)
+    {
+        func(begin, end);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(num_ranges - 1);
+
+    std::size_t range_size = (count + num_ranges - 1) / num_ranges;
+    for (std::size_t r = 1; r < num_ranges; ++r)
+    {
+        std::size_t b = begin + r * range_size;
+        std::size_t e = std::min(end, b + range_size);
+        if (b < e)
+            threads.push_back(std::thread(func, b, e));
+    }
+    func(begin, std::min(end, begin + range_size));
+
+    for (std::size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+// number parsing for the text formats read without Assimp (PlyReader, ObjReader)
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// exact powers of ten (a double holds 10^22 exactly)
+static const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// [+-]digits[.digits][(e|E)[+-]digits] without strtod's locale lookup and copy.
+// up to 19 significant digits and |exponent| <= 22 (every PLY / OBJ exporter we have writes
+// far less) take one exact multiplication or division in double; anything else, "nan" and
+// "inf" go through strtod. p is left after the number.
+inline bool parse_number(const char*& p, const char* end, double& value)
+{
+    const char* begin = p;
+    bool is_negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        is_negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int num_digits = 0, exponent = 0;
+    bool has_digits = false;
+    for (; p < end && (unsigned) (*p - '0') < 10; ++p, has_digits = true)
+    {
+        if (num_digits < 19)
+        {
+            mantissa = 10 * mantissa + (unsigned) (*p - '0');
+            num_digits += (mantissa != 0);
+        }
+        else
+        {
+            ++exponent;     // digits past the 19th only scale
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && (unsigned) (*p - '0') < 10; ++p, has_digits = true)
+        {
+            if (num_digits < 19)
+            {
+                mantissa = 10 * mantissa + (unsigned) (*p - '0');
+                num_digits += (mantissa != 0);
+                --exponent;
+            }
+        }
+    }
+    if (has_digits && p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool is_exponent_negative = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            is_exponent_negative = (*q++ == '-');
+        if (q < end && (unsigned) (*q - '0') < 10)
+        {
+            int e = 0;
+            for (; q < end && (unsigned) (*q - '0') < 10; ++q)
+                e = std::min(10 * e + (*q - '0'), 100000);
+            exponent += is_exponent_negative ? -e : e;
+            p = q;
+        }
+    }
+
+    bool is_fast = has_digits && num_digits < 19 && exponent >= -22 && exponent <= 22 && mantissa < (1ull << 53);
+    if (is_fast && (p == end || is_space(*p)))
+    {
+        double d = (double) mantissa;
+        d = (exponent < 0) ? d / kPow10[-exponent] : d * kPow10[exponent];
+        value = is_negative ? -d : d;
+        return true;
+    }
+
+    // slow path on a NUL-terminated copy of the token
+    p = begin;
+    const char* token_end = begin;
+    while (token_end < end && !is_space(*token_end))
+        ++token_end;
+    std::string token(begin, token_end);
+    char* parsed_end = NULL;
+    value = strtod(token.c_str(), &parsed_end);
+    if (parsed_end == token.c_str() || *parsed_end != '\0')
+        return false;
+    p = token_end;
+    return true;
+}
@@ -0,0 +1,834 @@
+#include "PlyReader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#include "MappedFile.h"
+#include "ParseNumber.h"
+
+namespace
+{
+
+enum PlyType { kPlyInvalid, kPlyInt8, kPlyUint8, kPlyInt16, kPlyUint16, kPlyInt32, kPlyUint32, kPlyFloat32, kPlyFloat64 };
+
+enum PlyFormat { kPlyAscii, kPlyBinaryLittleEndian, kPlyBinaryBigEndian };
+
+// where a vertex property goes: a component of one of the MeshArrays streams
+enum PlyTarget
+{
+    kTargetNone = -1,
+    kTargetX, kTargetY, kTargetZ,
+    kTargetNX, kTargetNY, kTargetNZ,
+    kTargetS, kTargetT,
+    kTargetRed, kTargetGreen, kTargetBlue, kTargetAlpha,
+    kNumTargets,
+    kTargetIndices = kNumTargets    // the list property of "face"
+};
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType     type = kPlyInvalid;         // of the value (of the items for a list)
+    PlyType     count_type = kPlyInvalid;   // of the item count (lists only)
+    bool        is_list = false;
+    int         target = kTargetNone;
+    float       divisor = 1.0f;             // colors of integer types are normalized
+};
+
+struct PlyElement
+{
+    std::string                 name;
+    std::size_t                 count = 0;
+    std::vector<PlyProperty>    properties;
+};
+
+PlyType parse_type(const std::string& name)
+{
+    if (name == "char" || name == "int8")       return kPlyInt8;
+    if (name == "uchar" || name == "uint8")     return kPlyUint8;
+    if (name == "short" || name == "int16")     return kPlyInt16;
+    if (name == "ushort" || name == "uint16")   return kPlyUint16;
+    if (name == "int" || name == "int32")       return kPlyInt32;
+    if (name == "uint" || name == "uint32")     return kPlyUint32;
+    if (name == "float" || name == "float32")   return kPlyFloat32;
+    if (name == "double" || name == "float64")  return kPlyFloat64;
+    return kPlyInvalid;
+}
+
+std::size_t type_size(PlyType type)
+{
+    switch (type)
+    {
+    case kPlyInt8: case kPlyUint8:      return 1;
+    case kPlyInt16: case kPlyUint16:    return 2;
+    case kPlyInt32: case kPlyUint32: case kPlyFloat32:  return 4;
+    case kPlyFloat64:                   return 8;
+    default:                            return 0;
+    }
+}
+
+// the full range of an integer color type maps to [0, 1] (a division, as Assimp does, so
+// both readers give the same floats)
+float color_divisor(PlyType type)
+{
+    switch (type)
+    {
+    case kPlyInt8:      return 127.0f;
+    case kPlyUint8:     return 255.0f;
+    case kPlyInt16:     return 32767.0f;
+    case kPlyUint16:    return 65535.0f;
+    case kPlyInt32:     return 2147483647.0f;
+    case kPlyUint32:    return 4294967295.0f;
+    default:            return 1.0f;
+    }
+}
+
+int vertex_target(const std::string& name)
+{
+    static const char* const names[][3] = {
+        { "x", NULL, NULL }, { "y", NULL, NULL }, { "z", NULL, NULL },
+        { "nx", NULL, NULL }, { "ny", NULL, NULL }, { "nz", NULL, NULL },
+        { "s", "u", "texture_u" }, { "t", "v", "texture_v" },
+        { "red", "r", "diffuse_red" }, { "green", "g", "diffuse_green" }, { "blue", "b", "diffuse_blue" }, { "alpha", "a", "diffuse_alpha" },
+    };
+    for (int target = 0; target < kNumTargets; ++target)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            if (names[target][k] != NULL && name == names[target][k])
+                return target;
+        }
+    }
+    return kTargetNone;
+}
+
+template <typename T>
+inline T load(const unsigned char* p, bool is_swapped)
+{
+    unsigned char bytes[sizeof(T)];
+    memcpy(bytes, p, sizeof(T));
+    if (is_swapped)
+    {
+        for (std::size_t i = 0; i < sizeof(T) / 2; ++i)
+            std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+    }
+    T value;
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+inline double load_binary(const unsigned char* p, PlyType type, bool is_swapped)
+{
+    switch (type)
+    {
+    case kPlyInt8:      return (int8_t) *p;
+    case kPlyUint8:     return *p;
+    case kPlyInt16:     return load<int16_t>(p, is_swapped);
+    case kPlyUint16:    return load<uint16_t>(p, is_swapped);
+    case kPlyInt32:     return load<int32_t>(p, is_swapped);
+    case kPlyUint32:    return load<uint32_t>(p, is_swapped);
+    case kPlyFloat32:   return load<float>(p, is_swapped);
+    case kPlyFloat64:   return load<double>(p, is_swapped);
+    default:            return 0.0;
+    }
+}
+
+bool is_host_little_endian()
+{
+    const uint16_t one = 1;
+    unsigned char byte;
+    memcpy(&byte, &one, 1);
+    return byte == 1;
+}
+
+class PlyParser
+{
+public:
+    PlyParser(MeshArrays& mesh) : mesh_(&mesh) {}
+
+    bool parse(const unsigned char* data, std::size_t size);
+
+    const std::string& error() const    { return error_; }
+
+    // PlyStream: the header, then the items of an element a window at a time
+    bool parse_header(const unsigned char* data, std::size_t size, std::size_t& header_size);
+    bool is_binary() const                              { return format_ != kPlyAscii; }
+    const std::vector<PlyElement>& elements() const     { return elements_; }
+    void set_mesh(MeshArrays& mesh)                     { mesh_ = &mesh; }
+    bool begin_items(const PlyElement& element, std::size_t count);
+    bool read_binary_item(const PlyElement& element, std::size_t item, std::size_t index, const unsigned char* data, std::size_t size);
+
+    // bytes of the binary item at data; 0 if it does not end within size
+    std::size_t binary_item_size(const PlyElement& element, const unsigned char* data, std::size_t size) const;
+
+private:
+    bool fail_(const std::string& message)  { error_ = message; return false; }
+
+    bool parse_header_();
+    bool read_element_(const PlyElement& element);
+
+    // one vertex / face from the current position (values[target] per target), stored at index
+    bool read_item_(const PlyElement& element, std::size_t item, std::size_t index);
+    bool read_ascii_values_(const PlyElement& element, std::size_t item);
+    bool read_binary_values_(const PlyElement& element, std::size_t item);
+    void store_vertex_(std::size_t v);
+    bool add_polygon_(std::size_t item);
+
+    MeshArrays*                 mesh_;
+    std::string                 error_;
+
+    const char*                 p_ = NULL;      // parse position
+    const char*                 end_ = NULL;
+    PlyFormat                   format_ = kPlyAscii;
+    bool                        is_swapped_ = false;
+    std::vector<PlyElement>     elements_;
+    std::size_t                 num_vertices_ = 0;  // in the vertex element (the face indices are checked against it)
+
+    bool                        has_target_[kNumTargets];
+    float                       values_[kNumTargets];
+    std::vector<unsigned int>   polygon_;       // indices of the current face
+};
+
+bool PlyParser::parse(const unsigned char* data, std::size_t size)
+{
+    p_ = (const char*) data;
+    end_ = p_ + size;
+    if (!parse_header_())
+        return false;
+
+    for (std::size_t e = 0; e < elements_.size(); ++e)
+    {
+        if (!read_element_(elements_[e]))
+            return false;
+    }
+
+    if (mesh_->positions.empty())
+        return fail_("no vertices");
+    return true;
+}
+
+bool PlyParser::parse_header(const unsigned char* data, std::size_t size, std::size_t& header_size)
+{
+    p_ = (const char*) data;
+    end_ = p_ + size;
+    if (!parse_header_())
+        return false;
+    header_size = p_ - (const char*) data;
+    return true;
+}
+
+bool PlyParser::parse_header_()
+{
+    // the header is short: parse it line by line as text
+    const char* header_end = NULL;
+    static const char kEndHeader[] = "end_header";
+    for (const char* q = p_; q + sizeof(kEndHeader) - 1 <= end_; ++q)
+    {
+        if ((q == p_ || q[-1] == '\n') && memcmp(q, kEndHeader, sizeof(kEndHeader) - 1) == 0)
+        {
+            header_end = q + sizeof(kEndHeader) - 1;
+            break;
+        }
+    }
+    if (header_end == NULL || end_ - p_ < 4 || memcmp(p_, "ply", 3) != 0)
+        return fail_("not a PLY file");
+
+    std::istringstream header(std::string(p_, header_end));
+    std::string line;
+    bool has_format = false;
+    while (std::getline(header, line))
+    {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format")
+        {
+            std::string format, version;
+            words >> format >> version;
+            if (format == "ascii")                      format_ = kPlyAscii;
+            else if (format == "binary_little_endian")  format_ = kPlyBinaryLittleEndian;
+            else if (format == "binary_big_endian")     format_ = kPlyBinaryBigEndian;
+            else
+                return fail_("unknown format " + format);
+            has_format = true;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            words >> element.name >> element.count;
+            if (words.fail())
+                return fail_("bad element line: " + line);
+            elements_.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (elements_.empty())
+                return fail_("property before element: " + line);
+
+            PlyElement& element = elements_.back();
+            PlyProperty property;
+            std::string type;
+            words >> type;
+            if (type == "list")
+            {
+                std::string count_type;
+                words >> count_type >> type;
+                property.is_list = true;
+                property.count_type = parse_type(count_type);
+                if (property.count_type == kPlyInvalid || property.count_type == kPlyFloat32 || property.count_type == kPlyFloat64)
+                    return fail_("bad list count type: " + line);
+            }
+            property.type = parse_type(type);
+            words >> property.name;
+            if (property.type == kPlyInvalid || property.name.empty())
+                return fail_("bad property: " + line);
+
+            if (element.name == "vertex" && !property.is_list)
+            {
+                property.target = vertex_target(property.name);
+                if (property.target >= kTargetRed && property.target <= kTargetAlpha)
+                    property.divisor = color_divisor(property.type);
+            }
+            else if (element.name == "face" && property.is_list && (property.name == "vertex_indices" || property.name == "vertex_index"))
+            {
+                property.target = kTargetIndices;
+            }
+            element.properties.push_back(property);
+        }
+        else if (keyword != "ply" && keyword != "comment" && keyword != "obj_info" && keyword != "end_header" && !keyword.empty())
+        {
+            return fail_("unknown header line: " + line);
+        }
+    }
+    if (!has_format)
+        return fail_("no format line");
+
+    is_swapped_ = (format_ == kPlyBinaryLittleEndian) != is_host_little_endian() && format_ != kPlyAscii;
+    for (std::size_t e = 0; e < elements_.size(); ++e)
+    {
+        if (elements_[e].name == "vertex")
+        {
+            num_vertices_ = elements_[e].count;
+            break;
+        }
+    }
+
+    // the data starts after the line break of end_header
+    p_ = header_end;
+    while (p_ < end_ && *p_ != '\n')
+        ++p_;
+    if (p_ < end_)
+        ++p_;
+    return true;
+}
+
+bool PlyParser::begin_items(const PlyElement& element, std::size_t count)
+{
+    if (element.name == "vertex")
+    {
+        for (int t = 0; t < kNumTargets; ++t)
+            has_target_[t] = false;
+        for (std::size_t i = 0; i < element.properties.size(); ++i)
+        {
+            if (element.properties[i].target != kTargetNone)
+                has_target_[element.properties[i].target] = true;
+        }
+        if (!has_target_[kTargetX] || !has_target_[kTargetY] || !has_target_[kTargetZ])
+            return fail_("vertex without x, y, z");
+
+        // a stream is written if any of its components is in the file
+        mesh_->positions.resize(count);
+        mesh_->normals.resize((has_target_[kTargetNX] || has_target_[kTargetNY] || has_target_[kTargetNZ]) ? count : 0);
+        mesh_->texcoords.resize((has_target_[kTargetS] || has_target_[kTargetT]) ? count : 0);
+        mesh_->colors.resize((has_target_[kTargetRed] || has_target_[kTargetGreen] || has_target_[kTargetBlue] || has_target_[kTargetAlpha]) ? count : 0);
+    }
+    else if (element.name == "face")
+    {
+        mesh_->tv_indices.clear();
+        mesh_->tv_indices.reserve(3 * count);
+    }
+    return true;
+}
+
+bool PlyParser::read_element_(const PlyElement& element)
+{
+    bool is_vertex = element.name == "vertex";
+    bool is_face = element.name == "face";
+    if (!begin_items(element, element.count))
+        return false;
+
+    // binary items of fixed size: check the whole element at once
+    std::size_t item_size = 0;
+    bool is_fixed_size = true;
+    for (std::size_t i = 0; i < element.properties.size(); ++i)
+    {
+        is_fixed_size = is_fixed_size && !element.properties[i].is_list;
+        item_size += type_size(element.properties[i].type);
+    }
+    if (format_ != kPlyAscii && is_fixed_size && (std::size_t) (end_ - p_) / std::max<std::size_t>(item_size, 1) < element.count)
+        return fail_("unexpected end of file in element " + element.name);
+
+    if (!is_vertex && !is_face && format_ != kPlyAscii && is_fixed_size)
+    {
+        p_ += item_size * element.count;    // skipped without looking at it
+        return true;
+    }
+
+    for (std::size_t item = 0; item < element.count; ++item)
+    {
+        if (!read_item_(element, item, item))
+            return false;
+    }
+    return true;
+}
+
+bool PlyParser::read_item_(const PlyElement& element, std::size_t item, std::size_t index)
+{
+    polygon_.clear();
+    for (int t = 0; t < kNumTargets; ++t)
+        values_[t] = (t == kTargetAlpha) ? 1.0f : 0.0f;
+
+    bool ok = (format_ == kPlyAscii) ? read_ascii_values_(element, item) : read_binary_values_(element, item);
+    if (!ok)
+        return false;
+
+    if (element.name == "vertex")
+        store_vertex_(index);
+    else if (element.name == "face")
+        return add_polygon_(item);
+    return true;
+}
+
+bool PlyParser::read_binary_item(const PlyElement& element, std::size_t item, std::size_t index, const unsigned char* data, std::size_t size)
+{
+    p_ = (const char*) data;
+    end_ = p_ + size;
+    return read_item_(element, item, index);
+}
+
+std::size_t PlyParser::binary_item_size(const PlyElement& element, const unsigned char* data, std::size_t size) const
+{
+    std::size_t item_size = 0;
+    for (std::size_t i = 0; i < element.properties.size(); ++i)
+    {
+        const PlyProperty& property = element.properties[i];
+        std::size_t count = 1;
+        if (property.is_list)
+        {
+            std::size_t count_size = type_size(property.count_type);
+            if (size - item_size < count_size)
+                return 0;
+            double value = load_binary(data + item_size, property.count_type, is_swapped_);
+            count = (value > 0.0) ? (std::size_t) value : 0;
+            item_size += count_size;
+        }
+        item_size += type_size(property.type) * count;
+        if (item_size > size)
+            return 0;
+    }
+    return item_size;
+}
+
+bool PlyParser::read_ascii_values_(const PlyElement& element, std::size_t item)
+{
+    for (std::size_t i = 0; i < element.properties.size(); ++i)
+    {
+        const PlyProperty& property = element.properties[i];
+
+        std::size_t count = 1;
+        double value;
+        if (property.is_list)
+        {
+            while (p_ < end_ && is_space(*p_))
+                ++p_;
+            if (!parse_number(p_, end_, value) || value < 0.0)
+                return fail_("bad list count in " + element.name + " " + std::to_string(item));
+            count = (std::size_t) value;
+        }
+
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            while (p_ < end_ && is_space(*p_))
+                ++p_;
+            if (p_ == end_)
+                return fail_("unexpected end of file in " + element.name + " " + std::to_string(item));
+            if (!parse_number(p_, end_, value))
+                return fail_("bad number in " + element.name + " " + std::to_string(item));
+
+            if (property.target == kTargetIndices)
+                polygon_.push_back((unsigned int) value);
+            else if (property.target != kTargetNone)
+                values_[property.target] = (float) value / property.divisor;
+        }
+    }
+    return true;
+}
+
+bool PlyParser::read_binary_values_(const PlyElement& element, std::size_t item)
+{
+    const unsigned char* p = (const unsigned char*) p_;
+    const unsigned char* end = (const unsigned char*) end_;
+
+    for (std::size_t i = 0; i < element.properties.size(); ++i)
+    {
+        const PlyProperty& property = element.properties[i];
+
+        std::size_t count = 1;
+        if (property.is_list)
+        {
+            if ((std::size_t) (end - p) < type_size(property.count_type))
+                return fail_("unexpected end of file in " + element.name + " " + std::to_string(item));
+            double value = load_binary(p, property.count_type, is_swapped_);
+            if (value < 0.0)
+                return fail_("bad list count in " + element.name + " " + std::to_string(item));
+            count = (std::size_t) value;
+            p += type_size(property.count_type);
+        }
+
+        std::size_t size = type_size(property.type);
+        if ((std::size_t) (end - p) / size < count)
+            return fail_("unexpected end of file in " + element.name + " " + std::to_string(item));
+
+        if (property.target == kTargetIndices)
+        {
+            for (std::size_t k = 0; k < count; ++k, p += size)
+                polygon_.push_back((unsigned int) load_binary(p, property.type, is_swapped_));
+        }
+        else
+        {
+            if (property.target != kTargetNone)
+                values_[property.target] = (float) load_binary(p, property.type, is_swapped_) / property.divisor;
+            p += size * count;
+        }
+    }
+
+    p_ = (const char*) p;
+    return true;
+}
+
+void PlyParser::store_vertex_(std::size_t v)
+{
+    mesh_->positions[v] = glm::vec3(values_[kTargetX], values_[kTargetY], values_[kTargetZ]);
+    if (!mesh_->normals.empty())
+        mesh_->normals[v] = glm::vec3(values_[kTargetNX], values_[kTargetNY], values_[kTargetNZ]);
+    if (!mesh_->texcoords.empty())
+        mesh_->texcoords[v] = glm::vec3(values_[kTargetS], values_[kTargetT], 0.0f);
+    if (!mesh_->colors.empty())
+        mesh_->colors[v] = glm::vec4(values_[kTargetRed], values_[kTargetGreen], values_[kTargetBlue], values_[kTargetAlpha]);
+}
+
+bool PlyParser::add_polygon_(std::size_t item)
+{
+    // vertex comes before face in every file we know of; the indices are checked against it
+    for (std::size_t i = 0; i < polygon_.size(); ++i)
+    {
+        if (polygon_[i] >= num_vertices_)
+            return fail_("vertex index out of range in face " + std::to_string(item));
+    }
+
+    // convert a polygon to a triangle fan (as Mesh::update_tv_indices() does for aiFaces);
+    // points and lines are dropped like aiProcess_SortByPType + the preset do
+    for (std::size_t i = 2; i < polygon_.size(); ++i)
+    {
+        mesh_->tv_indices.push_back(polygon_[0]);
+        mesh_->tv_indices.push_back(polygon_[i-1]);
+        mesh_->tv_indices.push_back(polygon_[i]);
+    }
+    return true;
+}
+
+} // namespace
+
+bool read_ply(const std::string& path, MeshArrays& mesh, std::string* error)
+{
+    mesh = MeshArrays();
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        if (error != NULL)
+            *error = "cannot open " + path;
+        return false;
+    }
+
+    PlyParser parser(mesh);
+    if (!parser.parse(file.data(), file.size()))
+    {
+        if (error != NULL)
+            *error = path + ": " + parser.error();
+        mesh = MeshArrays();
+        return false;
+    }
+    return true;
+}
+
+bool is_ply_path(const std::string& path)
+{
+    if (path.size() < 4)
+        return false;
+
+    std::string extension = path.substr(path.size() - 4);
+    for (std::size_t i = 0; i < extension.size(); ++i)
+        extension[i] = (char) tolower((unsigned char) extension[i]);
+    return extension == ".ply";
+}
+
+struct PlyStreamState
+{
+    PlyStreamState() : parser(scratch) {}
+
+    bool fail(const std::string& message)   { error = path + ": " + message; return false; }
+
+    bool refill();
+    std::size_t next_item_size(const PlyElement& element);
+    bool seek_element(std::size_t e);
+    std::size_t read_items(std::size_t e, std::size_t max_count, MeshArrays& arrays);
+
+    MeshArrays                  scratch;
+    PlyParser                   parser;
+    std::string                 path;
+    std::string                 error;
+
+    FILE*                       file = NULL;
+    std::vector<unsigned char>  window;
+    std::size_t                 begin = 0;          // the bytes not read yet: window[begin, end)
+    std::size_t                 end = 0;
+    long                        data_offset = 0;    // of the first element in the file
+
+    std::size_t                 element = 0;        // the next item to read
+    std::size_t                 item = 0;
+    std::size_t                 vertex_element = 0;
+    std::size_t                 face_element = 0;
+    bool                        has_faces = false;
+};
+
+bool PlyStreamState::refill()
+{
+    // the rest of the window moves to its front; an item larger than the window doubles it
+    if (begin > 0)
+    {
+        memmove(window.data(), window.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    if (end == window.size())
+        window.resize(2 * window.size());
+
+    std::size_t count = fread(window.data() + end, 1, window.size() - end, file);
+    end += count;
+    return count > 0;
+}
+
+std::size_t PlyStreamState::next_item_size(const PlyElement& element)
+{
+    for (;;)
+    {
+        std::size_t size = parser.binary_item_size(element, window.data() + begin, end - begin);
+        if (size > 0)
+            return size;
+        if (!refill())
+        {
+            fail("unexpected end of file in element " + element.name);
+            return 0;
+        }
+    }
+}
+
+bool PlyStreamState::seek_element(std::size_t e)
+{
+    const std::vector<PlyElement>& elements = parser.elements();
+    while (element < e)
+    {
+        for (; item < elements[element].count; ++item)
+        {
+            std::size_t size = next_item_size(elements[element]);
+            if (size == 0)
+                return false;
+            begin += size;
+        }
+        ++element;
+        item = 0;
+    }
+    return element == e;
+}
+
+std::size_t PlyStreamState::read_items(std::size_t e, std::size_t max_count, MeshArrays& arrays)
+{
+    if (file == NULL || !seek_element(e))
+        return 0;
+
+    const PlyElement& source = parser.elements()[e];
+    std::size_t count = std::min(max_count, source.count - item);
+    parser.set_mesh(arrays);
+    if (!parser.begin_items(source, count))
+    {
+        fail(parser.error());
+        return 0;
+    }
+
+    for (std::size_t k = 0; k < count; ++k, ++item)
+    {
+        std::size_t size = next_item_size(source);
+        if (size == 0)
+            return 0;
+        if (!parser.read_binary_item(source, item, k, window.data() + begin, size))
+        {
+            fail(parser.error());
+            return 0;
+        }
+        begin += size;
+    }
+
+    if (item == source.count)
+    {
+        ++element;
+        item = 0;
+    }
+    return count;
+}
+
+PlyStream::PlyStream() : state_(new PlyStreamState)
+{
+}
+
+PlyStream::~PlyStream()
+{
+    close();
+}
+
+bool PlyStream::open(const std::string& path, std::size_t window_bytes)
+{
+    close();
+    PlyStreamState& s = *state_;
+    s.path = path;
+    s.file = fopen(path.c_str(), "rb");
+    if (s.file == NULL)
+        return s.fail("cannot open");
+
+    // the header fits in the first window
+    s.window.resize(std::max<std::size_t>(window_bytes, 64 << 10));
+    s.end = fread(s.window.data(), 1, s.window.size(), s.file);
+    std::size_t header_size;
+    bool ok = s.parser.parse_header(s.window.data(), s.end, header_size);
+    if (!ok)
+        s.fail(s.parser.error());
+    else if (!s.parser.is_binary())
+        ok = s.fail("ascii PLY (read_ply() reads it whole)");
+
+    const std::vector<PlyElement>& elements = s.parser.elements();
+    bool has_vertices = false;
+    for (std::size_t e = 0; ok && e < elements.size(); ++e)
+    {
+        if (elements[e].properties.empty())
+            ok = s.fail("element " + elements[e].name + " without properties");
+        else if (elements[e].name == "vertex" && !has_vertices)
+        {
+            s.vertex_element = e;
+            has_vertices = true;
+        }
+        else if (elements[e].name == "face" && !s.has_faces)
+        {
+            s.face_element = e;
+            s.has_faces = true;
+        }
+    }
+    if (ok && !has_vertices)
+        ok = s.fail("no vertices");
+    if (ok && s.has_faces && s.face_element < s.vertex_element)
+        ok = s.fail("face before vertex");
+    if (!ok)
+    {
+        std::string error = s.error;
+        close();
+        state_->error = error;
+        return false;
+    }
+
+    s.begin = header_size;
+    s.data_offset = (long) header_size;
+    return true;
+}
+
+void PlyStream::close()
+{
+    if (state_->file != NULL)
+        fclose(state_->file);
+    state_.reset(new PlyStreamState);
+}
+
+std::size_t PlyStream::num_vertices() const
+{
+    return state_->file != NULL ? state_->parser.elements()[state_->vertex_element].count : 0;
+}
+
+std::size_t PlyStream::num_faces() const
+{
+    return (state_->file != NULL && state_->has_faces) ? state_->parser.elements()[state_->face_element].count : 0;
+}
+
+bool PlyStream::has_normals() const
+{
+    if (state_->file == NULL)
+        return false;
+    const std::vector<PlyProperty>& properties = state_->parser.elements()[state_->vertex_element].properties;
+    for (std::size_t i = 0; i < properties.size(); ++i)
+    {
+        if (properties[i].target >= kTargetNX && properties[i].target <= kTargetNZ)
+            return true;
+    }
+    return false;
+}
+
+bool PlyStream::has_colors() const
+{
+    if (state_->file == NULL)
+        return false;
+    const std::vector<PlyProperty>& properties = state_->parser.elements()[state_->vertex_element].properties;
+    for (std::size_t i = 0; i < properties.size(); ++i)
+    {
+        if (properties[i].target >= kTargetRed && properties[i].target <= kTargetAlpha)
+            return true;
+    }
+    return false;
+}
+
+std::size_t PlyStream::read_vertices(std::size_t max_count, MeshArrays& arrays)
+{
+    return state_->read_items(state_->vertex_element, max_count, arrays);
+}
+
+std::size_t PlyStream::read_faces(std::size_t max_count, std::vector<unsigned int>& tv_indices)
+{
+    tv_indices.clear();
+    if (!state_->has_faces)
+        return 0;
+
+    MeshArrays& faces = state_->scratch;
+    faces.tv_indices.swap(tv_indices);      // keeps the capacity of the caller's vector
+    std::size_t count = state_->read_items(state_->face_element, max_count, faces);
+    faces.tv_indices.swap(tv_indices);
+    return count;
+}
+
+bool PlyStream::rewind()
+{
+    PlyStreamState& s = *state_;
+    if (s.file == NULL || fseek(s.file, s.data_offset, SEEK_SET) != 0)
+        return false;
+    s.begin = s.end = 0;
+    s.element = s.item = 0;
+    s.error.clear();
+    return true;
+}
+
+const std::string& PlyStream::error() const
+{
+    return state_->error;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MeshArrays.h"
+
+// PLY reader for ascii, binary_little_endian and binary_big_endian files without Assimp:
+// the file is mapped (MappedFile) and parsed in place, the "vertex" and "face" elements go
+// straight into the MeshArrays and every other element is skipped.
+// returns false (and why in *error) for a malformed file or an unsupported property
+bool read_ply(const std::string& path, MeshArrays& mesh, std::string* error = NULL);
+
+// true if path ends with .ply (any case)
+bool is_ply_path(const std::string& path);
+
+struct PlyStreamState;
+
+// a binary PLY read front to back through a window of window_bytes, for files too large to
+// read at once (the out-of-core chunk builder, see ChunkFile.h): the vertices and the faces
+// come in batches, everything else is skipped. ascii files are not supported
+class PlyStream
+{
+public:
+    PlyStream();
+    ~PlyStream();
+
+    PlyStream(const PlyStream&) = delete;
+    PlyStream& operator=(const PlyStream&) = delete;
+
+    bool open(const std::string& path, std::size_t window_bytes = 16 << 20);
+    void close();
+
+    std::size_t num_vertices() const;
+    std::size_t num_faces() const;
+    bool has_normals() const;
+    bool has_colors() const;
+
+    // the next (up to) max_count vertices into the streams of arrays, which are replaced;
+    // 0 once the vertex element is done (or on an error)
+    std::size_t read_vertices(std::size_t max_count, MeshArrays& arrays);
+
+    // the next (up to) max_count faces as triangles (fans, like read_ply()) into tv_indices,
+    // which are replaced; the indices are those of the whole file. 0 once the faces are done
+    std::size_t read_faces(std::size_t max_count, std::vector<unsigned int>& tv_indices);
+
+    // back to the first element
+    bool rewind();
+
+    const std::string& error() const;
+
+private:
+    std::unique_ptr<PlyStreamState>     state_;
+};
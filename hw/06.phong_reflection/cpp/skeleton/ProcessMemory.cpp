@@ -0,0 +1,71 @@
+#include "ProcessMemory.h"
+
+#if defined(__linux__)
+#include <cstdio>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#include <sys/resource.h>
+#endif
+
+std::size_t resident_set_bytes()
+{
+#if defined(__linux__)
+    // /proc/self/statm: size resident shared ... in pages
+    FILE* fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL)
+        return 0;
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    return (n == 2) ? (std::size_t) resident * (std::size_t) sysconf(_SC_PAGESIZE) : 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &info, &count) != KERN_SUCCESS)
+        return 0;
+    return (std::size_t) info.resident_size;
+#else
+    return 0;
+#endif
+}
+
+std::size_t peak_resident_set_bytes()
+{
+#if defined(__linux__)
+    // /proc/self/status: "VmHWM:     1234 kB"
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp == NULL)
+        return 0;
+    char line[256];
+    unsigned long kb = 0;
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        if (sscanf(line, "VmHWM: %lu", &kb) == 1)
+            break;
+    }
+    fclose(fp);
+    return (std::size_t) kb * 1024;
+#elif defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return (std::size_t) usage.ru_maxrss;     // bytes on macOS
+#else
+    return 0;
+#endif
+}
+
+bool reset_peak_resident_set()
+{
+#if defined(__linux__)
+    // 5: reset the peak resident set size (Linux 4.0+)
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (fp == NULL)
+        return false;
+    bool ok = fputs("5", fp) >= 0;
+    return (fclose(fp) == 0) && ok;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+
+// resident set size of this process in bytes (0 where it cannot be read)
+std::size_t resident_set_bytes();
+
+// largest resident set size so far (Linux: VmHWM, macOS: ru_maxrss; 0 where it cannot be read)
+std::size_t peak_resident_set_bytes();
+
+// start the peak over at the current resident set size (Linux only; false where it cannot)
+bool reset_peak_resident_set();
@@ -0,0 +1,125 @@
+#include "RenderQueue.h"
+
+#include <chrono>
+#include <cstring>
+
+static const int kProgramBits = 4;
+static const int kMaterialBits = 16;
+static const int kMeshBits = 20;
+static const int kDepthBits = 24;
+
+static uint64_t key_field(uint64_t value, int bits)
+{
+    // values past the field wrap: they only weaken the grouping
+    return value & ((uint64_t(1) << bits) - 1);
+}
+
+// a positive float orders like its bits: the upper 24 of them (the sign is 0)
+static uint64_t depth_field(float depth)
+{
+    if (!(depth > 0.0f))
+        return 0;
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (32 - kDepthBits);
+}
+
+uint64_t make_sort_key(const DrawPacket& packet, RenderSortOrder sort_order)
+{
+    uint64_t program = key_field(packet.program, kProgramBits);
+    uint64_t material = key_field(packet.material_slot, kMaterialBits);
+    uint64_t mesh = key_field(packet.vertex_array, kMeshBits);
+    uint64_t depth = depth_field(packet.depth);
+
+    if (sort_order == kSortFrontToBack)
+        return program << 60 | depth << 36 | material << 20 | mesh;
+    return program << 60 | material << 44 | mesh << 24 | depth;
+}
+
+void radix_sort(std::vector<SortItem>& items, std::vector<SortItem>& scratch)
+{
+    const std::size_t n = items.size();
+    if (n < 2)
+        return;
+
+    // the histograms of all 8 bytes in one pass
+    std::vector<std::size_t> counts(8 * 256, 0);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        uint64_t key = items[i].key;
+        for (int b = 0; b < 8; ++b)
+            ++counts[b * 256 + ((key >> (8 * b)) & 0xff)];
+    }
+
+    scratch.resize(n);
+    for (int b = 0; b < 8; ++b)
+    {
+        std::size_t* count = &counts[b * 256];
+        int shift = 8 * b;
+        if (count[(items[0].key >> shift) & 0xff] == n)
+            continue;       // the same byte in every key
+
+        std::size_t offset = 0;
+        for (int d = 0; d < 256; ++d)
+        {
+            std::size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            scratch[count[(items[i].key >> shift) & 0xff]++] = items[i];
+        items.swap(scratch);
+    }
+}
+
+DrawStateChanges count_state_changes(const std::vector<DrawPacket>& packets, const std::vector<uint32_t>& order)
+{
+    DrawStateChanges changes;
+    const DrawPacket* last = NULL;
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        const DrawPacket& packet = packets[order[i]];
+        changes.program += (last == NULL || packet.program != last->program);
+        changes.material += (last == NULL || packet.material_slot != last->material_slot);
+        changes.vertex_array += (last == NULL || packet.vertex_array != last->vertex_array);
+        changes.object += (last == NULL || packet.object != last->object);
+        last = &packet;
+    }
+    return changes;
+}
+
+void RenderQueue::clear()
+{
+    packets_.clear();
+    order_.clear();
+}
+
+void RenderQueue::sort()
+{
+    order_.resize(packets_.size());
+    for (std::size_t i = 0; i < order_.size(); ++i)
+        order_[i] = (uint32_t) i;
+    emitted_changes_ = count_state_changes(packets_, order_);
+
+    if (is_sorted)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        items_.resize(packets_.size());
+        for (std::size_t i = 0; i < packets_.size(); ++i)
+        {
+            items_[i].key = make_sort_key(packets_[i], sort_order);
+            items_[i].index = (uint32_t) i;
+        }
+        radix_sort(items_, scratch_);
+        for (std::size_t i = 0; i < items_.size(); ++i)
+            order_[i] = items_[i].index;
+
+        sort_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    else
+    {
+        sort_ms_ = 0.0;
+    }
+    submitted_changes_ = count_state_changes(packets_, order_);
+}
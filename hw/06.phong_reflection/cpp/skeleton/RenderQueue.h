@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "ShadingType.h"
+#include "Material.h"
+#include "Mesh.h"
+
+// what the fields of a sort key are ordered by (program is always first: it is the
+// most expensive switch, and a frame has only one or two)
+enum RenderSortOrder
+{
+    kSortByState,           // program, material, mesh, depth: fewest state changes
+    kSortFrontToBack        // program, depth, material, mesh: nearest first for early-Z
+};
+
+// one draw: a mesh with the draw list, material and object uniforms it is drawn with
+struct DrawPacket
+{
+    const Mesh*         mesh = NULL;
+    const MeshDrawList* draw_list = NULL;
+    const Material*     material = NULL;        // sent as uniforms without uniform blocks
+    ShadingType         shading_type = kSmooth;
+    GLuint              vertex_array = 0;       // mesh->vertex_array(shading_type)
+    uint32_t            program = 0;            // an index the caller picks (e.g. of the shader program), < 16
+    uint32_t            object = 0;             // of the object uniforms (one per model)
+    uint32_t            material_slot = 0;      // of the UniformBlocks (the same for the same material)
+    float               depth = 0.0f;           // view distance (negative or NaN: 0)
+};
+
+// 64-bit key of a packet: program 4 bits, material 16 bits, mesh 20 bits (the VAO name) and
+// depth 24 bits (the upper bits of the float), in the order of sort_order
+uint64_t make_sort_key(const DrawPacket& packet, RenderSortOrder sort_order);
+
+// sorts items by key (stable; least significant byte first, the bytes all keys share are skipped)
+struct SortItem
+{
+    uint64_t    key;
+    uint32_t    index;
+};
+void radix_sort(std::vector<SortItem>& items, std::vector<SortItem>& scratch);
+
+// changes between consecutive packets of a submission order (the first packet sets all)
+struct DrawStateChanges
+{
+    std::size_t program = 0;
+    std::size_t material = 0;
+    std::size_t vertex_array = 0;
+    std::size_t object = 0;
+
+    std::size_t total() const   { return program + material + vertex_array + object; }
+};
+
+// the draws of one frame: the models add their packets, sort() puts them in key order and
+// the caller submits packets() in order(). no GL calls: the submission binds what a packet needs
+class RenderQueue
+{
+public:
+    // every draw of the viewer is opaque, so nearest first by default: the GPU skips the
+    // fragments behind what is already drawn. kSortByState trades that for fewer changes
+    RenderSortOrder sort_order = kSortFrontToBack;
+    bool            is_sorted = true;       // false: order() is the order the packets were added in
+
+public:
+    void clear();
+    void add(const DrawPacket& packet)      { packets_.push_back(packet); }
+
+    // order() by the keys; counts the state changes of the order the packets were added in
+    // and of order()
+    void sort();
+
+    const std::vector<DrawPacket>& packets() const  { return packets_; }
+    const std::vector<uint32_t>& order() const      { return order_; }
+
+    const DrawStateChanges& emitted_changes() const     { return emitted_changes_; }
+    const DrawStateChanges& submitted_changes() const   { return submitted_changes_; }
+    double sort_ms() const                              { return sort_ms_; }
+
+private:
+    std::vector<DrawPacket> packets_;
+    std::vector<uint32_t>   order_;
+    std::vector<SortItem>   items_;         // scratch of sort()
+    std::vector<SortItem>   scratch_;
+
+    DrawStateChanges    emitted_changes_;
+    DrawStateChanges    submitted_changes_;
+    double              sort_ms_ = 0.0;     // key building and the radix sort
+};
+
+// the state changes of submitting packets in order
+DrawStateChanges count_state_changes(const std::vector<DrawPacket>& packets, const std::vector<uint32_t>& order);
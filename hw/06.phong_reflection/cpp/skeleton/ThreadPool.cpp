@@ -0,0 +1,48 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+{
+    num_threads = num_worker_threads(num_threads);
+    threads_.reserve(num_threads);
+    for (unsigned int i = 0; i < num_threads; ++i)
+        threads_.push_back(std::thread(&ThreadPool::run_, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_stopping_ = true;
+    }
+    job_added_.notify_all();
+
+    for (std::size_t i = 0; i < threads_.size(); ++i)
+        threads_[i].join();
+}
+
+void ThreadPool::push_(const std::function<void()>& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(job);
+    }
+    job_added_.notify_one();
+}
+
+void ThreadPool::run_()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_added_.wait(lock, [this]() { return is_stopping_ || !jobs_.empty(); });
+            if (jobs_.empty())
+                return;     // stopping and nothing left
+
+            job = jobs_.front();
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Parallel.h"
+
+// fixed set of worker threads running submitted jobs in FIFO order.
+// unlike parallel_for() the threads outlive a single call, so long independent jobs
+// (e.g. importing one model each) overlap and the caller only waits for their futures.
+class ThreadPool
+{
+public:
+    // num_threads = 0: as many as the hardware supports
+    explicit ThreadPool(unsigned int num_threads = 0);
+    ~ThreadPool();      // finishes the queued jobs, then joins
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // run func() on a worker; the future gets its result (or its exception)
+    template <typename Func>
+    std::future<typename std::result_of<Func()>::type> submit(Func func)
+    {
+        typedef typename std::result_of<Func()>::type Result;
+        std::shared_ptr<std::packaged_task<Result()> > task = std::make_shared<std::packaged_task<Result()> >(func);
+        std::future<Result> future = task->get_future();
+        push_([task]() { (*task)(); });
+        return future;
+    }
+
+    std::size_t num_threads() const     { return threads_.size(); }
+
+private:
+    void push_(const std::function<void()>& job);
+    void run_();
+
+    std::vector<std::thread>            threads_;
+    std::deque<std::function<void()> >  jobs_;
+    std::mutex                          mutex_;
+    std::condition_variable             job_added_;
+    bool                                is_stopping_ = false;
+};
@@ -0,0 +1,188 @@
+#include "UniformBlocks.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void ObjectUniforms::set(const glm::mat4& _PVM, const glm::mat4& _model_matrix, const glm::mat3& _normal_matrix, bool _oct_normal)
+{
+    PVM = _PVM;
+    model_matrix = _model_matrix;
+    for (int c = 0; c < 3; ++c)
+        normal_matrix[c] = glm::vec4(_normal_matrix[c], 0.0f);
+    oct_normal = _oct_normal;
+}
+
+glm::mat3 ObjectUniforms::get_normal_matrix() const
+{
+    glm::mat3 mat;
+    for (int c = 0; c < 3; ++c)
+        mat[c] = glm::vec3(normal_matrix[c]);
+    return mat;
+}
+
+MaterialUniforms::MaterialUniforms(const Material& material)
+    : ambient(material.ambient), diffuse(material.diffuse), specular(material.specular), shininess(material.shininess)
+{
+}
+
+static std::size_t align_up(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// the block of program named name to binding; false if it is missing or larger than size
+static bool bind_block(GLuint program, const char* name, GLuint binding, std::size_t size)
+{
+    GLuint index = glGetUniformBlockIndex(program, name);
+    if (index == GL_INVALID_INDEX)
+    {
+        std::cout << "uniform block " << name << " is missing" << std::endl;
+        return false;
+    }
+
+    GLint data_size = 0;
+    glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+    if ((std::size_t) data_size > size)
+    {
+        std::cout << "uniform block " << name << ": " << data_size << " bytes, expected " << size << std::endl;
+        return false;
+    }
+
+    glUniformBlockBinding(program, index, binding);
+    return true;
+}
+
+UniformBlocks::~UniformBlocks()
+{
+    release();
+}
+
+bool UniformBlocks::is_supported()
+{
+    return GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object;
+}
+
+bool UniformBlocks::init(GLuint program, GLStateCache& state)
+{
+    release();
+    state_ = &state;
+
+    if (!bind_block(program, "FrameBlock", kFrameBlockBinding, sizeof(FrameUniforms))
+        || !bind_block(program, "ObjectBlock", kObjectBlockBinding, sizeof(ObjectUniforms))
+        || !bind_block(program, "MaterialBlock", kMaterialBlockBinding, sizeof(MaterialUniforms)))
+        return false;
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    offset_alignment_ = (alignment > 0) ? (std::size_t) alignment : 256;
+    object_stride_ = align_up(sizeof(ObjectUniforms), offset_alignment_);
+    material_stride_ = align_up(sizeof(MaterialUniforms), offset_alignment_);
+
+    glGenBuffers(1, &frame_buffer_);
+    glGenBuffers(1, &object_buffer_);
+    glGenBuffers(1, &material_buffer_);
+
+    // the frame block never moves: bound once
+    state_->bind_buffer(GL_UNIFORM_BUFFER, frame_buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+    state_->bind_buffer_base(GL_UNIFORM_BUFFER, kFrameBlockBinding, frame_buffer_);
+
+    // the materials added before (a program linked again) keep their slots
+    material_capacity_ = 0;
+    if (!materials_.empty())
+        upload_materials_();
+    return true;
+}
+
+bool UniformBlocks::attach(GLuint program)
+{
+    return bind_block(program, "FrameBlock", kFrameBlockBinding, sizeof(FrameUniforms))
+        && bind_block(program, "MaterialBlock", kMaterialBlockBinding, sizeof(MaterialUniforms));
+}
+
+void UniformBlocks::release()
+{
+    if (frame_buffer_ == 0)
+        return;
+
+    GLuint buffers[3] = { frame_buffer_, object_buffer_, material_buffer_ };
+    glDeleteBuffers(3, buffers);
+    frame_buffer_ = object_buffer_ = material_buffer_ = 0;
+    object_capacity_ = 0;
+    material_capacity_ = 0;
+    state_->invalidate();   // the names may come back for other buffers
+}
+
+void UniformBlocks::set_frame(const FrameUniforms& frame)
+{
+    state_->bind_buffer(GL_UNIFORM_BUFFER, frame_buffer_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+}
+
+void UniformBlocks::upload_objects(const std::vector<ObjectUniforms>& objects)
+{
+    std::size_t size = objects.size() * object_stride_;
+    if (size == 0)
+        return;
+
+    object_data_.resize(size);
+    for (std::size_t i = 0; i < objects.size(); ++i)
+        memcpy(&object_data_[i * object_stride_], &objects[i], sizeof(ObjectUniforms));
+
+    // orphan the storage of the last frame (it may still be read by its draws)
+    object_capacity_ = std::max(object_capacity_, size);
+    state_->bind_buffer(GL_UNIFORM_BUFFER, object_buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, object_capacity_, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, object_data_.data());
+}
+
+void UniformBlocks::bind_object(std::size_t i)
+{
+    state_->bind_buffer_range(GL_UNIFORM_BUFFER, kObjectBlockBinding, object_buffer_, i * object_stride_, sizeof(ObjectUniforms));
+}
+
+unsigned int UniformBlocks::add_material(const Material& material)
+{
+    unsigned int slot = (unsigned int) materials_.size();
+    materials_.push_back(MaterialUniforms(material));
+    if (!is_ready())
+        return slot;
+
+    if (materials_.size() > material_capacity_)
+    {
+        upload_materials_();
+    }
+    else
+    {
+        state_->bind_buffer(GL_UNIFORM_BUFFER, material_buffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, slot * material_stride_, sizeof(MaterialUniforms), &materials_[slot]);
+    }
+    return slot;
+}
+
+void UniformBlocks::bind_material(unsigned int slot, const Material& material)
+{
+    // an edit (the material window) changes the Material, not the slot
+    MaterialUniforms uniforms(material);
+    if (memcmp(&uniforms, &materials_[slot], sizeof(MaterialUniforms)) != 0)
+    {
+        materials_[slot] = uniforms;
+        state_->bind_buffer(GL_UNIFORM_BUFFER, material_buffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, slot * material_stride_, sizeof(MaterialUniforms), &uniforms);
+    }
+
+    state_->bind_buffer_range(GL_UNIFORM_BUFFER, kMaterialBlockBinding, material_buffer_, slot * material_stride_, sizeof(MaterialUniforms));
+}
+
+void UniformBlocks::upload_materials_()
+{
+    // a new store twice the size: the slots are all written again, once per doubling
+    material_capacity_ = std::max(materials_.size(), 2 * material_capacity_);
+    std::vector<unsigned char> data(material_capacity_ * material_stride_, 0);
+    for (std::size_t i = 0; i < materials_.size(); ++i)
+        memcpy(&data[i * material_stride_], &materials_[i], sizeof(MaterialUniforms));
+
+    state_->bind_buffer(GL_UNIFORM_BUFFER, material_buffer_);
+    glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+}
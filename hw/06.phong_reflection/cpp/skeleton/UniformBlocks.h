@@ -0,0 +1,118 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "GLStateCache.h"
+#include "Material.h"
+
+// binding points of the uniform blocks of shader/vertex_ubo.glsl
+enum UniformBlockBinding
+{
+    kFrameBlockBinding = 0,
+    kObjectBlockBinding = 1,
+    kMaterialBlockBinding = 2
+};
+
+// the blocks as std140 lays them out: a vec3 takes 16 bytes unless a float follows it,
+// a mat3 is three vec4 columns and a bool is 4 bytes
+
+// FrameBlock: camera and light, once per frame
+struct FrameUniforms
+{
+    glm::mat4   view_matrix;
+    glm::vec3   camera_position;    float pad0 = 0.0f;
+    glm::vec3   light_position;     float pad1 = 0.0f;
+    glm::vec3   light_ambient;      float pad2 = 0.0f;
+    glm::vec3   light_diffuse;      float pad3 = 0.0f;
+    glm::vec3   light_specular;     float pad4 = 0.0f;
+};
+
+// ObjectBlock: the matrices of one model
+struct ObjectUniforms
+{
+    glm::mat4   PVM;
+    glm::mat4   model_matrix;
+    glm::vec4   normal_matrix[3];   // mat3 columns
+    int32_t     oct_normal = 0;
+    int32_t     pad[3] = { 0, 0, 0 };
+
+    void set(const glm::mat4& _PVM, const glm::mat4& _model_matrix, const glm::mat3& _normal_matrix, bool _oct_normal);
+    glm::mat3 get_normal_matrix() const;
+};
+
+// MaterialBlock
+struct MaterialUniforms
+{
+    glm::vec3   ambient;            float pad0 = 0.0f;
+    glm::vec3   diffuse;            float pad1 = 0.0f;
+    glm::vec3   specular;
+    float       shininess = 0.0f;
+
+    MaterialUniforms() {}
+    explicit MaterialUniforms(const Material& material);
+};
+
+static_assert(sizeof(FrameUniforms) == 144, "FrameUniforms must match the std140 FrameBlock");
+static_assert(sizeof(ObjectUniforms) == 192, "ObjectUniforms must match the std140 ObjectBlock");
+static_assert(sizeof(MaterialUniforms) == 48, "MaterialUniforms must match the std140 MaterialBlock");
+
+// the uniforms of the GLSL 1.40 shaders in three buffers, so a draw switches them with a
+// glBindBufferRange() or two instead of a glUniform*() per value:
+//   frame     one glBufferSubData() per frame
+//   objects   the blocks of every model of the frame in one buffer (one upload), a range per model
+//   materials uploaded once (again only when edited), a range per material
+// the binds go through the GLStateCache of init(), which drops the repeated ones.
+// GL thread only. needs GL 3.1 or ARB_uniform_buffer_object
+class UniformBlocks
+{
+public:
+    UniformBlocks() {}
+    ~UniformBlocks();   // deletes the buffers (GL thread)
+
+    UniformBlocks(const UniformBlocks&) = delete;
+    UniformBlocks& operator=(const UniformBlocks&) = delete;
+
+    static bool is_supported();
+
+    // assign the blocks of program to their binding points and create the buffers;
+    // false if program lacks one of the blocks (or its size differs from the structs)
+    bool init(GLuint program, GLStateCache& state);
+    void release();
+    bool is_ready() const                   { return frame_buffer_ != 0; }
+
+    // another program that reads the frame and material blocks (and no object block), e.g.
+    // shader/vertex_instanced.glsl; false if it lacks one of them
+    static bool attach(GLuint program);
+
+    void set_frame(const FrameUniforms& frame);
+
+    // all objects of the frame at once; bind_object(i) then selects objects[i]
+    void upload_objects(const std::vector<ObjectUniforms>& objects);
+    void bind_object(std::size_t i);
+
+    // a slot of its own for a material (slots are never reused: a scene has few materials)
+    unsigned int add_material(const Material& material);
+    // bind slot, first uploading material if it differs from what the slot holds (an edit)
+    void bind_material(unsigned int slot, const Material& material);
+    std::size_t num_materials() const       { return materials_.size(); }
+
+private:
+    void upload_materials_();
+
+    GLStateCache* state_ = NULL;
+    GLuint  frame_buffer_ = 0;
+    GLuint  object_buffer_ = 0;
+    GLuint  material_buffer_ = 0;
+
+    std::size_t offset_alignment_ = 256;    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    std::size_t object_stride_ = 0;         // sizeof(ObjectUniforms) rounded up to offset_alignment_
+    std::size_t material_stride_ = 0;
+
+    std::vector<unsigned char>      object_data_;       // staging of upload_objects()
+    std::size_t                     object_capacity_ = 0;   // bytes of object_buffer_
+    std::vector<MaterialUniforms>   materials_;         // what each slot holds
+    std::size_t                     material_capacity_ = 0; // slots in material_buffer_
+};
@@ -0,0 +1,205 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static GLsizei gl_type_size(GLenum type)
+{
+    switch (type)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:  return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT: return 2;
+    default:                return 4;
+    }
+}
+
+static float oct_sign(float v)
+{
+    return (v >= 0.0f) ? 1.0f : -1.0f;
+}
+
+glm::vec2 oct_encode(const glm::vec3& n, int bits)
+{
+    // project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half
+    // (a zero normal, e.g. of a vertex with only zero-area triangles, becomes +z)
+    float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    glm::vec3 p = (l1 > 0.0f) ? n / l1 : glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec2 e(p.x, p.y);
+    if (p.z < 0.0f)
+        e = glm::vec2((1.0f - std::fabs(p.y)) * oct_sign(p.x), (1.0f - std::fabs(p.x)) * oct_sign(p.y));
+    e = e * 0.5f + 0.5f;
+
+    // rounding each component separately is not always the closest direction
+    float scale = (float) ((1 << bits) - 1);
+    glm::vec2 base(std::floor(e.x * scale), std::floor(e.y * scale));
+    glm::vec2 best = e;
+    float best_dot = -2.0f;
+    for (int k = 0; k < 4; ++k)
+    {
+        glm::vec2 candidate = glm::min(base + glm::vec2((float) (k & 1), (float) (k >> 1)), glm::vec2(scale)) / scale;
+        float d = glm::dot(oct_decode(candidate), n);
+        if (d > best_dot)
+        {
+            best_dot = d;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+glm::vec3 oct_decode(const glm::vec2& e)
+{
+    glm::vec2 f = e * 2.0f - 1.0f;
+    glm::vec3 n(f.x, f.y, 1.0f - std::fabs(f.x) - std::fabs(f.y));
+    if (n.z < 0.0f)
+    {
+        float x = (1.0f - std::fabs(n.y)) * oct_sign(n.x);
+        float y = (1.0f - std::fabs(n.x)) * oct_sign(n.y);
+        n.x = x;
+        n.y = y;
+    }
+    return glm::normalize(n);
+}
+
+VertexFormat VertexFormat::from_aimesh(const aiMesh* _pmesh, VertexPrecision precision)
+{
+    return from_attribs(_pmesh->HasVertexColors(0), _pmesh->HasTextureCoords(0), precision);
+}
+
+VertexFormat VertexFormat::from_attribs(bool has_colors, bool has_texcoords, VertexPrecision precision)
+{
+    VertexFormat format;
+
+    // normals are always there (computed from the faces if the mesh has none)
+    if (precision == kVertexFloat)
+    {
+        format.add(kAttribPosition, 3, GL_FLOAT);
+        format.add(kAttribNormal, 3, GL_FLOAT);
+        if (has_colors)
+            format.add(kAttribColor, 4, GL_FLOAT);
+    }
+    else
+    {
+        // position in [0, 1]^3 of the AABB, octahedral normal in [0, 1]^2
+        format.add(kAttribPosition, 3, GL_UNSIGNED_SHORT, GL_TRUE);
+        format.add(kAttribNormal, 2, (precision == kVertexQuantized16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE, GL_TRUE);
+        if (has_colors)
+            format.add(kAttribColor, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+    }
+    if (has_texcoords)
+        format.add(kAttribTexcoord, 2, GL_FLOAT);
+
+    return format;
+}
+
+void VertexFormat::bind_attrib_locations(GLuint program)
+{
+    glBindAttribLocation(program, kAttribPosition, "a_position");
+    glBindAttribLocation(program, kAttribNormal, "a_normal");
+    glBindAttribLocation(program, kAttribColor, "a_color");
+    glBindAttribLocation(program, kAttribTexcoord, "a_texcoord");
+    glBindAttribLocation(program, kAttribInstanceModel, "a_instance_model");
+    glBindAttribLocation(program, kAttribInstanceNormal, "a_instance_normal");
+    glBindAttribLocation(program, kAttribDrawData, "a_draw_data");
+}
+
+bool VertexFormat::operator==(const VertexFormat& other) const
+{
+    if (stride_ != other.stride_)
+        return false;
+    for (int i = 0; i < kNumVertexAttribs; ++i)
+    {
+        const Element& a = elements_[i];
+        const Element& b = other.elements_[i];
+        if (a.enabled != b.enabled)
+            return false;
+        if (a.enabled && (a.size != b.size || a.type != b.type || a.normalized != b.normalized || a.offset != b.offset))
+            return false;
+    }
+    return true;
+}
+
+void VertexFormat::add(VertexAttrib attrib, GLint size, GLenum type, GLboolean normalized)
+{
+    Element& element = elements_[attrib];
+
+    // align each attribute to its component size (so a 6-byte position can share
+    // 4 bytes with a 2-byte normal), and the whole vertex to 4 bytes
+    GLsizei type_size = gl_type_size(type);
+
+    element.enabled = true;
+    element.size = size;
+    element.type = type;
+    element.normalized = normalized;
+    element.offset = (size_ + type_size - 1) / type_size * type_size;
+
+    size_ = element.offset + size * type_size;
+    stride_ = (size_ + 3) & ~3;
+}
+
+void VertexFormat::pack(VertexAttrib attrib, unsigned char* vertex, const float* values) const
+{
+    const Element& element = elements_[attrib];
+    unsigned char* dst = vertex + element.offset;
+
+    for (GLint i = 0; i < element.size; ++i)
+    {
+        float v = values[i];
+        if (element.type == GL_FLOAT)
+        {
+            memcpy(dst + 4*i, &v, 4);
+        }
+        else if (element.type == GL_UNSIGNED_SHORT)
+        {
+            unsigned short q = (unsigned short) (std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f);
+            memcpy(dst + 2*i, &q, 2);
+        }
+        else //if (element.type == GL_UNSIGNED_BYTE)
+        {
+            dst[i] = (unsigned char) (std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+void VertexFormat::unpack(VertexAttrib attrib, const unsigned char* vertex, float* values) const
+{
+    const Element& element = elements_[attrib];
+    const unsigned char* src = vertex + element.offset;
+
+    for (GLint i = 0; i < element.size; ++i)
+    {
+        if (element.type == GL_FLOAT)
+        {
+            memcpy(&values[i], src + 4*i, 4);
+        }
+        else if (element.type == GL_UNSIGNED_SHORT)
+        {
+            unsigned short q;
+            memcpy(&q, src + 2*i, 2);
+            values[i] = q / 65535.0f;
+        }
+        else //if (element.type == GL_UNSIGNED_BYTE)
+        {
+            values[i] = src[i] / 255.0f;
+        }
+    }
+}
+
+void VertexFormat::set_attrib_pointers(std::size_t base_offset) const
+{
+    for (int i = 0; i < kNumVertexAttribs; ++i)
+    {
+        const Element& element = elements_[i];
+        if (!element.enabled)
+        {
+            glDisableVertexAttribArray(i);
+            continue;
+        }
+
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i, element.size, element.type, element.normalized, stride_, (void*)(base_offset + element.offset));
+    }
+}
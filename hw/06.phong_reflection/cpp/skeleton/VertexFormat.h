@@ -0,0 +1,95 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <assimp/scene.h>
+
+// fixed attribute locations shared by every shader program and VAO
+// (bound with glBindAttribLocation() before linking a program)
+enum VertexAttrib
+{
+    kAttribPosition = 0,    // a_position
+    kAttribNormal,          // a_normal
+    kAttribColor,           // a_color
+    kAttribTexcoord,        // a_texcoord
+    kNumVertexAttribs
+};
+
+// per-instance attributes of shader/vertex_instanced.glsl (divisor 1, see InstancedModel.h),
+// after the vertex ones; a matrix takes a location per column
+enum InstanceAttrib
+{
+    kAttribInstanceModel = kNumVertexAttribs,           // a_instance_model (mat4)
+    kAttribInstanceNormal = kAttribInstanceModel + 4,   // a_instance_normal (mat3)
+    kAttribDrawData = kAttribInstanceNormal + 3,        // a_draw_data (uvec2) of shader/vertex_indirect.glsl (see IndirectDraw.h)
+    kNumInstanceAttribLocations = 8
+};
+
+// storage of the vertex attributes
+// kVertexFloat       : float position / normal / color (reference)
+// kVertexQuantized16 : 16-bit position relative to the AABB, 2 x 16-bit octahedral normal, RGBA8 color
+// kVertexQuantized8  : same, with a 2 x 8-bit octahedral normal
+enum VertexPrecision { kVertexFloat, kVertexQuantized16, kVertexQuantized8 };
+
+// decode error of a quantized vertex format against the float reference
+struct QuantizationError
+{
+    float   max_position = 0.0f;        // in model units
+    float   max_normal_degrees = 0.0f;
+    float   max_color = 0.0f;           // per channel
+};
+
+// octahedral normal encoding in [0, 1]^2 (decoded by decode_normal() in shader/vertex.glsl).
+// oct_encode() picks the best of the 4 neighboring grid points for unorm storage with the given bits.
+glm::vec2 oct_encode(const glm::vec3& n, int bits);
+glm::vec3 oct_decode(const glm::vec2& e);
+
+// interleaved vertex layout: which attributes a vertex has and where they are
+class VertexFormat
+{
+public:
+    struct Element
+    {
+        bool        enabled = false;
+        GLint       size = 0;           // #components
+        GLenum      type = GL_FLOAT;
+        GLboolean   normalized = GL_FALSE;
+        GLsizei     offset = 0;         // byte offset in a vertex
+    };
+
+public:
+    VertexFormat() {}
+
+    // layout for the attributes that _pmesh actually has
+    static VertexFormat from_aimesh(const aiMesh* _pmesh, VertexPrecision precision = kVertexFloat);
+    static VertexFormat from_attribs(bool has_colors, bool has_texcoords, VertexPrecision precision = kVertexFloat);
+
+    // bind a_position, a_normal, ... to kAttribPosition, kAttribNormal, ... (and the instance attributes)
+    static void bind_attrib_locations(GLuint program);
+
+    void add(VertexAttrib attrib, GLint size, GLenum type, GLboolean normalized = GL_FALSE);
+
+    bool has(VertexAttrib attrib) const                 { return elements_[attrib].enabled; }
+    const Element& element(VertexAttrib attrib) const   { return elements_[attrib]; }
+    GLsizei stride() const                              { return stride_; }
+
+    // the same attributes at the same offsets (vertices of one can share a buffer with the other's)
+    bool operator==(const VertexFormat& other) const;
+    bool operator!=(const VertexFormat& other) const    { return !(*this == other); }
+
+    // write / read attrib of one vertex as floats (normalized types in [0, 1] like GL reads them)
+    void pack(VertexAttrib attrib, unsigned char* vertex, const float* values) const;
+    void unpack(VertexAttrib attrib, const unsigned char* vertex, float* values) const;
+
+    // set glVertexAttribPointer() for the currently bound VAO & GL_ARRAY_BUFFER, with the
+    // vertices base_offset bytes into the buffer (a range of a MeshPool buffer)
+    void set_attrib_pointers(std::size_t base_offset = 0) const;
+
+private:
+    Element     elements_[kNumVertexAttribs];
+    GLsizei     size_ = 0;          // end of the last attribute
+    GLsizei     stride_ = 0;        // size_ rounded up to 4 bytes
+};
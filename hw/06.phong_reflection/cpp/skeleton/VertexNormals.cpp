@@ -0,0 +1,108 @@
+#include "VertexNormals.h"
+#include "Parallel.h"
+
+void compute_face_normals(const Vec3SoA& positions, const std::vector<unsigned int>& tv_indices, Vec3SoA& f_normals, unsigned int num_threads)
+{
+    const MeshKernels& kernels = mesh_kernels();
+
+    f_normals.resize(tv_indices.size() / 3);
+
+    parallel_for(0, f_normals.size(), [&](std::size_t b, std::size_t e) {
+        kernels.face_normals(&positions.x[0], &positions.y[0], &positions.z[0], &tv_indices[3*b], e - b,
+                             &f_normals.x[b], &f_normals.y[b], &f_normals.z[b]);
+    }, num_threads);
+}
+
+void compute_triangle_areas(const Vec3SoA& positions, const std::vector<unsigned int>& tv_indices, std::vector<float>& areas, unsigned int num_threads)
+{
+    const MeshKernels& kernels = mesh_kernels();
+
+    areas.resize(tv_indices.size() / 3);
+
+    parallel_for(0, areas.size(), [&](std::size_t b, std::size_t e) {
+        kernels.triangle_areas(&positions.x[0], &positions.y[0], &positions.z[0], &tv_indices[3*b], e - b, &areas[b]);
+    }, num_threads);
+}
+
+void compute_vertex_normals_serial(const Vec3SoA& f_normals, const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, Vec3SoA& v_normals)
+{
+    v_normals.clear();
+    v_normals.resize(num_vertices);
+    if (num_vertices == 0)
+        return;
+
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+    {
+        unsigned int v = tv_indices[i];
+        v_normals.x[v] += f_normals.x[i/3];
+        v_normals.y[v] += f_normals.y[i/3];
+        v_normals.z[v] += f_normals.z[i/3];
+    }
+
+    mesh_kernels().normalize(&v_normals.x[0], &v_normals.y[0], &v_normals.z[0], num_vertices);
+}
+
+void compute_vertex_normals(const Vec3SoA& f_normals, const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, Vec3SoA& v_normals, unsigned int num_threads)
+{
+    const std::size_t kMinCornersPerChunk = 1 << 16;
+
+    std::size_t num_corners = tv_indices.size();
+    std::size_t num_chunks = std::min<std::size_t>(num_worker_threads(num_threads), num_corners / kMinCornersPerChunk);
+    if (num_chunks <= 1 || num_vertices == 0)
+    {
+        compute_vertex_normals_serial(f_normals, tv_indices, num_vertices, v_normals);
+        return;
+    }
+
+    std::size_t corners_per_chunk = ((num_corners / 3 + num_chunks - 1) / num_chunks) * 3;
+    std::size_t vertices_per_owner = (num_vertices + num_chunks - 1) / num_chunks;
+
+    // 1) bucket the corners of each triangle chunk by the owner of their vertex
+    //    buckets[chunk * num_chunks + owner] = corner indices (in increasing order)
+    std::vector< std::vector<unsigned int> > buckets(num_chunks * num_chunks);
+
+    parallel_for(0, num_chunks, [&](std::size_t chunk_b, std::size_t chunk_e) {
+        for (std::size_t chunk = chunk_b; chunk < chunk_e; ++chunk)
+        {
+            std::size_t b = chunk * corners_per_chunk;
+            std::size_t e = std::min(num_corners, b + corners_per_chunk);
+
+            std::vector<unsigned int>* chunk_buckets = &buckets[chunk * num_chunks];
+            for (std::size_t owner = 0; owner < num_chunks; ++owner)
+                chunk_buckets[owner].reserve((e - b) / num_chunks + (e - b) / 8);
+
+            for (std::size_t i = b; i < e; ++i)
+                chunk_buckets[tv_indices[i] / vertices_per_owner].push_back((unsigned int) i);
+        }
+    }, num_chunks, 1);
+
+    // 2) each owner accumulates and normalizes its own vertices
+    const MeshKernels& kernels = mesh_kernels();
+    v_normals.resize(num_vertices);
+
+    parallel_for(0, num_chunks, [&](std::size_t owner_b, std::size_t owner_e) {
+        for (std::size_t owner = owner_b; owner < owner_e; ++owner)
+        {
+            std::size_t vb = owner * vertices_per_owner;
+            std::size_t ve = std::min(num_vertices, vb + vertices_per_owner);
+
+            for (std::size_t v = vb; v < ve; ++v)
+                v_normals.x[v] = v_normals.y[v] = v_normals.z[v] = 0.0f;
+
+            for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+            {
+                const std::vector<unsigned int>& bucket = buckets[chunk * num_chunks + owner];
+                for (std::size_t k = 0; k < bucket.size(); ++k)
+                {
+                    unsigned int v = tv_indices[bucket[k]];
+                    v_normals.x[v] += f_normals.x[bucket[k] / 3];
+                    v_normals.y[v] += f_normals.y[bucket[k] / 3];
+                    v_normals.z[v] += f_normals.z[bucket[k] / 3];
+                }
+            }
+
+            if (vb < ve)
+                kernels.normalize(&v_normals.x[vb], &v_normals.y[vb], &v_normals.z[vb], ve - vb);
+        }
+    }, num_chunks, 1);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <vector>
+
+#include "MeshKernels.h"
+
+// per-triangle unit normal (size = #triangles)
+void compute_face_normals(const Vec3SoA& positions, const std::vector<unsigned int>& tv_indices, Vec3SoA& f_normals, unsigned int num_threads = 0);
+
+// per-triangle area (size = #triangles)
+void compute_triangle_areas(const Vec3SoA& positions, const std::vector<unsigned int>& tv_indices, std::vector<float>& areas, unsigned int num_threads = 0);
+
+// per-vertex normal = normalize(sum of adjacent face normals)
+//   serial   : scatter each face normal to its 3 vertices (reference)
+//   parallel : triangles are split into contiguous chunks and vertices into contiguous owner ranges.
+//              each chunk buckets its corners by owner, then each owner sums its buckets chunk by chunk.
+//              a vertex is written by one thread only and its face normals are added in the same
+//              (increasing triangle) order as the serial scatter, so both are bit-for-bit identical.
+void compute_vertex_normals_serial(const Vec3SoA& f_normals, const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, Vec3SoA& v_normals);
+void compute_vertex_normals(const Vec3SoA& f_normals, const std::vector<unsigned int>& tv_indices, std::size_t num_vertices, Vec3SoA& v_normals, unsigned int num_threads = 0);
@@ -0,0 +1,142 @@
+#pragma once
+// helpers shared by the CPU-side benchmarks in this directory (no GL context needed)
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <assimp/cimport.h>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "../Model.h"
+#include "../MeshProcess.h"
+
+struct BenchMesh
+{
+    std::vector<glm::vec3>      positions;
+    std::vector<unsigned int>   tv_indices;     // size = 3 x #triangles
+
+    std::size_t num_triangles() const   { return tv_indices.size() / 3; }
+};
+
+class BenchTimer
+{
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// best of num_runs wall times of func() in ms
+template <typename Func>
+double bench_best_ms(Func func, int num_runs = 5)
+{
+    double best = 1.0e30;
+    for (int i = 0; i < num_runs; ++i)
+    {
+        BenchTimer timer;
+        func();
+        double ms = timer.elapsed_ms();
+        if (ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+// bitwise comparison (NaN == NaN, unlike operator==)
+inline bool is_bit_identical(const std::vector<float>& a, const std::vector<float>& b)
+{
+    return a.size() == b.size() && (a.empty() || memcmp(&a[0], &b[0], sizeof(float)*a.size()) == 0);
+}
+
+// the mesh passes of the viewer (init_scene() in main.cpp) for the import benchmarks
+const unsigned int kBenchProcessFlags = kMeshProcessVertexCache | kMeshProcessOverdraw | kMeshProcessMeshlets | kMeshProcessLods | kMeshProcessVertexFetch;
+
+// Model::import_model() with kBenchProcessFlags, always from the source (no .meshcache) and
+// with the pass stats dropped; the other settings of model are used as they are
+inline bool import_bench_model(const std::string& path, Model& model)
+{
+    model.use_mesh_cache = false;
+    std::ostringstream log;
+    return model.import_model(path, kBenchProcessFlags, log);
+}
+
+// all meshes of a file merged into one triangle mesh
+inline bool load_bench_mesh(const std::string& path, BenchMesh& mesh)
+{
+    const aiScene* scene = aiImportFile(path.c_str(), aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+    if (scene == NULL)
+    {
+        std::cout << "Failed to load " << path << std::endl;
+        return false;
+    }
+
+    mesh.positions.clear();
+    mesh.tv_indices.clear();
+    for (unsigned int m = 0; m < scene->mNumMeshes; ++m)
+    {
+        const aiMesh* ai_mesh = scene->mMeshes[m];
+        unsigned int base = (unsigned int) mesh.positions.size();
+
+        for (unsigned int v = 0; v < ai_mesh->mNumVertices; ++v)
+            mesh.positions.push_back(glm::vec3(ai_mesh->mVertices[v].x, ai_mesh->mVertices[v].y, ai_mesh->mVertices[v].z));
+
+        for (unsigned int f = 0; f < ai_mesh->mNumFaces; ++f)
+        {
+            const aiFace& face = ai_mesh->mFaces[f];
+            for (unsigned int idx = 0; idx + 2 < face.mNumIndices; ++idx)
+            {
+                mesh.tv_indices.push_back(base + face.mIndices[0]);
+                mesh.tv_indices.push_back(base + face.mIndices[idx+1]);
+                mesh.tv_indices.push_back(base + face.mIndices[idx+2]);
+            }
+        }
+    }
+    aiReleaseImport(scene);
+    return true;
+}
+
+// 1-to-4 midpoint subdivision (shared edges get one midpoint)
+inline BenchMesh subdivide_bench_mesh(const BenchMesh& in)
+{
+    BenchMesh out;
+    out.positions = in.positions;
+    out.tv_indices.reserve(in.tv_indices.size() * 4);
+
+    std::unordered_map<unsigned long long, unsigned int> midpoints;
+    midpoints.reserve(in.tv_indices.size());
+
+    auto midpoint = [&](unsigned int a, unsigned int b) -> unsigned int {
+        unsigned long long key = (a < b) ? ((unsigned long long) a << 32 | b) : ((unsigned long long) b << 32 | a);
+        std::unordered_map<unsigned long long, unsigned int>::iterator it = midpoints.find(key);
+        if (it != midpoints.end())
+            return it->second;
+
+        unsigned int m = (unsigned int) out.positions.size();
+        out.positions.push_back(0.5f * (out.positions[a] + out.positions[b]));
+        midpoints[key] = m;
+        return m;
+    };
+
+    for (std::size_t i = 0; i < in.tv_indices.size(); i += 3)
+    {
+        unsigned int a = in.tv_indices[i], b = in.tv_indices[i+1], c = in.tv_indices[i+2];
+        unsigned int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+
+        unsigned int tris[12] = { a, ab, ca,   ab, b, bc,   ca, bc, c,   ab, bc, ca };
+        out.tv_indices.insert(out.tv_indices.end(), tris, tris + 12);
+    }
+    return out;
+}
@@ -0,0 +1,103 @@
+// a scene with --copies copies of one model (the bunny by default): memory of importing each copy
+// on its own vs. Models sharing the ModelAsset that AssetRegistry hands out for their key.
+// the unshared cost is measured on --imports separate imports and scaled up. no GL context:
+// the assets are imported but not uploaded, so only the CPU side of the meshes is counted.
+//
+//   make bench
+//   ./bench_asset_registry [--copies 1000] [--imports 10] [model]
+#include <cstdlib>
+#include <iomanip>
+#include <map>
+
+#include "BenchUtil.h"
+#include "../AssetRegistry.h"
+#include "../ProcessMemory.h"
+
+int main(int argc, char* argv[])
+{
+    int num_copies = 1000;
+    int num_imports = 10;
+    std::string path = "models/bunny.ply";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--copies" && i + 1 < argc)
+            num_copies = std::max(1, atoi(argv[++i]));
+        else if (arg == "--imports" && i + 1 < argc)
+            num_imports = std::max(1, atoi(argv[++i]));
+        else
+            path = arg;
+    }
+
+    const double kMB = 1.0 / (1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(2);
+
+    // shared: one import, then a handle per copy (first, so the import is measured on a fresh heap)
+    AssetRegistry registry;
+    Model settings;
+    AssetSourceKey source_key;
+    if (!AssetRegistry::make_source_key(path, kBenchProcessFlags, settings, source_key))
+    {
+        std::cout << path << ": cannot read" << std::endl;
+        return 1;
+    }
+
+    std::size_t rss_before = resident_set_bytes();
+    std::vector<Model> models;
+    models.reserve(num_copies);
+    models.push_back(settings);
+    MeshCacheKey cache_key;
+    if (!import_bench_model(path, models[0]) || !models[0].source_key(cache_key))
+    {
+        std::cout << path << ": import failed" << std::endl;
+        return 1;
+    }
+    AssetKey key = AssetRegistry::make_key(cache_key);
+    registry.insert(key, models[0].asset());
+    std::map<AssetSourceKey, AssetKey> sources;     // AssetLoader keeps the slot instead
+    sources[source_key] = key;
+    std::size_t rss_first = resident_set_bytes();
+
+    BenchTimer timer;
+    for (int i = 1; i < num_copies; ++i)
+    {
+        // what AssetLoader::add() does for a file it has seen: a source key (a stat()), a lookup
+        AssetSourceKey copy_key;
+        AssetRegistry::make_source_key(path, kBenchProcessFlags, settings, copy_key);
+
+        Model model = settings;
+        model.set_asset(registry.find(sources[copy_key]));
+        model.set_translate(glm::vec3((float) (i % 32), 0.0f, (float) (i / 32)));
+        models.push_back(model);
+    }
+    double copies_ms = timer.elapsed_ms();
+    std::size_t rss_all = resident_set_bytes();
+
+    // unshared: every copy imports its own meshes
+    std::vector<Model> imported(num_imports);
+    for (int i = 0; i < num_imports; ++i)
+    {
+        if (!import_bench_model(path, imported[i]))
+        {
+            std::cout << path << ": import failed" << std::endl;
+            return 1;
+        }
+    }
+    double unshared_per_copy = ((double) resident_set_bytes() - rss_all) / num_imports;
+    imported.clear();
+
+    bool is_shared = registry.num_assets() == 1 && models[0].num_asset_owners() == num_copies;
+    for (std::size_t i = 1; i < models.size(); ++i)
+        is_shared = is_shared && models[i].asset() == models[0].asset();
+
+    double shared_per_copy = ((double) rss_all - rss_first) / (num_copies - 1 > 0 ? num_copies - 1 : 1);
+    std::cout << path << ", " << num_copies << " copies" << std::endl
+              << "  unshared (each copy imported)   " << std::setw(10) << unshared_per_copy * kMB << " MB / copy, "
+              << std::setw(10) << unshared_per_copy * num_copies * kMB << " MB in all (scaled from " << num_imports << " imports)" << std::endl
+              << "  shared (AssetRegistry handles)  " << std::setw(10) << shared_per_copy / 1024.0 << " KB / copy, "
+              << std::setw(10) << ((double) rss_all - rss_before) * kMB << " MB in all (first import "
+              << ((double) rss_first - rss_before) * kMB << " MB)" << std::endl
+              << "  " << num_copies - 1 << " handles in " << copies_ms << " ms; "
+              << registry.num_assets() << " asset, " << models[0].num_asset_owners() << " owners: " << (is_shared ? "shared" : "NOT SHARED") << std::endl;
+    return is_shared ? 0 : 1;
+}
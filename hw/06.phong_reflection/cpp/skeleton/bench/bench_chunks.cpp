@@ -0,0 +1,164 @@
+// build_chunk_file() on a synthetic height-field "scan" of about --synthetic-mb MB (binary PLY,
+// x y z nx ny nz + uchar RGB): build time and the peak resident memory against the source size,
+// then every chunk read back one at a time through ChunkFileReader as ChunkedModel pages them in.
+// the chunks must hold the triangles of the source, each once.
+//
+//   make bench
+//   ./bench_chunks [--synthetic-mb 512] [--chunk-triangles 262144] [--tmp-dir /tmp] [model.ply]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../ChunkFile.h"
+#include "../MappedFile.h"
+#include "../ProcessMemory.h"
+
+// n x n height field, binary_little_endian (the host order of every machine this runs on)
+static bool write_scan(const std::string& path, int n)
+{
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (fp == NULL)
+        return false;
+
+    fprintf(fp, "ply\nformat binary_little_endian 1.0\ncomment synthetic scan (bench_chunks)\n");
+    fprintf(fp, "element vertex %d\n", n * n);
+    fprintf(fp, "property float x\nproperty float y\nproperty float z\n");
+    fprintf(fp, "property float nx\nproperty float ny\nproperty float nz\n");
+    fprintf(fp, "property uchar red\nproperty uchar green\nproperty uchar blue\n");
+    fprintf(fp, "element face %d\nproperty list uchar int vertex_indices\nend_header\n", 2 * (n - 1) * (n - 1));
+
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            float u = (float) i / (n - 1), v = (float) j / (n - 1);
+            float h = 0.05f * std::sin(25.0f * u) * std::cos(19.0f * v);
+            float values[6] = { u - 0.5f, v - 0.5f, h, 0.0f, 0.0f, 1.0f };
+            unsigned char color[3] = { (unsigned char) (255 * u), (unsigned char) (255 * v), (unsigned char) (128 + 1000 * h) };
+            fwrite(values, sizeof(float), 6, fp);
+            fwrite(color, 1, 3, fp);
+        }
+    }
+    for (int j = 0; j + 1 < n; ++j)
+    {
+        for (int i = 0; i + 1 < n; ++i)
+        {
+            int v0 = j * n + i;
+            unsigned char count = 3;
+            int triangles[2][3] = { { v0, v0 + 1, v0 + n + 1 }, { v0, v0 + n + 1, v0 + n } };
+            for (int t = 0; t < 2; ++t)
+            {
+                fwrite(&count, 1, 1, fp);
+                fwrite(triangles[t], sizeof(int), 3, fp);
+            }
+        }
+    }
+    return fclose(fp) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int synthetic_mb = 512;
+    std::string tmp_dir = "/tmp";
+    std::string path;
+    ChunkBuildOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--synthetic-mb" && i + 1 < argc)
+            synthetic_mb = std::max(1, atoi(argv[++i]));
+        else if (arg == "--chunk-triangles" && i + 1 < argc)
+            options.chunk_triangles = std::max(1, atoi(argv[++i]));
+        else if (arg == "--tmp-dir" && i + 1 < argc)
+            tmp_dir = argv[++i];
+        else
+            path = arg;
+    }
+
+    const double kMB = 1.0 / (1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(1);
+
+    bool is_synthetic = path.empty();
+    if (is_synthetic)
+    {
+        // 27 bytes per vertex + 2 x 13 bytes per triangle
+        int n = (int) std::sqrt(synthetic_mb * 1024.0 * 1024.0 / 53.0);
+        path = tmp_dir + "/bench_chunks_scan.ply";
+        if (!write_scan(path, n))
+        {
+            std::cout << "cannot write " << path << std::endl;
+            return 1;
+        }
+    }
+    uint64_t source_size;
+    int64_t mtime;
+    if (!stat_file(path, source_size, mtime))
+    {
+        std::cout << "cannot read " << path << std::endl;
+        return 1;
+    }
+
+    // build: the peak is what the builder holds, not the size of the mesh
+    std::string chunk_path = path + ".chunks";
+    bool has_peak = reset_peak_resident_set();
+    std::size_t base = resident_set_bytes();
+    std::string error;
+    BenchTimer build_timer;
+    if (!build_chunk_file(path, chunk_path, options, std::cout, &error))
+    {
+        std::cout << error << std::endl;
+        return 1;
+    }
+    double build_ms = build_timer.elapsed_ms();
+    double build_peak_mb = ((double) peak_resident_set_bytes() - base) * kMB;
+
+    ChunkFileKey key;
+    ChunkFileReader reader;
+    if (!make_chunk_file_key(path, options, key) || !reader.open(chunk_path, key))
+    {
+        std::cout << "cannot read " << chunk_path << std::endl;
+        return 1;
+    }
+
+    // read back: one chunk resident at a time
+    has_peak = reset_peak_resident_set() && has_peak;
+    base = resident_set_bytes();
+    uint64_t num_triangles = 0, bytes = 0;
+    uint32_t min_triangles = UINT32_MAX, max_triangles = 0;
+    BenchTimer read_timer;
+    for (std::size_t i = 0; i < reader.num_chunks(); ++i)
+    {
+        MeshArrays arrays;
+        if (!reader.read_chunk(i, arrays))
+        {
+            std::cout << "chunk " << i << ": read failed" << std::endl;
+            return 1;
+        }
+        const ChunkRecord& record = reader.record(i);
+        num_triangles += record.num_triangles;
+        bytes += record.size;
+        min_triangles = std::min(min_triangles, record.num_triangles);
+        max_triangles = std::max(max_triangles, record.num_triangles);
+    }
+    double read_ms = read_timer.elapsed_ms();
+    double read_peak_mb = ((double) peak_resident_set_bytes() - base) * kMB;
+
+    const ChunkFileHeader& header = reader.header();
+    bool is_complete = num_triangles == header.num_triangles;
+    std::cout << path << ": " << source_size * kMB << " MB, " << header.num_triangles << " triangles" << std::endl
+              << "  build   " << std::setw(10) << build_ms << " ms  " << std::setw(8) << source_size * kMB / (build_ms * 1.0e-3) << " MB/s"
+              << "  peak +" << (has_peak ? std::to_string((int) build_peak_mb) : std::string("n/a")) << " MB" << std::endl
+              << "  read    " << std::setw(10) << read_ms << " ms  " << std::setw(8) << bytes * kMB / (read_ms * 1.0e-3) << " MB/s"
+              << "  peak +" << (has_peak ? std::to_string((int) read_peak_mb) : std::string("n/a")) << " MB" << std::endl
+              << "  " << reader.num_chunks() << " chunks, triangles per chunk " << min_triangles << " .. " << max_triangles
+              << ", " << header.num_vertices << " vertices (with the ones on chunk borders)" << std::endl
+              << "  triangles " << (is_complete ? "complete" : "MISSING") << std::endl;
+
+    remove(chunk_path.c_str());
+    if (is_synthetic)
+        remove(path.c_str());
+    return is_complete ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+// resident memory of Model::import_model() (no mesh cache, no GL upload), relative to the
+// process before: the peak during the import, and the steady state of the ModelAsset alone
+// (what stays once upload_model() has dropped the GL buffer contents). the "aiScene kept" row
+// holds the Assimp scene of the model next to it, as the meshes did before they copied their
+// streams out (Mesh::compact_streams()) and the scene was released.
+//
+//   make bench
+//   ./bench_import_memory [model ...]
+#include <iomanip>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "BenchUtil.h"
+#include "../Model.h"
+#include "../ProcessMemory.h"
+
+enum ImportVariant
+{
+    kAssimpKeepScene,
+    kAssimpRelease,
+    kNativeReader
+};
+
+struct MemoryUse
+{
+    double  steady_mb = 0.0;
+    double  peak_mb = 0.0;
+    bool    has_peak = false;
+    double  ms = 0.0;
+};
+
+static void trim_heap()
+{
+    // freed blocks go back to the system, so one run does not pay for the next
+#if defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+static bool measure(const std::string& path, ImportVariant variant, MemoryUse& use)
+{
+    const double kMB = 1.0 / (1024.0 * 1024.0);
+    trim_heap();
+    use.has_peak = reset_peak_resident_set();
+    double base = (double) resident_set_bytes();
+
+    BenchTimer timer;
+    const aiScene* scene = NULL;
+    if (variant == kAssimpKeepScene)
+        scene = aiImportFile(path.c_str(), kDefaultImportFlags);
+
+    bool ok;
+    std::shared_ptr<ModelAsset> asset;
+    {
+        Model model;
+        model.use_native_ply = model.use_native_obj = (variant == kNativeReader);
+        ok = import_bench_model(path, model);
+        use.ms = timer.elapsed_ms();
+        asset = model.asset();
+    }
+    trim_heap();
+    use.steady_mb = ((double) resident_set_bytes() - base) * kMB;
+    use.peak_mb = ((double) peak_resident_set_bytes() - base) * kMB;
+
+    asset.reset();
+    aiReleaseImport(scene);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+    }
+
+    const char* const kVariantNames[] = { "Assimp, aiScene kept", "Assimp, released", "native reader" };
+    std::cout << std::fixed << std::setprecision(2);
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        std::cout << paths[i] << std::endl
+                  << "  import                 steady MB     peak MB        ms" << std::endl;
+        for (int v = kAssimpKeepScene; v <= kNativeReader; ++v)
+        {
+            MemoryUse use;
+            if (!measure(paths[i], (ImportVariant) v, use))
+            {
+                std::cout << "  " << kVariantNames[v] << ": import failed" << std::endl;
+                continue;
+            }
+            std::cout << "  " << std::left << std::setw(22) << kVariantNames[v] << std::right
+                      << std::setw(10) << use.steady_mb;
+            if (use.has_peak)
+                std::cout << std::setw(12) << use.peak_mb;
+            else
+                std::cout << std::setw(12) << "n/a";
+            std::cout << std::setw(10) << use.ms << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+// the CPU side of multi-draw indirect on a synthetic scene of --meshes meshes (sizes from 64
+// to --max-vertices, log-uniform) in --pools pools:
+//   RangeAllocator  the meshes allocated into a vertex and an index range as MeshPool grows them,
+//                   then --rounds of paging (a quarter freed and allocated again at other sizes):
+//                   ns per allocate / free, free ranges left and the largest of them
+//   IndirectDraw    add() of a packet per mesh (--ranges meshlet ranges each) and build():
+//                   commands / s, bytes a frame uploads, multi-draws against a draw per packet
+// the ranges must never overlap, and every command must point at its mesh's range.
+//
+//   make bench
+//   ./bench_indirect [--meshes 20000] [--pools 4] [--ranges 4] [--max-vertices 20000] [--rounds 20]
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+
+#include "BenchUtil.h"
+#include "../IndirectDraw.h"
+
+struct Allocation
+{
+    std::size_t first_vertex = RangeAllocator::kNone;
+    std::size_t num_vertices = 0;
+    std::size_t first_index = RangeAllocator::kNone;
+    std::size_t num_indices = 0;
+};
+
+// allocate() of count units, grown as MeshPool::allocate() grows a pool
+static std::size_t allocate_growing(RangeAllocator& allocator, std::size_t count, std::size_t& num_grows)
+{
+    std::size_t first = allocator.allocate(count);
+    if (first == RangeAllocator::kNone)
+    {
+        allocator.grow(std::max(std::max(2 * allocator.capacity(), allocator.capacity() + count), (std::size_t) 1 << 16));
+        ++num_grows;
+        first = allocator.allocate(count);
+    }
+    return first;
+}
+
+// the live ranges lie in [0, capacity) without overlapping
+static bool is_disjoint(std::vector<std::pair<std::size_t, std::size_t> > ranges, std::size_t capacity)
+{
+    std::sort(ranges.begin(), ranges.end());
+    for (std::size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (ranges[i].first + ranges[i].second > capacity)
+            return false;
+        if (i > 0 && ranges[i - 1].first + ranges[i - 1].second > ranges[i].first)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int num_meshes = 20000, num_pools = 4, num_ranges = 4, max_vertices = 20000, num_rounds = 20;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        int value = std::max(1, atoi(argv[i + 1]));
+        if (arg == "--meshes")
+            num_meshes = value;
+        else if (arg == "--pools")
+            num_pools = value;
+        else if (arg == "--ranges")
+            num_ranges = value;
+        else if (arg == "--max-vertices")
+            max_vertices = std::max(value, 64);
+        else if (arg == "--rounds")
+            num_rounds = value;
+    }
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> log_size(std::log(64.0), std::log((double) max_vertices));
+    std::cout << std::fixed << std::setprecision(3);
+
+    // ---- RangeAllocator: a vertex and an index allocator, as one pool of MeshPool
+    RangeAllocator vertices, indices;
+    std::vector<Allocation> allocations(num_meshes);
+    std::size_t num_grows = 0, num_operations = 0;
+    BenchTimer fill_timer;
+    for (int m = 0; m < num_meshes; ++m)
+    {
+        Allocation& a = allocations[m];
+        a.num_vertices = (std::size_t) std::exp(log_size(rng));
+        a.num_indices = 6 * a.num_vertices;     // about 2 triangles per vertex
+        a.first_vertex = allocate_growing(vertices, a.num_vertices, num_grows);
+        a.first_index = allocate_growing(indices, a.num_indices, num_grows);
+        num_operations += 2;
+    }
+    double fill_ms = fill_timer.elapsed_ms();
+    std::cout << num_meshes << " meshes: " << vertices.used() << " vertices, " << indices.used() << " indices, "
+              << num_grows << " grows, " << std::setw(6) << fill_ms * 1.0e6 / num_operations << " ns per allocate" << std::endl;
+
+    // paging: a quarter of the meshes leave, as many others come in
+    std::size_t num_churn = 0;
+    BenchTimer churn_timer;
+    for (int r = 0; r < num_rounds; ++r)
+    {
+        for (int m = 0; m < num_meshes; ++m)
+        {
+            if (rng() % 4 != 0)
+                continue;
+            Allocation& a = allocations[m];
+            vertices.free(a.first_vertex, a.num_vertices);
+            indices.free(a.first_index, a.num_indices);
+            a.num_vertices = (std::size_t) std::exp(log_size(rng));
+            a.num_indices = 6 * a.num_vertices;
+            a.first_vertex = allocate_growing(vertices, a.num_vertices, num_grows);
+            a.first_index = allocate_growing(indices, a.num_indices, num_grows);
+            num_churn += 4;
+        }
+    }
+    double churn_ms = churn_timer.elapsed_ms();
+
+    std::vector<std::pair<std::size_t, std::size_t> > vertex_ranges, index_ranges;
+    for (int m = 0; m < num_meshes; ++m)
+    {
+        vertex_ranges.push_back(std::make_pair(allocations[m].first_vertex, allocations[m].num_vertices));
+        index_ranges.push_back(std::make_pair(allocations[m].first_index, allocations[m].num_indices));
+    }
+    bool is_valid = is_disjoint(vertex_ranges, vertices.capacity()) && is_disjoint(index_ranges, indices.capacity());
+
+    std::cout << "after " << num_rounds << " rounds of paging: " << std::setw(6) << churn_ms * 1.0e6 / std::max<std::size_t>(num_churn, 1)
+              << " ns per allocate / free, " << num_grows << " grows" << std::endl;
+    std::cout << "  vertices " << vertices.used() << " / " << vertices.capacity() << " in use, "
+              << vertices.num_free_ranges() << " free ranges, largest " << vertices.largest_free() << std::endl;
+    std::cout << "  indices  " << indices.used() << " / " << indices.capacity() << " in use, "
+              << indices.num_free_ranges() << " free ranges, largest " << indices.largest_free() << std::endl;
+    std::cout << "  ranges " << (is_valid ? "disjoint" : "OVERLAP") << std::endl;
+
+    // ---- IndirectDraw: a packet per mesh, each mesh in one of the pools
+    std::vector<MeshPoolRange> ranges(num_meshes);
+    std::vector<MeshDrawList> draw_lists(num_meshes);
+    std::vector<DrawPacket> packets(num_meshes);
+    Material material;
+    for (int m = 0; m < num_meshes; ++m)
+    {
+        const Allocation& a = allocations[m];
+        ranges[m].pool = m % num_pools;
+        ranges[m].base_vertex = (GLint) a.first_vertex;
+        ranges[m].num_vertices = (GLuint) a.num_vertices;
+        ranges[m].first_index = (GLuint) a.first_index;
+        ranges[m].num_indices = (GLuint) a.num_indices;
+
+        // the visible meshlets: num_ranges ranges of the LOD 0 triangles
+        MeshDrawList& draw_list = draw_lists[m];
+        GLsizei count = (GLsizei) (a.num_indices / (2 * num_ranges)) / 3 * 3;
+        for (int k = 0; k < num_ranges; ++k)
+        {
+            draw_list.firsts.push_back(2 * k * count);
+            draw_list.counts.push_back(count);
+        }
+
+        packets[m].draw_list = &draw_list;
+        packets[m].material = &material;
+        packets[m].object = (uint32_t) (m / 8);
+        packets[m].material_slot = (uint32_t) (m % 12);
+    }
+
+    IndirectDraw indirect;
+    double build_ms = bench_best_ms([&]() {
+        indirect.clear();
+        for (int m = 0; m < num_meshes; ++m)
+            indirect.add(ranges[m], packets[m]);
+        indirect.build();
+    });
+
+    // every command of a mesh at its range, its draw data at base_instance
+    const std::vector<DrawElementsIndirectCommand>& commands = indirect.commands();
+    const std::vector<IndirectDrawData>& draw_data = indirect.draw_data();
+    bool is_same = commands.size() == (std::size_t) num_meshes * num_ranges;
+    std::size_t c = 0;
+    for (int p = 0; p < num_pools && is_same; ++p)
+    {
+        for (int m = p; m < num_meshes; m += num_pools)
+        {
+            for (int k = 0; k < num_ranges; ++k, ++c)
+            {
+                const DrawElementsIndirectCommand& command = commands[c];
+                is_same = is_same && command.first_index == ranges[m].first_index + (GLuint) draw_lists[m].firsts[k]
+                                  && command.count == (GLuint) draw_lists[m].counts[k] && command.base_vertex == ranges[m].base_vertex
+                                  && command.base_instance == c && command.instance_count == 1
+                                  && draw_data[c].object == packets[m].object && draw_data[c].material == packets[m].material_slot;
+            }
+        }
+    }
+
+    std::size_t num_objects = (num_meshes + 7) / 8;
+    std::size_t upload_bytes = commands.size() * (sizeof(DrawElementsIndirectCommand) + sizeof(IndirectDrawData))
+                             + num_objects * sizeof(ObjectUniforms) + 12 * sizeof(MaterialUniforms);
+    std::cout << num_meshes << " packets x " << num_ranges << " ranges: " << commands.size() << " commands in "
+              << std::setw(8) << build_ms << " ms (" << std::setw(7) << commands.size() / (build_ms * 1.0e3) << " M/s)" << std::endl;
+    std::cout << "  upload " << upload_bytes / 1024 << " KB per frame, " << num_pools << " multi-draws instead of "
+              << num_meshes << " draws (" << num_meshes << " VAO binds)" << std::endl;
+    std::cout << "  commands " << (is_same ? "match" : "DIFFER") << std::endl;
+    return (is_valid && is_same) ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// build_instance_matrices() on the stress grids of the instancing window (1k .. --max-instances
+// copies): M instances/s and the MB a frame would upload if every instance moved, against the
+// per-Model path of render_object() (get_model_matrix(), transpose(inverse()) for the normals).
+// the matrices must match that path.
+//
+//   make bench
+//   ./bench_instances [--max-instances 1048576]
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../InstancedModel.h"
+
+// what render_object() computes for a Model at transform
+static void model_matrices(const InstanceTransform& transform, InstanceMatrices& matrices)
+{
+    glm::mat4 mat_model = glm::translate(glm::mat4(1.0f), transform.translate) * glm::mat4_cast(transform.rotate)
+                        * glm::scale(glm::mat4(1.0f), transform.scale);
+    matrices.model_matrix = mat_model;
+    matrices.normal_matrix = glm::transpose(glm::inverse(glm::mat3(mat_model)));
+}
+
+static float max_difference(const InstanceMatrices& a, const InstanceMatrices& b)
+{
+    float difference = 0.0f;
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            difference = std::max(difference, std::abs(a.model_matrix[c][r] - b.model_matrix[c][r]));
+    for (int c = 0; c < 3; ++c)
+        for (int r = 0; r < 3; ++r)
+            difference = std::max(difference, std::abs(a.normal_matrix[c][r] - b.normal_matrix[c][r]));
+    return difference;
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t max_instances = 1 << 20;
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--max-instances")
+            max_instances = std::max(1, atoi(argv[++i]));
+    }
+
+    const double kMB = 1.0 / (1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "instance: " << sizeof(InstanceTransform) << " bytes of transform, " << sizeof(InstanceMatrices) << " bytes in the instance buffer" << std::endl;
+
+    bool is_same = true;
+    for (std::size_t count = 1024; count <= max_instances; count *= 4)
+    {
+        std::vector<InstanceTransform> transforms = make_instance_grid(count, glm::vec3(0.0f), 2.0f, glm::vec3(0.5f));
+        std::vector<InstanceMatrices> matrices(count), reference(count);
+
+        double build_ms = bench_best_ms([&]() { build_instance_matrices(&transforms[0], count, glm::mat4(1.0f), &matrices[0]); });
+        double model_ms = bench_best_ms([&]() {
+            for (std::size_t i = 0; i < count; ++i)
+                model_matrices(transforms[i], reference[i]);
+        });
+
+        float difference = 0.0f;
+        for (std::size_t i = 0; i < count; ++i)
+            difference = std::max(difference, max_difference(matrices[i], reference[i]));
+        is_same = is_same && difference < 1.0e-4f;
+
+        std::cout << std::setw(8) << count << " instances  build " << std::setw(8) << build_ms << " ms ("
+                  << std::setw(7) << count / (build_ms * 1.0e3) << " M/s)  per Model " << std::setw(8) << model_ms << " ms  upload "
+                  << std::setw(7) << count * sizeof(InstanceMatrices) * kMB << " MB  max difference " << std::scientific
+                  << std::setprecision(1) << difference << std::fixed << std::setprecision(3) << std::endl;
+    }
+    std::cout << "matrices " << (is_same ? "match" : "DIFFER") << std::endl;
+    return is_same ? 0 : 1;
+}
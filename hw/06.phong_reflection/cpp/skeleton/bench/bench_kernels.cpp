@@ -0,0 +1,193 @@
+// SoA mesh kernels: AoS glm loop vs. scalar / SSE2 / AVX2 kernels (single thread)
+// on bunny.ply and the hw/02 donut model.
+//
+//   make bench
+//   ./bench_kernels [models/bunny.ply]
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../MeshKernels.h"
+
+#include "../../../../02.TriangleMesh/cpp/skeleton/models/donut_vlist_triangles.hpp"
+
+static const char* kSimdNames[] = { "scalar", "sse2", "avx2" };
+
+// AoS reference of the old load path: one glm::vec3 at a time
+static void face_normals_aos(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& tv_indices, std::vector<glm::vec3>& f_normals)
+{
+    for (std::size_t f = 0; f < f_normals.size(); ++f)
+    {
+        const glm::vec3& p = positions[tv_indices[3*f]];
+        const glm::vec3& q = positions[tv_indices[3*f+1]];
+        const glm::vec3& r = positions[tv_indices[3*f+2]];
+
+        f_normals[f] = glm::normalize(glm::cross(q-p, r-p));
+    }
+}
+
+static void triangle_areas_aos(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& tv_indices, std::vector<float>& areas)
+{
+    for (std::size_t f = 0; f < areas.size(); ++f)
+    {
+        const glm::vec3& p = positions[tv_indices[3*f]];
+        const glm::vec3& q = positions[tv_indices[3*f+1]];
+        const glm::vec3& r = positions[tv_indices[3*f+2]];
+
+        areas[f] = 0.5f * glm::length(glm::cross(q-p, r-p));
+    }
+}
+
+static void normalize_aos(std::vector<glm::vec3>& v)
+{
+    for (std::size_t i = 0; i < v.size(); ++i)
+        v[i] = glm::normalize(v[i]);
+}
+
+static void print_row(const char* name, double ms, double base_ms, int num_reps)
+{
+    std::cout << "    " << std::left << std::setw(8) << name << std::right
+              << std::setw(9) << ms / num_reps << " ms  (x" << base_ms / ms << ")";
+}
+
+static void bench_model(const std::string& name, const BenchMesh& mesh)
+{
+    std::size_t num_triangles = mesh.num_triangles();
+    std::size_t num_vertices = mesh.positions.size();
+    const unsigned int* tv_indices = &mesh.tv_indices[0];
+
+    // repeat each kernel so that one timed run covers ~4M triangles
+    int num_reps = (int) std::max<std::size_t>(1, 4000000 / num_triangles);
+
+    std::cout << name << ": " << num_triangles << " triangles, " << num_vertices << " vertices, "
+              << num_reps << " reps / run, ms per call" << std::endl;
+
+    Vec3SoA positions;
+    positions.assign(&mesh.positions[0], num_vertices);
+
+    // unnormalized per-vertex sums as the input of normalize
+    Vec3SoA v_sums;
+    {
+        Vec3SoA f_normals;
+        f_normals.resize(num_triangles);
+        mesh_kernels(kSimdScalar).face_normals(&positions.x[0], &positions.y[0], &positions.z[0], tv_indices, num_triangles,
+                                               &f_normals.x[0], &f_normals.y[0], &f_normals.z[0]);
+        v_sums.resize(num_vertices);
+        for (std::size_t i = 0; i < mesh.tv_indices.size(); ++i)
+        {
+            v_sums.x[tv_indices[i]] += f_normals.x[i/3];
+            v_sums.y[tv_indices[i]] += f_normals.y[i/3];
+            v_sums.z[tv_indices[i]] += f_normals.z[i/3];
+        }
+    }
+
+    // AoS glm baseline
+    std::vector<glm::vec3> aos_f_normals(num_triangles), aos_v_normals(num_vertices);
+    std::vector<float> aos_areas(num_triangles);
+    double aos_ms[3];
+    aos_ms[0] = bench_best_ms([&]() {
+        for (int r = 0; r < num_reps; ++r)
+            face_normals_aos(mesh.positions, mesh.tv_indices, aos_f_normals);
+    });
+    aos_ms[1] = bench_best_ms([&]() {
+        for (int r = 0; r < num_reps; ++r)
+            triangle_areas_aos(mesh.positions, mesh.tv_indices, aos_areas);
+    });
+    aos_ms[2] = bench_best_ms([&]() {
+        for (int r = 0; r < num_reps; ++r)
+        {
+            for (std::size_t i = 0; i < num_vertices; ++i)
+                aos_v_normals[i] = v_sums.get(i);
+            normalize_aos(aos_v_normals);
+        }
+    });
+
+    Vec3SoA reference_f_normals, reference_v_normals;
+    std::vector<float> reference_areas;
+
+    const char* kernel_names[] = { "face normals", "triangle areas", "normalize" };
+    for (int k = 0; k < 3; ++k)
+    {
+        std::cout << "  " << kernel_names[k] << std::endl;
+        print_row("aos glm", aos_ms[k], aos_ms[k], num_reps);
+        std::cout << std::endl;
+
+        for (int level = kSimdScalar; level <= max_simd_level(); ++level)
+        {
+            const MeshKernels& kernels = mesh_kernels((SimdLevel) level);
+
+            Vec3SoA f_normals, v_normals;
+            std::vector<float> areas(num_triangles);
+            f_normals.resize(num_triangles);
+
+            double ms = 0.0;
+            bool is_identical = true;
+            if (k == 0)
+            {
+                ms = bench_best_ms([&]() {
+                    for (int r = 0; r < num_reps; ++r)
+                        kernels.face_normals(&positions.x[0], &positions.y[0], &positions.z[0], tv_indices, num_triangles,
+                                             &f_normals.x[0], &f_normals.y[0], &f_normals.z[0]);
+                });
+                if (level == kSimdScalar)
+                    reference_f_normals = f_normals;
+                is_identical = is_bit_identical(f_normals.x, reference_f_normals.x)
+                    && is_bit_identical(f_normals.y, reference_f_normals.y)
+                    && is_bit_identical(f_normals.z, reference_f_normals.z);
+            }
+            else if (k == 1)
+            {
+                ms = bench_best_ms([&]() {
+                    for (int r = 0; r < num_reps; ++r)
+                        kernels.triangle_areas(&positions.x[0], &positions.y[0], &positions.z[0], tv_indices, num_triangles, &areas[0]);
+                });
+                if (level == kSimdScalar)
+                    reference_areas = areas;
+                is_identical = is_bit_identical(areas, reference_areas);
+            }
+            else
+            {
+                // the timed runs copy the input too, like the AoS baseline
+                ms = bench_best_ms([&]() {
+                    for (int r = 0; r < num_reps; ++r)
+                    {
+                        v_normals = v_sums;
+                        kernels.normalize(&v_normals.x[0], &v_normals.y[0], &v_normals.z[0], num_vertices);
+                    }
+                });
+                if (level == kSimdScalar)
+                    reference_v_normals = v_normals;
+                is_identical = is_bit_identical(v_normals.x, reference_v_normals.x)
+                    && is_bit_identical(v_normals.y, reference_v_normals.y)
+                    && is_bit_identical(v_normals.z, reference_v_normals.z);
+            }
+
+            print_row(kSimdNames[level], ms, aos_ms[k], num_reps);
+            std::cout << (is_identical ? "  bit-identical" : "  MISMATCH") << std::endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string path = (argc > 1) ? argv[1] : "models/bunny.ply";
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "max SIMD level: " << kSimdNames[max_simd_level()] << std::endl;
+
+    BenchMesh bunny;
+    if (load_bench_mesh(path, bunny))
+        bench_model(path, bunny);
+
+    // hw/02 donut: GLfloat position[] / GLuint index[] arrays
+    BenchMesh donut;
+    std::size_t num_donut_vertices = sizeof(donut::vlist_triangles::position) / (3 * sizeof(GLfloat));
+    for (std::size_t v = 0; v < num_donut_vertices; ++v)
+    {
+        const GLfloat* p = &donut::vlist_triangles::position[3*v];
+        donut.positions.push_back(glm::vec3(p[0], p[1], p[2]));
+    }
+    donut.tv_indices.assign(donut::vlist_triangles::index, donut::vlist_triangles::index + donut::vlist_triangles::num_index);
+    bench_model("donut_vlist_triangles.hpp", donut);
+
+    return 0;
+}
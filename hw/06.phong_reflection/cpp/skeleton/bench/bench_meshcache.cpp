@@ -0,0 +1,144 @@
+// .meshcache cold vs. warm load of the CPU side of Model::load_model():
+//   cold = key + aiImportFile + mesh passes + pack_gl_buffers + save_cache + write
+//   warm = key + map and validate the cache + Mesh::load_cache (+ reading every GL buffer byte,
+//          which the upload would do)
+// on bunny.ply and avocado.obj. the cache is written to <model>.bench.meshcache and removed.
+//
+//   make bench
+//   ./bench_meshcache [model ...]
+#include <cstdio>
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../Mesh.h"
+
+static bool cold_load(const std::string& path, const std::string& cache_path, std::vector<Mesh>& meshes)
+{
+    MeshCacheKey key;
+    if (!make_mesh_cache_key(path, kBenchProcessFlags, aiProcessPreset_TargetRealtime_MaxQuality, kDrawElements, kVertexFloat, key))
+        return false;
+
+    const aiScene* scene = aiImportFile(path.c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
+    if (scene == NULL)
+        return false;
+
+    // the passes report their stats on std::cout
+    std::streambuf* cout_buf = std::cout.rdbuf(NULL);
+
+    MeshCacheWriter writer;
+    meshes.clear();
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        Mesh mesh(scene->mMeshes[i]);
+        mesh.update_tv_indices();
+        mesh.optimize_vertex_cache();
+        mesh.optimize_overdraw();
+        mesh.build_meshlets();
+        mesh.build_lods();
+        mesh.optimize_vertex_fetch();
+
+        MeshGpuData gpu_data;
+        mesh.pack_gl_buffers(kDrawElements, kVertexFloat, gpu_data);
+        mesh.save_cache(writer, gpu_data);
+        meshes.push_back(mesh);
+    }
+
+    std::cout.rdbuf(cout_buf);
+    std::cout.clear();
+
+    float aabb_min[3] = { 0.0f, 0.0f, 0.0f }, aabb_max[3] = { 1.0f, 1.0f, 1.0f };
+    bool ok = writer.write(cache_path, key, aabb_min, aabb_max);
+    aiReleaseImport(scene);
+    return ok;
+}
+
+static bool warm_load(const std::string& path, const std::string& cache_path, std::vector<Mesh>& meshes, std::size_t& gpu_bytes, unsigned int& checksum)
+{
+    MeshCacheKey key;
+    MeshCacheReader reader;
+    if (!make_mesh_cache_key(path, kBenchProcessFlags, aiProcessPreset_TargetRealtime_MaxQuality, kDrawElements, kVertexFloat, key) || !reader.open(cache_path, key))
+        return false;
+
+    meshes.clear();
+    gpu_bytes = 0;
+    checksum = 0;
+    for (uint32_t i = 0; i < reader.header().num_meshes; ++i)
+    {
+        Mesh mesh;
+        mesh.load_cache(reader, i);
+        meshes.push_back(mesh);
+
+        const MeshCacheRecord& record = reader.record(i);
+        for (int s = kSmooth; s <= kFlat; ++s)
+        {
+            const MeshCacheBlob* blobs[2] = { &record.vertices[s], &record.indices[s] };
+            for (int b = 0; b < 2; ++b)
+            {
+                const unsigned char* p = (const unsigned char*) reader.data(*blobs[b]);
+                for (uint64_t k = 0; k < blobs[b]->size; k += 64)
+                    checksum += p[k];
+                gpu_bytes += blobs[b]->size;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+    }
+
+    std::cout << std::fixed;
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        const std::string& path = paths[i];
+        std::string cache_path = path + ".bench.meshcache";
+
+        std::vector<Mesh> meshes;
+        bool ok = true;
+        double cold_ms = bench_best_ms([&]() { ok = cold_load(path, cache_path, meshes) && ok; }, 3);
+        if (!ok)
+        {
+            std::cout << path << ": import or cache write failed" << std::endl;
+            continue;
+        }
+
+        std::size_t num_vertices = 0, num_triangles = 0;
+        for (std::size_t m = 0; m < meshes.size(); ++m)
+        {
+            num_vertices += meshes[m].num_vertices();
+            num_triangles += meshes[m].lods().empty() ? 0 : meshes[m].lods()[0].index_count / 3;
+        }
+
+        std::size_t gpu_bytes = 0;
+        unsigned int checksum = 0;
+        double warm_ms = bench_best_ms([&]() { ok = warm_load(path, cache_path, meshes, gpu_bytes, checksum) && ok; }, 10);
+
+        MappedFile cache_file;
+        cache_file.open(cache_path);
+        std::size_t cache_bytes = cache_file.size();
+        cache_file.close();
+        remove(cache_path.c_str());
+
+        std::cout << path << ": " << meshes.size() << " meshes, " << num_vertices << " vertices, " << num_triangles << " triangles" << std::endl;
+        if (!ok)
+        {
+            std::cout << "  warm load failed" << std::endl;
+            continue;
+        }
+        std::cout << std::setprecision(2)
+                  << "  cold " << std::setw(9) << cold_ms << " ms (import + passes + pack + write)" << std::endl
+                  << "  warm " << std::setw(9) << warm_ms << " ms (map + validate + load, " << gpu_bytes / 1024 << " KiB of GL buffers)" << std::endl
+                  << "  " << std::setprecision(1) << cold_ms / warm_ms << "x faster, cache file " << cache_bytes / 1024 << " KiB"
+                  << " (checksum " << checksum % 100 << ")" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+// meshlets (64 vertices / 124 triangles): build time, fill rate, and how many meshlets
+// the CPU cone / frustum tests reject from 14 perspective views around the mesh
+// (6 axes + 8 cube corners at 2 x the bounding radius, fovy 60, and one view zoomed
+// in to half the screen), on bunny.ply and avocado.obj.
+//
+//   make bench
+//   ./bench_meshlets [model ...]
+#include <cmath>
+#include <iomanip>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "BenchUtil.h"
+#include "../Meshlet.h"
+#include "../MeshOptimizer.h"
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        BenchMesh mesh;
+        if (!load_bench_mesh(paths[i], mesh))
+            continue;
+
+        std::cout << paths[i] << ": " << mesh.num_triangles() << " triangles, " << mesh.positions.size() << " vertices" << std::endl;
+
+        reorder_for_vertex_cache(mesh.tv_indices, mesh.positions.size());
+        float acmr_before = analyze_vertex_cache(mesh.tv_indices, mesh.positions.size()).acmr;
+
+        std::vector<Meshlet> meshlets;
+        BenchTimer timer;
+        build_meshlets(mesh.tv_indices, &mesh.positions[0], mesh.positions.size(), meshlets);
+        double ms = timer.elapsed_ms();
+
+        std::size_t num_vertices = 0;
+        for (std::size_t m = 0; m < meshlets.size(); ++m)
+            num_vertices += meshlets[m].vertex_count;
+        std::cout << "  " << meshlets.size() << " meshlets in " << ms << " ms: avg "
+                  << (float) num_vertices / meshlets.size() << " vertices, "
+                  << (float) mesh.num_triangles() / meshlets.size() << " triangles"
+                  << ", ACMR " << acmr_before << " -> " << analyze_vertex_cache(mesh.tv_indices, mesh.positions.size()).acmr << std::endl;
+
+        glm::vec3 p_min = mesh.positions[0], p_max = mesh.positions[0];
+        for (std::size_t v = 1; v < mesh.positions.size(); ++v)
+        {
+            p_min = glm::min(p_min, mesh.positions[v]);
+            p_max = glm::max(p_max, mesh.positions[v]);
+        }
+        glm::vec3 center = 0.5f * (p_min + p_max);
+        float radius = 0.5f * glm::length(p_max - p_min);
+
+        for (int zoom = 0; zoom < 2; ++zoom)
+        {
+            std::size_t num_backfacing = 0, num_outside = 0, num_culled_triangles = 0;
+            for (int view = 0; view < 14; ++view)
+            {
+                glm::vec3 dir;
+                if (view < 6)
+                {
+                    dir = glm::vec3(0.0f);
+                    dir[view / 2] = (view % 2) ? -1.0f : 1.0f;
+                }
+                else
+                {
+                    int corner = view - 6;
+                    dir = glm::normalize(glm::vec3((corner & 1) ? -1.0f : 1.0f, (corner & 2) ? -1.0f : 1.0f, (corner & 4) ? -1.0f : 1.0f));
+                }
+                glm::vec3 up = (std::fabs(dir.y) > 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+                // zoomed: look at a point off the center so that about half the mesh is off-screen
+                glm::vec3 eye = center - dir * (zoom ? 1.0f : 2.0f) * radius;
+                glm::vec3 right = glm::normalize(glm::cross(dir, up));
+                glm::vec3 at = center + (zoom ? 0.5f * radius * right : glm::vec3(0.0f));
+                glm::mat4 mat_PV = glm::perspective(glm::radians(60.0f), 1.0f, 0.01f * radius, 10.0f * radius) * glm::lookAt(eye, at, up);
+                Frustum frustum = extract_frustum(mat_PV);
+
+                for (std::size_t m = 0; m < meshlets.size(); ++m)
+                {
+                    if (is_meshlet_outside(meshlets[m], frustum))
+                        ++num_outside;
+                    else if (is_meshlet_backfacing(meshlets[m], eye))
+                        ++num_backfacing;
+                    else
+                        continue;
+                    num_culled_triangles += meshlets[m].triangle_count;
+                }
+            }
+
+            float num_views_meshlets = 14.0f * meshlets.size();
+            std::cout << "  " << (zoom ? "zoomed " : "overall") << "  back-facing " << 100.0f * num_backfacing / num_views_meshlets << " %"
+                      << ", outside " << 100.0f * num_outside / num_views_meshlets << " %"
+                      << ", triangles culled " << 100.0f * num_culled_triangles / (14.0f * mesh.num_triangles()) << " %" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+// vertex-normal accumulation: serial scatter vs. partitioned parallel reduction
+// on bunny.ply subdivided up to 10M triangles.
+//
+//   make bench
+//   ./bench_normals [models/bunny.ply]
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../Parallel.h"
+#include "../VertexNormals.h"
+
+int main(int argc, char* argv[])
+{
+    const std::size_t kMaxTriangles = 10000000;
+
+    std::string path = (argc > 1) ? argv[1] : "models/bunny.ply";
+    BenchMesh mesh;
+    if (!load_bench_mesh(path, mesh))
+        return -1;
+
+    // at least up to 4 threads so the partitioned path is checked even on small machines
+    unsigned int max_threads = std::max(num_worker_threads(), 4u);
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int t = 1; t < max_threads; t *= 2)
+        thread_counts.push_back(t);
+    thread_counts.push_back(max_threads);
+
+    std::cout << std::fixed << std::setprecision(2);
+    while (true)
+    {
+        if (mesh.num_triangles() > kMaxTriangles)
+            mesh.tv_indices.resize(3 * kMaxTriangles);
+
+        Vec3SoA positions, f_normals, v_reference, v_normals;
+        positions.assign(&mesh.positions[0], mesh.positions.size());
+        compute_face_normals(positions, mesh.tv_indices, f_normals);
+
+        double serial_ms = bench_best_ms([&]() {
+            compute_vertex_normals_serial(f_normals, mesh.tv_indices, mesh.positions.size(), v_reference);
+        });
+
+        std::cout << mesh.num_triangles() << " triangles, " << mesh.positions.size() << " vertices" << std::endl;
+        std::cout << "  serial scatter     : " << serial_ms << " ms" << std::endl;
+
+        for (std::size_t i = 0; i < thread_counts.size(); ++i)
+        {
+            double parallel_ms = bench_best_ms([&]() {
+                compute_vertex_normals(f_normals, mesh.tv_indices, mesh.positions.size(), v_normals, thread_counts[i]);
+            });
+
+            bool is_identical = is_bit_identical(v_normals.x, v_reference.x)
+                && is_bit_identical(v_normals.y, v_reference.y)
+                && is_bit_identical(v_normals.z, v_reference.z);
+
+            std::cout << "  parallel   " << std::setw(2) << thread_counts[i] << " thr : " << parallel_ms << " ms"
+                      << " (x" << serial_ms / parallel_ms << ")"
+                      << (is_identical ? "  bit-identical" : "  MISMATCH") << std::endl;
+        }
+
+        if (mesh.num_triangles() >= kMaxTriangles)
+            break;
+        mesh = subdivide_bench_mesh(mesh);
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+// read_obj() on 1 and on all threads vs. aiImportFile() on avocado.obj and on a synthetic
+// height-field "scan" of about --synthetic-mb MB (v / vt / vn, quads, 4 materials in bands
+// of rows). Assimp runs with no post-processing (parse only) and with the preset Model uses.
+// the synthetic file is also written with negative (relative) face indices; every thread
+// count and both index styles must give the same meshes.
+//
+//   make bench
+//   ./bench_obj [--synthetic-mb 100] [--threads 8] [--tmp-dir /tmp] [model.obj ...]
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../ObjReader.h"
+#include "../Parallel.h"
+
+static const char* const kMaterialNames[] = { "red", "green", "blue", "white" };
+
+static bool write_mtl(const std::string& path)
+{
+    FILE* fp = fopen(path.c_str(), "w");
+    if (fp == NULL)
+        return false;
+    for (int m = 0; m < 4; ++m)
+    {
+        fprintf(fp, "newmtl %s\nNs 100.0\nKa 0.1 0.1 0.1\n", kMaterialNames[m]);
+        fprintf(fp, "Kd %.2f %.2f %.2f\nKs 0.5 0.5 0.5\nillum 2\n\n", m == 0 || m == 3 ? 0.8f : 0.1f, m == 1 || m == 3 ? 0.8f : 0.1f, m == 2 || m == 3 ? 0.8f : 0.1f);
+    }
+    return fclose(fp) == 0;
+}
+
+// n x n height field; the faces of each band of rows come right after its vertices
+static bool write_scan(const std::string& path, const std::string& mtl_name, int n, bool is_relative)
+{
+    FILE* fp = fopen(path.c_str(), "w");
+    if (fp == NULL)
+        return false;
+
+    fprintf(fp, "# synthetic scan (bench_obj)\nmtllib %s\no scan\n", mtl_name.c_str());
+    int rows_per_band = std::max(2, n / 16);
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            float u = (float) i / (n - 1), v = (float) j / (n - 1);
+            float h = 0.05f * std::sin(25.0f * u) * std::cos(19.0f * v);
+            glm::vec3 normal = glm::normalize(glm::vec3(-1.25f * std::cos(25.0f * u) * std::cos(19.0f * v) / (n - 1), 0.95f * std::sin(25.0f * u) * std::sin(19.0f * v) / (n - 1), 1.0f / (n - 1)));
+            fprintf(fp, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.4f %.4f %.4f\n", u - 0.5f, v - 0.5f, h, u, v, normal.x, normal.y, normal.z);
+        }
+        if (j == 0)
+            continue;
+
+        // quads between row j - 1 and j
+        if ((j - 1) % rows_per_band == 0)
+            fprintf(fp, "usemtl %s\n", kMaterialNames[((j - 1) / rows_per_band) % 4]);
+        int num_defined = (j + 1) * n;
+        for (int i = 0; i + 1 < n; ++i)
+        {
+            int q[4] = { (j - 1) * n + i + 1, (j - 1) * n + i + 2, j * n + i + 2, j * n + i + 1 };    // 1-based
+            if (is_relative)
+            {
+                for (int k = 0; k < 4; ++k)
+                    q[k] -= num_defined + 1;
+            }
+            fprintf(fp, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", q[0], q[0], q[0], q[1], q[1], q[1], q[2], q[2], q[2], q[3], q[3], q[3]);
+        }
+    }
+    return fclose(fp) == 0;
+}
+
+static std::size_t file_size(const std::string& path)
+{
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == NULL)
+        return 0;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size > 0 ? (std::size_t) size : 0;
+}
+
+static bool is_same(const std::vector<ObjMesh>& a, const std::vector<ObjMesh>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); ++i)
+    {
+        const MeshArrays& x = *a[i].arrays;
+        const MeshArrays& y = *b[i].arrays;
+        if (a[i].material.name != b[i].material.name || a[i].material.diffuse != b[i].material.diffuse
+            || x.positions != y.positions || x.normals != y.normals || x.texcoords != y.texcoords || x.tv_indices != y.tv_indices)
+            return false;
+    }
+    return true;
+}
+
+static void print_meshes(const std::vector<ObjMesh>& meshes)
+{
+    for (std::size_t i = 0; i < meshes.size(); ++i)
+    {
+        const Material& material = meshes[i].material;
+        std::cout << "  mesh " << i << " (" << material.name << "): " << meshes[i].arrays->num_vertices() << " vertices, "
+                  << meshes[i].arrays->tv_indices.size() / 3 << " triangles, " << std::setprecision(6)
+                  << "Ka " << material.ambient.x << " " << material.ambient.y << " " << material.ambient.z
+                  << ", Kd " << material.diffuse.x << " " << material.diffuse.y << " " << material.diffuse.z
+                  << ", Ks " << material.specular.x << " " << material.specular.y << " " << material.specular.z << std::endl;
+    }
+}
+
+// best of num_runs; the meshes of the last run on num_threads in meshes
+static void bench_file(const std::string& path, int num_runs, unsigned int num_threads, std::vector<ObjMesh>& meshes)
+{
+    double mb = file_size(path) / (1024.0 * 1024.0);
+
+    std::string error;
+    bool ok = true;
+    double single_ms = bench_best_ms([&]() { ok = read_obj(path, meshes, &error, 1); }, num_runs);
+    double multi_ms = bench_best_ms([&]() { ok = ok && read_obj(path, meshes, &error, num_threads); }, num_runs);
+    if (!ok)
+    {
+        std::cout << path << ": " << error << std::endl;
+        return;
+    }
+
+    std::size_t num_ai_meshes = 0;
+    double assimp_ms[2] = { 0.0, 0.0 };
+    const unsigned int ai_flags[2] = { 0, aiProcessPreset_TargetRealtime_MaxQuality };
+    for (int k = 0; k < 2; ++k)
+    {
+        assimp_ms[k] = bench_best_ms([&]() {
+            const aiScene* scene = aiImportFile(path.c_str(), ai_flags[k]);
+            num_ai_meshes = (scene != NULL) ? scene->mNumMeshes : 0;
+            aiReleaseImport(scene);
+        }, num_runs);
+    }
+
+    std::cout << path << ": " << std::setprecision(1) << mb << " MB, " << meshes.size() << " meshes (Assimp: " << num_ai_meshes << ")" << std::endl
+              << "  read_obj, 1 thread " << std::setw(9) << std::setprecision(2) << single_ms << " ms, " << std::setw(7) << std::setprecision(1) << mb / single_ms * 1000.0 << " MB/s" << std::endl
+              << "  read_obj, " << std::setw(2) << num_threads << " threads" << std::setw(7) << std::setprecision(2) << multi_ms << " ms, " << std::setw(7) << std::setprecision(1) << mb / multi_ms * 1000.0 << " MB/s" << std::endl
+              << "  aiImportFile(0)    " << std::setw(9) << std::setprecision(2) << assimp_ms[0] << " ms, " << std::setw(7) << std::setprecision(1) << mb / assimp_ms[0] * 1000.0 << " MB/s"
+              << "  (" << std::setprecision(1) << assimp_ms[0] / multi_ms << "x)" << std::endl
+              << "  aiImportFile(preset)" << std::setw(8) << std::setprecision(2) << assimp_ms[1] << " ms, " << std::setw(7) << std::setprecision(1) << mb / assimp_ms[1] * 1000.0 << " MB/s"
+              << "  (" << std::setprecision(1) << assimp_ms[1] / multi_ms << "x)" << std::endl;
+    print_meshes(meshes);
+}
+
+int main(int argc, char* argv[])
+{
+    double synthetic_mb = 100.0;
+    unsigned int num_threads = num_worker_threads();
+    std::string tmp_dir = "/tmp";
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--synthetic-mb" && i + 1 < argc)
+            synthetic_mb = atof(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            num_threads = std::max(1, atoi(argv[++i]));
+        else if (arg == "--tmp-dir" && i + 1 < argc)
+            tmp_dir = argv[++i];
+        else
+            paths.push_back(arg);
+    }
+    if (paths.empty())
+        paths.push_back("models/avocado.obj");
+
+    std::cout << std::fixed;
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        std::vector<ObjMesh> meshes;
+        bench_file(paths[i], 5, num_threads, meshes);
+    }
+
+    if (synthetic_mb <= 0.0)
+        return 0;
+
+    // about 160 bytes per vertex (v + vt + vn + a quad)
+    int n = std::max(3, (int) std::sqrt(synthetic_mb * 1024.0 * 1024.0 / 160.0));
+    std::string mtl_path = tmp_dir + "/bench_obj_scan.mtl";
+    std::string paths_scan[2] = { tmp_dir + "/bench_obj_scan.obj", tmp_dir + "/bench_obj_scan_relative.obj" };
+    if (!write_mtl(mtl_path) || !write_scan(paths_scan[0], "bench_obj_scan.mtl", n, false) || !write_scan(paths_scan[1], "bench_obj_scan.mtl", n, true))
+    {
+        std::cout << "cannot write the synthetic files to " << tmp_dir << std::endl;
+        return 1;
+    }
+
+    std::vector<ObjMesh> meshes;
+    bench_file(paths_scan[0], 3, num_threads, meshes);
+
+    // 1 chunk vs. many (more chunks than cores is fine here), absolute vs. relative indices
+    std::vector<ObjMesh> single, many, relative;
+    bool is_agreeing = read_obj(paths_scan[0], single, NULL, 1) && read_obj(paths_scan[0], many, NULL, 16)
+        && read_obj(paths_scan[1], relative, NULL, 16) && is_same(single, many) && is_same(single, relative);
+    std::cout << "  same meshes on 1 / 16 threads and with relative indices: " << (is_agreeing ? "yes" : "NO") << std::endl;
+
+    remove(mtl_path.c_str());
+    remove(paths_scan[0].c_str());
+    remove(paths_scan[1].c_str());
+    return 0;
+}
@@ -0,0 +1,65 @@
+// overdraw: CPU depth-only estimate (14 views) and FIFO-16 ACMR of
+//   original / vertex cache (forsyth) / forsyth + reorder_for_overdraw (several ACMR thresholds)
+// on bunny.ply and avocado.obj.
+//
+//   make bench
+//   ./bench_overdraw [model ...]
+#include <iomanip>
+#include <sstream>
+
+#include "BenchUtil.h"
+#include "../MeshOptimizer.h"
+
+static void print_stats(const std::string& label, const BenchMesh& mesh)
+{
+    VertexCacheStats vcache = analyze_vertex_cache(mesh.tv_indices, mesh.positions.size());
+    OverdrawStats overdraw = estimate_overdraw(mesh.tv_indices, &mesh.positions[0], mesh.positions.size());
+    OverdrawStats overdraw_culled = estimate_overdraw(mesh.tv_indices, &mesh.positions[0], mesh.positions.size(), 256, true);
+
+    std::cout << "  " << std::left << std::setw(18) << label << std::right
+              << "  ACMR " << vcache.acmr
+              << "  overdraw " << overdraw.overdraw
+              << "  (back faces culled: " << overdraw_culled.overdraw << ")" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        BenchMesh mesh;
+        if (!load_bench_mesh(paths[i], mesh))
+            continue;
+
+        std::cout << paths[i] << ": " << mesh.num_triangles() << " triangles" << std::endl;
+        print_stats("original", mesh);
+
+        reorder_for_vertex_cache(mesh.tv_indices, mesh.positions.size());
+        print_stats("forsyth", mesh);
+
+        const float thresholds[] = { 1.0f, 1.05f, 1.2f, 1.5f };
+        for (int k = 0; k < 4; ++k)
+        {
+            BenchMesh reordered = mesh;
+            BenchTimer timer;
+            reorder_for_overdraw(reordered.tv_indices, &reordered.positions[0], reordered.positions.size(), thresholds[k]);
+            double ms = timer.elapsed_ms();
+
+            std::ostringstream label;
+            label << std::fixed << std::setprecision(2) << "+overdraw " << thresholds[k];
+            print_stats(label.str(), reordered);
+            std::cout << "    reorder time: " << ms << " ms" << std::endl;
+        }
+    }
+
+    return 0;
+}
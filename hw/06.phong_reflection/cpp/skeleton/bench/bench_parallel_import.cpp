@@ -0,0 +1,69 @@
+// scene import: Model::import_model() of every model one after another vs. all at once on
+// a ThreadPool (as load_assets() in main.cpp does), without the mesh cache. the GL upload
+// is not part of it (it stays on the GL thread either way).
+//
+//   make bench
+//   ./bench_parallel_import [model ...]
+#include <future>
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../Model.h"
+#include "../ThreadPool.h"
+
+static bool import_one(const std::string& path)
+{
+    Model model;
+    return import_bench_model(path, model);
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+        paths.push_back("models/avocado.ply");
+        paths.push_back("models/avocado_smooth.ply");
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    double slowest_ms = 0.0, sum_ms = 0.0;
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        bool ok = true;
+        double ms = bench_best_ms([&]() { ok = import_one(paths[i]); }, 3);
+        if (!ok)
+        {
+            std::cout << paths[i] << ": import failed" << std::endl;
+            return 1;
+        }
+        std::cout << "  " << std::setw(8) << ms << " ms  " << paths[i] << std::endl;
+        slowest_ms = std::max(slowest_ms, ms);
+        sum_ms += ms;
+    }
+
+    double serial_ms = bench_best_ms([&]() {
+        for (std::size_t i = 0; i < paths.size(); ++i)
+            import_one(paths[i]);
+    }, 3);
+
+    double parallel_ms = bench_best_ms([&]() {
+        ThreadPool pool((unsigned int) std::min<std::size_t>(paths.size(), num_worker_threads()));
+        std::vector<std::future<bool> > imports;
+        for (std::size_t i = 0; i < paths.size(); ++i)
+            imports.push_back(pool.submit([&paths, i]() { return import_one(paths[i]); }));
+        for (std::size_t i = 0; i < imports.size(); ++i)
+            imports[i].get();
+    }, 3);
+
+    std::cout << paths.size() << " models, " << num_worker_threads() << " hardware threads" << std::endl
+              << "  serial   " << std::setw(8) << serial_ms << " ms (sum of singles " << sum_ms << " ms)" << std::endl
+              << "  parallel " << std::setw(8) << parallel_ms << " ms (slowest single " << slowest_ms << " ms)" << std::endl
+              << "  " << std::setprecision(2) << serial_ms / parallel_ms << "x" << std::endl;
+    return 0;
+}
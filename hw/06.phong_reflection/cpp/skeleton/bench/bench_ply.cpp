@@ -0,0 +1,211 @@
+// read_ply() vs. aiImportFile() on bunny.ply / avocado.ply and on synthetic height-field
+// "scans" (x y z nx ny nz s t + uchar RGBA, quads as 2 triangles) written as ascii,
+// binary_little_endian and binary_big_endian files of about --synthetic-mb MB each.
+// Assimp runs with no post-processing (parse only) and with the preset Model uses.
+// the three synthetic files hold the same values, so read_ply() must return the same arrays.
+//
+//   make bench
+//   ./bench_ply [--synthetic-mb 100] [--tmp-dir /tmp] [model.ply ...]
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../PlyReader.h"
+
+static const char* const kFormatNames[] = { "ascii", "binary_little_endian", "binary_big_endian" };
+
+static void put_bytes(FILE* fp, const void* data, std::size_t size, bool is_big_endian)
+{
+    unsigned char bytes[8];
+    memcpy(bytes, data, size);
+    const uint16_t one = 1;
+    bool is_host_big_endian = *(const unsigned char*) &one == 0;
+    if (is_big_endian != is_host_big_endian)
+    {
+        for (std::size_t i = 0; i < size / 2; ++i)
+            std::swap(bytes[i], bytes[size - 1 - i]);
+    }
+    fwrite(bytes, 1, size, fp);
+}
+
+// n x n height field; format 0 / 1 / 2 = ascii / binary LE / binary BE
+static bool write_scan(const std::string& path, int n, int format)
+{
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (fp == NULL)
+        return false;
+
+    fprintf(fp, "ply\nformat %s 1.0\ncomment synthetic scan (bench_ply)\n", kFormatNames[format]);
+    fprintf(fp, "element vertex %d\n", n * n);
+    fprintf(fp, "property float x\nproperty float y\nproperty float z\n");
+    fprintf(fp, "property float nx\nproperty float ny\nproperty float nz\n");
+    fprintf(fp, "property float s\nproperty float t\n");
+    fprintf(fp, "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n");
+    fprintf(fp, "element face %d\nproperty list uchar int vertex_indices\nend_header\n", 2 * (n - 1) * (n - 1));
+
+    for (int j = 0; j < n; ++j)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            float u = (float) i / (n - 1), v = (float) j / (n - 1);
+            float h = 0.05f * std::sin(25.0f * u) * std::cos(19.0f * v);
+            glm::vec3 normal = glm::normalize(glm::vec3(-1.25f * std::cos(25.0f * u) * std::cos(19.0f * v) / (n - 1), 0.95f * std::sin(25.0f * u) * std::sin(19.0f * v) / (n - 1), 1.0f / (n - 1)));
+            float values[8] = { u - 0.5f, v - 0.5f, h, normal.x, normal.y, normal.z, u, v };
+            unsigned char color[4] = { (unsigned char) (255 * u), (unsigned char) (255 * v), (unsigned char) (128 + 1000 * h), 255 };
+
+            if (format == 0)
+            {
+                // %.9g round-trips a float exactly
+                fprintf(fp, "%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %d %d %d %d\n", values[0], values[1], values[2], values[3], values[4], values[5], values[6], values[7],
+                        color[0], color[1], color[2], color[3]);
+            }
+            else
+            {
+                for (int k = 0; k < 8; ++k)
+                    put_bytes(fp, &values[k], sizeof(float), format == 2);
+                fwrite(color, 1, 4, fp);
+            }
+        }
+    }
+
+    for (int j = 0; j + 1 < n; ++j)
+    {
+        for (int i = 0; i + 1 < n; ++i)
+        {
+            int32_t v0 = j * n + i, v1 = v0 + 1, v2 = v0 + n + 1, v3 = v0 + n;
+            int32_t triangles[2][3] = { { v0, v1, v2 }, { v0, v2, v3 } };
+            for (int t = 0; t < 2; ++t)
+            {
+                if (format == 0)
+                {
+                    fprintf(fp, "3 %d %d %d\n", triangles[t][0], triangles[t][1], triangles[t][2]);
+                }
+                else
+                {
+                    unsigned char count = 3;
+                    fwrite(&count, 1, 1, fp);
+                    for (int k = 0; k < 3; ++k)
+                        put_bytes(fp, &triangles[t][k], sizeof(int32_t), format == 2);
+                }
+            }
+        }
+    }
+    return fclose(fp) == 0;
+}
+
+static std::size_t file_size(const std::string& path)
+{
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (fp == NULL)
+        return 0;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size > 0 ? (std::size_t) size : 0;
+}
+
+static bool is_same(const MeshArrays& a, const MeshArrays& b)
+{
+    return a.positions == b.positions && a.normals == b.normals && a.colors == b.colors
+        && a.texcoords == b.texcoords && a.tv_indices == b.tv_indices;
+}
+
+// best of num_runs; MeshArrays of the last run in mesh
+static void bench_file(const std::string& path, int num_runs, MeshArrays& mesh)
+{
+    double mb = file_size(path) / (1024.0 * 1024.0);
+
+    std::string error;
+    bool ok = true;
+    double native_ms = bench_best_ms([&]() { ok = read_ply(path, mesh, &error); }, num_runs);
+    if (!ok)
+    {
+        std::cout << path << ": " << error << std::endl;
+        return;
+    }
+
+    std::size_t num_ai_vertices = 0;
+    double assimp_ms[2] = { 0.0, 0.0 };
+    const unsigned int ai_flags[2] = { 0, aiProcessPreset_TargetRealtime_MaxQuality };
+    for (int k = 0; k < 2; ++k)
+    {
+        assimp_ms[k] = bench_best_ms([&]() {
+            const aiScene* scene = aiImportFile(path.c_str(), ai_flags[k]);
+            num_ai_vertices = (scene != NULL && scene->mNumMeshes > 0) ? scene->mMeshes[0]->mNumVertices : 0;
+            aiReleaseImport(scene);
+        }, num_runs);
+    }
+
+    std::cout << path << ": " << std::setprecision(1) << mb << " MB, " << mesh.num_vertices() << " vertices, "
+              << mesh.tv_indices.size() / 3 << " triangles (Assimp: " << num_ai_vertices << " vertices)" << std::endl
+              << "  read_ply           " << std::setw(9) << std::setprecision(2) << native_ms << " ms, " << std::setw(7) << std::setprecision(1) << mb / native_ms * 1000.0 << " MB/s" << std::endl
+              << "  aiImportFile(0)    " << std::setw(9) << std::setprecision(2) << assimp_ms[0] << " ms, " << std::setw(7) << std::setprecision(1) << mb / assimp_ms[0] * 1000.0 << " MB/s"
+              << "  (" << std::setprecision(1) << assimp_ms[0] / native_ms << "x)" << std::endl
+              << "  aiImportFile(preset)" << std::setw(8) << std::setprecision(2) << assimp_ms[1] << " ms, " << std::setw(7) << std::setprecision(1) << mb / assimp_ms[1] * 1000.0 << " MB/s"
+              << "  (" << std::setprecision(1) << assimp_ms[1] / native_ms << "x)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    double synthetic_mb = 100.0;
+    std::string tmp_dir = "/tmp";
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--synthetic-mb" && i + 1 < argc)
+            synthetic_mb = atof(argv[++i]);
+        else if (arg == "--tmp-dir" && i + 1 < argc)
+            tmp_dir = argv[++i];
+        else
+            paths.push_back(arg);
+    }
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.ply");
+        paths.push_back("models/avocado_smooth.ply");
+    }
+
+    std::cout << std::fixed;
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        MeshArrays mesh;
+        bench_file(paths[i], 5, mesh);
+    }
+
+    if (synthetic_mb <= 0.0)
+        return 0;
+
+    // about 54 bytes per vertex in binary (vertex + 2 faces), about twice that in ascii
+    for (int format = 0; format < 3; ++format)
+    {
+        double bytes_per_vertex = (format == 0) ? 125.0 : 54.0;
+        int n = std::max(2, (int) std::sqrt(synthetic_mb * 1024.0 * 1024.0 / bytes_per_vertex));
+
+        std::string path = tmp_dir + "/bench_ply_scan_" + kFormatNames[format] + ".ply";
+        if (!write_scan(path, n, format))
+        {
+            std::cout << "cannot write " << path << std::endl;
+            return 1;
+        }
+
+        MeshArrays mesh;
+        bench_file(path, 3, mesh);
+
+        // the binary files hold what the ascii one holds (n differs, so rewrite it small)
+        std::string check_path = tmp_dir + "/bench_ply_check_" + kFormatNames[format] + ".ply";
+        std::string ascii_path = tmp_dir + "/bench_ply_check_ascii.ply";
+        MeshArrays check, ascii;
+        bool is_agreeing = write_scan(check_path, 257, format) && write_scan(ascii_path, 257, 0)
+            && read_ply(check_path, check) && read_ply(ascii_path, ascii) && is_same(check, ascii);
+        std::cout << "  same arrays as ascii: " << (is_agreeing ? "yes" : "NO") << std::endl;
+
+        remove(path.c_str());
+        remove(check_path.c_str());
+        remove(ascii_path.c_str());
+    }
+    return 0;
+}
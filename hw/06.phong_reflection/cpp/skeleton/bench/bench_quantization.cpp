@@ -0,0 +1,105 @@
+// quantized vertex formats: bytes per vertex and max decode error against the float
+// reference (VertexFormat layouts with a color attribute),
+// on bunny.ply and avocado.obj.
+//
+//   make bench
+//   ./bench_quantization [model ...]
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../VertexFormat.h"
+#include "../VertexNormals.h"
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+    }
+
+    const char* names[] = { "float", "quant16", "quant8" };
+
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        BenchMesh mesh;
+        if (!load_bench_mesh(paths[i], mesh))
+            continue;
+
+        std::size_t num_vertices = mesh.positions.size();
+        std::cout << paths[i] << ": " << mesh.num_triangles() << " triangles, " << num_vertices << " vertices" << std::endl;
+
+        Vec3SoA positions, f_normals, v_normals;
+        positions.assign(&mesh.positions[0], num_vertices);
+        compute_face_normals(positions, mesh.tv_indices, f_normals);
+        compute_vertex_normals(f_normals, mesh.tv_indices, num_vertices, v_normals);
+
+        glm::vec3 box_min(1.0e30f), box_max(-1.0e30f);
+        for (std::size_t v = 0; v < num_vertices; ++v)
+        {
+            box_min = glm::min(box_min, mesh.positions[v]);
+            box_max = glm::max(box_max, mesh.positions[v]);
+        }
+        glm::vec3 box_extent = glm::max(box_max - box_min, glm::vec3(1.0e-20f));
+
+        for (int p = kVertexFloat; p <= kVertexQuantized8; ++p)
+        {
+            VertexPrecision precision = (VertexPrecision) p;
+            VertexFormat format = VertexFormat::from_attribs(true, false, precision);
+            std::vector<unsigned char> vertex(format.stride());
+            QuantizationError error;
+
+            for (std::size_t v = 0; v < num_vertices; ++v)
+            {
+                glm::vec3 position = mesh.positions[v];
+                glm::vec3 normal = v_normals.get(v);
+                glm::vec4 color(normal * 0.5f + 0.5f, 1.0f);   // any smooth color will do
+
+                glm::vec3 qposition = (precision == kVertexFloat) ? position : (position - box_min) / box_extent;
+                glm::vec2 qnormal = oct_encode(normal, (precision == kVertexQuantized16) ? 16 : 8);
+                format.pack(kAttribPosition, &vertex[0], &qposition[0]);
+                format.pack(kAttribNormal, &vertex[0], (precision == kVertexFloat) ? &normal[0] : &qnormal[0]);
+                format.pack(kAttribColor, &vertex[0], &color[0]);
+
+                glm::vec3 dposition, dnormal;
+                glm::vec4 dcolor;
+                glm::vec2 dnormal_oct;
+                format.unpack(kAttribPosition, &vertex[0], &dposition[0]);
+                format.unpack(kAttribColor, &vertex[0], &dcolor[0]);
+                if (precision == kVertexFloat)
+                {
+                    format.unpack(kAttribNormal, &vertex[0], &dnormal[0]);
+                }
+                else
+                {
+                    dposition = box_min + dposition * box_extent;
+                    format.unpack(kAttribNormal, &vertex[0], &dnormal_oct[0]);
+                    dnormal = oct_decode(dnormal_oct);
+                }
+
+                glm::vec4 dc = glm::abs(dcolor - color);
+                // atan2(|a x b|, a . b) stays accurate for tiny angles, unlike acos()
+                float angle = std::atan2(glm::length(glm::cross(dnormal, normal)), glm::dot(dnormal, normal));
+                error.max_position = std::max(error.max_position, glm::length(dposition - position));
+                error.max_normal_degrees = std::max(error.max_normal_degrees, glm::degrees(angle));
+                error.max_color = std::max(error.max_color, std::max(std::max(dc.x, dc.y), std::max(dc.z, dc.w)));
+            }
+
+            float diagonal = glm::length(box_max - box_min);
+            std::cout << "  " << std::left << std::setw(8) << names[p] << std::right
+                      << std::setw(3) << format.stride() << " B/vertex, "
+                      << std::setw(8) << num_vertices * format.stride() / 1024 << " KB"
+                      << std::scientific << std::setprecision(2)
+                      << "  max error: position " << error.max_position / diagonal << " x diagonal"
+                      << ", normal " << std::fixed << std::setprecision(4) << error.max_normal_degrees << " deg"
+                      << ", color " << error.max_color * 255.0f << " / 255" << std::endl;
+        }
+    }
+
+    return 0;
+}
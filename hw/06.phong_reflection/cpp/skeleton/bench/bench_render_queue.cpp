@@ -0,0 +1,125 @@
+// RenderQueue on a synthetic scene: --objects models, each a copy of one of --assets distinct
+// assets of --meshes meshes, the meshes using --materials materials, at random depths.
+// the state changes (program, material, mesh, object) of the packets in the order the models
+// add them, and sorted with either key layout; radix_sort() against std::stable_sort on the keys.
+//
+//   make bench
+//   ./bench_render_queue [--objects 2000] [--assets 16] [--meshes 8] [--materials 12]
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+
+#include "BenchUtil.h"
+#include "../RenderQueue.h"
+
+static void print_changes(const char* label, const DrawStateChanges& changes)
+{
+    std::cout << "  " << std::left << std::setw(34) << label << std::right
+              << " program " << std::setw(3) << changes.program
+              << "  material " << std::setw(6) << changes.material
+              << "  mesh " << std::setw(6) << changes.vertex_array
+              << "  object " << std::setw(6) << changes.object
+              << "  total " << std::setw(7) << changes.total() << std::endl;
+}
+
+// the depths of the packets in order never decrease (the quantized ones of the keys)
+static bool is_front_to_back(const std::vector<DrawPacket>& packets, const std::vector<uint32_t>& order)
+{
+    for (std::size_t i = 1; i < order.size(); ++i)
+    {
+        uint64_t a = make_sort_key(packets[order[i - 1]], kSortFrontToBack) >> 36;
+        uint64_t b = make_sort_key(packets[order[i]], kSortFrontToBack) >> 36;
+        if (b < a)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int num_objects = 2000, num_assets = 16, num_meshes = 8, num_materials = 12;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        int value = std::max(1, atoi(argv[i + 1]));
+        if (arg == "--objects")
+            num_objects = value;
+        else if (arg == "--assets")
+            num_assets = value;
+        else if (arg == "--meshes")
+            num_meshes = value;
+        else if (arg == "--materials")
+            num_materials = value;
+    }
+
+    // the packets of the models in g_models order: an object's meshes one after the other
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> depth(0.5f, 200.0f);
+    Mesh mesh;
+    MeshDrawList draw_list;
+    Material material;
+    RenderQueue queue;
+    for (int o = 0; o < num_objects; ++o)
+    {
+        int asset = (int) (rng() % num_assets);
+        float object_depth = depth(rng);
+        for (int m = 0; m < num_meshes; ++m)
+        {
+            DrawPacket packet;
+            packet.mesh = &mesh;
+            packet.draw_list = &draw_list;
+            packet.material = &material;
+            packet.vertex_array = (GLuint) (1 + asset * num_meshes + m);
+            packet.object = (uint32_t) o;
+            packet.material_slot = (uint32_t) ((asset * 7 + m) % num_materials);
+            packet.depth = object_depth + 0.01f * m;
+            queue.add(packet);
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << queue.packets().size() << " packets: " << num_objects << " objects of " << num_assets << " assets x "
+              << num_meshes << " meshes, " << num_materials << " materials" << std::endl;
+
+    queue.is_sorted = false;
+    queue.sort();
+    print_changes("as added", queue.emitted_changes());
+
+    queue.is_sorted = true;
+    queue.sort_order = kSortByState;
+    queue.sort();
+    print_changes("program, material, mesh, depth", queue.submitted_changes());
+
+    queue.sort_order = kSortFrontToBack;
+    queue.sort();
+    print_changes("program, depth, material, mesh", queue.submitted_changes());
+    bool is_ordered = is_front_to_back(queue.packets(), queue.order());
+    std::cout << "  front to back " << (is_ordered ? "yes" : "NO") << std::endl;
+
+    // the sort alone, on the keys of both layouts
+    bool is_same = true;
+    for (int order = kSortByState; order <= kSortFrontToBack; ++order)
+    {
+        std::vector<SortItem> keys(queue.packets().size());
+        for (std::size_t i = 0; i < keys.size(); ++i)
+        {
+            keys[i].key = make_sort_key(queue.packets()[i], (RenderSortOrder) order);
+            keys[i].index = (uint32_t) i;
+        }
+
+        std::vector<SortItem> radix, scratch, reference;
+        double radix_ms = bench_best_ms([&]() { radix = keys; radix_sort(radix, scratch); });
+        double std_ms = bench_best_ms([&]() {
+            reference = keys;
+            std::stable_sort(reference.begin(), reference.end(), [](const SortItem& a, const SortItem& b) { return a.key < b.key; });
+        });
+        for (std::size_t i = 0; i < keys.size(); ++i)
+            is_same = is_same && radix[i].index == reference[i].index;
+
+        std::cout << "  " << (order == kSortByState ? "by state     " : "front to back")
+                  << "  radix_sort " << std::setw(8) << radix_ms << " ms  std::stable_sort " << std::setw(8) << std_ms << " ms" << std::endl;
+    }
+    std::cout << "  radix_sort order " << (is_same ? "matches" : "DIFFERS") << std::endl;
+    return (is_same && is_ordered) ? 0 : 1;
+}
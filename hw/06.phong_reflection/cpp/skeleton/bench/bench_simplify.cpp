@@ -0,0 +1,55 @@
+// LOD chain by quadric edge collapse: triangles, error and build time per LOD,
+// on bunny.ply and avocado.obj (meshes merged; material boundaries stay locked).
+//
+//   make bench
+//   ./bench_simplify [model ...]
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../MeshSimplify.h"
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+    }
+
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        BenchMesh mesh;
+        if (!load_bench_mesh(paths[i], mesh))
+            continue;
+
+        std::cout << paths[i] << ": " << mesh.num_triangles() << " triangles, " << mesh.positions.size() << " vertices" << std::endl;
+
+        glm::vec3 p_min = mesh.positions[0], p_max = mesh.positions[0];
+        for (std::size_t v = 1; v < mesh.positions.size(); ++v)
+        {
+            p_min = glm::min(p_min, mesh.positions[v]);
+            p_max = glm::max(p_max, mesh.positions[v]);
+        }
+        float radius = 0.5f * glm::length(p_max - p_min);
+
+        std::vector<unsigned int> lod_indices;
+        std::vector<MeshLod> lods;
+        BenchTimer timer;
+        build_lod_chain(mesh.tv_indices, &mesh.positions[0], mesh.positions.size(), lod_indices, lods);
+        double ms = timer.elapsed_ms();
+
+        for (std::size_t l = 0; l < lods.size(); ++l)
+        {
+            std::cout << "  LOD " << l << ": " << std::setw(7) << lods[l].index_count / 3 << " triangles"
+                      << std::scientific << std::setprecision(2)
+                      << ", error " << lods[l].error << " (" << lods[l].error / radius << " x radius)"
+                      << std::fixed << std::endl;
+        }
+        std::cout << "  build time " << std::setprecision(1) << ms << " ms" << std::endl;
+    }
+
+    return 0;
+}
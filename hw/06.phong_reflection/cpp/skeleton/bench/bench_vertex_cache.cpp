@@ -0,0 +1,55 @@
+// post-transform vertex cache: ACMR / ATVR before and after reorder_for_vertex_cache()
+// (FIFO 16 / 32 simulation, no GPU needed), on bunny.ply and avocado.obj.
+//
+//   make bench
+//   ./bench_vertex_cache [model ...]
+#include <iomanip>
+
+#include "BenchUtil.h"
+#include "../MeshOptimizer.h"
+
+static void print_stats(const char* label, const BenchMesh& mesh)
+{
+    std::cout << "  " << std::left << std::setw(10) << label << std::right;
+
+    const unsigned int cache_sizes[] = { 16, 32 };
+    for (int i = 0; i < 2; ++i)
+    {
+        VertexCacheStats stats = analyze_vertex_cache(mesh.tv_indices, mesh.positions.size(), cache_sizes[i]);
+        std::cout << "  FIFO " << std::setw(2) << cache_sizes[i] << ": ACMR " << stats.acmr << ", ATVR " << stats.atvr;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+        paths.push_back(argv[i]);
+    if (paths.empty())
+    {
+        paths.push_back("models/bunny.ply");
+        paths.push_back("models/avocado.obj");
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (std::size_t i = 0; i < paths.size(); ++i)
+    {
+        BenchMesh mesh;
+        if (!load_bench_mesh(paths[i], mesh))
+            continue;
+
+        std::cout << paths[i] << ": " << mesh.num_triangles() << " triangles, " << mesh.positions.size() << " vertices" << std::endl;
+        print_stats("original", mesh);
+
+        BenchMesh reordered = mesh;
+        BenchTimer timer;
+        reorder_for_vertex_cache(reordered.tv_indices, reordered.positions.size());
+        double ms = timer.elapsed_ms();
+
+        print_stats("forsyth", reordered);
+        std::cout << "  reorder time: " << ms << " ms" << std::endl;
+    }
+
+    return 0;
+}
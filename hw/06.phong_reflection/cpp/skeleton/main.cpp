@@ -1,5 +1,5 @@
 ﻿///// main.cpp
-///// OpenGL 3+, GLSL 1.20, GLEW, GLFW3
+///// OpenGL 3+, GLSL 1.20 (1.40 with uniform blocks), GLEW, GLFW3
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -10,6 +10,8 @@
 #include <fstream>
 #include <cassert>
 #include <map>
+#include <algorithm>
+#include <memory>
 
 // include glm
 #include <glm/glm.hpp>
@@ -30,6 +32,17 @@
 #include "Model.h"
 #include "Mesh.h"
 #include "Light.h"
+#include "VertexFormat.h"
+#include "AssetLoader.h"
+#include "ChunkedModel.h"
+#include "ImportFlags.h"
+#include "ProcessMemory.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include "RenderQueue.h"
+#include "InstancedModel.h"
+#include "MeshPool.h"
+#include "IndirectDraw.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 /// initialization 관련 변수 및 함수
@@ -37,6 +50,8 @@
 GLFWwindow* createWindow(int width, int height, const char* title);
 void init_window(GLFWwindow* window);
 bool init_scene(const std::string& filename);
+bool read_model_name(std::istream& fin, std::string& name, std::string& import_spec);
+int  profile_scene_import(const std::string& filename);
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -57,6 +72,7 @@ GLint   loc_u_PVM;        // uniform 변수 u_PVM 위치
 GLint   loc_u_view_matrix;
 GLint   loc_u_model_matrix;
 GLint   loc_u_normal_matrix;
+GLint   loc_u_oct_normal;       // a_normal is octahedral-encoded (quantized vertex formats)
 
 GLint   loc_u_camera_position;
 GLint   loc_u_light_position;
@@ -71,8 +87,34 @@ GLint   loc_u_obj_specular;
 GLint   loc_u_obj_shininess;
 GLint   loc_a_normal;
 
+// the draws of render_object() set the GL state through g_gl_state (repeated calls are dropped)
+GLStateCache g_gl_state;
+// the draws of the models in key order: front to back (the default), or grouped by program, material and mesh
+RenderQueue g_render_queue;
+
+// GLSL 1.40 variant (GL 3.1+): the uniforms above in three blocks (see UniformBlocks.h)
+GLuint  program_ubo = 0;
+UniformBlocks g_uniform_blocks;
+bool    g_use_uniform_blocks = true;
+std::vector<ObjectUniforms> g_object_uniforms;  // of every model in the frame (g_models, then g_chunked_models)
+
+// GLSL 1.40 + per-instance matrices (GL 3.3): the frame and material blocks of program_ubo
+GLuint  program_instanced = 0;
+GLint   loc_u_instanced_view_proj_matrix;
+GLint   loc_u_instanced_oct_normal;
+
+// GLSL 4.30 (GL 4.3): the meshes are uploaded into g_mesh_pool, and the packets drawn from it
+// with a glMultiDrawElementsIndirect per pool (object and material looked up by draw ID)
+MeshPool g_mesh_pool;
+GLuint  program_indirect = 0;
+IndirectDraw g_indirect_draw;
+bool    g_use_indirect_draw = true;
+
 GLuint create_shader_from_file(const std::string& filename, GLuint shader_type);
+GLuint create_program_from_files(const std::string& vertex_filename, const std::string& fragment_filename);
 void init_shader_program();
+void set_object_uniforms(const ObjectUniforms& object);
+void set_material_uniforms(const Material& material);
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,7 +129,62 @@ std::vector<Camera> g_cameras;
 std::vector<Model> g_models;
 Light g_light;
 
-bool load_asset(const std::string& filename);
+GLuint  g_draw_time_query = 0;      // GL_TIME_ELAPSED query for render_object() (0: GL < 3.3 without ARB_timer_query)
+bool    g_is_draw_time_pending = false;
+double  g_draw_time_ms = 0.0;       // GPU time of the last measured render_object()
+std::size_t g_timed_triangles = 0;  // #triangles drawn in the frame being measured
+double  g_triangle_rate = 0.0;      // triangles / s of the last measured render_object()
+std::size_t g_num_draw_times = 0;   // GPU times read so far (a new g_draw_time_ms each)
+
+bool    g_is_meshlet_culling = true;    // CPU cone / frustum culling of meshlets
+LodSelection g_lod_selection;           // pixels_per_unit is set from the camera every frame
+MeshletCullStats g_cull_stats;          // of the last render_object()
+
+const int kNumFrameTimes = 120;
+float   g_frame_times_ms[kNumFrameTimes] = { 0.0f };   // CPU frame times of the recent frames (ring buffer)
+int     g_frame_time_offset = 0;
+double  g_last_frame_time = 0.0;
+
+std::unique_ptr<AssetLoader> g_asset_loader;  // streams in the models of info.txt (slot i = g_models[i])
+std::vector<std::unique_ptr<ChunkedModel> > g_chunked_models;    // "chunked" models of info.txt (paged in by visibility)
+std::vector<std::unique_ptr<InstancedModel> > g_instanced_models;    // copies of a model placed by the instancing window
+bool    g_draw_instances_only = false;  // skip g_models and g_chunked_models (the stress ramp)
+int     g_num_instances = 1000;         // of the instancing window
+
+// instancing stress ramp: the instances of the selected model double every step up to
+// max_instances; a step averages the GPU / CPU times of kStressFrames frames after a warm-up
+const int kStressWarmupFrames = 10;
+const int kStressFrames = 30;
+struct InstanceStressStep
+{
+  std::size_t num_instances;
+  std::size_t num_triangles;      // drawn per frame
+  double      gpu_ms;
+  double      cpu_ms;
+};
+struct InstanceStress
+{
+  bool        is_running = false;
+  int         max_instances = 1 << 18;
+  std::size_t num_instances = 0;  // of the current step
+  int         num_frames = 0;     // of the current step, warm-up included
+  std::size_t num_draw_times = 0; // g_num_draw_times last seen
+  int         num_samples = 0;
+  double      gpu_ms_sum = 0.0;
+  double      cpu_ms_sum = 0.0;
+  std::vector<InstanceStressStep> steps;
+};
+InstanceStress g_instance_stress;
+int     g_upload_budget_kb = 2048;        // GPU upload per frame while models stream in
+double  g_scene_load_start_time = 0.0;
+bool    g_is_scene_loaded = false;
+double  g_scene_load_ms = 0.0;      // until every model was uploaded (shown in the model window)
+double  g_scene_resident_mb = 0.0;  // resident set once loaded, and its peak while loading
+double  g_scene_peak_mb = 0.0;
+
+void update_asset_loading();
+bool place_instances(std::size_t count);
+void update_instance_stress();
 // void init_buffer_objects();     // VBO init 함수: GPU의 VBO를 초기화하는 함수.
 void render_object();           // rendering 함수: 물체(삼각형)를 렌더링하는 함수.
 void render(GLFWwindow* window);
@@ -153,30 +250,34 @@ void scroll_callback(GLFWwindow* window, double x, double y)
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-  glm::vec3 translate = g_models[g_obj_select_idx].get_translate();
-  glm::vec3 scale = g_models[g_obj_select_idx].get_scale();
-  
-  // move left
-  if (key == GLFW_KEY_H && action == GLFW_PRESS) 
-    translate[0] -= 0.1f;
-  // mode right
-  if (key == GLFW_KEY_L && action == GLFW_PRESS)
-    translate[0] += 0.1f;
-  // move up
-  if (key == GLFW_KEY_K && action == GLFW_PRESS)
-    translate[1] += 0.1f;
-  // move down 
-  if (key == GLFW_KEY_J && action == GLFW_PRESS)
-    translate[1] -= 0.1f;
-
-  // scale
-  if (key == GLFW_KEY_EQUAL && action == GLFW_PRESS)
-    scale += 0.1f;
-  if (key == GLFW_KEY_MINUS && action == GLFW_PRESS)
-    scale -= 0.1f;
-  
-  g_models[g_obj_select_idx].set_translate(translate);
-  g_models[g_obj_select_idx].set_scale(scale);
+  // a scene of chunked models only has no g_models
+  if (!g_models.empty())
+  {
+    glm::vec3 translate = g_models[g_obj_select_idx].get_translate();
+    glm::vec3 scale = g_models[g_obj_select_idx].get_scale();
+
+    // move left
+    if (key == GLFW_KEY_H && action == GLFW_PRESS) 
+      translate[0] -= 0.1f;
+    // mode right
+    if (key == GLFW_KEY_L && action == GLFW_PRESS)
+      translate[0] += 0.1f;
+    // move up
+    if (key == GLFW_KEY_K && action == GLFW_PRESS)
+      translate[1] += 0.1f;
+    // move down 
+    if (key == GLFW_KEY_J && action == GLFW_PRESS)
+      translate[1] -= 0.1f;
+
+    // scale
+    if (key == GLFW_KEY_EQUAL && action == GLFW_PRESS)
+      scale += 0.1f;
+    if (key == GLFW_KEY_MINUS && action == GLFW_PRESS)
+      scale -= 0.1f;
+
+    g_models[g_obj_select_idx].set_translate(translate);
+    g_models[g_obj_select_idx].set_scale(scale);
+  }
 
   // camera extrinsic parameter
   if (key == GLFW_KEY_A && action == GLFW_PRESS)
@@ -220,23 +321,59 @@ bool init_scene(const std::string& filename)
 
   int count;
   fin >> count;
+
+  // the models stream in while the scene renders (see update_asset_loading());
+  // until then g_models[i] only carries the name and the transform
+  g_scene_load_start_time = glfwGetTime();
+  g_asset_loader.reset(new AssetLoader((unsigned int) std::min<std::size_t>(count, num_worker_threads())));
+  const unsigned int process_flags = kMeshProcessVertexCache | kMeshProcessOverdraw | kMeshProcessMeshlets | kMeshProcessLods | kMeshProcessVertexFetch;
   for (int i = 0; i < count; i++)
   {
     std::string name;
     glm::vec3   vec_scale, vec_translate;
 
-    fin >> name;
-    if (!load_asset(name))
-    { 
-      std::cout << "Failed to load a asset file: " << name << std::endl;
-      return -1;
-    }
-
+    std::string import_spec;
+    read_model_name(fin, name, import_spec);
     fin >> vec_scale[0] >> vec_scale[1] >> vec_scale[2] 
         >> vec_translate[0] >> vec_translate[1] >> vec_translate[2];
 
-    g_models[i].set_scale(vec_scale);
-    g_models[i].set_translate(vec_translate);
+    // "chunked" after the path: a mesh too large for memory, paged in by visibility (binary PLY);
+    // its .chunks file is built here the first time, which reads the whole source once
+    if (import_spec == "chunked")
+    {
+      std::unique_ptr<ChunkedModel> chunked(new ChunkedModel());
+      chunked->set_name(name);
+      chunked->set_scale(vec_scale);
+      chunked->set_translate(vec_translate);
+      if (!chunked->load_model(name))
+      {
+        std::cout << filename << ": failed to load the chunked model " << name << std::endl;
+        return false;
+      }
+      g_chunked_models.push_back(std::move(chunked));
+      continue;
+    }
+
+    Model model;
+    model.set_name(name);
+    model.set_scale(vec_scale);
+    model.set_translate(vec_translate);
+
+    // import flags after the path: the model goes through Assimp with them
+    if (!import_spec.empty())
+    {
+      std::string error;
+      if (!parse_import_flags(import_spec, model.import_flags, &error))
+      {
+        std::cout << filename << ": " << error << std::endl;
+        return false;
+      }
+      model.use_native_ply = false;
+      model.use_native_obj = false;
+    }
+    g_models.push_back(model);
+
+    g_asset_loader->add(name, process_flags, model);
   }
 
   // init g_cameras
@@ -268,6 +405,54 @@ bool init_scene(const std::string& filename)
   return true;
 }
 
+// the path line of a model in info.txt, optionally followed by Assimp import flags
+// (see parse_import_flags()), e.g. "models/bunny.ply realtime_max_quality-CalcTangentSpace",
+// or by "chunked" for an out-of-core model (see ChunkedModel), e.g. "models/scan.ply chunked"
+bool read_model_name(std::istream& fin, std::string& name, std::string& import_spec)
+{
+  fin >> name;
+  std::getline(fin, import_spec);
+
+  std::size_t begin = import_spec.find_first_not_of(" \t\r");
+  std::size_t end = import_spec.find_last_not_of(" \t\r");
+  import_spec = (begin == std::string::npos) ? std::string() : import_spec.substr(begin, end - begin + 1);
+  return !fin.fail();
+}
+
+// --profile-import: every Assimp post-process step of the models of the scene on its own
+// (time, scene and process memory), without a window
+int profile_scene_import(const std::string& filename)
+{
+  std::ifstream fin(filename);
+  if (fin.fail())
+  {
+    std::cout << "Failed to load a info file" << std::endl;
+    return -1;
+  }
+
+  int count;
+  fin >> count;
+  for (int i = 0; i < count; i++)
+  {
+    std::string name, import_spec, error;
+    glm::vec3   vec_scale, vec_translate;
+    read_model_name(fin, name, import_spec);
+    fin >> vec_scale[0] >> vec_scale[1] >> vec_scale[2] 
+        >> vec_translate[0] >> vec_translate[1] >> vec_translate[2];
+
+    unsigned int import_flags = kDefaultImportFlags;
+    std::vector<ImportStepProfile> steps;
+    if ((!import_spec.empty() && !parse_import_flags(import_spec, import_flags, &error))
+        || !profile_import_steps(name, import_flags, steps, &error))
+    {
+      std::cout << error << std::endl;
+      return -1;
+    }
+    print_import_profile(name, import_flags, steps);
+  }
+  return 0;
+}
+
 void init_imgui(GLFWwindow* window) 
 {
   const char* glsl_version = "#version 120";
@@ -294,16 +479,108 @@ void init_imgui(GLFWwindow* window)
 }
 
 
-bool load_asset(const std::string& filename)
-{  
-  Model model;
-  if (model.load_model(filename))
+void update_asset_loading()
+{
+  if (!g_asset_loader || g_is_scene_loaded)
+    return;
+
+  std::vector<std::size_t> completed = g_asset_loader->update((std::size_t) g_upload_budget_kb * 1024);
+  for (std::size_t i = 0; i < completed.size(); ++i)
   {
-    g_models.push_back(model);
-    return true;
+    std::size_t slot = completed[i];
+    Model& placeholder = g_models[slot];
+    Model model = g_asset_loader->take_model(slot);
+
+    // keep what was edited while the model was loading
+    glm::quat quat;   placeholder.get_rotate(quat);
+    model.set_translate(placeholder.get_translate());
+    model.set_rotate(quat);
+    model.set_scale(placeholder.get_scale());
+    model.shading_type = placeholder.shading_type;
+    placeholder = model;
+  }
+
+  if (!g_asset_loader->is_busy())
+  {
+    g_is_scene_loaded = true;
+    g_scene_load_ms = (glfwGetTime() - g_scene_load_start_time) * 1000.0;
+    // steady state: the meshes alone (the import arrays and the aiScenes are released by now)
+    g_scene_resident_mb = resident_set_bytes() / (1024.0 * 1024.0);
+    g_scene_peak_mb = peak_resident_set_bytes() / (1024.0 * 1024.0);
   }
-  else 
+}
+
+// count copies of the selected model around it (in place of the ones placed before)
+bool place_instances(std::size_t count)
+{
+  if (program_instanced == 0 || g_models.empty())
+    return false;
+  const Model& source = g_models[g_obj_select_idx];
+  if (!source.is_uploaded() || source.meshes().empty())
+    return false;
+
+  // a copy every 1.5 model widths
+  glm::vec3 extent = (source.asset()->aabb_max - source.asset()->aabb_min) * source.get_scale();
+  float spacing = 1.5f * std::max(std::max(extent.x, extent.z), 1.0e-3f);
+
+  if (g_instanced_models.empty() || g_instanced_models[0]->model().asset() != source.asset())
+  {
+    g_instanced_models.clear();
+    g_instanced_models.push_back(std::unique_ptr<InstancedModel>(new InstancedModel(source)));
+  }
+  g_instanced_models[0]->edit_instances() = make_instance_grid(count, source.get_translate(), spacing, source.get_scale());
+  return true;
+}
+
+bool begin_instance_stress_step(std::size_t num_instances)
+{
+  InstanceStress& stress = g_instance_stress;
+  if (!place_instances(num_instances))
     return false;
+
+  stress.num_instances = num_instances;
+  stress.num_frames = 0;
+  stress.num_samples = 0;
+  stress.gpu_ms_sum = 0.0;
+  stress.cpu_ms_sum = 0.0;
+  return true;
+}
+
+void update_instance_stress()
+{
+  InstanceStress& stress = g_instance_stress;
+  if (!stress.is_running)
+    return;
+
+  // the frames of this step after the warm-up (the GPU times come a frame or two late)
+  ++stress.num_frames;
+  if (stress.num_frames > kStressWarmupFrames)
+  {
+    stress.cpu_ms_sum += g_frame_times_ms[(g_frame_time_offset + kNumFrameTimes - 1) % kNumFrameTimes];
+    // without the timer query every frame is a sample (and the GPU time stays 0)
+    if (g_draw_time_query == 0 || g_num_draw_times != stress.num_draw_times)
+    {
+      stress.gpu_ms_sum += g_draw_time_ms;
+      ++stress.num_samples;
+    }
+  }
+  stress.num_draw_times = g_num_draw_times;
+  if (stress.num_samples < kStressFrames)
+    return;
+
+  InstanceStressStep step;
+  step.num_instances = stress.num_instances;
+  step.num_triangles = g_instanced_models.empty() ? 0 : g_instanced_models[0]->num_drawn_triangles();
+  step.gpu_ms = stress.gpu_ms_sum / stress.num_samples;
+  step.cpu_ms = stress.cpu_ms_sum / (stress.num_frames - kStressWarmupFrames);
+  stress.steps.push_back(step);
+
+  std::size_t next = 2 * stress.num_instances;
+  if (next > (std::size_t) stress.max_instances || !begin_instance_stress_step(next))
+  {
+    stress.is_running = false;
+    g_draw_instances_only = false;
+  }
 }
 
 void compose_imgui_frame()
@@ -320,15 +597,26 @@ void compose_imgui_frame()
   }
 
   // control window
+  if (!g_models.empty())
   {
     ImGui::Begin("모델(model)");
 
     for (std::size_t i = 0; i < g_models.size(); i++)
     {
-      ImGui::RadioButton(g_models[i].get_name().c_str(), &g_obj_select_idx, i);
+      // "###": the ID stays the same while the load state in the label changes
+      std::string label = g_models[i].get_name();
+      AssetLoadState state = g_asset_loader ? g_asset_loader->state(i) : kAssetLoaded;
+      if (state == kAssetUploading)
+        label += " (uploading " + std::to_string((int) (100.0f * g_asset_loader->upload_progress(i))) + "%)";
+      else if (state != kAssetLoaded)
+        label += std::string(" (") + to_string(state) + ")";
+      label += "###model" + std::to_string(i);
+      ImGui::RadioButton(label.c_str(), &g_obj_select_idx, i);
     }
 
     Model& model = g_models[g_obj_select_idx];
+    // draw path / vertex format rebuild the GL buffers, which a model still loading has not got
+    bool is_model_loaded = !g_asset_loader || g_asset_loader->state(g_obj_select_idx) == kAssetLoaded;
 
     glm::vec3 translate = model.get_translate();
     glm::quat quat;   model.get_rotate(quat);
@@ -350,25 +638,109 @@ void compose_imgui_frame()
     bool is_flat_shading = prev_shading_type ? kFlat : kSmooth;
     ImGui::Checkbox("Flat shading: ", &is_flat_shading);
     model.shading_type = is_flat_shading ? ShadingType::kFlat : ShadingType::kSmooth;
+    // both normal streams stay in GPU memory; Model::draw() just picks one of them
     if (model.shading_type != prev_shading_type)
+      std::cout << "shading changed" << std::endl;
+
+    ImGui::PlotLines("frame time (ms)", g_frame_times_ms, kNumFrameTimes, g_frame_time_offset, NULL, 0.0f, 50.0f, ImVec2(0.0f, 60.0f));
+    ImGui::SliderInt("upload budget (KiB / frame)", &g_upload_budget_kb, 64, 65536);
+    if (g_asset_loader && !g_is_scene_loaded)
+      ImGui::Text("streaming: %zu KiB this frame", g_asset_loader->last_update_bytes() / 1024);
+    else if (g_asset_loader)
+      ImGui::Text("scene loaded in %.1f ms, resident %.1f MB (peak while loading %.1f MB)", g_scene_load_ms, g_scene_resident_mb, g_scene_peak_mb);
+    ImGui::NewLine();
+
+    ImGui::BeginDisabled(!is_model_loaded);
+
+    ImGui::Text("Draw path");
+    DrawType prev_draw_type = model.draw_type;
+    int draw_type = model.draw_type;
+    ImGui::RadioButton("glDrawElements", &draw_type, kDrawElements);
+    ImGui::RadioButton("glDrawArrays", &draw_type, kDrawArrays);
+    if ((DrawType) draw_type != prev_draw_type)
+      model.set_vertex_format((DrawType) draw_type, model.vertex_precision);
+
+    ImGui::Text("Vertex format");
+    VertexPrecision prev_vertex_precision = model.vertex_precision;
+    int vertex_precision = model.vertex_precision;
+    ImGui::RadioButton("float", &vertex_precision, kVertexFloat);
+    ImGui::RadioButton("16-bit position, 2x16-bit oct normal", &vertex_precision, kVertexQuantized16);
+    ImGui::RadioButton("16-bit position, 2x8-bit oct normal", &vertex_precision, kVertexQuantized8);
+    if ((VertexPrecision) vertex_precision != prev_vertex_precision)
+      model.set_vertex_format(model.draw_type, (VertexPrecision) vertex_precision);
+    ImGui::EndDisabled();
+    if (model.vertex_precision != kVertexFloat)
     {
-      for (std::size_t i = 0; i < model.meshes.size(); ++i)
+      // largest error over the meshes against the float reference
+      QuantizationError error;
+      for (std::size_t i = 0; i < model.meshes().size(); ++i)
       {
-        Mesh& mesh = model.meshes[i];
+        const QuantizationError& mesh_error = model.meshes()[i].quantization_error();
+        error.max_position = std::max(error.max_position, mesh_error.max_position);
+        error.max_normal_degrees = std::max(error.max_normal_degrees, mesh_error.max_normal_degrees);
+        error.max_color = std::max(error.max_color, mesh_error.max_color);
+      }
+      ImGui::Text("max error: position %.2e, normal %.3f deg, color %.4f", error.max_position, error.max_normal_degrees, error.max_color);
+    }
+    // the meshes (and materials) of a model are shared by the models of the same file and options
+    ImGui::Text("VRAM (model): %zu bytes, shared by %ld models", model.gpu_bytes(), model.num_asset_owners());
+    if (g_asset_loader && is_model_loaded)
+    {
+      if (g_asset_loader->is_shared(g_obj_select_idx))
+        ImGui::Text("load: shares the meshes of an earlier model");
+      else
+        ImGui::Text("load: import %.1f ms, upload %.2f ms (GL time over the frames)", g_asset_loader->import_ms(g_obj_select_idx), g_asset_loader->upload_ms(g_obj_select_idx));
+    }
+    if (g_asset_loader)
+      ImGui::Text("VRAM (scene): %zu bytes in %zu distinct models", g_asset_loader->registry().gpu_bytes(), g_asset_loader->registry().num_assets());
+    if (g_draw_time_query != 0)
+      ImGui::Text("GPU draw time (scene): %.3f ms", g_draw_time_ms);
+    else
+      ImGui::Text("GPU draw time (scene): not supported (GL 3.3)");
+    ImGui::BeginDisabled(!g_uniform_blocks.is_ready());
+    ImGui::Checkbox("Uniform buffer objects (GLSL 1.40)", &g_use_uniform_blocks);
+    ImGui::EndDisabled();
+    ImGui::NewLine();
 
-        mesh.set_gl_buffers(model.shading_type);
+    ImGui::Text("Meshlets");
+    ImGui::Checkbox("Cone / frustum culling", &g_is_meshlet_culling);
+    ImGui::Text("meshlets: %zu, back-facing: %zu, outside: %zu",
+      g_cull_stats.num_meshlets, g_cull_stats.num_backfacing, g_cull_stats.num_outside);
+    ImGui::Text("triangles: %zu / %zu in %zu draw ranges",
+      g_cull_stats.num_drawn_triangles, g_cull_stats.num_triangles, g_cull_stats.num_draw_ranges);
+    ImGui::Text("throughput: %.1f M triangles/s", g_triangle_rate * 1.0e-6);
+    ImGui::NewLine();
+
+    ImGui::Text("LOD");
+    ImGui::SliderFloat("max error (pixels)", &g_lod_selection.max_pixel_error, 0.25f, 16.0f);
+    ImGui::SliderInt("force LOD (-1: auto)", &g_lod_selection.forced_lod, -1, kMaxMeshLods - 1);
+    for (unsigned int l = 0; l < kMaxMeshLods; ++l)
+    {
+      // over all meshes of the model: triangles, worst error, #meshes drawn with this LOD now
+      std::size_t num_triangles = 0, num_meshes = 0, num_drawn = 0;
+      float max_error = 0.0f;
+      for (std::size_t i = 0; i < model.meshes().size(); ++i)
+      {
+        const Mesh& mesh = model.meshes()[i];
+        if (l >= mesh.lods().size())
+          continue;
+        num_triangles += mesh.lods()[l].index_count / 3;
+        max_error = std::max(max_error, mesh.lods()[l].error);
+        ++num_meshes;
+        num_drawn += (model.current_lod(i) == l);
       }
-      std::cout << "shading changed" << std::endl;
-    }    
+      if (num_meshes > 0)
+        ImGui::Text("LOD %u: %zu triangles, error %.2e, drawn %zu / %zu", l, num_triangles, max_error, num_drawn, num_meshes);
+    }
     ImGui::NewLine();
 
     ImGui::Text("Materials");
 
    
     std::string label;
-    for (std::size_t i = 0; i < model.meshes.size(); ++i)
+    for (std::size_t i = 0; i < model.meshes().size(); ++i)
     {
-      Mesh& mesh = model.meshes[i];
+      Mesh& mesh = model.meshes()[i];
 
       label = mesh.material.name + "-ambient";
       ImGui::ColorEdit3(label.c_str(), glm::value_ptr(mesh.material.ambient));
@@ -441,6 +813,146 @@ void compose_imgui_frame()
     ImGui::End();
   }
 
+  {
+    // calls render_object() made through g_gl_state in the last frame
+    ImGui::Begin("GL 상태 (state calls)");
+
+    const GLStateStats& stats = g_gl_state.last_frame_stats();
+    ImGui::Text("issued: %zu, skipped: %zu, draws: %zu", stats.total_issued(), stats.total_skipped(), stats.num_draws);
+    for (int i = 0; i < kNumStateCalls; ++i)
+      ImGui::Text("%-24s %6zu issued %6zu skipped", state_call_name((GLStateCall) i), stats.issued[i], stats.skipped[i]);
+    if (g_uniform_blocks.is_ready())
+      ImGui::Text("materials in uniform blocks: %zu", g_uniform_blocks.num_materials());
+    ImGui::Text("uniform blocks: %s, instancing: %s, multi-draw indirect: %s", g_uniform_blocks.is_ready() ? "on" : "not supported",
+      program_instanced != 0 ? "on" : "not supported", g_indirect_draw.is_ready() ? "on" : "not supported");
+    ImGui::NewLine();
+
+    // state changes between consecutive packets: in the order the models add them, and as submitted
+    ImGui::Text("Render queue");
+    ImGui::Checkbox("Sort draws", &g_render_queue.is_sorted);
+    int sort_order = g_render_queue.sort_order;
+    ImGui::RadioButton("program, material, mesh, depth", &sort_order, kSortByState);
+    ImGui::RadioButton("program, depth (front to back), material, mesh", &sort_order, kSortFrontToBack);
+    g_render_queue.sort_order = (RenderSortOrder) sort_order;
+
+    const DrawStateChanges& emitted = g_render_queue.emitted_changes();
+    const DrawStateChanges& submitted = g_render_queue.submitted_changes();
+    ImGui::Text("packets: %zu, sort: %.3f ms", g_render_queue.packets().size(), g_render_queue.sort_ms());
+    ImGui::Text("%-10s %8s %8s", "changes", "models", "queue");
+    ImGui::Text("%-10s %8zu %8zu", "program", emitted.program, submitted.program);
+    ImGui::Text("%-10s %8zu %8zu", "material", emitted.material, submitted.material);
+    ImGui::Text("%-10s %8zu %8zu", "mesh", emitted.vertex_array, submitted.vertex_array);
+    ImGui::Text("%-10s %8zu %8zu", "object", emitted.object, submitted.object);
+    ImGui::Text("%-10s %8zu %8zu", "total", emitted.total(), submitted.total());
+    ImGui::NewLine();
+
+    // the meshes in g_mesh_pool: their packets become commands of a multi-draw per pool
+    ImGui::Text("Multi-draw indirect");
+    ImGui::BeginDisabled(!g_indirect_draw.is_ready());
+    ImGui::Checkbox("glMultiDrawElementsIndirect (GL 4.3)", &g_use_indirect_draw);
+    ImGui::EndDisabled();
+    const IndirectDrawStats& indirect = g_indirect_draw.stats();
+    ImGui::Text("packets: %zu in %zu commands, %zu multi-draws; %zu outside the pool",
+      indirect.num_packets, indirect.num_commands, indirect.num_multi_draws, indirect.num_fallback_packets);
+    ImGui::Text("upload: %zu bytes (commands, draw data, objects, materials)", indirect.upload_bytes);
+    ImGui::Text("pool: %zu / %zu bytes in %zu buffer pairs", g_mesh_pool.used_bytes(), g_mesh_pool.gpu_bytes(), g_mesh_pool.num_pools());
+    for (std::size_t i = 0; i < g_mesh_pool.num_pools(); ++i)
+    {
+      const MeshPoolBuffers& pool = g_mesh_pool.buffers((int) i);
+      ImGui::Text("  %2d-byte vertices, %zu-byte indices: %zu ranges, %zu free, %zu grows",
+        (int) pool.format.stride(), pool.index_size(), pool.num_ranges, pool.vertices.num_free_ranges() + pool.indices.num_free_ranges(), pool.num_grows);
+      ImGui::Text("    vertices %zu / %zu, indices %zu / %zu",
+        pool.vertices.used(), pool.vertices.capacity(), pool.indices.used(), pool.indices.capacity());
+    }
+
+    ImGui::End();
+  }
+
+  if (program_instanced != 0 && !g_models.empty())
+  {
+    // copies of the selected model in one instanced draw per mesh
+    ImGui::Begin("인스턴싱 (instancing)");
+    InstanceStress& stress = g_instance_stress;
+
+    ImGui::Text("model: %s", g_models[g_obj_select_idx].get_name().c_str());
+    ImGui::BeginDisabled(stress.is_running);
+    ImGui::InputInt("instances", &g_num_instances, 1000, 10000);
+    g_num_instances = std::max(g_num_instances, 1);
+    if (ImGui::Button("Place"))
+      place_instances((std::size_t) g_num_instances);
+    ImGui::SameLine();
+    if (ImGui::Button("Remove"))
+      g_instanced_models.clear();
+    ImGui::Checkbox("Draw the instances only", &g_draw_instances_only);
+    ImGui::EndDisabled();
+
+    for (std::size_t i = 0; i < g_instanced_models.size(); ++i)
+    {
+      const InstancedModel& model = *g_instanced_models[i];
+      ImGui::Text("%zu instances, %zu triangles (LOD %u), instance buffer %zu bytes",
+        model.num_instances(), model.num_drawn_triangles(), model.model().current_lod(0), model.gpu_bytes());
+    }
+    ImGui::NewLine();
+
+    // x2 instances per step; the other models are not drawn while it runs
+    ImGui::Text("Stress ramp");
+    ImGui::BeginDisabled(stress.is_running);
+    ImGui::InputInt("max instances", &stress.max_instances, 0, 0);
+    stress.max_instances = std::max(stress.max_instances, 1);
+    if (ImGui::Button("Run"))
+    {
+      stress.steps.clear();
+      stress.is_running = begin_instance_stress_step(std::min<std::size_t>(1024, stress.max_instances));
+      g_draw_instances_only = stress.is_running;
+    }
+    ImGui::EndDisabled();
+    if (stress.is_running)
+      ImGui::Text("running: %zu instances, frame %d", stress.num_instances, stress.num_frames);
+
+    ImGui::Text("%10s %12s %8s %8s %10s %10s", "instances", "triangles", "GPU ms", "CPU ms", "M inst/s", "M tri/s");
+    for (std::size_t i = 0; i < stress.steps.size(); ++i)
+    {
+      const InstanceStressStep& step = stress.steps[i];
+      ImGui::Text("%10zu %12zu %8.3f %8.3f %10.2f %10.1f", step.num_instances, step.num_triangles, step.gpu_ms, step.cpu_ms,
+        step.num_instances / (step.gpu_ms * 1.0e3), step.num_triangles / (step.gpu_ms * 1.0e3));
+    }
+
+    ImGui::End();
+  }
+
+  if (!g_chunked_models.empty())
+  {
+    ImGui::Begin("out-of-core 모델 (chunked)");
+
+    for (std::size_t i = 0; i < g_chunked_models.size(); ++i)
+    {
+      ChunkedModel& model = *g_chunked_models[i];
+      const ChunkResidencyStats& stats = model.stats();
+      ImGui::PushID((int) i);
+
+      ImGui::Text("%s: %llu triangles in %zu chunks", model.get_name().c_str(), (unsigned long long) model.chunk_header().num_triangles, stats.num_chunks);
+
+      int budget_mb = (int) (model.memory_budget >> 20);
+      ImGui::SliderInt("memory budget (MiB)", &budget_mb, 16, 8192);
+      model.memory_budget = (std::size_t) budget_mb << 20;
+      bool is_flat_shading = model.shading_type == kFlat;
+      ImGui::Checkbox("Flat shading", &is_flat_shading);
+      model.shading_type = is_flat_shading ? kFlat : kSmooth;
+
+      ImGui::Text("visible: %zu, resident: %zu, drawn: %zu, loading: %zu",
+        stats.num_visible, stats.num_resident, stats.num_drawn, stats.num_loading);
+      ImGui::Text("resident: %.1f / %d MiB, triangles drawn: %zu",
+        stats.resident_bytes / (1024.0 * 1024.0), budget_mb, stats.num_drawn_triangles);
+      ImGui::Text("loads: %zu, evictions: %zu, over budget: %zu",
+        stats.num_loads, stats.num_evictions, stats.num_rejected);
+
+      ImGui::PopID();
+      ImGui::NewLine();
+    }
+
+    ImGui::End();
+  }
+
   if (is_font_loaded)
   {
     ImGui::PopFont();
@@ -496,55 +1008,130 @@ GLuint create_shader_from_file(const std::string& filename, GLuint shader_type)
   return shader;
 }
 
-// vertex shader와 fragment shader를 링크시켜 program을 생성하는 함수
-void init_shader_program()
+// vertex shader와 fragment shader를 링크시켜 program을 생성하는 함수 (실패하면 0)
+GLuint create_program_from_files(const std::string& vertex_filename, const std::string& fragment_filename)
 {
   GLuint vertex_shader
-    = create_shader_from_file("./shader/vertex.glsl", GL_VERTEX_SHADER);
+    = create_shader_from_file(vertex_filename, GL_VERTEX_SHADER);
 
   std::cout << "vertex_shader id: " << vertex_shader << std::endl;
-  assert(vertex_shader != 0);
 
   GLuint fragment_shader
-    = create_shader_from_file("./shader/fragment.glsl", GL_FRAGMENT_SHADER);
+    = create_shader_from_file(fragment_filename, GL_FRAGMENT_SHADER);
 
   std::cout << "fragment_shader id: " << fragment_shader << std::endl;
-  assert(fragment_shader != 0);
 
-  program = glCreateProgram();
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, fragment_shader);
-  glLinkProgram(program);
+  if (vertex_shader == 0 || fragment_shader == 0)
+  {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return 0;
+  }
+
+  GLuint linked_program = glCreateProgram();
+  glAttachShader(linked_program, vertex_shader);
+  glAttachShader(linked_program, fragment_shader);
+  // every Mesh VAO uses the same fixed attribute locations
+  VertexFormat::bind_attrib_locations(linked_program);
+  glLinkProgram(linked_program);
 
   GLint is_linked;
-  glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+  glGetProgramiv(linked_program, GL_LINK_STATUS, &is_linked);
   if (is_linked != GL_TRUE)
   {
     std::cout << "Shader LINK error: " << std::endl;
 
     GLint buf_len;
-    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &buf_len);
+    glGetProgramiv(linked_program, GL_INFO_LOG_LENGTH, &buf_len);
 
     std::string log_string(1 + buf_len, '\0');
-    glGetProgramInfoLog(program, buf_len, 0, (GLchar *)log_string.c_str());
+    glGetProgramInfoLog(linked_program, buf_len, 0, (GLchar *)log_string.c_str());
 
     std::cout << "error_log: " << log_string << std::endl;
 
-    glDeleteProgram(program);
-    program = 0;
+    glDeleteProgram(linked_program);
+    linked_program = 0;
   }
 
-  std::cout << "program id: " << program << std::endl;
+  // the program keeps them
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  std::cout << "program id: " << linked_program << std::endl;
+  return linked_program;
+}
+
+void init_shader_program()
+{
+  program = create_program_from_files("./shader/vertex.glsl", "./shader/fragment.glsl");
   assert(program != 0);
 
+  // without GL 3.1 (or a 1.40 shader that fails) everything goes through program
+  if (UniformBlocks::is_supported())
+  {
+    program_ubo = create_program_from_files("./shader/vertex_ubo.glsl", "./shader/fragment_ubo.glsl");
+    if (program_ubo != 0 && !g_uniform_blocks.init(program_ubo, g_gl_state))
+    {
+      glDeleteProgram(program_ubo);
+      program_ubo = 0;
+    }
+  }
+
+  // instancing reads the frame and material blocks of g_uniform_blocks
+  if (g_uniform_blocks.is_ready() && InstancedModel::is_supported())
+  {
+    program_instanced = create_program_from_files("./shader/vertex_instanced.glsl", "./shader/fragment_ubo.glsl");
+    if (program_instanced != 0 && !UniformBlocks::attach(program_instanced))
+    {
+      glDeleteProgram(program_instanced);
+      program_instanced = 0;
+    }
+    if (program_instanced != 0)
+    {
+      loc_u_instanced_view_proj_matrix = glGetUniformLocation(program_instanced, "u_view_proj_matrix");
+      loc_u_instanced_oct_normal = glGetUniformLocation(program_instanced, "u_oct_normal");
+    }
+  }
+
+  // the scene is loaded after this: every mesh goes into the pool
+  if (g_uniform_blocks.is_ready() && IndirectDraw::is_supported() && MeshPool::is_supported())
+  {
+    program_indirect = create_program_from_files("./shader/vertex_indirect.glsl", "./shader/fragment_ubo.glsl");
+    if (program_indirect != 0 && !g_indirect_draw.init(g_mesh_pool))
+    {
+      glDeleteProgram(program_indirect);
+      program_indirect = 0;
+    }
+    if (program_indirect != 0)
+      MeshPool::set_active(&g_mesh_pool);
+  }
+
   loc_u_PVM = glGetUniformLocation(program, "u_PVM");
 
   loc_a_position = glGetAttribLocation(program, "a_position");
   loc_a_color = glGetAttribLocation(program, "a_color");
 
-  // TODO: get locations of the GPU uniform/attribute variables 
-  //       for implementing Phong reflection model
+  loc_u_light_position     = glGetUniformLocation(program, "u_light_position");
+  loc_u_light_ambient      = glGetUniformLocation(program, "u_light_ambient");
+  loc_u_light_diffuse      = glGetUniformLocation(program, "u_light_diffuse");
+  loc_u_light_specular     = glGetUniformLocation(program, "u_light_specular");
+
+  loc_u_obj_ambient        = glGetUniformLocation(program, "u_obj_ambient");
+  loc_u_obj_diffuse        = glGetUniformLocation(program, "u_obj_diffuse");
+  loc_u_obj_specular       = glGetUniformLocation(program, "u_obj_specular");
+  loc_u_obj_shininess      = glGetUniformLocation(program, "u_obj_shininess");
+
+  loc_u_camera_position    = glGetUniformLocation(program, "u_camera_position");
+  loc_u_view_matrix        = glGetUniformLocation(program, "u_view_matrix");
+  loc_u_model_matrix       = glGetUniformLocation(program, "u_model_matrix");
+  loc_u_normal_matrix      = glGetUniformLocation(program, "u_normal_matrix");
+  loc_u_oct_normal         = glGetUniformLocation(program, "u_oct_normal");
 
+  loc_a_normal             = glGetAttribLocation(program, "a_normal");
+
+  // GL_TIME_ELAPSED is GL 3.3 (or ARB_timer_query): a legacy context draws without the GPU time
+  if (GLEW_VERSION_3_3 || GLEW_ARB_timer_query)
+    glGenQueries(1, &g_draw_time_query);
 }
 
 void render_object()
@@ -556,31 +1143,211 @@ void render_object()
   glm::mat4 mat_proj = camera.get_projection_matrix();
 
 
-  // 특정 쉐이더 프로그램 사용
-  glUseProgram(program);
+  // 이전 프레임의 GPU draw time 읽기 (결과가 준비되지 않았으면 기다리지 않음)
+  if (g_is_draw_time_pending)
+  {
+    GLint is_available = GL_FALSE;
+    glGetQueryObjectiv(g_draw_time_query, GL_QUERY_RESULT_AVAILABLE, &is_available);
+    if (is_available == GL_TRUE)
+    {
+      GLuint64 elapsed_ns = 0;
+      glGetQueryObjectui64v(g_draw_time_query, GL_QUERY_RESULT, &elapsed_ns);
+      g_draw_time_ms = elapsed_ns * 1.0e-6;
+      g_triangle_rate = elapsed_ns ? g_timed_triangles / (elapsed_ns * 1.0e-9) : 0.0;
+      g_is_draw_time_pending = false;
+      ++g_num_draw_times;
+    }
+  }
+
+  bool is_timing = g_draw_time_query != 0 && !g_is_draw_time_pending;
+  if (is_timing)
+    glBeginQuery(GL_TIME_ELAPSED, g_draw_time_query);
 
-  // TODO : send uniform for camera & light to GPU
+  // LOD: 화면에서 1 world unit의 pixel 수 (clip w = 1 기준, perspective/ortho 모두 mat_proj[1][1])
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  g_lod_selection.pixels_per_unit = mat_proj[1][1] * 0.5f * viewport[3];
 
+  // 보이는 meshlet만 그림 (cone culling을 하면 삼각형 단위 back-face culling도 켬)
+  g_cull_stats = MeshletCullStats();
+  for (std::size_t i = 0; !g_draw_instances_only && i < g_models.size(); ++i)
+    g_models[i].cull(mat_proj * mat_view, camera.position(), g_is_meshlet_culling, g_lod_selection, g_cull_stats);
+
+  // instanced models: the instance buffers are uploaded here, the triangles count all instances
+  for (std::size_t i = 0; i < g_instanced_models.size(); ++i)
+  {
+    g_instanced_models[i]->update();
+    g_instanced_models[i]->cull(mat_proj * mat_view, camera.position(), g_lod_selection, g_cull_stats);
+  }
+
+  // out-of-core models: page in the visible chunks (uploads happen here, on the GL thread)
+  std::size_t num_chunk_triangles = 0;
+  for (std::size_t i = 0; !g_draw_instances_only && i < g_chunked_models.size(); ++i)
+  {
+    g_chunked_models[i]->update(mat_proj * mat_view, camera.position());
+    num_chunk_triangles += g_chunked_models[i]->stats().num_drawn_triangles;
+  }
+  if (is_timing)
+    g_timed_triangles = g_cull_stats.num_drawn_triangles + num_chunk_triangles;
+
+  // a VAO for each pool the uploads above created
+  g_indirect_draw.update();
+
+  // the GL objects of this frame are all created (uploads above): draws from here on
+  g_gl_state.begin_frame();
+  g_gl_state.set_capability(GL_CULL_FACE, g_is_meshlet_culling);
+
+  // 모델마다 PVM / model / normal matrix (uniform blocks: 한 번에 upload)
+  glm::mat4 mat_view_proj = mat_proj * mat_view;
+  g_object_uniforms.resize(g_models.size() + g_chunked_models.size());
   for (std::size_t i = 0; i < g_models.size(); ++i)
   {
-    Model& model = g_models[i];
+    const Model& model = g_models[i];
 
-    // TODO : set mat_model, mat_normal, mat_PVM 
-    // TODO : send uniform data for model to GPU
-    
-    model.draw(loc_a_position, loc_a_normal, loc_u_obj_ambient, loc_u_obj_diffuse, loc_u_obj_specular, loc_u_obj_shininess);
+    glm::mat4 mat_model = model.get_model_matrix();
+    glm::mat3 mat_normal = glm::transpose(glm::inverse(glm::mat3(mat_model)));
+
+    // quantized positions: decode [0, 1]^3 -> model space as a part of the model matrix
+    mat_model = mat_model * model.get_position_decode_matrix();
+    g_object_uniforms[i].set(mat_view_proj * mat_model, mat_model, mat_normal, model.vertex_precision != kVertexFloat);
+  }
+  for (std::size_t i = 0; i < g_chunked_models.size(); ++i)
+  {
+    glm::mat4 mat_model = g_chunked_models[i]->get_model_matrix();
+    glm::mat3 mat_normal = glm::transpose(glm::inverse(glm::mat3(mat_model)));
+    g_object_uniforms[g_models.size() + i].set(mat_view_proj * mat_model, mat_model, mat_normal, false);
+  }
+
+  bool use_blocks = g_use_uniform_blocks && g_uniform_blocks.is_ready();
+
+  // the packets of every model (in g_models, then g_chunked_models order), sorted by key
+  uint32_t program_index = use_blocks ? 1 : 0;
+  g_render_queue.clear();
+  if (!g_draw_instances_only)
+  {
+    for (std::size_t i = 0; i < g_models.size(); ++i)
+      g_models[i].emit(g_render_queue, g_uniform_blocks, program_index, (uint32_t) i, mat_view);
+    for (std::size_t i = 0; i < g_chunked_models.size(); ++i)
+      g_chunked_models[i]->emit(g_render_queue, g_uniform_blocks, program_index, (uint32_t) (g_models.size() + i), mat_view);
+  }
+  g_render_queue.sort();
+
+  // the frame block: program_ubo and program_instanced
+  if (g_uniform_blocks.is_ready())
+  {
+    FrameUniforms frame;
+    frame.view_matrix = mat_view;
+    frame.camera_position = camera.position();
+    frame.light_position = g_light.pos;
+    frame.light_ambient = g_light.ambient;
+    frame.light_diffuse = g_light.diffuse;
+    frame.light_specular = g_light.specular;
+    g_uniform_blocks.set_frame(frame);
+  }
+
+  // 특정 쉐이더 프로그램 사용
+  g_gl_state.use_program(use_blocks ? program_ubo : program);
+
+  if (use_blocks)
+  {
+    g_uniform_blocks.upload_objects(g_object_uniforms);
+  }
+  else
+  {
+    // camera and light: sent again only when they change
+    g_gl_state.uniform(loc_u_view_matrix, mat_view);
+    g_gl_state.uniform(loc_u_camera_position, camera.position());
+
+    g_gl_state.uniform(loc_u_light_position, g_light.pos);
+    g_gl_state.uniform(loc_u_light_ambient, g_light.ambient);
+    g_gl_state.uniform(loc_u_light_diffuse, g_light.diffuse);
+    g_gl_state.uniform(loc_u_light_specular, g_light.specular);
+  }
+
+  // each packet binds its object and material (g_gl_state drops what the packet before set);
+  // with multi-draw indirect only the packets of meshes outside the pool are drawn here
+  bool use_indirect = g_use_indirect_draw && g_indirect_draw.is_ready();
+  g_indirect_draw.clear();
+
+  const std::vector<DrawPacket>& packets = g_render_queue.packets();
+  const std::vector<uint32_t>& order = g_render_queue.order();
+  for (std::size_t i = 0; i < order.size(); ++i)
+  {
+    const DrawPacket& packet = packets[order[i]];
+    if (use_indirect && g_indirect_draw.add(packet))
+      continue;
+
+    if (use_blocks)
+    {
+      g_uniform_blocks.bind_object(packet.object);
+      g_uniform_blocks.bind_material(packet.material_slot, *packet.material);
+    }
+    else
+    {
+      set_object_uniforms(g_object_uniforms[packet.object]);
+      set_material_uniforms(*packet.material);
+    }
+    packet.mesh->draw(packet.shading_type, *packet.draw_list, g_gl_state);
+  }
+
+  // the pooled packets in queue order: a multi-draw per pool
+  if (use_indirect)
+  {
+    g_gl_state.use_program(program_indirect);
+    g_indirect_draw.submit(g_gl_state, g_object_uniforms);
+  }
+
+  // instanced models: a draw per mesh for all the instances
+  if (!g_instanced_models.empty())
+  {
+    g_gl_state.use_program(program_instanced);
+    g_gl_state.uniform(loc_u_instanced_view_proj_matrix, mat_view_proj);
+    for (std::size_t i = 0; i < g_instanced_models.size(); ++i)
+      g_instanced_models[i]->draw(g_gl_state, g_uniform_blocks, loc_u_instanced_oct_normal);
+  }
+
+  // the program and the last VAO stay bound: ImGui saves and restores them, and the
+  // next frame binds what it needs (only if it differs)
+
+  if (is_timing)
+  {
+    glEndQuery(GL_TIME_ELAPSED);
+    g_is_draw_time_pending = true;
   }
+}
 
-  // 쉐이더 프로그램 사용해제
-  glUseProgram(0);
+void set_object_uniforms(const ObjectUniforms& object)
+{
+  g_gl_state.uniform(loc_u_PVM, object.PVM);
+  g_gl_state.uniform(loc_u_model_matrix, object.model_matrix);
+  g_gl_state.uniform(loc_u_normal_matrix, object.get_normal_matrix());
+  g_gl_state.uniform(loc_u_oct_normal, object.oct_normal);
+}
+
+void set_material_uniforms(const Material& material)
+{
+  g_gl_state.uniform(loc_u_obj_ambient, material.ambient);
+  g_gl_state.uniform(loc_u_obj_diffuse, material.diffuse);
+  g_gl_state.uniform(loc_u_obj_specular, material.specular);
+  g_gl_state.uniform(loc_u_obj_shininess, material.shininess);
 }
 
 void render(GLFWwindow* window) 
 {
+  double now = glfwGetTime();
+  if (g_last_frame_time > 0.0)
+  {
+    g_frame_times_ms[g_frame_time_offset] = (float) ((now - g_last_frame_time) * 1000.0);
+    g_frame_time_offset = (g_frame_time_offset + 1) % kNumFrameTimes;
+  }
+  g_last_frame_time = now;
+
   glClearColor(g_clear_color[0], g_clear_color[1], g_clear_color[2], 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
   glfwPollEvents();
+  update_asset_loading();
+  update_instance_stress();
   compose_imgui_frame();
 
   render_object();
@@ -610,6 +1377,12 @@ void render(GLFWwindow* window)
 
 int main(int argc, char* argv[])
 {
+  for (int i = 1; i < argc; ++i)
+  {
+    if (std::string(argv[i]) == "--profile-import")
+      return profile_scene_import("info.txt");
+  }
+
   // create window
   GLFWwindow* window = createWindow(1000, 1000, "Hello Assimp");
 
@@ -627,6 +1400,15 @@ int main(int argc, char* argv[])
     render(window);
   }
 
+  // the last Model of an asset deletes its GL buffers: before the context goes
+  g_models.clear();
+  g_asset_loader.reset();
+  g_chunked_models.clear();
+  g_instanced_models.clear();
+  g_indirect_draw.release();
+  g_mesh_pool.release();
+  g_uniform_blocks.release();
+
   glfwTerminate();
 
   return 0;
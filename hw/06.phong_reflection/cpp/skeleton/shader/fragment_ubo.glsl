@@ -0,0 +1,10 @@
+#version 140                  // GLSL 1.40
+
+in  vec3 v_color;
+
+out vec4 frag_color;
+
+void main()
+{
+	frag_color = vec4(v_color, 1.0);
+}
@@ -8,6 +8,7 @@ uniform mat4 u_PVM;
 // for phong shading
 uniform mat4 u_model_matrix;
 uniform mat3 u_normal_matrix;
+uniform bool u_oct_normal;    // a_normal.xy: octahedral-encoded normal in [0, 1]^2 (quantized vertex formats)
 
 uniform vec3 u_light_position;
 uniform vec3 u_light_ambient;
@@ -24,12 +25,28 @@ uniform mat4 u_view_matrix;
 
 varying vec3 v_color;
 
+// must match oct_decode() in VertexFormat.cpp
+vec3 decode_normal()
+{
+  if (!u_oct_normal)
+    return a_normal;
+
+  vec2 f = a_normal.xy * 2.0 - 1.0;
+  vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+  if (n.z < 0.0)
+  {
+    vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    n.xy = (1.0 - abs(n.yx)) * s;
+  }
+  return normalize(n);
+}
+
 vec3 directional_light() 
 {
   vec3 color = vec3(0.0);
 
   vec3 position_wc = (u_model_matrix * vec4(a_position, 1.0f)).xyz;
-  vec3 normal_wc   = normalize(u_normal_matrix * a_normal);
+  vec3 normal_wc   = normalize(u_normal_matrix * decode_normal());
 
   vec3 light_dir = normalize(u_light_position);
 
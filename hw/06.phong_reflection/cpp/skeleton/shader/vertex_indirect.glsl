@@ -0,0 +1,98 @@
+#version 430                  // GLSL 4.30: vertex_ubo.glsl drawn by glMultiDrawElementsIndirect (see IndirectDraw.h)
+
+in vec3 a_position;           // per-vertex position (per-vertex input)
+in vec3 a_normal;
+
+in uvec2 a_draw_data;         // per draw (divisor 1, read at the command's base_instance): object, material
+
+// camera and light: once per frame (binding = kFrameBlockBinding)
+layout(std140, binding = 0) uniform FrameBlock
+{
+  mat4 u_view_matrix;
+  vec3 u_camera_position;
+  vec3 u_light_position;
+  vec3 u_light_ambient;
+  vec3 u_light_diffuse;
+  vec3 u_light_specular;
+};
+
+// ObjectUniforms of UniformBlocks.h (std430 lays it out as the std140 ObjectBlock)
+struct ObjectData
+{
+  mat4  PVM;
+  mat4  model_matrix;
+  vec4  normal_matrix[3];     // mat3 columns
+  ivec4 oct_normal;           // x: a_normal.xy is an octahedral-encoded normal in [0, 1]^2
+};
+
+// MaterialUniforms
+struct MaterialData
+{
+  vec3  ambient;    float pad0;
+  vec3  diffuse;    float pad1;
+  vec3  specular;
+  float shininess;
+};
+
+// kIndirectObjectBinding, kIndirectMaterialBinding
+layout(std430, binding = 0) readonly buffer ObjectBuffer
+{
+  ObjectData objects[];
+};
+
+layout(std430, binding = 1) readonly buffer MaterialBuffer
+{
+  MaterialData materials[];
+};
+
+out vec3 v_color;
+
+// must match oct_decode() in VertexFormat.cpp
+vec3 decode_normal(bool oct_normal)
+{
+  if (!oct_normal)
+    return a_normal;
+
+  vec2 f = a_normal.xy * 2.0 - 1.0;
+  vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+  if (n.z < 0.0)
+  {
+    vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    n.xy = (1.0 - abs(n.yx)) * s;
+  }
+  return normalize(n);
+}
+
+vec3 directional_light(ObjectData object, MaterialData material)
+{
+  vec3 color = vec3(0.0);
+
+  mat3 normal_matrix = mat3(object.normal_matrix[0].xyz, object.normal_matrix[1].xyz, object.normal_matrix[2].xyz);
+  vec3 position_wc = (object.model_matrix * vec4(a_position, 1.0)).xyz;
+  vec3 normal_wc   = normalize(normal_matrix * decode_normal(object.oct_normal.x != 0));
+
+  vec3 light_dir = normalize(u_light_position);
+
+  // ambient
+  color += (u_light_ambient * material.ambient);
+
+  // diffuse
+  float ndotl = max(dot(normal_wc, light_dir), 0.0);
+  color += (ndotl * u_light_diffuse * material.diffuse);
+
+  // specular
+  vec3 view_dir = normalize(u_camera_position - position_wc);
+  vec3 reflect_dir = reflect(-light_dir, normal_wc);
+
+  float rdotv = max(dot(view_dir, reflect_dir), 0.0);
+  color += (pow(rdotv, material.shininess) * u_light_specular * material.specular);
+
+  return color;
+}
+
+void main()
+{
+  ObjectData object = objects[a_draw_data.x];
+  gl_Position = object.PVM * vec4(a_position, 1.0);
+  v_color = directional_light(object, materials[a_draw_data.y]);
+}
@@ -0,0 +1,83 @@
+#version 140                  // GLSL 1.40: vertex.glsl with the uniforms in blocks (see UniformBlocks.h)
+
+in vec3 a_position;           // per-vertex position (per-vertex input)
+in vec3 a_normal;
+
+// camera and light: once per frame
+layout(std140) uniform FrameBlock
+{
+  mat4 u_view_matrix;
+  vec3 u_camera_position;
+  vec3 u_light_position;
+  vec3 u_light_ambient;
+  vec3 u_light_diffuse;
+  vec3 u_light_specular;
+};
+
+// one model
+layout(std140) uniform ObjectBlock
+{
+  mat4 u_PVM;
+  mat4 u_model_matrix;
+  mat3 u_normal_matrix;
+  bool u_oct_normal;          // a_normal.xy: octahedral-encoded normal in [0, 1]^2 (quantized vertex formats)
+};
+
+// one mesh
+layout(std140) uniform MaterialBlock
+{
+  vec3  u_obj_ambient;
+  vec3  u_obj_diffuse;
+  vec3  u_obj_specular;
+  float u_obj_shininess;
+};
+
+out vec3 v_color;
+
+// must match oct_decode() in VertexFormat.cpp
+vec3 decode_normal()
+{
+  if (!u_oct_normal)
+    return a_normal;
+
+  vec2 f = a_normal.xy * 2.0 - 1.0;
+  vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+  if (n.z < 0.0)
+  {
+    vec2 s = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    n.xy = (1.0 - abs(n.yx)) * s;
+  }
+  return normalize(n);
+}
+
+vec3 directional_light()
+{
+  vec3 color = vec3(0.0);
+
+  vec3 position_wc = (u_model_matrix * vec4(a_position, 1.0)).xyz;
+  vec3 normal_wc   = normalize(u_normal_matrix * decode_normal());
+
+  vec3 light_dir = normalize(u_light_position);
+
+  // ambient
+  color += (u_light_ambient * u_obj_ambient);
+
+  // diffuse
+  float ndotl = max(dot(normal_wc, light_dir), 0.0);
+  color += (ndotl * u_light_diffuse * u_obj_diffuse);
+
+  // specular
+  vec3 view_dir = normalize(u_camera_position - position_wc);
+  vec3 reflect_dir = reflect(-light_dir, normal_wc);
+
+  float rdotv = max(dot(view_dir, reflect_dir), 0.0);
+  color += (pow(rdotv, u_obj_shininess) * u_light_specular * u_obj_specular);
+
+  return color;
+}
+
+void main()
+{
+  gl_Position = u_PVM * vec4(a_position, 1.0);
+  v_color = directional_light();
+}
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <cassert>
 #include <map>
+#include <cctype>
 
 // include glm
 #include <glm/glm.hpp>
@@ -109,7 +110,8 @@ bool set_gl_buffers(Mesh& mesh);
 /// 렌더링 관련 변수 및 함수
 ////////////////////////////////////////////////////////////////////////////////
 bool init_scene(const std::string& filename);
-bool load_model(const std::string& filename);
+bool load_model(const std::string& filename, unsigned int import_flags = aiProcessPreset_TargetRealtime_MaxQuality);
+bool parse_import_flags(const std::string& line, unsigned int& flags);
 
 // void init_buffer_objects();     // VBO init 함수: GPU의 VBO를 초기화하는 함수.
 void render_object();           // rendering 함수: 물체(삼각형)를 렌더링하는 함수.
@@ -240,9 +242,17 @@ bool init_scene(const std::string& filename)
     return  false;
   }
 
-  std::string name;
+  // the model path, optionally followed by its Assimp import flags (see parse_import_flags())
+  std::string name, import_word;
+  unsigned int import_flags = aiProcessPreset_TargetRealtime_MaxQuality;
   fin >> name;
-  if (!load_model(name))
+  std::getline(fin, import_word);
+  if (!parse_import_flags(import_word, import_flags))
+  {
+    std::cout << "Unknown import flags: " << import_word << std::endl;
+    return false;
+  }
+  if (!load_model(name, import_flags))
   { 
     std::cout << "Failed to load a model file: " << name << std::endl;
     return -1;
@@ -267,9 +277,109 @@ bool init_scene(const std::string& filename)
 }
 
 
-bool load_model(const std::string& filename)
+// the import flags of a model, in the syntax of hw/06 (ImportFlags.h): presets and
+// aiProcess_ steps joined by '|', a step after '-' taken out again, e.g.
+//   realtime_max_quality-CalcTangentSpace-FindInvalidData
+//   Triangulate|JoinIdenticalVertices|GenSmoothNormals|SortByPType
+// presets: realtime_fast, realtime_quality, realtime_max_quality, none (the aiProcess_ prefix
+// of a step is optional). an empty line keeps flags
+bool find_import_flags(const std::string& name, unsigned int& flags)
+{
+  static const struct { unsigned int flag; const char* name; } steps[] = {
+    { aiProcess_ValidateDataStructure,  "ValidateDataStructure" },
+    { aiProcess_MakeLeftHanded,         "MakeLeftHanded" },
+    { aiProcess_FlipUVs,                "FlipUVs" },
+    { aiProcess_FlipWindingOrder,       "FlipWindingOrder" },
+    { aiProcess_RemoveComponent,        "RemoveComponent" },
+    { aiProcess_RemoveRedundantMaterials, "RemoveRedundantMaterials" },
+    { aiProcess_EmbedTextures,          "EmbedTextures" },
+    { aiProcess_FindInstances,          "FindInstances" },
+    { aiProcess_OptimizeGraph,          "OptimizeGraph" },
+    { aiProcess_OptimizeMeshes,         "OptimizeMeshes" },
+    { aiProcess_FindDegenerates,        "FindDegenerates" },
+    { aiProcess_GenUVCoords,            "GenUVCoords" },
+    { aiProcess_TransformUVCoords,      "TransformUVCoords" },
+    { aiProcess_GlobalScale,            "GlobalScale" },
+    { aiProcess_PopulateArmatureData,   "PopulateArmatureData" },
+    { aiProcess_PreTransformVertices,   "PreTransformVertices" },
+    { aiProcess_Triangulate,            "Triangulate" },
+    { aiProcess_SortByPType,            "SortByPType" },
+    { aiProcess_FindInvalidData,        "FindInvalidData" },
+    { aiProcess_FixInfacingNormals,     "FixInfacingNormals" },
+    { aiProcess_SplitByBoneCount,       "SplitByBoneCount" },
+    { aiProcess_SplitLargeMeshes,       "SplitLargeMeshes" },
+    { aiProcess_DropNormals,            "DropNormals" },
+    { aiProcess_GenNormals,             "GenNormals" },
+    { aiProcess_ForceGenNormals,        "ForceGenNormals" },
+    { aiProcess_GenSmoothNormals,       "GenSmoothNormals" },
+    { aiProcess_CalcTangentSpace,       "CalcTangentSpace" },
+    { aiProcess_JoinIdenticalVertices,  "JoinIdenticalVertices" },
+    { aiProcess_Debone,                 "Debone" },
+    { aiProcess_LimitBoneWeights,       "LimitBoneWeights" },
+    { aiProcess_ImproveCacheLocality,   "ImproveCacheLocality" },
+    { aiProcess_GenBoundingBoxes,       "GenBoundingBoxes" },
+  };
+
+  if (name == "realtime_max_quality")
+    flags = aiProcessPreset_TargetRealtime_MaxQuality;
+  else if (name == "realtime_quality")
+    flags = aiProcessPreset_TargetRealtime_Quality;
+  else if (name == "realtime_fast")
+    flags = aiProcessPreset_TargetRealtime_Fast;
+  else if (name == "none")
+    flags = 0;
+  else
+  {
+    std::string step = (name.compare(0, 10, "aiProcess_") == 0) ? name.substr(10) : name;
+    for (std::size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i)
+    {
+      if (step == steps[i].name)
+      {
+        flags = steps[i].flag;
+        return true;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+bool parse_import_flags(const std::string& line, unsigned int& flags)
+{
+  // words and the '|' / '-' between them; blanks are ignored
+  std::string spec;
+  for (std::size_t i = 0; i < line.size(); ++i)
+  {
+    if (!isspace((unsigned char) line[i]))
+      spec += line[i];
+  }
+  if (spec.empty())
+    return true;
+
+  unsigned int result = 0;
+  char op = '|';
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i <= spec.size(); ++i)
+  {
+    if (i < spec.size() && spec[i] != '|' && spec[i] != '-')
+      continue;
+
+    unsigned int word_flags = 0;
+    if (!find_import_flags(spec.substr(begin, i - begin), word_flags))
+      return false;
+    result = (op == '|') ? (result | word_flags) : (result & ~word_flags);
+
+    if (i < spec.size())
+      op = spec[i];
+    begin = i + 1;
+  }
+  flags = result;
+  return true;
+}
+
+bool load_model(const std::string& filename, unsigned int import_flags)
 {
-  const aiScene* scene = aiImportFile(filename.c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
+  const aiScene* scene = aiImportFile(filename.c_str(), import_flags);
   if (scene == NULL)
       return false;
 
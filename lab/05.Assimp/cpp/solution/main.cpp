@@ -10,6 +10,7 @@
 #include <fstream>
 #include <cassert>
 #include <map>
+#include <cctype>
 
 // include glm
 #include <glm/glm.hpp>
@@ -72,6 +73,13 @@ Camera g_camera;
 ////////////////////////////////////////////////////////////////////////////////
 /// 모델 관련 변수 및 함수
 ////////////////////////////////////////////////////////////////////////////////
+// interleaved vertex
+struct Vertex
+{
+  glm::vec3   position;
+  GLubyte     color[4];     // rgba8 (normalized to [0,1] by the GL), 16 bytes/vertex instead of 28
+};
+
 // triangle mesh
 struct Mesh
 {
@@ -84,8 +92,8 @@ struct Mesh
   std::vector<glm::vec3>      tv_positions;   // per triangle-vertex 3D position (size = 3 x #triangles)
   std::vector<glm::vec4>      tv_colors;      // per triangle-vertex rgba (size = 3 x #triangles)
 
-  GLuint  position_buffer;    // GPU 메모리에서 vertices_buffer 위치 
-  GLuint  color_buffer;       // GPU 메모리에서 color_buffer 위치
+  GLuint  vertex_array;       // VAO: vertex_buffer의 attribute 설정
+  GLuint  vertex_buffer;      // GPU 메모리에서 interleaved vertex buffer 위치
 };
 
 // object
@@ -109,7 +117,8 @@ bool set_gl_buffers(Mesh& mesh);
 /// 렌더링 관련 변수 및 함수
 ////////////////////////////////////////////////////////////////////////////////
 bool init_scene(const std::string& filename);
-bool load_model(const std::string& filename);
+bool load_model(const std::string& filename, unsigned int import_flags = aiProcessPreset_TargetRealtime_MaxQuality);
+bool parse_import_flags(const std::string& line, unsigned int& flags);
 
 bool load_asset(const std::string& filename);
 // void init_buffer_objects();     // VBO init 함수: GPU의 VBO를 초기화하는 함수.
@@ -241,9 +250,17 @@ bool init_scene(const std::string& filename)
     return  false;
   }
 
-  std::string name;
+  // the model path, optionally followed by its Assimp import flags (see parse_import_flags())
+  std::string name, import_word;
+  unsigned int import_flags = aiProcessPreset_TargetRealtime_MaxQuality;
   fin >> name;
-  if (!load_model(name))
+  std::getline(fin, import_word);
+  if (!parse_import_flags(import_word, import_flags))
+  {
+    std::cout << "Unknown import flags: " << import_word << std::endl;
+    return false;
+  }
+  if (!load_model(name, import_flags))
   { 
     std::cout << "Failed to load a model file: " << name << std::endl;
     return -1;
@@ -268,9 +285,109 @@ bool init_scene(const std::string& filename)
 }
 
 
-bool load_model(const std::string& filename)
+// the import flags of a model, in the syntax of hw/06 (ImportFlags.h): presets and
+// aiProcess_ steps joined by '|', a step after '-' taken out again, e.g.
+//   realtime_max_quality-CalcTangentSpace-FindInvalidData
+//   Triangulate|JoinIdenticalVertices|GenSmoothNormals|SortByPType
+// presets: realtime_fast, realtime_quality, realtime_max_quality, none (the aiProcess_ prefix
+// of a step is optional). an empty line keeps flags
+bool find_import_flags(const std::string& name, unsigned int& flags)
+{
+  static const struct { unsigned int flag; const char* name; } steps[] = {
+    { aiProcess_ValidateDataStructure,  "ValidateDataStructure" },
+    { aiProcess_MakeLeftHanded,         "MakeLeftHanded" },
+    { aiProcess_FlipUVs,                "FlipUVs" },
+    { aiProcess_FlipWindingOrder,       "FlipWindingOrder" },
+    { aiProcess_RemoveComponent,        "RemoveComponent" },
+    { aiProcess_RemoveRedundantMaterials, "RemoveRedundantMaterials" },
+    { aiProcess_EmbedTextures,          "EmbedTextures" },
+    { aiProcess_FindInstances,          "FindInstances" },
+    { aiProcess_OptimizeGraph,          "OptimizeGraph" },
+    { aiProcess_OptimizeMeshes,         "OptimizeMeshes" },
+    { aiProcess_FindDegenerates,        "FindDegenerates" },
+    { aiProcess_GenUVCoords,            "GenUVCoords" },
+    { aiProcess_TransformUVCoords,      "TransformUVCoords" },
+    { aiProcess_GlobalScale,            "GlobalScale" },
+    { aiProcess_PopulateArmatureData,   "PopulateArmatureData" },
+    { aiProcess_PreTransformVertices,   "PreTransformVertices" },
+    { aiProcess_Triangulate,            "Triangulate" },
+    { aiProcess_SortByPType,            "SortByPType" },
+    { aiProcess_FindInvalidData,        "FindInvalidData" },
+    { aiProcess_FixInfacingNormals,     "FixInfacingNormals" },
+    { aiProcess_SplitByBoneCount,       "SplitByBoneCount" },
+    { aiProcess_SplitLargeMeshes,       "SplitLargeMeshes" },
+    { aiProcess_DropNormals,            "DropNormals" },
+    { aiProcess_GenNormals,             "GenNormals" },
+    { aiProcess_ForceGenNormals,        "ForceGenNormals" },
+    { aiProcess_GenSmoothNormals,       "GenSmoothNormals" },
+    { aiProcess_CalcTangentSpace,       "CalcTangentSpace" },
+    { aiProcess_JoinIdenticalVertices,  "JoinIdenticalVertices" },
+    { aiProcess_Debone,                 "Debone" },
+    { aiProcess_LimitBoneWeights,       "LimitBoneWeights" },
+    { aiProcess_ImproveCacheLocality,   "ImproveCacheLocality" },
+    { aiProcess_GenBoundingBoxes,       "GenBoundingBoxes" },
+  };
+
+  if (name == "realtime_max_quality")
+    flags = aiProcessPreset_TargetRealtime_MaxQuality;
+  else if (name == "realtime_quality")
+    flags = aiProcessPreset_TargetRealtime_Quality;
+  else if (name == "realtime_fast")
+    flags = aiProcessPreset_TargetRealtime_Fast;
+  else if (name == "none")
+    flags = 0;
+  else
+  {
+    std::string step = (name.compare(0, 10, "aiProcess_") == 0) ? name.substr(10) : name;
+    for (std::size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i)
+    {
+      if (step == steps[i].name)
+      {
+        flags = steps[i].flag;
+        return true;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+bool parse_import_flags(const std::string& line, unsigned int& flags)
 {
-  const aiScene* scene = aiImportFile(filename.c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
+  // words and the '|' / '-' between them; blanks are ignored
+  std::string spec;
+  for (std::size_t i = 0; i < line.size(); ++i)
+  {
+    if (!isspace((unsigned char) line[i]))
+      spec += line[i];
+  }
+  if (spec.empty())
+    return true;
+
+  unsigned int result = 0;
+  char op = '|';
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i <= spec.size(); ++i)
+  {
+    if (i < spec.size() && spec[i] != '|' && spec[i] != '-')
+      continue;
+
+    unsigned int word_flags = 0;
+    if (!find_import_flags(spec.substr(begin, i - begin), word_flags))
+      return false;
+    result = (op == '|') ? (result | word_flags) : (result & ~word_flags);
+
+    if (i < spec.size())
+      op = spec[i];
+    begin = i + 1;
+  }
+  flags = result;
+  return true;
+}
+
+bool load_model(const std::string& filename, unsigned int import_flags)
+{
+  const aiScene* scene = aiImportFile(filename.c_str(), import_flags);
   if (scene == NULL)
       return false;
 
@@ -359,8 +476,8 @@ bool updata_mesh_data(Mesh& mesh)
 bool gen_gl_buffers(Mesh& mesh)
 {
   // generate GPU buffers
-  glGenBuffers(1, &mesh.position_buffer);
-  glGenBuffers(1, &mesh.color_buffer);
+  glGenVertexArrays(1, &mesh.vertex_array);
+  glGenBuffers(1, &mesh.vertex_buffer);
 
   return  true;
 }
@@ -371,11 +488,27 @@ bool set_gl_buffers(Mesh& mesh)
   std::vector<glm::vec3>& tv_positions = mesh.tv_positions;   // per triangle-vertex 3D position (size = 3 x #triangles)
   std::vector<glm::vec4>& tv_colors = mesh.tv_colors;         // per triangle-vertex rgba colors (size = 3 x #triangles)
 
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.position_buffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*tv_positions.size(), &tv_positions[0], GL_STATIC_DRAW);
+  std::vector<Vertex> vertices(tv_positions.size());
+  for (std::size_t i = 0; i < vertices.size(); ++i)
+  {
+    vertices[i].position = tv_positions[i];
+    for (int c = 0; c < 4; ++c)
+      vertices[i].color[c] = (GLubyte) (glm::clamp(tv_colors[i][c], 0.0f, 1.0f) * 255.0f + 0.5f);
+  }
+
+  // VAO remembers the attribute setup, so draw_mesh() only binds it
+  glBindVertexArray(mesh.vertex_array);
 
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.color_buffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4)*tv_colors.size(), &tv_colors[0], GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex)*vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+  glEnableVertexAttribArray(loc_a_position);
+  glVertexAttribPointer(loc_a_position, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+  glEnableVertexAttribArray(loc_a_color);
+  glVertexAttribPointer(loc_a_color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
   return  true;
 }
@@ -543,24 +676,14 @@ void render_object()
   draw_mesh(g_model.mesh);
 
   // 쉐이더 프로그램 사용해제
+  glBindVertexArray(0);
   glUseProgram(0);
 }
 
 void draw_mesh(Mesh& mesh)
 {
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.position_buffer);
-  glEnableVertexAttribArray(loc_a_position);
-  glVertexAttribPointer(loc_a_position, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-  // TODO : bind color buffer
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.color_buffer); 
-  glEnableVertexAttribArray(loc_a_color);
-  glVertexAttribPointer(loc_a_color, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
+  glBindVertexArray(mesh.vertex_array);
   glDrawArrays(GL_TRIANGLES, 0, (GLsizei) mesh.tv_positions.size());
-  
-  glDisableVertexAttribArray(loc_a_position);
-  glDisableVertexAttribArray(loc_a_color);
 }
 
 
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// structure-of-arrays vec3 stream (x[], y[], z[]) for the SIMD kernels below
+struct Vec3SoA
+{
+    std::vector<float>  x, y, z;
+
+    std::size_t size() const                { return x.size(); }
+    void resize(std::size_t n)              { x.resize(n); y.resize(n); z.resize(n); }
+    void clear()                            { x.clear(); y.clear(); z.clear(); }
+
+    glm::vec3 get(std::size_t i) const      { return glm::vec3(x[i], y[i], z[i]); }
+    void set(std::size_t i, const glm::vec3& v)     { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+    void push_back(const glm::vec3& v)      { x.push_back(v.x); y.push_back(v.y); z.push_back(v.z); }
+
+    void assign(const glm::vec3* v, std::size_t n);     // AoS -> SoA
+    void copy_to(glm::vec3* v) const;                   // SoA -> AoS
+};
+
+enum SimdLevel
+{
+    kSimdScalar = 0,    // plain C++ (any CPU)
+    kSimdSSE2,          // 4 floats / op
+    kSimdAVX2,          // 8 floats / op (+ gather)
+    kSimdBest           // the best one this CPU supports
+};
+
+// kernels over [0, n) of SoA streams.
+// every level performs the same float operations in the same order (no FMA),
+// so all of them return bit-for-bit the same results.
+struct MeshKernels
+{
+    SimdLevel   level;
+    const char* name;
+
+    // n[f] = normalize(cross(q-p, r-p)) of triangle f = (tv_indices[3f], [3f+1], [3f+2]);
+    // (0, 0, 0) for a zero-area triangle, so it adds nothing to the vertex normals around it
+    void (*face_normals)(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* nx, float* ny, float* nz);
+
+    // area[f] = 0.5 * |cross(q-p, r-p)|
+    void (*triangle_areas)(const float* px, const float* py, const float* pz, const unsigned int* tv_indices, std::size_t num_triangles, float* areas);
+
+    // (x, y, z)[i] = normalize((x, y, z)[i]) in place; a zero vector stays (0, 0, 0)
+    void (*normalize)(float* x, float* y, float* z, std::size_t n);
+};
+
+// detected once; kSimdScalar on non-x86 CPUs and compilers without target attributes
+SimdLevel max_simd_level();
+
+// kernels of the given level (clamped to max_simd_level())
+const MeshKernels& mesh_kernels(SimdLevel level = kSimdBest);
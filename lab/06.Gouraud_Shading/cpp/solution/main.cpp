@@ -1,5 +1,5 @@
 ﻿///// main.cpp
-///// OpenGL 3+, GLSL 1.20, GLEW, GLFW3
+///// OpenGL 3+, GLSL 1.20 (1.40 with uniform blocks), GLEW, GLFW3
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -10,6 +10,9 @@
 #include <fstream>
 #include <cassert>
 #include <map>
+#include <cctype>
+#include <thread>
+#include <algorithm>
 
 // include glm
 #include <glm/glm.hpp>
@@ -28,6 +31,7 @@
 
 #include "Material.h"
 #include "Light.h"
+#include "MeshKernels.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 /// initialization 관련 변수 및 함수
@@ -68,8 +72,48 @@ GLint   loc_u_obj_diffuse;
 GLint   loc_u_obj_specular;
 GLint   loc_u_obj_shininess;
 
+// GLSL 1.40 variant (GL 3.1+): 위의 uniform들을 세 uniform block에 담아 buffer로 전달
+//   FrameBlock: camera & light (프레임마다 한 번), ObjectBlock: model의 matrix,
+//   MaterialBlock: mesh마다 하나 (load_model()에서 한 번 upload, glBindBufferRange()로 선택)
+enum UniformBlockBinding { kFrameBlockBinding = 0, kObjectBlockBinding = 1, kMaterialBlockBinding = 2 };
+
+// std140 layout: vec3 뒤에 float가 없으면 16 bytes, mat3는 vec4 column 3개
+struct FrameBlock
+{
+  glm::mat4   view_matrix;
+  glm::vec4   camera_position;
+  glm::vec4   light_position;
+  glm::vec4   light_ambient;
+  glm::vec4   light_diffuse;
+  glm::vec4   light_specular;
+};
+
+struct ObjectBlock
+{
+  glm::mat4   PVM;
+  glm::mat4   model_matrix;
+  glm::vec4   normal_matrix[3];
+};
+
+struct MaterialBlock
+{
+  glm::vec4   ambient;
+  glm::vec4   diffuse;
+  glm::vec3   specular;
+  float       shininess;
+};
+
+GLuint  program_ubo = 0;        // 0: GL 3.1 미지원 (program만 사용)
+GLuint  g_frame_ubo = 0;
+GLuint  g_object_ubo = 0;
+GLuint  g_material_ubo = 0;
+GLsizeiptr g_material_stride = 0;   // sizeof(MaterialBlock)을 GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 단위로 올림
+bool    g_use_ubo = true;
+
 GLuint create_shader_from_file(const std::string& filename, GLuint shader_type);
+GLuint create_program_from_files(const std::string& vertex_filename, const std::string& fragment_filename);
 void init_shader_program();
+void init_uniform_blocks();
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -93,6 +137,13 @@ Camera g_camera;
 enum ShadingType { kSmooth, kFlat };
 ShadingType   g_shading_type = kSmooth;
 
+// interleaved vertex
+struct Vertex
+{
+  glm::vec3   position;
+  glm::vec3   normal;
+};
+
 // triangle mesh
 struct Mesh
 {
@@ -102,14 +153,18 @@ struct Mesh
   std::vector<unsigned int>   tv_indices;     // size = 3 x #triangles
 
   // position and normal for flat shading
-  std::vector<glm::vec3>      tv_positions;       // per triangle-vertex 3D position (size = 3 x #triangles)
-  std::vector<glm::vec3>      tv_flat_normals;    // per triangle-vertex flat normal (size = 3 x #triangles)
-  std::vector<glm::vec3>      tv_smooth_normals;  // per triangle-vertex smooth normal (size = 3 x #triangles)
+  // (a vertex is split only if its adjacent triangles have different face normals)
+  std::vector<glm::vec3>      flat_positions;     // per-vertex 3D position (size >= #vertices)
+  std::vector<glm::vec3>      flat_normals;       // per-vertex flat normal (size >= #vertices)
+  std::vector<unsigned int>   flat_indices;       // size = 3 x #triangles
 
-  GLuint  position_buffer;    // GPU 메모리에서 vertices_buffer 위치 
-  GLuint  normal_buffer;      // GPU 메모리에서 normal_buffer 위치
+  // [kSmooth], [kFlat] 쉐이딩 별 GPU buffer (둘 다 GPU 메모리에 유지)
+  GLuint  vertex_array[2];    // VAO: vertex_buffer의 attribute 설정 + index_buffer
+  GLuint  vertex_buffer[2];   // GPU 메모리에서 interleaved vertex buffer 위치
+  GLuint  index_buffer[2];    // GPU 메모리에서 index_buffer 위치
 
   Material   material;        // mesh material  
+  GLintptr   material_offset = 0;   // g_material_ubo에서 이 mesh의 MaterialBlock 위치
 };
 
 struct Model 
@@ -128,6 +183,8 @@ Model g_model;
 bool updata_mesh_data(Mesh& mesh);    
 bool gen_gl_buffers(Mesh& mesh);
 bool set_gl_buffers(Mesh& mesh); 
+void upload_material_blocks();              // 모든 mesh의 material을 g_material_ubo에 한 번에
+void update_material_block(const Mesh& mesh);   // material이 (ImGui에서) 바뀐 mesh 하나
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -136,11 +193,12 @@ bool set_gl_buffers(Mesh& mesh);
 Light g_light;
 
 bool init_scene(const std::string& filename);
-bool load_model(const std::string& filename);
+bool load_model(const std::string& filename, unsigned int import_flags = aiProcessPreset_TargetRealtime_MaxQuality);
+bool parse_import_flags(const std::string& line, unsigned int& flags);
 bool init_gpu_buffers();
 bool load_asset(const std::string& filename);
 void render_object();           // rendering 함수: 물체(삼각형)를 렌더링하는 함수.
-void draw_mesh(Mesh& mesh);
+void draw_mesh(Mesh& mesh, bool use_ubo);
 void render(GLFWwindow* window);
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -216,6 +274,7 @@ void init_window(GLFWwindow* window)
 {
   init_imgui(window);
   init_shader_program();
+  init_uniform_blocks();
 
   glEnable(GL_DEPTH_TEST);
 
@@ -265,9 +324,17 @@ bool init_scene(const std::string& filename)
     return  false;
   }
 
-  std::string name;
+  // the model path, optionally followed by its Assimp import flags (see parse_import_flags())
+  std::string name, import_word;
+  unsigned int import_flags = aiProcessPreset_TargetRealtime_MaxQuality;
   fin >> name;
-  if (!load_model(name))
+  std::getline(fin, import_word);
+  if (!parse_import_flags(import_word, import_flags))
+  {
+    std::cout << "Unknown import flags: " << import_word << std::endl;
+    return false;
+  }
+  if (!load_model(name, import_flags))
   { 
     std::cout << "Failed to load a model file: " << name << std::endl;
     return -1;
@@ -292,9 +359,109 @@ bool init_scene(const std::string& filename)
 }
 
 
-bool load_model(const std::string& filename)
+// the import flags of a model, in the syntax of hw/06 (ImportFlags.h): presets and
+// aiProcess_ steps joined by '|', a step after '-' taken out again, e.g.
+//   realtime_max_quality-CalcTangentSpace-FindInvalidData
+//   Triangulate|JoinIdenticalVertices|GenSmoothNormals|SortByPType
+// presets: realtime_fast, realtime_quality, realtime_max_quality, none (the aiProcess_ prefix
+// of a step is optional). an empty line keeps flags
+bool find_import_flags(const std::string& name, unsigned int& flags)
+{
+  static const struct { unsigned int flag; const char* name; } steps[] = {
+    { aiProcess_ValidateDataStructure,  "ValidateDataStructure" },
+    { aiProcess_MakeLeftHanded,         "MakeLeftHanded" },
+    { aiProcess_FlipUVs,                "FlipUVs" },
+    { aiProcess_FlipWindingOrder,       "FlipWindingOrder" },
+    { aiProcess_RemoveComponent,        "RemoveComponent" },
+    { aiProcess_RemoveRedundantMaterials, "RemoveRedundantMaterials" },
+    { aiProcess_EmbedTextures,          "EmbedTextures" },
+    { aiProcess_FindInstances,          "FindInstances" },
+    { aiProcess_OptimizeGraph,          "OptimizeGraph" },
+    { aiProcess_OptimizeMeshes,         "OptimizeMeshes" },
+    { aiProcess_FindDegenerates,        "FindDegenerates" },
+    { aiProcess_GenUVCoords,            "GenUVCoords" },
+    { aiProcess_TransformUVCoords,      "TransformUVCoords" },
+    { aiProcess_GlobalScale,            "GlobalScale" },
+    { aiProcess_PopulateArmatureData,   "PopulateArmatureData" },
+    { aiProcess_PreTransformVertices,   "PreTransformVertices" },
+    { aiProcess_Triangulate,            "Triangulate" },
+    { aiProcess_SortByPType,            "SortByPType" },
+    { aiProcess_FindInvalidData,        "FindInvalidData" },
+    { aiProcess_FixInfacingNormals,     "FixInfacingNormals" },
+    { aiProcess_SplitByBoneCount,       "SplitByBoneCount" },
+    { aiProcess_SplitLargeMeshes,       "SplitLargeMeshes" },
+    { aiProcess_DropNormals,            "DropNormals" },
+    { aiProcess_GenNormals,             "GenNormals" },
+    { aiProcess_ForceGenNormals,        "ForceGenNormals" },
+    { aiProcess_GenSmoothNormals,       "GenSmoothNormals" },
+    { aiProcess_CalcTangentSpace,       "CalcTangentSpace" },
+    { aiProcess_JoinIdenticalVertices,  "JoinIdenticalVertices" },
+    { aiProcess_Debone,                 "Debone" },
+    { aiProcess_LimitBoneWeights,       "LimitBoneWeights" },
+    { aiProcess_ImproveCacheLocality,   "ImproveCacheLocality" },
+    { aiProcess_GenBoundingBoxes,       "GenBoundingBoxes" },
+  };
+
+  if (name == "realtime_max_quality")
+    flags = aiProcessPreset_TargetRealtime_MaxQuality;
+  else if (name == "realtime_quality")
+    flags = aiProcessPreset_TargetRealtime_Quality;
+  else if (name == "realtime_fast")
+    flags = aiProcessPreset_TargetRealtime_Fast;
+  else if (name == "none")
+    flags = 0;
+  else
+  {
+    std::string step = (name.compare(0, 10, "aiProcess_") == 0) ? name.substr(10) : name;
+    for (std::size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i)
+    {
+      if (step == steps[i].name)
+      {
+        flags = steps[i].flag;
+        return true;
+      }
+    }
+    return false;
+  }
+  return true;
+}
+
+bool parse_import_flags(const std::string& line, unsigned int& flags)
+{
+  // words and the '|' / '-' between them; blanks are ignored
+  std::string spec;
+  for (std::size_t i = 0; i < line.size(); ++i)
+  {
+    if (!isspace((unsigned char) line[i]))
+      spec += line[i];
+  }
+  if (spec.empty())
+    return true;
+
+  unsigned int result = 0;
+  char op = '|';
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i <= spec.size(); ++i)
+  {
+    if (i < spec.size() && spec[i] != '|' && spec[i] != '-')
+      continue;
+
+    unsigned int word_flags = 0;
+    if (!find_import_flags(spec.substr(begin, i - begin), word_flags))
+      return false;
+    result = (op == '|') ? (result | word_flags) : (result & ~word_flags);
+
+    if (i < spec.size())
+      op = spec[i];
+    begin = i + 1;
+  }
+  flags = result;
+  return true;
+}
+
+bool load_model(const std::string& filename, unsigned int import_flags)
 {
-  const aiScene* scene = aiImportFile(filename.c_str(), aiProcessPreset_TargetRealtime_MaxQuality);
+  const aiScene* scene = aiImportFile(filename.c_str(), import_flags);
   if (scene == NULL)
       return false;
 
@@ -351,72 +518,166 @@ bool load_model(const std::string& filename)
     gen_gl_buffers(mesh);
     set_gl_buffers(mesh);
   }
+  upload_material_blocks();
 
   return true;
 }
 
+// split [0, count) into contiguous ranges (of min_range_size or more), one per hardware thread,
+// and call func(range_begin, range_end) for each range
+template <typename Func>
+void parallel_for(std::size_t count, Func func, std::size_t min_range_size = 4096)
+{
+  if (count == 0)
+    return;
+
+  std::size_t num_ranges = std::max(1u, std::thread::hardware_concurrency());
+  num_ranges = std::min(num_ranges, (count + min_range_size - 1) / min_range_size);
+  if (num_ranges <= 1)
+  {
+    func(0, count);
+    return;
+  }
+
+  std::size_t range_size = (count + num_ranges - 1) / num_ranges;
+  std::vector<std::thread> threads;
+  for (std::size_t b = range_size; b < count; b += range_size)
+    threads.push_back(std::thread(func, b, std::min(count, b + range_size)));
+  func(0, std::min(count, range_size));
+
+  for (std::size_t i = 0; i < threads.size(); ++i)
+    threads[i].join();
+}
+
 bool updata_mesh_data(Mesh& mesh)
 {
   // raw data
   std::vector<glm::vec3>& positions = mesh.positions;         // raw 3D positions
   std::vector<unsigned int>& tv_indices = mesh.tv_indices;    // raw tv_indices (size = 3 x #triangles)
-  std::vector<glm::vec3>& normals = mesh.normals;             // per-vertex 3D normal (temp)
+  std::vector<glm::vec3>& normals = mesh.normals;             // per-vertex 3D normal
   
   // buffer data for flat shading
-  std::vector<glm::vec3>& tv_positions = mesh.tv_positions;           // per triangle-vertex 3D position (size = 3 x #triangles)
-  std::vector<glm::vec3>& tv_flat_normals = mesh.tv_flat_normals;     // per triangle-vertex 3D normal (size = 3 x #triangles)
-  std::vector<glm::vec3>& tv_smooth_normals = mesh.tv_smooth_normals; // per triangle-vertex 3D normal (size = 3 x #triangles)
-
-  // init normals
-  normals.resize(positions.size());
-  for (std::size_t i = 0; i < normals.size(); ++i)
-    normals[i] = glm::vec3(0.0f, 0.0f, 0.0f);
-
-  // init tv_positions and tv_flat_normals
-  tv_positions.resize(tv_indices.size());
-  tv_flat_normals.resize(tv_indices.size());
-  for (std::size_t i = 0; i < tv_indices.size(); ++i)
+  std::vector<glm::vec3>& flat_positions = mesh.flat_positions;   // per-vertex 3D position (size >= #vertices)
+  std::vector<glm::vec3>& flat_normals = mesh.flat_normals;       // per-vertex flat normal (size >= #vertices)
+  std::vector<unsigned int>& flat_indices = mesh.flat_indices;    // size = 3 x #triangles
+
+  // SoA copy of the positions for the SIMD kernels (MeshKernels.h)
+  const MeshKernels& kernels = mesh_kernels();
+  Vec3SoA soa_positions;
+  soa_positions.assign(&positions[0], positions.size());
+
+  // 1) face normals: each thread takes a contiguous range of triangles
+  std::size_t num_triangles = tv_indices.size() / 3;
+  Vec3SoA f_normals;
+  f_normals.resize(num_triangles);
+  parallel_for(num_triangles, [&](std::size_t b, std::size_t e) {
+    kernels.face_normals(&soa_positions.x[0], &soa_positions.y[0], &soa_positions.z[0], &tv_indices[3*b], e - b,
+                         &f_normals.x[b], &f_normals.y[b], &f_normals.z[b]);
+  });
+
+  // 2) per-vertex normals: the triangles are split into chunks and the vertices into as many
+  //    owner ranges. each chunk sorts its corners into a bucket per owner once, then each
+  //    thread adds up only the buckets of its own vertices (no data race), chunk by chunk
+  //    in the same triangle order as a serial loop (same result)
+  Vec3SoA v_normals;
+  v_normals.resize(positions.size());
+
+  std::size_t num_chunks = std::max(1u, std::thread::hardware_concurrency());
+  num_chunks = std::min(num_chunks, num_triangles / 4096);
+  if (num_chunks <= 1 || positions.empty())
   {
-    tv_positions[i] = glm::vec3(0.0f, 0.0f, 0.0f);
-    tv_flat_normals[i]   = glm::vec3(0.0f, 0.0f, 0.0f);
+    // a small mesh: the serial loop
+    for (std::size_t i = 0; i < tv_indices.size(); ++i)
+    {
+      unsigned int v = tv_indices[i];
+      v_normals.x[v] += f_normals.x[i/3];
+      v_normals.y[v] += f_normals.y[i/3];
+      v_normals.z[v] += f_normals.z[i/3];
+    }
+    if (!positions.empty())
+      kernels.normalize(&v_normals.x[0], &v_normals.y[0], &v_normals.z[0], v_normals.size());
   }
-
-  // for each triangle
-  // 1) compute face normal 
-  // 2) update normals, tv_positions, tv_flat_normals 
-  for (std::size_t i = 0; i < tv_indices.size(); i+=3)
+  else
   {
-    glm::vec3 p = positions[tv_indices[i]];
-    glm::vec3 q = positions[tv_indices[i+1]];
-    glm::vec3 r = positions[tv_indices[i+2]];
+    std::size_t corners_per_chunk = ((num_triangles + num_chunks - 1) / num_chunks) * 3;
+    std::size_t vertices_per_owner = (positions.size() + num_chunks - 1) / num_chunks;
 
-    glm::vec3 f_normal = glm::cross(q-p, r-p);
-    f_normal = glm::normalize(f_normal);
+    // buckets[chunk * num_chunks + owner] = corners (indices into tv_indices) of the owner's vertices
+    std::vector< std::vector<unsigned int> > buckets(num_chunks * num_chunks);
+    parallel_for(num_chunks, [&](std::size_t chunk_b, std::size_t chunk_e) {
+      for (std::size_t chunk = chunk_b; chunk < chunk_e; ++chunk)
+      {
+        std::size_t b = chunk * corners_per_chunk;
+        std::size_t e = std::min(tv_indices.size(), b + corners_per_chunk);
+        for (std::size_t owner = 0; owner < num_chunks; ++owner)
+          buckets[chunk * num_chunks + owner].reserve((e - b) / num_chunks + (e - b) / 8);
 
-    // add-up each face_normal to normals
-    normals[tv_indices[i]]   += f_normal;
-    normals[tv_indices[i+1]] += f_normal;
-    normals[tv_indices[i+2]] += f_normal;
+        for (std::size_t i = b; i < e; ++i)
+          buckets[chunk * num_chunks + tv_indices[i] / vertices_per_owner].push_back((unsigned int) i);
+      }
+    }, 1);
 
-    // set tv_positions and tv_flat_normals as each face normal
-    tv_positions[i]   = p;   tv_flat_normals[i]   = f_normal;
-    tv_positions[i+1] = q;   tv_flat_normals[i+1] = f_normal;
-    tv_positions[i+2] = r;   tv_flat_normals[i+2] = f_normal;
+    parallel_for(num_chunks, [&](std::size_t owner_b, std::size_t owner_e) {
+      for (std::size_t owner = owner_b; owner < owner_e; ++owner)
+      {
+        std::size_t vb = owner * vertices_per_owner;
+        std::size_t ve = std::min(v_normals.size(), vb + vertices_per_owner);
+
+        for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+        {
+          const std::vector<unsigned int>& bucket = buckets[chunk * num_chunks + owner];
+          for (std::size_t k = 0; k < bucket.size(); ++k)
+          {
+            unsigned int v = tv_indices[bucket[k]];
+            v_normals.x[v] += f_normals.x[bucket[k]/3];
+            v_normals.y[v] += f_normals.y[bucket[k]/3];
+            v_normals.z[v] += f_normals.z[bucket[k]/3];
+          }
+        }
+
+        if (vb < ve)
+          kernels.normalize(&v_normals.x[vb], &v_normals.y[vb], &v_normals.z[vb], ve - vb);
+      }
+    }, 1);
   }
-  assert(tv_positions.size() == tv_flat_normals.size());
 
-  // normalize per-vertex normals
-  for (std::size_t i = 0; i < normals.size(); ++i)
-    normals[i] = glm::normalize(normals[i]);
+  normals.resize(positions.size());
+  v_normals.copy_to(&normals[0]);
+
+  // split_head[v] / split_next[w] chain the flat vertices made from the raw vertex v
+  const unsigned int kNone = 0xFFFFFFFFu;
+  std::vector<unsigned int> split_head(positions.size(), kNone);
+  std::vector<unsigned int> split_next;
+
+  flat_positions.clear();
+  flat_normals.clear();
+  flat_indices.resize(tv_indices.size());
 
-  // update tv_smooth_normals
-  tv_smooth_normals.resize(tv_indices.size());
+  // 3) update flat_positions, flat_normals, flat_indices
   for (std::size_t i = 0; i < tv_indices.size(); i+=3)
   {
-    tv_smooth_normals[i]   = normals[tv_indices[i]];
-    tv_smooth_normals[i+1] = normals[tv_indices[i+1]];
-    tv_smooth_normals[i+2] = normals[tv_indices[i+2]];
+    glm::vec3 f_normal = f_normals.get(i/3);
+
+    // reuse a flat vertex with the same face normal, or split a new one
+    for (std::size_t k = i; k < i+3; ++k)
+    {
+      unsigned int v = tv_indices[k];
+      unsigned int w = split_head[v];
+      while (w != kNone && flat_normals[w] != f_normal)
+        w = split_next[w];
+
+      if (w == kNone)
+      {
+        w = (unsigned int) flat_positions.size();
+        flat_positions.push_back(positions[v]);
+        flat_normals.push_back(f_normal);
+        split_next.push_back(split_head[v]);
+        split_head[v] = w;
+      }
+      flat_indices[k] = w;
+    }
   }
+  assert(flat_positions.size() == flat_normals.size());
 
   return  true;
 }
@@ -424,34 +685,57 @@ bool updata_mesh_data(Mesh& mesh)
 bool gen_gl_buffers(Mesh& mesh)
 {
   // generate GPU buffers
-  glGenBuffers(1, &mesh.position_buffer);
-  glGenBuffers(1, &mesh.normal_buffer);
+  glGenVertexArrays(2, mesh.vertex_array);
+  glGenBuffers(2, mesh.vertex_buffer);
+  glGenBuffers(2, mesh.index_buffer);
 
   return  true;
 }
 
 bool set_gl_buffers(Mesh& mesh)
 {
-  // per-vertex position and normal data
-  std::vector<glm::vec3>  positions;
-  std::vector<glm::vec3>  normals;
+  std::size_t indexed_bytes = 0;
 
-  if (g_shading_type == kSmooth)
-  {
-    positions = mesh.tv_positions;
-    normals   = mesh.tv_smooth_normals;
-  }
-  else //if (g_shading_type == kFlat)
+  // upload buffers for both shading types, so that switching them needs no upload
+  for (int shading_type = kSmooth; shading_type <= kFlat; ++shading_type)
   {
-    positions = mesh.tv_positions;
-    normals   = mesh.tv_flat_normals;
-  }
+    // per-vertex position and normal data, and triangle-vertex indices
+    const std::vector<glm::vec3>&     positions = (shading_type == kSmooth) ? mesh.positions : mesh.flat_positions;
+    const std::vector<glm::vec3>&     normals   = (shading_type == kSmooth) ? mesh.normals : mesh.flat_normals;
+    const std::vector<unsigned int>&  indices   = (shading_type == kSmooth) ? mesh.tv_indices : mesh.flat_indices;
+
+    std::vector<Vertex> vertices(positions.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+      vertices[i].position = positions[i];
+      vertices[i].normal   = normals[i];
+    }
+
+    // VAO remembers the attribute setup and the index buffer
+    glBindVertexArray(mesh.vertex_array[shading_type]);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer[shading_type]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex)*vertices.size(), &vertices[0], GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(loc_a_position);
+    glVertexAttribPointer(loc_a_position, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(loc_a_normal);
+    glVertexAttribPointer(loc_a_normal, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer[shading_type]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*indices.size(), &indices[0], GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.position_buffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*positions.size(), &positions[0], GL_STATIC_DRAW);
+    indexed_bytes += sizeof(Vertex)*vertices.size() + sizeof(unsigned int)*indices.size();
+  }
 
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.normal_buffer);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)*normals.size(), &normals[0], GL_STATIC_DRAW);
+  // VRAM usage compared to per triangle-vertex expansion for glDrawArrays
+  std::size_t expanded_bytes = 3 * sizeof(glm::vec3)*mesh.tv_indices.size();
+  std::cout << mesh.material.name << ": " << indexed_bytes << " bytes (glDrawElements, smooth + flat), "
+            << expanded_bytes << " bytes (glDrawArrays, smooth + flat)" << std::endl;
 
   return  true;
 }
@@ -485,12 +769,13 @@ void compose_imgui_frame()
     bool is_flat_shading = g_shading_type ? kFlat : kSmooth;
     ImGui::Checkbox("Flat shading: ", &is_flat_shading);
     g_shading_type = is_flat_shading ? kFlat : kSmooth;
+    // both shading types stay in GPU memory; draw_mesh() just picks one of them
     if (g_shading_type != prev_shading_type)
-    {
-      for (std::size_t i = 0; i < g_model.meshes.size(); ++i)
-        set_gl_buffers(g_model.meshes[i]);
       std::cout << "shading changed" << std::endl;
-    }
+
+    ImGui::BeginDisabled(program_ubo == 0);
+    ImGui::Checkbox("Uniform buffer objects (GLSL 1.40)", &g_use_ubo);
+    ImGui::EndDisabled();
     
     ImGui::NewLine();
 
@@ -500,14 +785,17 @@ void compose_imgui_frame()
     {
       Mesh& mesh = g_model.meshes[i];
 
+      bool is_edited = false;
       label = mesh.material.name + "-ambient";
-      ImGui::ColorEdit3(label.c_str(), glm::value_ptr(mesh.material.ambient));
+      is_edited |= ImGui::ColorEdit3(label.c_str(), glm::value_ptr(mesh.material.ambient));
       label = mesh.material.name + "-diffuse";
-      ImGui::ColorEdit3(label.c_str(), glm::value_ptr(mesh.material.diffuse));
+      is_edited |= ImGui::ColorEdit3(label.c_str(), glm::value_ptr(mesh.material.diffuse));
       label = mesh.material.name + "-specular";
-      ImGui::ColorEdit3(label.c_str(), glm::value_ptr(mesh.material.specular));
+      is_edited |= ImGui::ColorEdit3(label.c_str(), glm::value_ptr(mesh.material.specular));
       label = mesh.material.name + "-shininess";
-      ImGui::SliderFloat(label.c_str(), &mesh.material.shininess, 0.0f, 500.0f);
+      is_edited |= ImGui::SliderFloat(label.c_str(), &mesh.material.shininess, 0.0f, 500.0f);
+      if (is_edited)
+        update_material_block(mesh);
       ImGui::NewLine();
     }
     
@@ -595,45 +883,63 @@ GLuint create_shader_from_file(const std::string& filename, GLuint shader_type)
   return shader;
 }
 
-// vertex shader와 fragment shader를 링크시켜 program을 생성하는 함수
-void init_shader_program()
+// vertex shader와 fragment shader를 링크시켜 program을 생성하는 함수 (실패하면 0)
+GLuint create_program_from_files(const std::string& vertex_filename, const std::string& fragment_filename)
 {
   GLuint vertex_shader
-    = create_shader_from_file("./shader/vertex.glsl", GL_VERTEX_SHADER);
+    = create_shader_from_file(vertex_filename, GL_VERTEX_SHADER);
 
   std::cout << "vertex_shader id: " << vertex_shader << std::endl;
-  assert(vertex_shader != 0);
 
   GLuint fragment_shader
-    = create_shader_from_file("./shader/fragment.glsl", GL_FRAGMENT_SHADER);
+    = create_shader_from_file(fragment_filename, GL_FRAGMENT_SHADER);
 
   std::cout << "fragment_shader id: " << fragment_shader << std::endl;
-  assert(fragment_shader != 0);
 
-  program = glCreateProgram();
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, fragment_shader);
-  glLinkProgram(program);
+  if (vertex_shader == 0 || fragment_shader == 0)
+  {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return 0;
+  }
+
+  GLuint linked_program = glCreateProgram();
+  glAttachShader(linked_program, vertex_shader);
+  glAttachShader(linked_program, fragment_shader);
+  // 두 program이 같은 VAO를 쓰므로 attribute 위치를 고정
+  glBindAttribLocation(linked_program, 0, "a_position");
+  glBindAttribLocation(linked_program, 1, "a_normal");
+  glLinkProgram(linked_program);
 
   GLint is_linked;
-  glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+  glGetProgramiv(linked_program, GL_LINK_STATUS, &is_linked);
   if (is_linked != GL_TRUE)
   {
     std::cout << "Shader LINK error: " << std::endl;
 
     GLint buf_len;
-    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &buf_len);
+    glGetProgramiv(linked_program, GL_INFO_LOG_LENGTH, &buf_len);
 
     std::string log_string(1 + buf_len, '\0');
-    glGetProgramInfoLog(program, buf_len, 0, (GLchar *)log_string.c_str());
+    glGetProgramInfoLog(linked_program, buf_len, 0, (GLchar *)log_string.c_str());
 
     std::cout << "error_log: " << log_string << std::endl;
 
-    glDeleteProgram(program);
-    program = 0;
+    glDeleteProgram(linked_program);
+    linked_program = 0;
   }
 
-  std::cout << "program id: " << program << std::endl;
+  // the program keeps them
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  std::cout << "program id: " << linked_program << std::endl;
+  return linked_program;
+}
+
+void init_shader_program()
+{
+  program = create_program_from_files("./shader/vertex.glsl", "./shader/fragment.glsl");
   assert(program != 0);
 
   loc_u_PVM = glGetUniformLocation(program, "u_PVM");
@@ -662,6 +968,90 @@ void init_shader_program()
 
 }
 
+// uniform block을 binding point에 연결하고 buffer 생성 (GL 3.1 미지원이거나 실패하면 program_ubo = 0)
+void init_uniform_blocks()
+{
+  if (!GLEW_VERSION_3_1 && !GLEW_ARB_uniform_buffer_object)
+    return;
+
+  program_ubo = create_program_from_files("./shader/vertex_ubo.glsl", "./shader/fragment_ubo.glsl");
+  if (program_ubo == 0)
+    return;
+
+  const char* names[3] = { "FrameBlock", "ObjectBlock", "MaterialBlock" };
+  for (GLuint binding = 0; binding < 3; ++binding)
+  {
+    GLuint index = glGetUniformBlockIndex(program_ubo, names[binding]);
+    if (index == GL_INVALID_INDEX)
+    {
+      std::cout << "uniform block " << names[binding] << " is missing" << std::endl;
+      glDeleteProgram(program_ubo);
+      program_ubo = 0;
+      return;
+    }
+    glUniformBlockBinding(program_ubo, index, binding);
+  }
+
+  GLint alignment = 256;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  g_material_stride = (sizeof(MaterialBlock) + alignment - 1) / alignment * alignment;
+
+  glGenBuffers(1, &g_frame_ubo);
+  glGenBuffers(1, &g_object_ubo);
+  glGenBuffers(1, &g_material_ubo);
+
+  glBindBuffer(GL_UNIFORM_BUFFER, g_frame_ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, g_object_ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(ObjectBlock), NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  // frame / object block은 buffer 전체를 한 번 연결; material은 mesh마다 glBindBufferRange()
+  glBindBufferBase(GL_UNIFORM_BUFFER, kFrameBlockBinding, g_frame_ubo);
+  glBindBufferBase(GL_UNIFORM_BUFFER, kObjectBlockBinding, g_object_ubo);
+}
+
+static MaterialBlock make_material_block(const Material& material)
+{
+  MaterialBlock block;
+  block.ambient = glm::vec4(material.ambient, 0.0f);
+  block.diffuse = glm::vec4(material.diffuse, 0.0f);
+  block.specular = material.specular;
+  block.shininess = material.shininess;
+  return block;
+}
+
+void upload_material_blocks()
+{
+  if (program_ubo == 0 || g_model.meshes.empty())
+    return;
+
+  std::vector<unsigned char> data(g_model.meshes.size() * g_material_stride, 0);
+  for (std::size_t i = 0; i < g_model.meshes.size(); ++i)
+  {
+    Mesh& mesh = g_model.meshes[i];
+    MaterialBlock block = make_material_block(mesh.material);
+
+    mesh.material_offset = i * g_material_stride;
+    memcpy(&data[mesh.material_offset], &block, sizeof(MaterialBlock));
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, g_material_ubo);
+  glBufferData(GL_UNIFORM_BUFFER, data.size(), &data[0], GL_STATIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void update_material_block(const Mesh& mesh)
+{
+  if (program_ubo == 0)
+    return;
+
+  MaterialBlock block = make_material_block(mesh.material);
+  glBindBuffer(GL_UNIFORM_BUFFER, g_material_ubo);
+  glBufferSubData(GL_UNIFORM_BUFFER, mesh.material_offset, sizeof(MaterialBlock), &block);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
 void render_object()
 {
   // set transform
@@ -669,20 +1059,7 @@ void render_object()
   glm::mat4 mat_proj = glm::perspective(glm::radians(g_camera.fovy), g_camera.aspect, 0.01f, 1000.0f);
 
 
-  // 특정 쉐이더 프로그램 사용
-  glUseProgram(program);
-
-  // TODO : send uniform for camera & light to GPU
-  glUniformMatrix4fv(loc_u_view_matrix, 1, false, glm::value_ptr(mat_view)); 
-  glUniform3fv(loc_u_camera_position, 1, glm::value_ptr(g_camera.position));
-  
-  glUniform3fv(loc_u_light_position, 1, glm::value_ptr(g_light.pos));
-  glUniform3fv(loc_u_light_ambient, 1, glm::value_ptr(g_light.ambient));
-  glUniform3fv(loc_u_light_diffuse, 1, glm::value_ptr(g_light.diffuse));
-  glUniform3fv(loc_u_light_specular, 1, glm::value_ptr(g_light.specular));
-
   // TODO : set mat_model, mat_normal, mat_PVM 
-  // TODO : send uniform data for model to GPU
   glm::mat4 mat_model = glm::mat4(1.0f);
 
   mat_model = mat_model * glm::translate(glm::mat4(1.0f), g_model.translate);
@@ -693,38 +1070,77 @@ void render_object()
 
   glm::mat4 mat_PVM = mat_proj * mat_view * mat_model;
 
-  glUniformMatrix4fv(loc_u_PVM, 1, GL_FALSE, glm::value_ptr(mat_PVM));
-  glUniformMatrix4fv(loc_u_model_matrix, 1, false, glm::value_ptr(mat_model));   
-  glUniformMatrix3fv(loc_u_normal_matrix, 1, false, glm::value_ptr(mat_normal));  
+  bool use_ubo = g_use_ubo && program_ubo != 0;
+
+  // 특정 쉐이더 프로그램 사용
+  glUseProgram(use_ubo ? program_ubo : program);
+
+  if (use_ubo)
+  {
+    // camera & light, model: buffer 하나에 하나씩 upload
+    FrameBlock frame;
+    frame.view_matrix = mat_view;
+    frame.camera_position = glm::vec4(g_camera.position, 1.0f);
+    frame.light_position = glm::vec4(g_light.pos, 0.0f);
+    frame.light_ambient = glm::vec4(g_light.ambient, 0.0f);
+    frame.light_diffuse = glm::vec4(g_light.diffuse, 0.0f);
+    frame.light_specular = glm::vec4(g_light.specular, 0.0f);
+
+    ObjectBlock object;
+    object.PVM = mat_PVM;
+    object.model_matrix = mat_model;
+    for (int c = 0; c < 3; ++c)
+      object.normal_matrix[c] = glm::vec4(mat_normal[c], 0.0f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, g_frame_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameBlock), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_object_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ObjectBlock), &object);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  }
+  else
+  {
+    // TODO : send uniform for camera & light to GPU
+    glUniformMatrix4fv(loc_u_view_matrix, 1, false, glm::value_ptr(mat_view)); 
+    glUniform3fv(loc_u_camera_position, 1, glm::value_ptr(g_camera.position));
+    
+    glUniform3fv(loc_u_light_position, 1, glm::value_ptr(g_light.pos));
+    glUniform3fv(loc_u_light_ambient, 1, glm::value_ptr(g_light.ambient));
+    glUniform3fv(loc_u_light_diffuse, 1, glm::value_ptr(g_light.diffuse));
+    glUniform3fv(loc_u_light_specular, 1, glm::value_ptr(g_light.specular));
+
+    // TODO : send uniform data for model to GPU
+    glUniformMatrix4fv(loc_u_PVM, 1, GL_FALSE, glm::value_ptr(mat_PVM));
+    glUniformMatrix4fv(loc_u_model_matrix, 1, false, glm::value_ptr(mat_model));   
+    glUniformMatrix3fv(loc_u_normal_matrix, 1, false, glm::value_ptr(mat_normal));  
+  }
 
   for (std::size_t i=0; i < g_model.meshes.size(); ++i)
-    draw_mesh(g_model.meshes[i]);
+    draw_mesh(g_model.meshes[i], use_ubo);
 
   // 쉐이더 프로그램 사용해제
+  glBindVertexArray(0);
   glUseProgram(0);
 }
 
-void draw_mesh(Mesh& mesh)
+void draw_mesh(Mesh& mesh, bool use_ubo)
 {
-  glUniform3fv(loc_u_obj_ambient, 1, glm::value_ptr(mesh.material.ambient));
-  glUniform3fv(loc_u_obj_diffuse, 1, glm::value_ptr(mesh.material.diffuse));
-  glUniform3fv(loc_u_obj_specular, 1, glm::value_ptr(mesh.material.specular));
-  glUniform1f(loc_u_obj_shininess, mesh.material.shininess);
-
-
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.position_buffer);
-  glEnableVertexAttribArray(loc_a_position);
-  glVertexAttribPointer(loc_a_position, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+  if (use_ubo)
+  {
+    // uniform 4개 대신 이미 upload된 MaterialBlock 하나를 선택
+    glBindBufferRange(GL_UNIFORM_BUFFER, kMaterialBlockBinding, g_material_ubo, mesh.material_offset, sizeof(MaterialBlock));
+  }
+  else
+  {
+    glUniform3fv(loc_u_obj_ambient, 1, glm::value_ptr(mesh.material.ambient));
+    glUniform3fv(loc_u_obj_diffuse, 1, glm::value_ptr(mesh.material.diffuse));
+    glUniform3fv(loc_u_obj_specular, 1, glm::value_ptr(mesh.material.specular));
+    glUniform1f(loc_u_obj_shininess, mesh.material.shininess);
+  }
 
-  // TODO : bind normal buffer
-  glBindBuffer(GL_ARRAY_BUFFER, mesh.normal_buffer); 
-  glEnableVertexAttribArray(loc_a_normal);
-  glVertexAttribPointer(loc_a_normal, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-  glDrawArrays(GL_TRIANGLES, 0, (GLsizei) mesh.tv_positions.size());
-  
-  glDisableVertexAttribArray(loc_a_position);
-  glDisableVertexAttribArray(loc_a_normal);
+  glBindVertexArray(mesh.vertex_array[g_shading_type]);
+  glDrawElements(GL_TRIANGLES, (GLsizei) mesh.tv_indices.size(), GL_UNSIGNED_INT, (void*)0);
 }
 
 
@@ -0,0 +1,66 @@
+#version 140                  // GLSL 1.40: vertex.glsl with the uniforms in uniform blocks
+
+in vec3 a_position;           // per-vertex position (per-vertex input)
+in vec3 a_normal;
+
+// camera & light: 프레임마다 한 번 (main.cpp의 FrameBlock)
+layout(std140) uniform FrameBlock
+{
+  mat4 u_view_matrix;
+  vec3 u_camera_position;
+  vec3 u_light_position;
+  vec3 u_light_ambient;
+  vec3 u_light_diffuse;
+  vec3 u_light_specular;
+};
+
+// model (ObjectBlock)
+layout(std140) uniform ObjectBlock
+{
+  mat4 u_PVM;
+  mat4 u_model_matrix;
+  mat3 u_normal_matrix;
+};
+
+// mesh material (MaterialBlock): glBindBufferRange()로 mesh마다 선택
+layout(std140) uniform MaterialBlock
+{
+  vec3  u_obj_ambient;
+  vec3  u_obj_diffuse;
+  vec3  u_obj_specular;
+  float u_obj_shininess;
+};
+
+out vec3 v_color;
+
+vec3 directional_light()
+{
+  vec3 color = vec3(0.0);
+  vec3 position_wc = (u_model_matrix * vec4(a_position, 1.0)).xyz;
+  vec3 normal_wc = normalize(u_normal_matrix * a_normal);
+
+  vec3 light_dir = normalize(u_light_position);
+
+  // ambient
+  color += (u_light_ambient * u_obj_ambient);
+
+  // diffuse
+  float ndotl = max(dot(normal_wc, light_dir), 0.0);
+  color += (ndotl * u_light_diffuse * u_obj_diffuse);
+
+  // specular
+  vec3 view_dir = normalize(u_camera_position - position_wc);
+  vec3 reflect_dir = reflect(-light_dir, normal_wc);
+
+  float rdotv = max(dot(view_dir, reflect_dir), 0.0);
+  color += (pow(rdotv, u_obj_shininess) * u_light_specular * u_obj_specular);
+
+  return color;
+}
+
+void main()
+{
+  gl_Position = u_PVM * vec4(a_position, 1.0);
+
+  v_color = directional_light();
+}